@@ -642,7 +642,7 @@ static inline bool cpu_handle_halt(CPUState *cpu)
             return true;
         }
 
-        cpu->halted = 0;
+        qatomic_set(&cpu->halted, 0);
     }
 #endif /* !CONFIG_USER_ONLY */
 
@@ -771,7 +771,7 @@ static inline bool cpu_handle_interrupt(CPUState *cpu,
             interrupt_request &= ~CPU_INTERRUPT_SSTEP_MASK;
         }
         if (interrupt_request & CPU_INTERRUPT_DEBUG) {
-            cpu->interrupt_request &= ~CPU_INTERRUPT_DEBUG;
+            qatomic_and(&cpu->interrupt_request, ~CPU_INTERRUPT_DEBUG);
             cpu->exception_index = EXCP_DEBUG;
             qemu_mutex_unlock_iothread();
             return true;
@@ -781,8 +781,10 @@ static inline bool cpu_handle_interrupt(CPUState *cpu,
             /* Do nothing */
         } else if (interrupt_request & CPU_INTERRUPT_HALT) {
             replay_interrupt();
-            cpu->interrupt_request &= ~CPU_INTERRUPT_HALT;
-            cpu->halted = 1;
+            qatomic_and(&cpu->interrupt_request, ~CPU_INTERRUPT_HALT);
+            qatomic_set(&cpu->halted, 1);
+            /* Pairs with cpu_interrupt_lockless(), as in x86's do_hlt(). */
+            smp_mb();
             cpu->exception_index = EXCP_HLT;
             qemu_mutex_unlock_iothread();
             return true;
@@ -837,7 +839,7 @@ static inline bool cpu_handle_interrupt(CPUState *cpu,
         }
 #endif /* !CONFIG_USER_ONLY */
         if (interrupt_request & CPU_INTERRUPT_EXITTB) {
-            cpu->interrupt_request &= ~CPU_INTERRUPT_EXITTB;
+            qatomic_and(&cpu->interrupt_request, ~CPU_INTERRUPT_EXITTB);
             /* ensure that no TB jump will be modified as
                the program flow was changed */
             *last_tb = NULL;
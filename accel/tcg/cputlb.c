@@ -33,6 +33,7 @@
 #include "qemu/atomic.h"
 #include "qemu/atomic128.h"
 #include "exec/translate-all.h"
+#include "sysemu/dirtylimit.h"
 #include "trace.h"
 #include "tb-hash.h"
 #include "internal.h"
@@ -301,29 +302,33 @@ void tlb_destroy(CPUState *cpu)
     }
 }
 
-/* flush_all_helper: run fn across all cpus
+static void tlb_queue_flush(CPUState *cpu, uint16_t idxmap,
+                            const CPUTLBPendingFlush *d);
+
+/* flush_all_helper: queue a flush on all cpus but src
  *
- * If the wait flag is set then the src cpu's helper will be queued as
- * "safe" work and the loop exited creating a synchronisation point
- * where all queued work will be finished before execution starts
- * again.
+ * The flush is performed by each cpu at its next exit, see
+ * tlb_queue_flush.  If the src cpu's own flush is then queued as
+ * "safe" work, this creates a synchronisation point where all queued
+ * work will be finished before execution starts again.
  */
-static void flush_all_helper(CPUState *src, run_on_cpu_func fn,
-                             run_on_cpu_data d)
+static void flush_all_helper(CPUState *src, uint16_t idxmap,
+                             const CPUTLBPendingFlush *d)
 {
     CPUState *cpu;
 
     CPU_FOREACH(cpu) {
         if (cpu != src) {
-            async_run_on_cpu(cpu, fn, d);
+            tlb_queue_flush(cpu, idxmap, d);
         }
     }
 }
 
-void tlb_flush_counts(size_t *pfull, size_t *ppart, size_t *pelide)
+void tlb_flush_counts(size_t *pfull, size_t *ppart, size_t *pelide,
+                      size_t *pbatch)
 {
     CPUState *cpu;
-    size_t full = 0, part = 0, elide = 0;
+    size_t full = 0, part = 0, elide = 0, batch = 0;
 
     CPU_FOREACH(cpu) {
         CPUArchState *env = cpu->env_ptr;
@@ -331,10 +336,12 @@ void tlb_flush_counts(size_t *pfull, size_t *ppart, size_t *pelide)
         full += qatomic_read(&env_tlb(env)->c.full_flush_count);
         part += qatomic_read(&env_tlb(env)->c.part_flush_count);
         elide += qatomic_read(&env_tlb(env)->c.elide_flush_count);
+        batch += qatomic_read(&env_tlb(env)->c.batch_flush_count);
     }
     *pfull = full;
     *ppart = part;
     *pelide = elide;
+    *pbatch = batch;
 }
 
 static void tlb_flush_by_mmuidx_async_work(CPUState *cpu, run_on_cpu_data data)
@@ -360,10 +367,10 @@ static void tlb_flush_by_mmuidx_async_work(CPUState *cpu, run_on_cpu_data data)
         tlb_flush_one_mmuidx_locked(env, mmu_idx, now);
     }
 
-    qemu_spin_unlock(&env_tlb(env)->c.lock);
-
-    tcg_flush_jmp_cache(cpu);
-
+    /*
+     * Update the statistics with the lock held, since other cpus
+     * account elided flushes in tlb_queue_flush.
+     */
     if (to_clean == ALL_MMUIDX_BITS) {
         qatomic_set(&env_tlb(env)->c.full_flush_count,
                    env_tlb(env)->c.full_flush_count + 1);
@@ -376,6 +383,10 @@ static void tlb_flush_by_mmuidx_async_work(CPUState *cpu, run_on_cpu_data data)
                        ctpop16(asked & ~to_clean));
         }
     }
+
+    qemu_spin_unlock(&env_tlb(env)->c.lock);
+
+    tcg_flush_jmp_cache(cpu);
 }
 
 void tlb_flush_by_mmuidx(CPUState *cpu, uint16_t idxmap)
@@ -383,8 +394,7 @@ void tlb_flush_by_mmuidx(CPUState *cpu, uint16_t idxmap)
     tlb_debug("mmu_idx: 0x%" PRIx16 "\n", idxmap);
 
     if (cpu->created && !qemu_cpu_is_self(cpu)) {
-        async_run_on_cpu(cpu, tlb_flush_by_mmuidx_async_work,
-                         RUN_ON_CPU_HOST_INT(idxmap));
+        tlb_queue_flush(cpu, idxmap, NULL);
     } else {
         tlb_flush_by_mmuidx_async_work(cpu, RUN_ON_CPU_HOST_INT(idxmap));
     }
@@ -401,7 +411,7 @@ void tlb_flush_by_mmuidx_all_cpus(CPUState *src_cpu, uint16_t idxmap)
 
     tlb_debug("mmu_idx: 0x%"PRIx16"\n", idxmap);
 
-    flush_all_helper(src_cpu, fn, RUN_ON_CPU_HOST_INT(idxmap));
+    flush_all_helper(src_cpu, idxmap, NULL);
     fn(src_cpu, RUN_ON_CPU_HOST_INT(idxmap));
 }
 
@@ -416,7 +426,7 @@ void tlb_flush_by_mmuidx_all_cpus_synced(CPUState *src_cpu, uint16_t idxmap)
 
     tlb_debug("mmu_idx: 0x%"PRIx16"\n", idxmap);
 
-    flush_all_helper(src_cpu, fn, RUN_ON_CPU_HOST_INT(idxmap));
+    flush_all_helper(src_cpu, idxmap, NULL);
     async_safe_run_on_cpu(src_cpu, fn, RUN_ON_CPU_HOST_INT(idxmap));
 }
 
@@ -600,22 +610,14 @@ void tlb_flush_page_by_mmuidx(CPUState *cpu, target_ulong addr, uint16_t idxmap)
 
     if (qemu_cpu_is_self(cpu)) {
         tlb_flush_page_by_mmuidx_async_0(cpu, addr, idxmap);
-    } else if (idxmap < TARGET_PAGE_SIZE) {
-        /*
-         * Most targets have only a few mmu_idx.  In the case where
-         * we can stuff idxmap into the low TARGET_PAGE_BITS, avoid
-         * allocating memory for this operation.
-         */
-        async_run_on_cpu(cpu, tlb_flush_page_by_mmuidx_async_1,
-                         RUN_ON_CPU_TARGET_PTR(addr | idxmap));
     } else {
-        TLBFlushPageByMMUIdxData *d = g_new(TLBFlushPageByMMUIdxData, 1);
+        CPUTLBPendingFlush d = {
+            .addr = addr,
+            .len = TARGET_PAGE_SIZE,
+            .bits = TARGET_LONG_BITS,
+        };
 
-        /* Otherwise allocate a structure, freed by the worker.  */
-        d->addr = addr;
-        d->idxmap = idxmap;
-        async_run_on_cpu(cpu, tlb_flush_page_by_mmuidx_async_2,
-                         RUN_ON_CPU_HOST_PTR(d));
+        tlb_queue_flush(cpu, idxmap, &d);
     }
 }
 
@@ -624,6 +626,18 @@ void tlb_flush_page(CPUState *cpu, target_ulong addr)
     tlb_flush_page_by_mmuidx(cpu, addr, ALL_MMUIDX_BITS);
 }
 
+static void flush_page_all_helper(CPUState *src, target_ulong addr,
+                                  uint16_t idxmap)
+{
+    CPUTLBPendingFlush d = {
+        .addr = addr,
+        .len = TARGET_PAGE_SIZE,
+        .bits = TARGET_LONG_BITS,
+    };
+
+    flush_all_helper(src, idxmap, &d);
+}
+
 void tlb_flush_page_by_mmuidx_all_cpus(CPUState *src_cpu, target_ulong addr,
                                        uint16_t idxmap)
 {
@@ -632,30 +646,7 @@ void tlb_flush_page_by_mmuidx_all_cpus(CPUState *src_cpu, target_ulong addr,
     /* This should already be page aligned */
     addr &= TARGET_PAGE_MASK;
 
-    /*
-     * Allocate memory to hold addr+idxmap only when needed.
-     * See tlb_flush_page_by_mmuidx for details.
-     */
-    if (idxmap < TARGET_PAGE_SIZE) {
-        flush_all_helper(src_cpu, tlb_flush_page_by_mmuidx_async_1,
-                         RUN_ON_CPU_TARGET_PTR(addr | idxmap));
-    } else {
-        CPUState *dst_cpu;
-
-        /* Allocate a separate data block for each destination cpu.  */
-        CPU_FOREACH(dst_cpu) {
-            if (dst_cpu != src_cpu) {
-                TLBFlushPageByMMUIdxData *d
-                    = g_new(TLBFlushPageByMMUIdxData, 1);
-
-                d->addr = addr;
-                d->idxmap = idxmap;
-                async_run_on_cpu(dst_cpu, tlb_flush_page_by_mmuidx_async_2,
-                                 RUN_ON_CPU_HOST_PTR(d));
-            }
-        }
-    }
-
+    flush_page_all_helper(src_cpu, addr, idxmap);
     tlb_flush_page_by_mmuidx_async_0(src_cpu, addr, idxmap);
 }
 
@@ -673,30 +664,20 @@ void tlb_flush_page_by_mmuidx_all_cpus_synced(CPUState *src_cpu,
     /* This should already be page aligned */
     addr &= TARGET_PAGE_MASK;
 
+    flush_page_all_helper(src_cpu, addr, idxmap);
+
     /*
-     * Allocate memory to hold addr+idxmap only when needed.
-     * See tlb_flush_page_by_mmuidx for details.
+     * Most targets have only a few mmu_idx.  In the case where
+     * we can stuff idxmap into the low TARGET_PAGE_BITS, avoid
+     * allocating memory for this operation.
      */
     if (idxmap < TARGET_PAGE_SIZE) {
-        flush_all_helper(src_cpu, tlb_flush_page_by_mmuidx_async_1,
-                         RUN_ON_CPU_TARGET_PTR(addr | idxmap));
         async_safe_run_on_cpu(src_cpu, tlb_flush_page_by_mmuidx_async_1,
                               RUN_ON_CPU_TARGET_PTR(addr | idxmap));
     } else {
-        CPUState *dst_cpu;
         TLBFlushPageByMMUIdxData *d;
 
-        /* Allocate a separate data block for each destination cpu.  */
-        CPU_FOREACH(dst_cpu) {
-            if (dst_cpu != src_cpu) {
-                d = g_new(TLBFlushPageByMMUIdxData, 1);
-                d->addr = addr;
-                d->idxmap = idxmap;
-                async_run_on_cpu(dst_cpu, tlb_flush_page_by_mmuidx_async_2,
-                                 RUN_ON_CPU_HOST_PTR(d));
-            }
-        }
-
+        /* Otherwise allocate a structure, freed by the worker.  */
         d = g_new(TLBFlushPageByMMUIdxData, 1);
         d->addr = addr;
         d->idxmap = idxmap;
@@ -760,15 +741,8 @@ static void tlb_flush_range_locked(CPUArchState *env, int midx,
     }
 }
 
-typedef struct {
-    target_ulong addr;
-    target_ulong len;
-    uint16_t idxmap;
-    uint16_t bits;
-} TLBFlushRangeData;
-
 static void tlb_flush_range_by_mmuidx_async_0(CPUState *cpu,
-                                              TLBFlushRangeData d)
+                                              CPUTLBPendingFlush d)
 {
     CPUArchState *env = cpu->env_ptr;
     int mmu_idx;
@@ -809,16 +783,149 @@ static void tlb_flush_range_by_mmuidx_async_0(CPUState *cpu,
 static void tlb_flush_range_by_mmuidx_async_1(CPUState *cpu,
                                               run_on_cpu_data data)
 {
-    TLBFlushRangeData *d = data.host_ptr;
+    CPUTLBPendingFlush *d = data.host_ptr;
     tlb_flush_range_by_mmuidx_async_0(cpu, *d);
     g_free(d);
 }
 
+/**
+ * tlb_flush_pending_async_work:
+ * @cpu: cpu on which to flush
+ * @data: unused
+ *
+ * Perform all of the flushes that other cpus have queued for @cpu
+ * with tlb_queue_flush.  Called through async_run_on_cpu.
+ */
+static void tlb_flush_pending_async_work(CPUState *cpu, run_on_cpu_data data)
+{
+    CPUTLBCommon *c = &env_tlb(cpu->env_ptr)->c;
+    CPUTLBPendingFlush pending[CPU_TLB_PENDING_FLUSHES];
+    uint16_t full;
+    int i, n;
+
+    qemu_spin_lock(&c->lock);
+    full = c->pending_full;
+    n = c->n_pending;
+    memcpy(pending, c->pending, n * sizeof(pending[0]));
+    c->pending_full = 0;
+    c->n_pending = 0;
+    c->pending_queued = false;
+    qemu_spin_unlock(&c->lock);
+
+    if (full) {
+        tlb_flush_by_mmuidx_async_work(cpu, RUN_ON_CPU_HOST_INT(full));
+    }
+    for (i = 0; i < n; i++) {
+        CPUTLBPendingFlush *d = &pending[i];
+
+        /* Nothing left to do for the mmu_idx that were flushed entirely. */
+        d->idxmap &= ~full;
+        if (!d->idxmap) {
+            continue;
+        }
+        if (d->bits >= TARGET_LONG_BITS && d->len == TARGET_PAGE_SIZE) {
+            tlb_flush_page_by_mmuidx_async_0(cpu, d->addr, d->idxmap);
+        } else {
+            tlb_flush_range_by_mmuidx_async_0(cpu, *d);
+        }
+    }
+}
+
+/**
+ * tlb_queue_flush:
+ * @cpu: cpu on which to flush
+ * @idxmap: set of mmu_idx to flush
+ * @d: page or range to flush, or NULL to flush @idxmap entirely
+ *
+ * Queue a flush requested by another cpu.  The flush is added to the
+ * set of pending flushes of @cpu, which it drains with a single work
+ * item at its next exit; only the first flush added to an empty set
+ * queues the work item and kicks @cpu.  Page and range flushes that
+ * do not fit in the set are turned into full flushes of their mmu_idx.
+ *
+ * An mmu_idx that has not been filled since its last full flush has
+ * no entries to remove, so the flush is elided for it altogether.
+ * This is only reliable while @cpu is outside cpu_exec: a running cpu
+ * may be about to install an entry that it walked from the page
+ * tables before the caller updated them.
+ */
+static void tlb_queue_flush(CPUState *cpu, uint16_t idxmap,
+                            const CPUTLBPendingFlush *d)
+{
+    CPUTLBCommon *c = &env_tlb(cpu->env_ptr)->c;
+    uint16_t elide = 0;
+    bool queue = false;
+    int i;
+
+    /*
+     * Order the caller's page table updates before the read of
+     * cpu->running.  Pairs with the barrier in cpu_exec_start.
+     */
+    smp_mb();
+
+    qemu_spin_lock(&c->lock);
+
+    if (!qatomic_read(&cpu->running)) {
+        elide = idxmap & ~c->dirty;
+        idxmap &= ~elide;
+    }
+
+    if (!idxmap) {
+        goto done;
+    }
+
+    if (d) {
+        /* A pending full flush already covers these mmu_idx. */
+        idxmap &= ~c->pending_full;
+        if (!idxmap) {
+            goto batched;
+        }
+        for (i = 0; i < c->n_pending; i++) {
+            CPUTLBPendingFlush *p = &c->pending[i];
+
+            if (p->addr == d->addr && p->len == d->len &&
+                p->bits == d->bits) {
+                p->idxmap |= idxmap;
+                goto batched;
+            }
+        }
+        if (c->n_pending < CPU_TLB_PENDING_FLUSHES) {
+            CPUTLBPendingFlush *p = &c->pending[c->n_pending++];
+
+            *p = *d;
+            p->idxmap = idxmap;
+        } else {
+            c->pending_full |= idxmap;
+        }
+    } else {
+        c->pending_full |= idxmap;
+    }
+
+ batched:
+    if (c->pending_queued) {
+        qatomic_set(&c->batch_flush_count, c->batch_flush_count + 1);
+    } else {
+        c->pending_queued = true;
+        queue = true;
+    }
+
+ done:
+    if (elide) {
+        qatomic_set(&c->elide_flush_count,
+                    c->elide_flush_count + ctpop16(elide));
+    }
+    qemu_spin_unlock(&c->lock);
+
+    if (queue) {
+        async_run_on_cpu(cpu, tlb_flush_pending_async_work, RUN_ON_CPU_NULL);
+    }
+}
+
 void tlb_flush_range_by_mmuidx(CPUState *cpu, target_ulong addr,
                                target_ulong len, uint16_t idxmap,
                                unsigned bits)
 {
-    TLBFlushRangeData d;
+    CPUTLBPendingFlush d;
 
     /*
      * If all bits are significant, and len is small,
@@ -843,10 +950,7 @@ void tlb_flush_range_by_mmuidx(CPUState *cpu, target_ulong addr,
     if (qemu_cpu_is_self(cpu)) {
         tlb_flush_range_by_mmuidx_async_0(cpu, d);
     } else {
-        /* Otherwise allocate a structure, freed by the worker.  */
-        TLBFlushRangeData *p = g_memdup(&d, sizeof(d));
-        async_run_on_cpu(cpu, tlb_flush_range_by_mmuidx_async_1,
-                         RUN_ON_CPU_HOST_PTR(p));
+        tlb_queue_flush(cpu, idxmap, &d);
     }
 }
 
@@ -860,8 +964,7 @@ void tlb_flush_range_by_mmuidx_all_cpus(CPUState *src_cpu,
                                         target_ulong addr, target_ulong len,
                                         uint16_t idxmap, unsigned bits)
 {
-    TLBFlushRangeData d;
-    CPUState *dst_cpu;
+    CPUTLBPendingFlush d;
 
     /*
      * If all bits are significant, and len is small,
@@ -883,16 +986,7 @@ void tlb_flush_range_by_mmuidx_all_cpus(CPUState *src_cpu,
     d.idxmap = idxmap;
     d.bits = bits;
 
-    /* Allocate a separate data block for each destination cpu.  */
-    CPU_FOREACH(dst_cpu) {
-        if (dst_cpu != src_cpu) {
-            TLBFlushRangeData *p = g_memdup(&d, sizeof(d));
-            async_run_on_cpu(dst_cpu,
-                             tlb_flush_range_by_mmuidx_async_1,
-                             RUN_ON_CPU_HOST_PTR(p));
-        }
-    }
-
+    flush_all_helper(src_cpu, idxmap, &d);
     tlb_flush_range_by_mmuidx_async_0(src_cpu, d);
 }
 
@@ -910,8 +1004,7 @@ void tlb_flush_range_by_mmuidx_all_cpus_synced(CPUState *src_cpu,
                                                uint16_t idxmap,
                                                unsigned bits)
 {
-    TLBFlushRangeData d, *p;
-    CPUState *dst_cpu;
+    CPUTLBPendingFlush d, *p;
 
     /*
      * If all bits are significant, and len is small,
@@ -933,14 +1026,7 @@ void tlb_flush_range_by_mmuidx_all_cpus_synced(CPUState *src_cpu,
     d.idxmap = idxmap;
     d.bits = bits;
 
-    /* Allocate a separate data block for each destination cpu.  */
-    CPU_FOREACH(dst_cpu) {
-        if (dst_cpu != src_cpu) {
-            p = g_memdup(&d, sizeof(d));
-            async_run_on_cpu(dst_cpu, tlb_flush_range_by_mmuidx_async_1,
-                             RUN_ON_CPU_HOST_PTR(p));
-        }
-    }
+    flush_all_helper(src_cpu, idxmap, &d);
 
     p = g_memdup(&d, sizeof(d));
     async_safe_run_on_cpu(src_cpu, tlb_flush_range_by_mmuidx_async_1,
@@ -1371,7 +1457,9 @@ static uint64_t io_readx(CPUArchState *env, CPUTLBEntryFull *full,
         cpu_io_recompile(cpu, retaddr);
     }
 
-    {
+    if (!mr->global_locking) {
+        r = memory_region_dispatch_read(mr, mr_offset, &val, op, full->attrs);
+    } else {
         QEMU_IOTHREAD_LOCK_GUARD();
         r = memory_region_dispatch_read(mr, mr_offset, &val, op, full->attrs);
     }
@@ -1426,7 +1514,9 @@ static void io_writex(CPUArchState *env, CPUTLBEntryFull *full,
      */
     save_iotlb_data(cpu, section, mr_offset);
 
-    {
+    if (!mr->global_locking) {
+        r = memory_region_dispatch_write(mr, mr_offset, val, op, full->attrs);
+    } else {
         QEMU_IOTHREAD_LOCK_GUARD();
         r = memory_region_dispatch_write(mr, mr_offset, val, op, full->attrs);
     }
@@ -1507,9 +1597,16 @@ static void notdirty_write(CPUState *cpu, vaddr mem_vaddr, unsigned size,
         tb_invalidate_phys_range_fast(ram_addr, size, retaddr);
     }
 
+    /* Account the page to this vCPU for the dirty page rate limit. */
+    if (unlikely(global_dirty_tracking & GLOBAL_DIRTY_LIMIT) &&
+        !cpu_physical_memory_get_dirty_flag(ram_addr,
+                                            DIRTY_MEMORY_DIRTY_LIMIT)) {
+        dirtylimit_tcg_page_dirtied(cpu);
+    }
+
     /*
-     * Set both VGA and migration bits for simplicity and to remove
-     * the notdirty callback faster.
+     * Set all bits but code for simplicity and to remove the notdirty
+     * callback faster.
      */
     cpu_physical_memory_set_dirty_range(ram_addr, size, DIRTY_CLIENTS_NOCODE);
 
@@ -30,8 +30,12 @@
 #include "qemu/main-loop.h"
 #include "qemu/notify.h"
 #include "qemu/guest-random.h"
+#include "qemu/stats64.h"
+#include "qemu/timer.h"
+#include "qemu/processor.h"
 #include "exec/exec-all.h"
 #include "hw/boards.h"
+#include "sysemu/stats.h"
 
 #include "tcg-accel-ops.h"
 #include "tcg-accel-ops-mttcg.h"
@@ -56,6 +60,218 @@ static void mttcg_force_rcu(Notifier *notify, void *data)
     async_run_on_cpu(cpu, do_nothing, RUN_ON_CPU_NULL);
 }
 
+/*
+ * Halt polling
+ *
+ * Waking a sleeping vCPU thread costs a futex wakeup and a reschedule
+ * on the host, which dominates the latency of guest IPIs and of short
+ * I/O completions.  When the guest halts we can instead spin for a
+ * while without the BQL, waiting for a kick.  As in KVM the polling
+ * window adapts to the observed halt durations: it grows while halts
+ * end shortly after they start, and shrinks when they overrun the
+ * maximum.  Polling never takes more than mttcg_halt_poll_budget
+ * percent of each second of a vCPU thread's time.
+ */
+
+#define HALT_POLL_START_NS      (10 * SCALE_US)
+#define HALT_POLL_PERIOD_NS     NANOSECONDS_PER_SECOND
+
+typedef struct MttcgHaltPoll {
+    uint32_t window_ns;
+    int64_t period_start;
+    int64_t period_poll_ns;
+
+    /* Updated by the vCPU thread, read by query-stats. */
+    Stat64 attempted_poll;
+    Stat64 successful_poll;
+    Stat64 wakeup;
+    Stat64 poll_success_ns;
+    Stat64 poll_fail_ns;
+    Stat64 wait_ns;
+} MttcgHaltPoll;
+
+static bool mttcg_halt_poll_allowed(MttcgHaltPoll *hp, int64_t now)
+{
+    if (now - hp->period_start >= HALT_POLL_PERIOD_NS) {
+        hp->period_start = now;
+        hp->period_poll_ns = 0;
+    }
+    return hp->period_poll_ns <
+           HALT_POLL_PERIOD_NS / 100 * mttcg_halt_poll_budget;
+}
+
+static void mttcg_halt_poll_adjust(MttcgHaltPoll *hp, int64_t block_ns)
+{
+    uint32_t window = hp->window_ns;
+
+    if (block_ns <= window) {
+        return;
+    }
+    if (window && block_ns > mttcg_halt_poll_ns) {
+        /* long halt, polling was a waste of time */
+        window /= 2;
+    } else if (window < mttcg_halt_poll_ns && block_ns < mttcg_halt_poll_ns) {
+        /* short halt that the window did not cover */
+        window = window ? window * 2 : HALT_POLL_START_NS;
+        window = MIN(window, mttcg_halt_poll_ns);
+    }
+    qatomic_set(&hp->window_ns, window);
+}
+
+/*
+ * Like qemu_wait_io_event(), but poll for a while before sleeping if the
+ * vCPU is halted.  Everything that can end a halt (interrupts, queued work,
+ * stop requests) kicks the vCPU, which sets exit_request; that is the only
+ * thing we have to watch while polling without the BQL.
+ */
+static void mttcg_wait_io_event(CPUState *cpu)
+{
+    MttcgHaltPoll *hp = cpu->tcg_halt_poll;
+    uint32_t window = hp->window_ns;
+    bool woken = false;
+    int64_t start, now;
+
+    if (!mttcg_halt_poll_ns || !cpu->halted || cpu_is_stopped(cpu) ||
+        !cpu_thread_is_idle(cpu)) {
+        qemu_wait_io_event(cpu);
+        return;
+    }
+
+    start = now = get_clock();
+    if (window && mttcg_halt_poll_allowed(hp, start)) {
+        stat64_add(&hp->attempted_poll, 1);
+        qemu_mutex_unlock_iothread();
+        while (!qatomic_read(&cpu->exit_request) && now - start < window) {
+            cpu_relax();
+            now = get_clock();
+        }
+        qemu_mutex_lock_iothread();
+
+        hp->period_poll_ns += now - start;
+        woken = !cpu_thread_is_idle(cpu);
+        if (woken) {
+            stat64_add(&hp->successful_poll, 1);
+            stat64_add(&hp->poll_success_ns, now - start);
+        } else {
+            stat64_add(&hp->poll_fail_ns, now - start);
+        }
+    }
+
+    qemu_wait_io_event(cpu);
+    if (!woken) {
+        int64_t end = get_clock();
+
+        stat64_add(&hp->wakeup, 1);
+        stat64_add(&hp->wait_ns, end - now);
+        now = end;
+    }
+    mttcg_halt_poll_adjust(hp, now - start);
+}
+
+static const struct {
+    const char *name;
+    size_t offset;
+    bool ns;
+} mttcg_halt_poll_stats[] = {
+    { "halt_attempted_poll", offsetof(MttcgHaltPoll, attempted_poll), false },
+    { "halt_successful_poll", offsetof(MttcgHaltPoll, successful_poll), false },
+    { "halt_wakeup", offsetof(MttcgHaltPoll, wakeup), false },
+    { "halt_poll_success_ns", offsetof(MttcgHaltPoll, poll_success_ns), true },
+    { "halt_poll_fail_ns", offsetof(MttcgHaltPoll, poll_fail_ns), true },
+    { "halt_wait_ns", offsetof(MttcgHaltPoll, wait_ns), true },
+};
+
+static StatsList *add_mttcg_stat(StatsList *list, strList *names,
+                                 const char *name, uint64_t value)
+{
+    Stats *stats;
+
+    if (!apply_str_list_filter(name, names)) {
+        return list;
+    }
+    stats = g_new0(Stats, 1);
+    stats->name = g_strdup(name);
+    stats->value = g_new0(StatsValue, 1);
+    stats->value->type = QTYPE_QNUM;
+    stats->value->u.scalar = value;
+    QAPI_LIST_PREPEND(list, stats);
+    return list;
+}
+
+static void mttcg_query_stats(StatsResultList **result, StatsTarget target,
+                              strList *names, strList *targets, Error **errp)
+{
+    CPUState *cpu;
+    int i;
+
+    if (target != STATS_TARGET_VCPU) {
+        return;
+    }
+
+    CPU_FOREACH(cpu) {
+        MttcgHaltPoll *hp = cpu->tcg_halt_poll;
+        StatsList *stats_list = NULL;
+
+        if (!hp ||
+            !apply_str_list_filter(cpu->parent_obj.canonical_path, targets)) {
+            continue;
+        }
+        for (i = 0; i < ARRAY_SIZE(mttcg_halt_poll_stats); i++) {
+            Stat64 *stat = (void *)hp + mttcg_halt_poll_stats[i].offset;
+
+            stats_list = add_mttcg_stat(stats_list, names,
+                                        mttcg_halt_poll_stats[i].name,
+                                        stat64_get(stat));
+        }
+        stats_list = add_mttcg_stat(stats_list, names, "halt_poll_ns",
+                                    qatomic_read(&hp->window_ns));
+        if (stats_list) {
+            add_stats_entry(result, STATS_PROVIDER_TCG,
+                            cpu->parent_obj.canonical_path, stats_list);
+        }
+    }
+}
+
+static StatsSchemaValueList *add_mttcg_schema(StatsSchemaValueList *list,
+                                              const char *name,
+                                              StatsType type, bool ns)
+{
+    StatsSchemaValue *value = g_new0(StatsSchemaValue, 1);
+
+    value->name = g_strdup(name);
+    value->type = type;
+    if (ns) {
+        value->has_unit = true;
+        value->unit = STATS_UNIT_SECONDS;
+        value->has_base = true;
+        value->base = 10;
+        value->exponent = -9;
+    }
+    QAPI_LIST_PREPEND(list, value);
+    return list;
+}
+
+static void mttcg_query_stats_schemas(StatsSchemaList **result, Error **errp)
+{
+    StatsSchemaValueList *stats_list = NULL;
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(mttcg_halt_poll_stats); i++) {
+        stats_list = add_mttcg_schema(stats_list, mttcg_halt_poll_stats[i].name,
+                                      STATS_TYPE_CUMULATIVE,
+                                      mttcg_halt_poll_stats[i].ns);
+    }
+    stats_list = add_mttcg_schema(stats_list, "halt_poll_ns",
+                                  STATS_TYPE_INSTANT, true);
+    add_stats_schema(result, STATS_PROVIDER_TCG, STATS_TARGET_VCPU, stats_list);
+}
+
+void mttcg_register_stats(void)
+{
+    add_stats_callbacks(STATS_PROVIDER_TCG, mttcg_query_stats,
+                        mttcg_query_stats_schemas);
+}
+
 /*
  * In the multi-threaded case each vCPU has its own thread. The TLS
  * variable current_cpu can be used deep in the code to find the
@@ -120,9 +336,11 @@ static void *mttcg_cpu_thread_fn(void *arg)
         }
 
         qatomic_mb_set(&cpu->exit_request, 0);
-        qemu_wait_io_event(cpu);
+        mttcg_wait_io_event(cpu);
     } while (!cpu->unplug || cpu_can_run(cpu));
 
+    g_free(cpu->tcg_halt_poll);
+    cpu->tcg_halt_poll = NULL;
     tcg_cpus_destroy(cpu);
     qemu_mutex_unlock_iothread();
     rcu_remove_force_rcu_notifier(&force_rcu.notifier);
@@ -145,6 +363,7 @@ void mttcg_start_vcpu_thread(CPUState *cpu)
     cpu->thread = g_new0(QemuThread, 1);
     cpu->halt_cond = g_malloc0(sizeof(QemuCond));
     qemu_cond_init(cpu->halt_cond);
+    cpu->tcg_halt_poll = g_new0(MttcgHaltPoll, 1);
 
     /* create a thread per vCPU with TCG (MTTCG) */
     snprintf(thread_name, VCPU_THREAD_NAME_SIZE, "CPU %d/TCG",
@@ -10,10 +10,21 @@
 #ifndef TCG_ACCEL_OPS_MTTCG_H
 #define TCG_ACCEL_OPS_MTTCG_H
 
+/*
+ * Halt polling: upper bound of the polling window in nanoseconds (0
+ * disables polling), and the percentage of each second a vCPU thread
+ * may spend polling.  Set from the accelerator properties.
+ */
+extern uint32_t mttcg_halt_poll_ns;
+extern uint32_t mttcg_halt_poll_budget;
+
 /* kick MTTCG vCPU thread */
 void mttcg_kick_vcpu_thread(CPUState *cpu);
 
 /* start an mttcg vCPU thread */
 void mttcg_start_vcpu_thread(CPUState *cpu);
 
+/* register the halt polling statistics with query-stats */
+void mttcg_register_stats(void);
+
 #endif /* TCG_ACCEL_OPS_MTTCG_H */
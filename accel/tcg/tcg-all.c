@@ -35,6 +35,7 @@
 #include "qemu/units.h"
 #if !defined(CONFIG_USER_ONLY)
 #include "hw/boards.h"
+#include "tcg-accel-ops-mttcg.h"
 #endif
 #include "internal.h"
 
@@ -44,6 +45,8 @@ struct TCGState {
     bool mttcg_enabled;
     int splitwx_enabled;
     unsigned long tb_size;
+    uint32_t halt_poll_ns;
+    uint32_t halt_poll_budget;
 };
 typedef struct TCGState TCGState;
 
@@ -106,9 +109,15 @@ static void tcg_accel_instance_init(Object *obj)
 #else
     s->splitwx_enabled = 0;
 #endif
+
+    s->halt_poll_budget = 10;
 }
 
 bool mttcg_enabled;
+#ifndef CONFIG_USER_ONLY
+uint32_t mttcg_halt_poll_ns;
+uint32_t mttcg_halt_poll_budget;
+#endif
 
 static int tcg_init_machine(MachineState *ms)
 {
@@ -121,6 +130,10 @@ static int tcg_init_machine(MachineState *ms)
 
     tcg_allowed = true;
     mttcg_enabled = s->mttcg_enabled;
+#ifndef CONFIG_USER_ONLY
+    mttcg_halt_poll_ns = s->halt_poll_ns;
+    mttcg_halt_poll_budget = s->halt_poll_budget;
+#endif
 
     page_init();
     tb_htable_init();
@@ -196,6 +209,60 @@ static void tcg_set_tb_size(Object *obj, Visitor *v,
     s->tb_size = value;
 }
 
+#ifndef CONFIG_USER_ONLY
+static void tcg_get_halt_poll_ns(Object *obj, Visitor *v,
+                                 const char *name, void *opaque,
+                                 Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value = s->halt_poll_ns;
+
+    visit_type_uint32(v, name, &value, errp);
+}
+
+static void tcg_set_halt_poll_ns(Object *obj, Visitor *v,
+                                 const char *name, void *opaque,
+                                 Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value;
+
+    if (!visit_type_uint32(v, name, &value, errp)) {
+        return;
+    }
+
+    s->halt_poll_ns = value;
+}
+
+static void tcg_get_halt_poll_budget(Object *obj, Visitor *v,
+                                     const char *name, void *opaque,
+                                     Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value = s->halt_poll_budget;
+
+    visit_type_uint32(v, name, &value, errp);
+}
+
+static void tcg_set_halt_poll_budget(Object *obj, Visitor *v,
+                                     const char *name, void *opaque,
+                                     Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value;
+
+    if (!visit_type_uint32(v, name, &value, errp)) {
+        return;
+    }
+    if (value > 100) {
+        error_setg(errp, "halt-poll-budget must be a percentage (0-100)");
+        return;
+    }
+
+    s->halt_poll_budget = value;
+}
+#endif
+
 static bool tcg_get_splitwx(Object *obj, Error **errp)
 {
     TCGState *s = TCG_STATE(obj);
@@ -245,6 +312,20 @@ static void tcg_accel_class_init(ObjectClass *oc, void *data)
         tcg_get_splitwx, tcg_set_splitwx);
     object_class_property_set_description(oc, "split-wx",
         "Map jit pages into separate RW and RX regions");
+
+#ifndef CONFIG_USER_ONLY
+    object_class_property_add(oc, "halt-poll-ns", "uint32",
+        tcg_get_halt_poll_ns, tcg_set_halt_poll_ns,
+        NULL, NULL);
+    object_class_property_set_description(oc, "halt-poll-ns",
+        "Maximum time a halted MTTCG vCPU polls for wakeups before sleeping");
+
+    object_class_property_add(oc, "halt-poll-budget", "uint32",
+        tcg_get_halt_poll_budget, tcg_set_halt_poll_budget,
+        NULL, NULL);
+    object_class_property_set_description(oc, "halt-poll-budget",
+        "Percentage of host CPU time a vCPU may spend halt polling");
+#endif
 }
 
 static const TypeInfo tcg_accel_type = {
@@ -24,6 +24,9 @@
 #include "qemu/osdep.h"
 #include "sysemu/cryptodev.h"
 #include "qapi/error.h"
+#include "qemu/thread.h"
+#include "block/aio.h"
+#include "block/thread-pool.h"
 #include "standard-headers/linux/virtio_crypto.h"
 #include "crypto/cipher.h"
 #include "crypto/akcipher.h"
@@ -44,6 +47,10 @@ typedef struct CryptoDevBackendBuiltinSession {
     uint8_t direction; /* encryption or decryption */
     uint8_t type; /* cipher? hash? aead? */
     QCryptoAkCipher *akcipher;
+    /* Serializes operations, the cipher object holds the IV */
+    QemuMutex mutex;
+    /* One for the session table, one for each operation in flight */
+    unsigned int refcnt;
     QTAILQ_ENTRY(CryptoDevBackendBuiltinSession) next;
 } CryptoDevBackendBuiltinSession;
 
@@ -53,31 +60,60 @@ typedef struct CryptoDevBackendBuiltinSession {
 #define CRYPTODEV_BUITLIN_MAX_AUTH_KEY_LEN    512
 #define CRYPTODEV_BUITLIN_MAX_CIPHER_KEY_LEN  64
 
+/* Max number of operations handed to a worker thread at once */
+#define CRYPTODEV_BUILTIN_BATCH_SIZE 32
+
+typedef struct CryptoDevBackendBuiltinTask {
+    CryptoDevBackendBuiltinSession *sess;
+    CryptoDevBackendOpInfo *op_info;
+    CryptoDevCompletionFunc cb;
+    void *opaque;
+    int status;
+} CryptoDevBackendBuiltinTask;
+
+typedef struct CryptoDevBackendBuiltinBatch {
+    struct CryptoDevBackendBuiltin *builtin;
+    uint32_t queue_index;
+    unsigned int count;
+    CryptoDevBackendBuiltinTask tasks[CRYPTODEV_BUILTIN_BATCH_SIZE];
+} CryptoDevBackendBuiltinBatch;
+
+/*
+ * Sessions are created, looked up and released in the AioContext that
+ * the queues of the frontend run in.  Only the cipher operations run
+ * in the worker threads of that context's thread pool.
+ */
 struct CryptoDevBackendBuiltin {
     CryptoDevBackend parent_obj;
 
     CryptoDevBackendBuiltinSession *sessions[MAX_NUM_SESSIONS];
+
+    /* Batch that is still accepting operations, for each queue */
+    CryptoDevBackendBuiltinBatch *batch[MAX_CRYPTO_QUEUE_NUM];
 };
 
 static void cryptodev_builtin_init(
              CryptoDevBackend *backend, Error **errp)
 {
-    /* Only support one queue */
     int queues = backend->conf.peers.queues;
     CryptoDevBackendClient *cc;
+    int i;
 
-    if (queues != 1) {
+    if (queues > MAX_CRYPTO_QUEUE_NUM) {
         error_setg(errp,
-                  "Only support one queue in cryptdov-builtin backend");
+                  "Only support up to %d queues in cryptodev-builtin backend",
+                  MAX_CRYPTO_QUEUE_NUM);
         return;
     }
 
-    cc = cryptodev_backend_new_client(
-              "cryptodev-builtin", NULL);
-    cc->info_str = g_strdup_printf("cryptodev-builtin0");
-    cc->queue_index = 0;
-    cc->type = CRYPTODEV_BACKEND_TYPE_BUILTIN;
-    backend->conf.peers.ccs[0] = cc;
+    for (i = 0; i < queues; i++) {
+        cc = cryptodev_backend_new_client(
+                  "cryptodev-builtin", NULL);
+        cc->info_str = g_strdup_printf("cryptodev-builtin%d", i);
+        cc->queue_index = i;
+        cc->type = CRYPTODEV_BACKEND_TYPE_BUILTIN;
+        backend->conf.peers.ccs[i] = cc;
+    }
 
     backend->conf.crypto_services =
                          1u << VIRTIO_CRYPTO_SERVICE_CIPHER |
@@ -287,6 +323,8 @@ static int cryptodev_builtin_create_cipher_session(
     sess->cipher = cipher;
     sess->direction = sess_info->direction;
     sess->type = sess_info->op_type;
+    qemu_mutex_init(&sess->mutex);
+    sess->refcnt = 1;
 
     builtin->sessions[index] = sess;
 
@@ -349,6 +387,8 @@ static int cryptodev_builtin_create_akcipher_session(
 
     sess = g_new0(CryptoDevBackendBuiltinSession, 1);
     sess->akcipher = akcipher;
+    qemu_mutex_init(&sess->mutex);
+    sess->refcnt = 1;
 
     builtin->sessions[index] = sess;
 
@@ -405,6 +445,23 @@ static int cryptodev_builtin_create_session(
     return 0;
 }
 
+static void cryptodev_builtin_session_unref(
+                 CryptoDevBackendBuiltinSession *session)
+{
+    if (--session->refcnt > 0) {
+        return;
+    }
+
+    if (session->cipher) {
+        qcrypto_cipher_free(session->cipher);
+    } else if (session->akcipher) {
+        qcrypto_akcipher_free(session->akcipher);
+    }
+
+    qemu_mutex_destroy(&session->mutex);
+    g_free(session);
+}
+
 static int cryptodev_builtin_close_session(
            CryptoDevBackend *backend,
            uint64_t session_id,
@@ -418,15 +475,10 @@ static int cryptodev_builtin_close_session(
 
     assert(session_id < MAX_NUM_SESSIONS && builtin->sessions[session_id]);
 
+    /* Operations still in flight keep the session alive until they finish */
     session = builtin->sessions[session_id];
-    if (session->cipher) {
-        qcrypto_cipher_free(session->cipher);
-    } else if (session->akcipher) {
-        qcrypto_akcipher_free(session->akcipher);
-    }
-
-    g_free(session);
     builtin->sessions[session_id] = NULL;
+    cryptodev_builtin_session_unref(session);
     if (cb) {
         cb(opaque, VIRTIO_CRYPTO_OK);
     }
@@ -526,6 +578,77 @@ static int cryptodev_builtin_asym_operation(
     return VIRTIO_CRYPTO_OK;
 }
 
+static int cryptodev_builtin_do_task(CryptoDevBackendBuiltinTask *task)
+{
+    CryptoDevBackendBuiltinSession *sess = task->sess;
+    CryptoDevBackendOpInfo *op_info = task->op_info;
+    int status = -VIRTIO_CRYPTO_ERR;
+    Error *local_error = NULL;
+
+    qemu_mutex_lock(&sess->mutex);
+    if (op_info->algtype == CRYPTODEV_BACKEND_ALG_SYM) {
+        status = cryptodev_builtin_sym_operation(sess, op_info->u.sym_op_info,
+                                                 &local_error);
+    } else if (op_info->algtype == CRYPTODEV_BACKEND_ALG_ASYM) {
+        status = cryptodev_builtin_asym_operation(sess, op_info->op_code,
+                                                  op_info->u.asym_op_info,
+                                                  &local_error);
+    }
+    qemu_mutex_unlock(&sess->mutex);
+
+    if (local_error) {
+        error_report_err(local_error);
+    }
+    return status;
+}
+
+/* Worker thread: run all operations of a batch */
+static int cryptodev_builtin_batch_run(void *opaque)
+{
+    CryptoDevBackendBuiltinBatch *batch = opaque;
+    unsigned int i;
+
+    for (i = 0; i < batch->count; i++) {
+        batch->tasks[i].status = cryptodev_builtin_do_task(&batch->tasks[i]);
+    }
+    return 0;
+}
+
+static void cryptodev_builtin_batch_complete(void *opaque, int ret)
+{
+    CryptoDevBackendBuiltinBatch *batch = opaque;
+    unsigned int i;
+
+    for (i = 0; i < batch->count; i++) {
+        CryptoDevBackendBuiltinTask *task = &batch->tasks[i];
+
+        if (task->cb) {
+            task->cb(task->opaque, task->status);
+        }
+        cryptodev_builtin_session_unref(task->sess);
+    }
+    g_free(batch);
+}
+
+/*
+ * Bottom half scheduled when the first operation is added to a batch, so
+ * that everything the frontend submits before returning to the event loop
+ * goes to the thread pool as a single work item.
+ */
+static void cryptodev_builtin_batch_submit(void *opaque)
+{
+    CryptoDevBackendBuiltinBatch *batch = opaque;
+    CryptoDevBackendBuiltin *builtin = batch->builtin;
+    AioContext *ctx = qemu_get_current_aio_context();
+
+    if (builtin->batch[batch->queue_index] == batch) {
+        builtin->batch[batch->queue_index] = NULL;
+    }
+    thread_pool_submit_aio(aio_get_thread_pool(ctx),
+                           cryptodev_builtin_batch_run, batch,
+                           cryptodev_builtin_batch_complete, batch);
+}
+
 static int cryptodev_builtin_operation(
                  CryptoDevBackend *backend,
                  CryptoDevBackendOpInfo *op_info,
@@ -536,35 +659,45 @@ static int cryptodev_builtin_operation(
     CryptoDevBackendBuiltin *builtin =
                       CRYPTODEV_BACKEND_BUILTIN(backend);
     CryptoDevBackendBuiltinSession *sess;
-    CryptoDevBackendSymOpInfo *sym_op_info;
-    CryptoDevBackendAsymOpInfo *asym_op_info;
+    CryptoDevBackendBuiltinBatch *batch;
+    CryptoDevBackendBuiltinTask *task;
     enum CryptoDevBackendAlgType algtype = op_info->algtype;
-    int status = -VIRTIO_CRYPTO_ERR;
-    Error *local_error = NULL;
 
     if (op_info->session_id >= MAX_NUM_SESSIONS ||
               builtin->sessions[op_info->session_id] == NULL) {
-        error_setg(&local_error, "Cannot find a valid session id: %" PRIu64 "",
-                   op_info->session_id);
+        error_report("Cannot find a valid session id: %" PRIu64 "",
+                     op_info->session_id);
         return -VIRTIO_CRYPTO_INVSESS;
     }
 
-    sess = builtin->sessions[op_info->session_id];
-    if (algtype == CRYPTODEV_BACKEND_ALG_SYM) {
-        sym_op_info = op_info->u.sym_op_info;
-        status = cryptodev_builtin_sym_operation(sess, sym_op_info,
-                                                 &local_error);
-    } else if (algtype == CRYPTODEV_BACKEND_ALG_ASYM) {
-        asym_op_info = op_info->u.asym_op_info;
-        status = cryptodev_builtin_asym_operation(sess, op_info->op_code,
-                                                  asym_op_info, &local_error);
+    if (algtype != CRYPTODEV_BACKEND_ALG_SYM &&
+        algtype != CRYPTODEV_BACKEND_ALG_ASYM) {
+        return -VIRTIO_CRYPTO_NOTSUPP;
     }
 
-    if (local_error) {
-        error_report_err(local_error);
+    assert(queue_index < backend->conf.peers.queues);
+    batch = builtin->batch[queue_index];
+    if (!batch) {
+        batch = g_new0(CryptoDevBackendBuiltinBatch, 1);
+        batch->builtin = builtin;
+        batch->queue_index = queue_index;
+        builtin->batch[queue_index] = batch;
+        aio_bh_schedule_oneshot(qemu_get_current_aio_context(),
+                                cryptodev_builtin_batch_submit, batch);
     }
-    if (cb) {
-        cb(opaque, status);
+
+    sess = builtin->sessions[op_info->session_id];
+    sess->refcnt++;
+
+    task = &batch->tasks[batch->count++];
+    task->sess = sess;
+    task->op_info = op_info;
+    task->cb = cb;
+    task->opaque = opaque;
+
+    /* Full, the next operation starts a new batch */
+    if (batch->count == CRYPTODEV_BUILTIN_BATCH_SIZE) {
+        builtin->batch[queue_index] = NULL;
     }
     return 0;
 }
@@ -576,7 +709,7 @@ static void cryptodev_builtin_cleanup(
     CryptoDevBackendBuiltin *builtin =
                       CRYPTODEV_BACKEND_BUILTIN(backend);
     size_t i;
-    int queues = backend->conf.peers.queues;
+    int queues = MIN(backend->conf.peers.queues, MAX_CRYPTO_QUEUE_NUM);
     CryptoDevBackendClient *cc;
 
     for (i = 0; i < MAX_NUM_SESSIONS; i++) {
@@ -585,6 +718,10 @@ static void cryptodev_builtin_cleanup(
         }
     }
 
+    for (i = 0; i < MAX_CRYPTO_QUEUE_NUM; i++) {
+        assert(!builtin->batch[i]);
+    }
+
     for (i = 0; i < queues; i++) {
         cc = backend->conf.peers.ccs[i];
         if (cc) {
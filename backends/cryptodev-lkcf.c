@@ -25,6 +25,7 @@
 #include "crypto/cipher.h"
 #include "crypto/akcipher.h"
 #include "qapi/error.h"
+#include "block/aio-wait.h"
 #include "qemu/main-loop.h"
 #include "qemu/thread.h"
 #include "qemu/error-report.h"
@@ -261,6 +262,7 @@ static void cryptodev_lkcf_cleanup(CryptoDevBackend *backend, Error **errp)
     qemu_mutex_unlock(&lkcf->mutex);
     qemu_cond_broadcast(&lkcf->cond);
 
+    qemu_set_fd_handler(lkcf->eventfd, NULL, NULL, NULL);
     close(lkcf->eventfd);
     for (i = 0; i < NR_WORKER_THREAD; i++) {
         qemu_thread_join(&lkcf->worker_threads[i]);
@@ -437,6 +439,11 @@ out:
 
     if (kick) {
         eventfd_write(task->lkcf->eventfd, 1);
+        /*
+         * The eventfd is only watched by the iohandler context, so also
+         * wake up anybody waiting in AIO_WAIT_WHILE() for the response.
+         */
+        aio_wait_kick();
     }
 }
 
@@ -1462,13 +1462,13 @@ int blk_make_zero(BlockBackend *blk, BdrvRequestFlags flags)
 void blk_inc_in_flight(BlockBackend *blk)
 {
     IO_CODE();
-    qatomic_inc(&blk->in_flight);
+    bdrv_busy_inc(&blk->in_flight);
 }
 
 void blk_dec_in_flight(BlockBackend *blk)
 {
     IO_CODE();
-    qatomic_dec(&blk->in_flight);
+    bdrv_busy_dec(&blk->in_flight);
     aio_wait_kick();
 }
 
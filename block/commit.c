@@ -22,6 +22,7 @@
 #include "qemu/ratelimit.h"
 #include "qemu/memalign.h"
 #include "sysemu/block-backend.h"
+#include "block/aio_task.h"
 
 enum {
     /*
@@ -30,6 +31,15 @@ enum {
      * contiguous regions of the image is efficient.
      */
     COMMIT_BUFFER_SIZE = 512 * 1024, /* in bytes */
+
+    /*
+     * The buffer size doubles with every chunk that is committed
+     * successfully, up to this limit.
+     */
+    COMMIT_MAX_BUFFER_SIZE = 8 * 1024 * 1024, /* in bytes */
+
+    /* Maximum number of chunks that are committed in parallel */
+    COMMIT_MAX_WORKERS = 8,
 };
 
 typedef struct CommitBlockJob {
@@ -43,8 +53,24 @@ typedef struct CommitBlockJob {
     bool base_read_only;
     bool chain_frozen;
     char *backing_file_str;
+
+    int64_t chunk;          /* current buffer size, in bytes */
 } CommitBlockJob;
 
+typedef struct CommitChunk {
+    int64_t offset;
+    int64_t bytes;
+    bool done;              /* committed successfully */
+    int ret;                /* result of the last attempt to commit it */
+    bool error_in_source;   /* whether that attempt failed reading from top */
+} CommitChunk;
+
+typedef struct CommitTask {
+    AioTask task;
+    CommitBlockJob *s;
+    CommitChunk *chunk;
+} CommitTask;
+
 static int commit_prepare(Job *job)
 {
     CommitBlockJob *s = container_of(job, CommitBlockJob, common.job);
@@ -113,14 +139,64 @@ static void commit_clean(Job *job)
     blk_unref(s->top);
 }
 
+static coroutine_fn int commit_task_entry(AioTask *task)
+{
+    CommitTask *t = container_of(task, CommitTask, task);
+    CommitBlockJob *s = t->s;
+    CommitChunk *c = t->chunk;
+    void *buf;
+    int ret;
+
+    assert(c->bytes < SIZE_MAX);
+
+    c->error_in_source = true;
+    buf = blk_blockalign(s->top, c->bytes);
+    ret = blk_co_pread(s->top, c->offset, c->bytes, buf, 0);
+    if (ret >= 0) {
+        ret = blk_co_pwrite(s->base, c->offset, c->bytes, buf, 0);
+        if (ret < 0) {
+            c->error_in_source = false;
+        }
+    }
+    qemu_vfree(buf);
+
+    c->ret = ret;
+    c->done = ret >= 0;
+    if (c->done) {
+        s->chunk = MIN(s->chunk * 2, COMMIT_MAX_BUFFER_SIZE);
+    } else {
+        s->chunk = COMMIT_BUFFER_SIZE;
+    }
+
+    /* Errors are handled by commit_run() */
+    return 0;
+}
+
+/*
+ * Number of bytes that are committed before the job yields, i.e. what the
+ * rate limit allows in a time slice
+ */
+static int64_t commit_window_size(CommitBlockJob *s)
+{
+    if (s->common.speed) {
+        return MAX(COMMIT_BUFFER_SIZE, s->common.speed * BLOCK_JOB_SLICE_TIME /
+                                       NANOSECONDS_PER_SECOND);
+    }
+    return INT64_MAX;
+}
+
 static int coroutine_fn commit_run(Job *job, Error **errp)
 {
     CommitBlockJob *s = container_of(job, CommitBlockJob, common.job);
-    int64_t offset;
+    CommitChunk chunks[COMMIT_MAX_WORKERS];
+    int nb_chunks = 0; /* chunks from @offset on, not published yet */
+    AioTaskPool *pool;
+    int64_t offset = 0;
+    int64_t extent_end = 0; /* end of the area whose allocation is known */
+    bool copy = false;
     uint64_t delay_ns = 0;
     int ret = 0;
     int64_t n = 0; /* bytes */
-    QEMU_AUTO_VFREE void *buf = NULL;
     int64_t len, base_len;
 
     len = blk_co_getlength(s->top);
@@ -141,11 +217,12 @@ static int coroutine_fn commit_run(Job *job, Error **errp)
         }
     }
 
-    buf = blk_blockalign(s->top, COMMIT_BUFFER_SIZE);
+    s->chunk = COMMIT_BUFFER_SIZE;
+    pool = aio_task_pool_new(COMMIT_MAX_WORKERS);
 
-    for (offset = 0; offset < len; offset += n) {
-        bool copy;
-        bool error_in_source = true;
+    while (offset < len) {
+        int64_t window_end, window_size, copied;
+        int i;
 
         /* Note that even when no rate limit is applied we need to yield
          * with no pending I/O here so that bdrv_drain_all() returns.
@@ -154,44 +231,116 @@ static int coroutine_fn commit_run(Job *job, Error **errp)
         if (job_is_cancelled(&s->common.job)) {
             break;
         }
-        /* Copy if allocated above the base */
-        ret = blk_co_is_allocated_above(s->top, s->base_overlay, true,
-                                        offset, COMMIT_BUFFER_SIZE, &n);
-        copy = (ret > 0);
-        trace_commit_one_iteration(s, offset, n, ret);
-        if (copy) {
-            assert(n < SIZE_MAX);
-
-            ret = blk_co_pread(s->top, offset, n, buf, 0);
-            if (ret >= 0) {
-                ret = blk_co_pwrite(s->base, offset, n, buf, 0);
-                if (ret < 0) {
-                    error_in_source = false;
+        delay_ns = 0;
+
+        if (offset >= extent_end) {
+            /*
+             * Look up the allocation status of the whole remaining area; it
+             * is then committed in chunks.
+             */
+            assert(nb_chunks == 0);
+            ret = blk_co_is_allocated_above(s->top, s->base_overlay, true,
+                                            offset, len - offset, &n);
+            trace_commit_one_iteration(s, offset, n, ret);
+            if (ret < 0) {
+                BlockErrorAction action =
+                    block_job_error_action(&s->common, s->on_error, true,
+                                           -ret);
+                if (action == BLOCK_ERROR_ACTION_REPORT) {
+                    break;
                 }
+                ret = 0;
+                continue;
             }
+            copy = (ret > 0);
+            ret = 0;
+            extent_end = offset + n;
         }
-        if (ret < 0) {
-            BlockErrorAction action =
-                block_job_error_action(&s->common, s->on_error,
-                                       error_in_source, -ret);
-            if (action == BLOCK_ERROR_ACTION_REPORT) {
-                return ret;
-            } else {
-                n = 0;
+
+        if (!copy) {
+            /* Publish progress */
+            job_progress_update(&s->common.job, extent_end - offset);
+            offset = extent_end;
+            continue;
+        }
+
+        /*
+         * Chunks left over from the last round either failed and are
+         * committed again, or wait for a failed one before them.  Add new
+         * chunks after them, up to the end of the extent.
+         */
+        window_end = offset;
+        if (nb_chunks) {
+            window_end = chunks[nb_chunks - 1].offset +
+                         chunks[nb_chunks - 1].bytes;
+        }
+        window_size = commit_window_size(s);
+        while (nb_chunks < COMMIT_MAX_WORKERS && window_end < extent_end &&
+               window_end - offset < window_size) {
+            n = MIN(s->chunk, MIN(extent_end - window_end, window_size));
+            chunks[nb_chunks++] = (CommitChunk) {
+                .offset = window_end,
+                .bytes = n,
+            };
+            window_end += n;
+        }
+
+        /* Only account what is committed in this round to the rate limit */
+        copied = 0;
+        for (i = 0; i < nb_chunks; i++) {
+            CommitTask *task;
+
+            if (chunks[i].done) {
+                copied -= chunks[i].bytes;
                 continue;
             }
+            task = g_new(CommitTask, 1);
+            *task = (CommitTask) {
+                .task.func = commit_task_entry,
+                .s = s,
+                .chunk = &chunks[i],
+            };
+            aio_task_pool_start_task(pool, &task->task);
+        }
+        aio_task_pool_wait_all(pool);
+
+        for (i = 0; i < nb_chunks; i++) {
+            if (chunks[i].done) {
+                copied += chunks[i].bytes;
+            }
         }
-        /* Publish progress */
-        job_progress_update(&s->common.job, n);
+        delay_ns = block_job_ratelimit_get_delay(&s->common, copied);
 
-        if (copy) {
-            delay_ns = block_job_ratelimit_get_delay(&s->common, n);
-        } else {
-            delay_ns = 0;
+        /*
+         * Publish progress up to the first chunk that failed, and apply the
+         * error policy to it, as if the chunks were committed one by one.
+         * Unless the error is reported, it is committed again in the next
+         * round, together with any failed chunks after it.
+         */
+        for (i = 0; i < nb_chunks; i++) {
+            CommitChunk *c = &chunks[i];
+
+            if (!c->done) {
+                BlockErrorAction action =
+                    block_job_error_action(&s->common, s->on_error,
+                                           c->error_in_source, -c->ret);
+                if (action == BLOCK_ERROR_ACTION_REPORT) {
+                    ret = c->ret;
+                    goto out;
+                }
+                break;
+            }
+            job_progress_update(&s->common.job, c->bytes);
+            offset += c->bytes;
         }
+        nb_chunks -= i;
+        memmove(chunks, &chunks[i], nb_chunks * sizeof(chunks[0]));
     }
 
-    return 0;
+out:
+    aio_task_pool_free(pool);
+
+    return ret;
 }
 
 static const BlockJobDriver commit_job_driver = {
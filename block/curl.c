@@ -45,6 +45,18 @@
 #define CURL_NUM_ACB    8
 #define CURL_TIMEOUT_MAX 10000
 
+/* Granularity of the cache of data read from the server */
+#define CURL_CACHE_BLOCK_SIZE (64 * 1024)
+
+/*
+ * Sequential reads are prefetched with range requests of this size, so that
+ * several of them can be in flight in parallel.
+ */
+#define CURL_PREFETCH_SIZE (1024 * 1024)
+
+/* Upper limit for the readahead window of sequential reads */
+#define CURL_READAHEAD_MAX (16 * 1024 * 1024)
+
 #define CURL_BLOCK_OPT_URL       "url"
 #define CURL_BLOCK_OPT_READAHEAD "readahead"
 #define CURL_BLOCK_OPT_SSLVERIFY "sslverify"
@@ -55,10 +67,12 @@
 #define CURL_BLOCK_OPT_PASSWORD_SECRET "password-secret"
 #define CURL_BLOCK_OPT_PROXY_USERNAME "proxy-username"
 #define CURL_BLOCK_OPT_PROXY_PASSWORD_SECRET "proxy-password-secret"
+#define CURL_BLOCK_OPT_CACHE_SIZE "cache-size"
 
 #define CURL_BLOCK_OPT_READAHEAD_DEFAULT (256 * 1024)
 #define CURL_BLOCK_OPT_SSLVERIFY_DEFAULT true
 #define CURL_BLOCK_OPT_TIMEOUT_DEFAULT 5
+#define CURL_BLOCK_OPT_CACHE_SIZE_DEFAULT (16 * 1024 * 1024)
 
 struct BDRVCURLState;
 struct CURLState;
@@ -82,6 +96,13 @@ typedef struct CURLSocket {
     struct BDRVCURLState *s;
 } CURLSocket;
 
+typedef struct CURLCacheBlock {
+    uint64_t index;     /* offset / CURL_CACHE_BLOCK_SIZE */
+    size_t len;         /* shorter than a block only at the end of the file */
+    char *data;
+    QTAILQ_ENTRY(CURLCacheBlock) lru;
+} CURLCacheBlock;
+
 typedef struct CURLState
 {
     struct BDRVCURLState *s;
@@ -115,6 +136,17 @@ typedef struct BDRVCURLState {
     char *password;
     char *proxyusername;
     char *proxypassword;
+
+    /* Cache of data read from the server, protected by mutex */
+    GHashTable *cache; /* &block->index -> CURLCacheBlock */
+    QTAILQ_HEAD(, CURLCacheBlock) cache_lru; /* least recently used first */
+    uint64_t cache_size;
+    uint64_t cache_used;
+
+    /* Readahead for sequential reads, protected by mutex */
+    uint64_t seq_next;          /* offset at which the last read ended */
+    uint64_t prefetch_end;      /* end of the data requested so far */
+    size_t readahead_window;
 } BDRVCURLState;
 
 static void curl_clean_state(CURLState *s);
@@ -321,6 +353,104 @@ static bool curl_find_buf(BDRVCURLState *s, uint64_t start, uint64_t len,
     return false;
 }
 
+static void curl_cache_block_free(gpointer data)
+{
+    CURLCacheBlock *block = data;
+
+    g_free(block->data);
+    g_free(block);
+}
+
+/* Called with s->mutex held.  */
+static void curl_cache_insert(BDRVCURLState *s, uint64_t start,
+                              const char *buf, size_t len)
+{
+    uint64_t end = start + len;
+    uint64_t offset = QEMU_ALIGN_UP(start, CURL_CACHE_BLOCK_SIZE);
+
+    if (!s->cache_size) {
+        return;
+    }
+
+    /* Only complete blocks are cached */
+    for (; offset < end; offset += CURL_CACHE_BLOCK_SIZE) {
+        uint64_t index = offset / CURL_CACHE_BLOCK_SIZE;
+        uint64_t block_end = MIN(offset + CURL_CACHE_BLOCK_SIZE, s->len);
+        CURLCacheBlock *block;
+
+        if (block_end > end) {
+            break;
+        }
+
+        block = g_hash_table_lookup(s->cache, &index);
+        if (block) {
+            QTAILQ_REMOVE(&s->cache_lru, block, lru);
+            QTAILQ_INSERT_TAIL(&s->cache_lru, block, lru);
+            continue;
+        }
+
+        while (s->cache_used + CURL_CACHE_BLOCK_SIZE > s->cache_size &&
+               !QTAILQ_EMPTY(&s->cache_lru)) {
+            CURLCacheBlock *victim = QTAILQ_FIRST(&s->cache_lru);
+
+            QTAILQ_REMOVE(&s->cache_lru, victim, lru);
+            s->cache_used -= victim->len;
+            g_hash_table_remove(s->cache, &victim->index);
+        }
+
+        block = g_new(CURLCacheBlock, 1);
+        block->index = index;
+        block->len = block_end - offset;
+        block->data = g_memdup2(buf + (offset - start), block->len);
+        QTAILQ_INSERT_TAIL(&s->cache_lru, block, lru);
+        s->cache_used += block->len;
+        g_hash_table_insert(s->cache, &block->index, block);
+    }
+}
+
+/*
+ * Complete @acb from the cache if all of its data is there.
+ * Called with s->mutex held.
+ */
+static bool curl_cache_read(BDRVCURLState *s, uint64_t start, uint64_t len,
+                            CURLAIOCB *acb)
+{
+    uint64_t clamped_end = MIN(start + len, s->len);
+    uint64_t first, last, index;
+
+    if (!s->cache_size || clamped_end <= start) {
+        return false;
+    }
+
+    first = start / CURL_CACHE_BLOCK_SIZE;
+    last = (clamped_end - 1) / CURL_CACHE_BLOCK_SIZE;
+    for (index = first; index <= last; index++) {
+        if (!g_hash_table_contains(s->cache, &index)) {
+            return false;
+        }
+    }
+
+    for (index = first; index <= last; index++) {
+        CURLCacheBlock *block = g_hash_table_lookup(s->cache, &index);
+        uint64_t block_start = index * CURL_CACHE_BLOCK_SIZE;
+        uint64_t from = MAX(start, block_start);
+        uint64_t to = MIN(clamped_end, block_start + block->len);
+
+        qemu_iovec_from_buf(acb->qiov, from - start,
+                            block->data + (from - block_start), to - from);
+        QTAILQ_REMOVE(&s->cache_lru, block, lru);
+        QTAILQ_INSERT_TAIL(&s->cache_lru, block, lru);
+    }
+    if (clamped_end - start < len) {
+        qemu_iovec_memset(acb->qiov, clamped_end - start, 0,
+                          len - (clamped_end - start));
+    }
+
+    trace_curl_cache_hit(len, start);
+    acb->ret = 0;
+    return true;
+}
+
 /* Called with s->mutex held.  */
 static void curl_multi_check_completion(BDRVCURLState *s)
 {
@@ -356,6 +486,9 @@ static void curl_multi_check_completion(BDRVCURLState *s)
                         error_report("curl: further errors suppressed");
                     }
                 }
+            } else {
+                curl_cache_insert(s, state->buf_start, state->orig_buf,
+                                  state->buf_off);
             }
 
             for (i = 0; i < CURL_NUM_ACB; i++) {
@@ -483,6 +616,15 @@ static int curl_init_state(BDRVCURLState *s, CURLState *state)
             curl_easy_setopt(state->curl, CURLOPT_FAILONERROR, 1)) {
             goto err;
         }
+#if LIBCURL_VERSION_NUM >= 0x072b00
+        /*
+         * Rather wait for a connection that allows multiplexing (HTTP/2)
+         * than open a new connection for each parallel range request.
+         */
+        if (curl_easy_setopt(state->curl, CURLOPT_PIPEWAIT, 1L)) {
+            goto err;
+        }
+#endif
         if (s->username) {
             if (curl_easy_setopt(state->curl, CURLOPT_USERNAME, s->username)) {
                 goto err;
@@ -576,6 +718,8 @@ static void curl_detach_aio_context(BlockDriverState *bs)
             g_free(s->states[i].orig_buf);
             s->states[i].orig_buf = NULL;
         }
+        /* Prefetch requests have been dropped along with the states */
+        s->prefetch_end = s->seq_next;
         if (s->multi) {
             curl_multi_cleanup(s->multi);
             s->multi = NULL;
@@ -600,6 +744,9 @@ static void curl_attach_aio_context(BlockDriverState *bs,
     curl_multi_setopt(s->multi, CURLMOPT_SOCKETFUNCTION, curl_sock_cb);
     curl_multi_setopt(s->multi, CURLMOPT_TIMERDATA, s);
     curl_multi_setopt(s->multi, CURLMOPT_TIMERFUNCTION, curl_timer_cb);
+#if LIBCURL_VERSION_NUM >= 0x072b00
+    curl_multi_setopt(s->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
 }
 
 static QemuOptsList runtime_opts = {
@@ -656,6 +803,11 @@ static QemuOptsList runtime_opts = {
             .type = QEMU_OPT_STRING,
             .help = "ID of secret used as password for HTTP proxy auth",
         },
+        {
+            .name = CURL_BLOCK_OPT_CACHE_SIZE,
+            .type = QEMU_OPT_SIZE,
+            .help = "Size of the cache for data read from the server",
+        },
         { /* end of list */ }
     },
 };
@@ -704,6 +856,9 @@ static int curl_open(BlockDriverState *bs, QDict *options, int flags,
         goto out_noclean;
     }
 
+    s->cache_size = qemu_opt_get_size(opts, CURL_BLOCK_OPT_CACHE_SIZE,
+                                      CURL_BLOCK_OPT_CACHE_SIZE_DEFAULT);
+
     s->timeout = qemu_opt_get_number(opts, CURL_BLOCK_OPT_TIMEOUT,
                                      CURL_BLOCK_OPT_TIMEOUT_DEFAULT);
     if (s->timeout > CURL_TIMEOUT_MAX) {
@@ -828,6 +983,11 @@ static int curl_open(BlockDriverState *bs, QDict *options, int flags,
     }
     trace_curl_open_size(s->len);
 
+    s->cache = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL,
+                                     curl_cache_block_free);
+    QTAILQ_INIT(&s->cache_lru);
+    s->readahead_window = s->readahead_size;
+
     qemu_mutex_lock(&s->mutex);
     curl_clean_state(state);
     qemu_mutex_unlock(&s->mutex);
@@ -856,21 +1016,136 @@ out_noclean:
     return -EINVAL;
 }
 
+/*
+ * Start fetching @len bytes at @start with @state, which must have been
+ * returned by curl_find_state().  @acb may be NULL for prefetching.  On
+ * failure, @state is released again.  Called with s->mutex held.
+ */
+static int curl_start_transfer(BDRVCURLState *s, CURLState *state,
+                               uint64_t start, uint64_t len, CURLAIOCB *acb)
+{
+    uint64_t end = start + len - 1;
+    int running;
+
+    if (curl_init_state(s, state) < 0) {
+        curl_clean_state(state);
+        return -EIO;
+    }
+
+    state->buf_off = 0;
+    g_free(state->orig_buf);
+    state->buf_start = start;
+    state->buf_len = len;
+    state->orig_buf = g_try_malloc(state->buf_len);
+    if (state->buf_len && state->orig_buf == NULL) {
+        curl_clean_state(state);
+        return -ENOMEM;
+    }
+    state->acb[0] = acb;
+
+    snprintf(state->range, 127, "%" PRIu64 "-%" PRIu64, start, end);
+    if (curl_easy_setopt(state->curl, CURLOPT_RANGE, state->range) ||
+        curl_multi_add_handle(s->multi, state->curl) != CURLM_OK) {
+        state->acb[0] = NULL;
+        curl_clean_state(state);
+        return -EIO;
+    }
+
+    /* Tell curl it needs to kick things off */
+    curl_multi_socket_action(s->multi, CURL_SOCKET_TIMEOUT, 0, &running);
+    return 0;
+}
+
+/*
+ * Issue range requests for the readahead window after the last read, in
+ * parallel, for whatever is neither cached nor requested yet.  A couple of
+ * states are left free for reads that miss.  Called with s->mutex held.
+ */
+static void curl_readahead(BDRVCURLState *s)
+{
+    uint64_t target = MIN(s->seq_next + s->readahead_window, s->len);
+
+    if (!s->cache_size) {
+        /* Prefetched data would not be kept around */
+        return;
+    }
+
+    while (s->prefetch_end < target) {
+        uint64_t start = s->prefetch_end;
+        uint64_t index = start / CURL_CACHE_BLOCK_SIZE;
+        uint64_t len;
+        CURLState *state;
+        int i, nb_free = 0;
+
+        if (g_hash_table_contains(s->cache, &index)) {
+            s->prefetch_end = MIN((index + 1) * CURL_CACHE_BLOCK_SIZE, s->len);
+            continue;
+        }
+
+        for (i = 0; i < CURL_NUM_STATES; i++) {
+            CURLState *st = &s->states[i];
+
+            if (!st->in_use) {
+                nb_free++;
+            } else if (start >= st->buf_start &&
+                       start < st->buf_start + st->buf_len) {
+                s->prefetch_end = st->buf_start + st->buf_len;
+                break;
+            }
+        }
+        if (i < CURL_NUM_STATES) {
+            continue;
+        }
+        if (nb_free <= 2) {
+            return;
+        }
+
+        len = MIN(QEMU_ALIGN_UP(start + 1, CURL_PREFETCH_SIZE), s->len) - start;
+        state = curl_find_state(s);
+        trace_curl_prefetch(len, start, s->readahead_window);
+        if (curl_start_transfer(s, state, start, len, NULL) < 0) {
+            return;
+        }
+        s->prefetch_end = start + len;
+    }
+}
+
 static void coroutine_fn curl_setup_preadv(BlockDriverState *bs, CURLAIOCB *acb)
 {
     CURLState *state;
-    int running;
+    int ret;
 
     BDRVCURLState *s = bs->opaque;
 
     uint64_t start = acb->offset;
-    uint64_t end;
+    uint64_t req_start, req_end;
+    bool sequential;
 
     qemu_mutex_lock(&s->mutex);
 
+    /*
+     * Grow the readahead window while the reads are sequential, and fall
+     * back to the configured readahead size otherwise.
+     */
+    sequential = start == s->seq_next;
+    if (sequential) {
+        size_t max = MAX(s->readahead_size,
+                         MIN(CURL_READAHEAD_MAX, s->cache_size / 2));
+
+        s->readahead_window = MIN(s->readahead_window * 2, max);
+    } else {
+        s->readahead_window = s->readahead_size;
+        s->prefetch_end = start;
+    }
+    s->seq_next = start + acb->bytes;
+
     // In case we have the requested data already (e.g. read-ahead),
     // we can just call the callback and be done.
-    if (curl_find_buf(s, start, acb->bytes, acb)) {
+    if (curl_cache_read(s, start, acb->bytes, acb) ||
+        curl_find_buf(s, start, acb->bytes, acb)) {
+        if (sequential) {
+            curl_readahead(s);
+        }
         goto out;
     }
 
@@ -883,41 +1158,28 @@ static void coroutine_fn curl_setup_preadv(BlockDriverState *bs, CURLAIOCB *acb)
         qemu_co_queue_wait(&s->free_state_waitq, &s->mutex);
     }
 
-    if (curl_init_state(s, state) < 0) {
-        curl_clean_state(state);
-        acb->ret = -EIO;
-        goto out;
+    if (s->cache_size) {
+        /* Request whole cache blocks, so that all of the data can be cached */
+        req_start = QEMU_ALIGN_DOWN(start, CURL_CACHE_BLOCK_SIZE);
+        req_end = MIN(QEMU_ALIGN_UP(start + acb->bytes + s->readahead_size,
+                                    CURL_CACHE_BLOCK_SIZE),
+                      s->len);
+    } else {
+        req_start = start;
+        req_end = MIN(start + acb->bytes + s->readahead_size, s->len);
     }
+    acb->start = start - req_start;
+    acb->end = acb->start + MIN(acb->bytes, s->len - start);
 
-    acb->start = 0;
-    acb->end = MIN(acb->bytes, s->len - start);
-
-    state->buf_off = 0;
-    g_free(state->orig_buf);
-    state->buf_start = start;
-    state->buf_len = MIN(acb->end + s->readahead_size, s->len - start);
-    end = start + state->buf_len - 1;
-    state->orig_buf = g_try_malloc(state->buf_len);
-    if (state->buf_len && state->orig_buf == NULL) {
-        curl_clean_state(state);
-        acb->ret = -ENOMEM;
+    ret = curl_start_transfer(s, state, req_start, req_end - req_start, acb);
+    if (ret < 0) {
+        acb->ret = ret;
         goto out;
     }
-    state->acb[0] = acb;
-
-    snprintf(state->range, 127, "%" PRIu64 "-%" PRIu64, start, end);
     trace_curl_setup_preadv(acb->bytes, start, state->range);
-    if (curl_easy_setopt(state->curl, CURLOPT_RANGE, state->range) ||
-        curl_multi_add_handle(s->multi, state->curl) != CURLM_OK) {
-        state->acb[0] = NULL;
-        acb->ret = -EIO;
-
-        curl_clean_state(state);
-        goto out;
-    }
 
-    /* Tell curl it needs to kick things off */
-    curl_multi_socket_action(s->multi, CURL_SOCKET_TIMEOUT, 0, &running);
+    s->prefetch_end = MAX(s->prefetch_end, req_end);
+    curl_readahead(s);
 
 out:
     qemu_mutex_unlock(&s->mutex);
@@ -951,6 +1213,7 @@ static void curl_close(BlockDriverState *bs)
     qemu_mutex_destroy(&s->mutex);
 
     g_hash_table_destroy(s->sockets);
+    g_hash_table_destroy(s->cache);
     g_free(s->cookie);
     g_free(s->url);
     g_free(s->username);
@@ -968,8 +1231,8 @@ static void curl_refresh_filename(BlockDriverState *bs)
 {
     BDRVCURLState *s = bs->opaque;
 
-    /* "readahead" and "timeout" do not change the guest-visible data,
-     * so ignore them */
+    /* "readahead", "timeout" and "cache-size" do not change the
+     * guest-visible data, so ignore them */
     if (s->sslverify != CURL_BLOCK_OPT_SSLVERIFY_DEFAULT ||
         s->cookie || s->username || s->password || s->proxyusername ||
         s->proxypassword)
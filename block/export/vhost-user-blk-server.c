@@ -22,6 +22,10 @@
 
 enum {
     VHOST_USER_BLK_NUM_QUEUES_DEFAULT = 1,
+    /* Maximum number of buffers of a request, including header and status */
+    VHOST_USER_BLK_MAX_SEGMENTS = 128,
+    /* Number of requests that are popped from a virtqueue at once */
+    VHOST_USER_BLK_POP_BATCH = 32,
 };
 
 typedef struct VuBlkReq {
@@ -46,7 +50,7 @@ static void vu_blk_req_complete(VuBlkReq *req, size_t in_len)
     vu_queue_push(vu_dev, req->vq, &req->elem, in_len);
     vu_queue_notify(vu_dev, req->vq);
 
-    free(req);
+    vu_queue_elem_free(req->vq, req);
 }
 
 /* Called with server refcount increased, must decrease before returning */
@@ -66,7 +70,7 @@ static void coroutine_fn vu_blk_virtio_process_req(void *opaque)
     in_len = virtio_blk_process_req(handler, in_iov, out_iov,
                                     in_num, out_num);
     if (in_len < 0) {
-        free(req);
+        vu_queue_elem_free(req->vq, req);
         vhost_user_server_unref(server);
         return;
     }
@@ -80,23 +84,26 @@ static void vu_blk_process_vq(VuDev *vu_dev, int idx)
     VuServer *server = container_of(vu_dev, VuServer, vu_dev);
     VuVirtq *vq = vu_get_queue(vu_dev, idx);
 
-    while (1) {
-        VuBlkReq *req;
+    void *reqs[VHOST_USER_BLK_POP_BATCH];
+    unsigned int i, n;
 
-        req = vu_queue_pop(vu_dev, vq, sizeof(VuBlkReq));
-        if (!req) {
-            break;
-        }
+    do {
+        n = vu_queue_pop_batch(vu_dev, vq, sizeof(VuBlkReq), reqs,
+                               ARRAY_SIZE(reqs));
 
-        req->server = server;
-        req->vq = vq;
+        for (i = 0; i < n; i++) {
+            VuBlkReq *req = reqs[i];
 
-        Coroutine *co =
-            qemu_coroutine_create(vu_blk_virtio_process_req, req);
+            req->server = server;
+            req->vq = vq;
 
-        vhost_user_server_ref(server);
-        qemu_coroutine_enter(co);
-    }
+            Coroutine *co =
+                qemu_coroutine_create(vu_blk_virtio_process_req, req);
+
+            vhost_user_server_ref(server);
+            qemu_coroutine_enter(co);
+        }
+    } while (n == ARRAY_SIZE(reqs));
 }
 
 static void vu_blk_queue_set_started(VuDev *vu_dev, int idx, bool started)
@@ -106,6 +113,15 @@ static void vu_blk_queue_set_started(VuDev *vu_dev, int idx, bool started)
     assert(vu_dev);
 
     vq = vu_get_queue(vu_dev, idx);
+    if (started) {
+        /*
+         * Requests can usually be popped without allocating memory.  If
+         * requests from a previous start are still in flight, the pool
+         * cannot be resized, and allocation falls back to malloc().
+         */
+        vu_queue_set_elem_pool(vq, sizeof(VuBlkReq),
+                               VHOST_USER_BLK_MAX_SEGMENTS, vq->vring.num);
+    }
     vu_set_queue_handler(vu_dev, vq, started ? vu_blk_process_vq : NULL);
 }
 
@@ -230,7 +246,7 @@ vu_blk_initialize_config(BlockDriverState *bs,
         cpu_to_le64(bdrv_getlength(bs) >> VIRTIO_BLK_SECTOR_BITS);
     config->blk_size = cpu_to_le32(blk_size);
     config->size_max = cpu_to_le32(0);
-    config->seg_max = cpu_to_le32(128 - 2);
+    config->seg_max = cpu_to_le32(VHOST_USER_BLK_MAX_SEGMENTS - 2);
     config->min_io_size = cpu_to_le16(1);
     config->opt_io_size = cpu_to_le32(1);
     config->num_queues = cpu_to_le16(num_queues);
@@ -74,6 +74,7 @@ static void __attribute__((__constructor__)) bdrv_init_graph_lock(void)
 
 void register_aiocontext(AioContext *ctx)
 {
+    bdrv_register_busy_count(ctx);
     ctx->bdrv_graph = g_new0(BdrvGraphRWlock, 1);
     QEMU_LOCK_GUARD(&aio_context_list_lock);
     assert(ctx->bdrv_graph->reader_count == 0);
@@ -82,6 +83,7 @@ void register_aiocontext(AioContext *ctx)
 
 void unregister_aiocontext(AioContext *ctx)
 {
+    bdrv_unregister_busy_count(ctx);
     QEMU_LOCK_GUARD(&aio_context_list_lock);
     orphaned_reader_count += ctx->bdrv_graph->reader_count;
     QTAILQ_REMOVE(&aio_context_list, ctx->bdrv_graph, next_aio);
@@ -370,6 +370,13 @@ static void bdrv_do_drained_begin(BlockDriverState *bs, BdrvChild *parent,
      * though we don't return to the main AioContext loop - this automatically
      * includes other nodes in the same AioContext and therefore all child
      * nodes.
+     *
+     * Unlike bdrv_drain_all_poll(), this doesn't consult bdrv_busy_count():
+     * bdrv_drain_poll() only looks at @bs and its parents, so the cost of
+     * each poll is bounded by the depth of the graph above @bs, not by the
+     * number of nodes.  The counter is global, so requests on unrelated
+     * nodes would keep it non-zero and it couldn't short-circuit anything
+     * here anyway.
      */
     if (poll) {
         BDRV_POLL_WHILE(bs, bdrv_drain_poll_top_level(bs, parent));
@@ -425,17 +432,88 @@ void bdrv_drain(BlockDriverState *bs)
     bdrv_drained_end(bs);
 }
 
-static void bdrv_drain_assert_idle(BlockDriverState *bs)
+unsigned int bdrv_drain_all_count = 0;
+
+/*
+ * The number of BlockDriverStates and BlockBackends that have requests in
+ * flight is kept per AioContext, like the reader count of the graph lock,
+ * so that I/O in different IOThreads does not bounce a shared cacheline.
+ * A node can become busy in one thread and idle in another, so the count
+ * of a single AioContext can be negative; only the total is meaningful.
+ * It can be transiently off while a node changes state on another thread;
+ * however, whenever it is too high a decrement and aio_wait_kick() are
+ * still to come.
+ */
+typedef struct BdrvBusyCount BdrvBusyCount;
+
+struct BdrvBusyCount {
+    uint32_t count;
+
+    /* Protected by busy_list_lock */
+    QTAILQ_ENTRY(BdrvBusyCount) next;
+};
+
+/* Protects busy_list and orphaned_busy_count */
+static QemuMutex busy_list_lock;
+static QTAILQ_HEAD(, BdrvBusyCount) busy_list =
+    QTAILQ_HEAD_INITIALIZER(busy_list);
+
+/* Balance of the AioContexts that were destroyed */
+static uint32_t orphaned_busy_count;
+
+static void __attribute__((__constructor__)) bdrv_init_busy_count(void)
+{
+    qemu_mutex_init(&busy_list_lock);
+}
+
+void bdrv_register_busy_count(AioContext *ctx)
+{
+    ctx->bdrv_busy = g_new0(BdrvBusyCount, 1);
+    QEMU_LOCK_GUARD(&busy_list_lock);
+    QTAILQ_INSERT_TAIL(&busy_list, ctx->bdrv_busy, next);
+}
+
+void bdrv_unregister_busy_count(AioContext *ctx)
+{
+    QEMU_LOCK_GUARD(&busy_list_lock);
+    orphaned_busy_count += qatomic_read(&ctx->bdrv_busy->count);
+    QTAILQ_REMOVE(&busy_list, ctx->bdrv_busy, next);
+    g_free(ctx->bdrv_busy);
+}
+
+static BdrvBusyCount *bdrv_busy_count_self(void)
+{
+    AioContext *ctx = qemu_get_current_aio_context();
+
+    return (ctx ?: qemu_get_aio_context())->bdrv_busy;
+}
+
+static uint32_t bdrv_busy_count(void)
 {
-    BdrvChild *child, *next;
+    BdrvBusyCount *busy;
+    uint32_t count;
 
-    assert(qatomic_read(&bs->in_flight) == 0);
-    QLIST_FOREACH_SAFE(child, &bs->children, next, next) {
-        bdrv_drain_assert_idle(child->bs);
+    QEMU_LOCK_GUARD(&busy_list_lock);
+    count = orphaned_busy_count;
+    QTAILQ_FOREACH(busy, &busy_list, next) {
+        count += qatomic_read(&busy->count);
     }
+    return count;
 }
 
-unsigned int bdrv_drain_all_count = 0;
+void bdrv_busy_inc(unsigned int *in_flight)
+{
+    if (qatomic_fetch_inc(in_flight) == 0) {
+        qatomic_inc(&bdrv_busy_count_self()->count);
+    }
+}
+
+void bdrv_busy_dec(unsigned int *in_flight)
+{
+    if (qatomic_fetch_dec(in_flight) == 1) {
+        qatomic_dec(&bdrv_busy_count_self()->count);
+    }
+}
 
 static bool bdrv_drain_all_poll(void)
 {
@@ -443,6 +521,20 @@ static bool bdrv_drain_all_poll(void)
     bool result = false;
     GLOBAL_STATE_CODE();
 
+    /*
+     * As long as some request is in flight, there is no need to look at
+     * every node of the graph: the last completion kicks AIO_WAIT_WHILE()
+     * and we come back here.  Only walk the graph when everything looks
+     * idle, to check the parents and to not rely on bdrv_busy_count() being
+     * exact.
+     *
+     * This is only worth it here, where each poll would otherwise visit
+     * every node; see bdrv_do_drained_begin() for the single-node case.
+     */
+    if ((int32_t)bdrv_busy_count() > 0) {
+        return true;
+    }
+
     /* bdrv_drain_poll() can't make changes to the graph and we are holding the
      * main AioContext lock, so iterating bdrv_next_all_states() is safe. */
     while ((bs = bdrv_next_all_states(bs))) {
@@ -522,7 +614,7 @@ void bdrv_drain_all_begin(void)
     AIO_WAIT_WHILE(NULL, bdrv_drain_all_poll());
 
     while ((bs = bdrv_next_all_states(bs))) {
-        bdrv_drain_assert_idle(bs);
+        assert(qatomic_read(&bs->in_flight) == 0);
     }
 }
 
@@ -755,7 +847,7 @@ static coroutine_fn int bdrv_get_cluster_size(BlockDriverState *bs)
 void bdrv_inc_in_flight(BlockDriverState *bs)
 {
     IO_CODE();
-    qatomic_inc(&bs->in_flight);
+    bdrv_busy_inc(&bs->in_flight);
 }
 
 void bdrv_wakeup(BlockDriverState *bs)
@@ -767,7 +859,7 @@ void bdrv_wakeup(BlockDriverState *bs)
 void bdrv_dec_in_flight(BlockDriverState *bs)
 {
     IO_CODE();
-    qatomic_dec(&bs->in_flight);
+    bdrv_busy_dec(&bs->in_flight);
     bdrv_wakeup(bs);
 }
 
@@ -25,11 +25,19 @@
 #include "qemu/ratelimit.h"
 #include "qemu/bitmap.h"
 #include "qemu/memalign.h"
+#include "qemu/stats64.h"
 
 #define MAX_IN_FLIGHT 16
 #define MAX_IO_BYTES (1 << 20) /* 1 Mb */
 #define DEFAULT_MIRROR_BUF_SIZE (MAX_IN_FLIGHT * MAX_IO_BYTES)
 
+/*
+ * The latency of writes to the filter node is collected in a histogram
+ * with four buckets for each power of two.
+ */
+#define MIRROR_LATENCY_SUB_BITS 2
+#define MIRROR_LATENCY_BUCKETS (64 << MIRROR_LATENCY_SUB_BITS)
+
 /* The mirroring buffer is a list of granularity-sized chunks.
  * Free chunks are organized in a list.
  */
@@ -86,6 +94,21 @@ typedef struct MirrorBlockJob {
     int64_t active_write_bytes_in_flight;
     bool prepared;
     bool in_drain;
+
+    /*
+     * Active writes in write-async mode, in the order in which they were
+     * queued.  Those before async_pending are being written to the target.
+     */
+    QTAILQ_HEAD(, MirrorOp) async_ops;
+    MirrorOp *async_pending;
+    /* Bytes of the active writes that hold a place in the queue */
+    int64_t async_bytes_queued;
+    /* Number of mirror_async_writer() coroutines */
+    int async_writers;
+    /* Woken up whenever queued writes have reached the target */
+    CoQueue async_write_done;
+
+    Stat64 write_latency[MIRROR_LATENCY_BUCKETS];
 } MirrorBlockJob;
 
 typedef struct MirrorBDSOpaque {
@@ -94,6 +117,12 @@ typedef struct MirrorBDSOpaque {
     bool is_commit;
 } MirrorBDSOpaque;
 
+typedef enum MirrorMethod {
+    MIRROR_METHOD_COPY,
+    MIRROR_METHOD_ZERO,
+    MIRROR_METHOD_DISCARD,
+} MirrorMethod;
+
 struct MirrorOp {
     MirrorBlockJob *s;
     QEMUIOVector qiov;
@@ -107,18 +136,26 @@ struct MirrorOp {
     bool is_pseudo_op;
     bool is_active_write;
     bool is_in_flight;
+    /* Set for active writes that are queued in write-async mode */
+    bool is_queued;
     CoQueue waiting_requests;
     Coroutine *co;
     MirrorOp *waiting_for_op;
 
     QTAILQ_ENTRY(MirrorOp) next;
-};
 
-typedef enum MirrorMethod {
-    MIRROR_METHOD_COPY,
-    MIRROR_METHOD_ZERO,
-    MIRROR_METHOD_DISCARD,
-} MirrorMethod;
+    /*
+     * Queued active writes in write-async mode: the area to write to the
+     * target (which may be smaller than the area of the operation), how to
+     * write it and, for MIRROR_METHOD_COPY, the data in @qiov.
+     */
+    MirrorMethod method;
+    int flags;
+    int64_t target_offset;
+    uint64_t target_bytes;
+    void *bounce_buf;
+    QTAILQ_ENTRY(MirrorOp) async_next;
+};
 
 static BlockErrorAction mirror_error_action(MirrorBlockJob *s, bool read,
                                             int error)
@@ -643,6 +680,13 @@ static void coroutine_fn mirror_wait_for_all_io(MirrorBlockJob *s)
     }
 }
 
+static void coroutine_fn mirror_wait_for_async_writes(MirrorBlockJob *s)
+{
+    while (!QTAILQ_EMPTY(&s->async_ops)) {
+        qemu_co_queue_wait(&s->async_write_done, NULL);
+    }
+}
+
 /**
  * mirror_exit_common: handle both abort() and prepare() cases.
  * for .prepare, returns 0 on success and -errno on failure.
@@ -1112,6 +1156,10 @@ immediate_exit:
     }
 
     assert(s->in_flight == 0);
+
+    /* Queued active writes use the in-flight bitmap until they are done */
+    mirror_wait_for_async_writes(s);
+
     qemu_vfree(s->buf);
     g_free(s->cow_bitmap);
     g_free(s->in_flight_bitmap);
@@ -1190,7 +1238,7 @@ static bool mirror_drained_poll(BlockJob *job)
         }
     }
 
-    return !!s->in_flight;
+    return !!s->in_flight || !QTAILQ_EMPTY(&s->async_ops);
 }
 
 static bool mirror_cancel(Job *job, bool force)
@@ -1216,6 +1264,61 @@ static bool commit_active_cancel(Job *job, bool force)
     return force || !job_is_ready(job);
 }
 
+static unsigned mirror_latency_bucket(uint64_t ns)
+{
+    int shift;
+
+    if (ns < (1 << MIRROR_LATENCY_SUB_BITS)) {
+        return ns;
+    }
+    shift = 63 - clz64(ns) - MIRROR_LATENCY_SUB_BITS;
+    return ((shift + 1) << MIRROR_LATENCY_SUB_BITS) |
+           ((ns >> shift) & ((1 << MIRROR_LATENCY_SUB_BITS) - 1));
+}
+
+/* Largest latency that falls into histogram bucket @idx */
+static uint64_t mirror_latency_bucket_max(unsigned idx)
+{
+    unsigned sub = idx & ((1 << MIRROR_LATENCY_SUB_BITS) - 1);
+    unsigned shift;
+
+    if (idx < (1 << MIRROR_LATENCY_SUB_BITS)) {
+        return idx;
+    }
+    shift = (idx >> MIRROR_LATENCY_SUB_BITS) - 1;
+    return (((1ULL << MIRROR_LATENCY_SUB_BITS) + sub + 1) << shift) - 1;
+}
+
+static void mirror_query(BlockJob *job, BlockJobInfo *info)
+{
+    MirrorBlockJob *s = container_of(job, MirrorBlockJob, common);
+    static const unsigned permille[] = { 500, 900, 990, 999 };
+    uint64_t buckets[MIRROR_LATENCY_BUCKETS];
+    uint64_t percentiles[ARRAY_SIZE(permille)] = { 0 };
+    uint64_t count = 0, sum = 0;
+    unsigned i, j = 0;
+
+    for (i = 0; i < MIRROR_LATENCY_BUCKETS; i++) {
+        buckets[i] = stat64_get(&s->write_latency[i]);
+        count += buckets[i];
+    }
+    for (i = 0; i < MIRROR_LATENCY_BUCKETS && count; i++) {
+        sum += buckets[i];
+        while (j < ARRAY_SIZE(permille) && sum * 1000 >= count * permille[j]) {
+            percentiles[j++] = mirror_latency_bucket_max(i);
+        }
+    }
+
+    info->write_latency = g_new(BlockJobWriteLatency, 1);
+    *info->write_latency = (BlockJobWriteLatency) {
+        .count = count,
+        .p50 = percentiles[0],
+        .p90 = percentiles[1],
+        .p99 = percentiles[2],
+        .p999 = percentiles[3],
+    };
+}
+
 static const BlockJobDriver mirror_job_driver = {
     .job_driver = {
         .instance_size          = sizeof(MirrorBlockJob),
@@ -1230,6 +1333,7 @@ static const BlockJobDriver mirror_job_driver = {
         .cancel                 = mirror_cancel,
     },
     .drained_poll           = mirror_drained_poll,
+    .query                  = mirror_query,
 };
 
 static const BlockJobDriver commit_active_job_driver = {
@@ -1246,19 +1350,23 @@ static const BlockJobDriver commit_active_job_driver = {
         .cancel                 = commit_active_cancel,
     },
     .drained_poll           = mirror_drained_poll,
+    .query                  = mirror_query,
 };
 
-static void coroutine_fn
-do_sync_target_write(MirrorBlockJob *job, MirrorMethod method,
-                     uint64_t offset, uint64_t bytes,
-                     QEMUIOVector *qiov, int flags)
+/*
+ * Shrink the area of an active write to what must be copied to the target,
+ * mark it clean in the dirty bitmap and account for it in the job progress.
+ * Returns false if nothing is left to copy.
+ */
+static bool coroutine_fn
+active_write_shrink(MirrorBlockJob *job, uint64_t *offset, uint64_t *bytes,
+                    size_t *qiov_offset)
 {
-    int ret;
-    size_t qiov_offset = 0;
     int64_t bitmap_offset, bitmap_end;
 
-    if (!QEMU_IS_ALIGNED(offset, job->granularity) &&
-        bdrv_dirty_bitmap_get(job->dirty_bitmap, offset))
+    *qiov_offset = 0;
+    if (!QEMU_IS_ALIGNED(*offset, job->granularity) &&
+        bdrv_dirty_bitmap_get(job->dirty_bitmap, *offset))
     {
             /*
              * Dirty unaligned padding: ignore it.
@@ -1277,40 +1385,51 @@ do_sync_target_write(MirrorBlockJob *job, MirrorMethod method,
              * even if each write will contribute, as guest is not guaranteed to
              * rewrite the whole disk.
              */
-            qiov_offset = QEMU_ALIGN_UP(offset, job->granularity) - offset;
-            if (bytes <= qiov_offset) {
+            *qiov_offset = QEMU_ALIGN_UP(*offset, job->granularity) - *offset;
+            if (*bytes <= *qiov_offset) {
                 /* nothing to do after shrink */
-                return;
+                return false;
             }
-            offset += qiov_offset;
-            bytes -= qiov_offset;
+            *offset += *qiov_offset;
+            *bytes -= *qiov_offset;
     }
 
-    if (!QEMU_IS_ALIGNED(offset + bytes, job->granularity) &&
-        bdrv_dirty_bitmap_get(job->dirty_bitmap, offset + bytes - 1))
+    if (!QEMU_IS_ALIGNED(*offset + *bytes, job->granularity) &&
+        bdrv_dirty_bitmap_get(job->dirty_bitmap, *offset + *bytes - 1))
     {
-        uint64_t tail = (offset + bytes) % job->granularity;
+        uint64_t tail = (*offset + *bytes) % job->granularity;
 
-        if (bytes <= tail) {
+        if (*bytes <= tail) {
             /* nothing to do after shrink */
-            return;
+            return false;
         }
-        bytes -= tail;
+        *bytes -= tail;
     }
 
     /*
      * Tails are either clean or shrunk, so for bitmap resetting
      * we safely align the range down.
      */
-    bitmap_offset = QEMU_ALIGN_UP(offset, job->granularity);
-    bitmap_end = QEMU_ALIGN_DOWN(offset + bytes, job->granularity);
+    bitmap_offset = QEMU_ALIGN_UP(*offset, job->granularity);
+    bitmap_end = QEMU_ALIGN_DOWN(*offset + *bytes, job->granularity);
     if (bitmap_offset < bitmap_end) {
         bdrv_reset_dirty_bitmap(job->dirty_bitmap, bitmap_offset,
                                 bitmap_end - bitmap_offset);
     }
 
-    job_progress_increase_remaining(&job->common.job, bytes);
-    job->active_write_bytes_in_flight += bytes;
+    job_progress_increase_remaining(&job->common.job, *bytes);
+    job->active_write_bytes_in_flight += *bytes;
+    return true;
+}
+
+/* Write an area that was prepared by active_write_shrink() to the target */
+static void coroutine_fn
+active_write_to_target(MirrorBlockJob *job, MirrorMethod method,
+                       uint64_t offset, uint64_t bytes,
+                       QEMUIOVector *qiov, size_t qiov_offset, int flags)
+{
+    int ret;
+    int64_t bitmap_offset, bitmap_end;
 
     switch (method) {
     case MIRROR_METHOD_COPY:
@@ -1359,6 +1478,62 @@ do_sync_target_write(MirrorBlockJob *job, MirrorMethod method,
     }
 }
 
+static void coroutine_fn
+do_sync_target_write(MirrorBlockJob *job, MirrorMethod method,
+                     uint64_t offset, uint64_t bytes,
+                     QEMUIOVector *qiov, int flags)
+{
+    size_t qiov_offset;
+
+    if (active_write_shrink(job, &offset, &bytes, &qiov_offset)) {
+        active_write_to_target(job, method, offset, bytes, qiov, qiov_offset,
+                               flags);
+    }
+}
+
+/*
+ * Wait for the operations that an active write in write-async mode conflicts
+ * with.  In contrast to mirror_wait_on_conflicts(), this does not wait for
+ * active writes that are already queued: mirror_async_writer() takes care of
+ * writing overlapping areas to the target in the right order.
+ */
+static void coroutine_fn mirror_wait_on_async_conflicts(MirrorOp *self,
+                                                        MirrorBlockJob *s,
+                                                        uint64_t offset,
+                                                        uint64_t bytes)
+{
+    uint64_t self_start_chunk = offset / s->granularity;
+    uint64_t self_end_chunk = DIV_ROUND_UP(offset + bytes, s->granularity);
+    uint64_t self_nb_chunks = self_end_chunk - self_start_chunk;
+    MirrorOp *op;
+
+retry:
+    QTAILQ_FOREACH(op, &s->ops_in_flight, next) {
+        uint64_t op_start_chunk = op->offset / s->granularity;
+        uint64_t op_nb_chunks = DIV_ROUND_UP(op->offset + op->bytes,
+                                             s->granularity) -
+                                op_start_chunk;
+
+        if (s->ret < 0) {
+            return;
+        }
+
+        /* See mirror_wait_on_conflicts() for op->waiting_for_op */
+        if (op == self || op->is_queued || op->waiting_for_op) {
+            continue;
+        }
+
+        if (ranges_overlap(self_start_chunk, self_nb_chunks,
+                           op_start_chunk, op_nb_chunks))
+        {
+            self->waiting_for_op = op;
+            qemu_co_queue_wait(&op->waiting_requests, NULL);
+            self->waiting_for_op = NULL;
+            goto retry;
+        }
+    }
+}
+
 static MirrorOp *coroutine_fn active_write_prepare(MirrorBlockJob *s,
                                                    uint64_t offset,
                                                    uint64_t bytes)
@@ -1367,6 +1542,19 @@ static MirrorOp *coroutine_fn active_write_prepare(MirrorBlockJob *s,
     uint64_t start_chunk = offset / s->granularity;
     uint64_t end_chunk = DIV_ROUND_UP(offset + bytes, s->granularity);
 
+    if (s->copy_mode == MIRROR_COPY_MODE_WRITE_ASYNC) {
+        /*
+         * Do not let the target fall behind by more than the buffer size.
+         * A single write that is larger than that may still go ahead when
+         * the queue is empty.
+         */
+        while (s->async_bytes_queued > 0 &&
+               s->async_bytes_queued + bytes > s->buf_size) {
+            qemu_co_queue_wait(&s->async_write_done, NULL);
+        }
+        s->async_bytes_queued += bytes;
+    }
+
     op = g_new(MirrorOp, 1);
     *op = (MirrorOp){
         .s                  = s,
@@ -1394,7 +1582,11 @@ static MirrorOp *coroutine_fn active_write_prepare(MirrorBlockJob *s,
      * until the area is copied in full.  Therefore, we must wait for the whole
      * area to become free of concurrent requests.
      */
-    mirror_wait_on_conflicts(op, s, offset, bytes);
+    if (s->copy_mode == MIRROR_COPY_MODE_WRITE_ASYNC) {
+        mirror_wait_on_async_conflicts(op, s, offset, bytes);
+    } else {
+        mirror_wait_on_conflicts(op, s, offset, bytes);
+    }
 
     bitmap_set(s->in_flight_bitmap, start_chunk, end_chunk - start_chunk);
 
@@ -1403,12 +1595,13 @@ static MirrorOp *coroutine_fn active_write_prepare(MirrorBlockJob *s,
 
 static void coroutine_fn active_write_settle(MirrorOp *op)
 {
-    uint64_t start_chunk = op->offset / op->s->granularity;
+    MirrorBlockJob *s = op->s;
+    uint64_t start_chunk = op->offset / s->granularity;
     uint64_t end_chunk = DIV_ROUND_UP(op->offset + op->bytes,
-                                      op->s->granularity);
+                                      s->granularity);
 
-    if (!--op->s->in_active_write_counter && op->s->actively_synced) {
-        BdrvChild *source = op->s->mirror_top_bs->backing;
+    if (!--s->in_active_write_counter && s->actively_synced) {
+        BdrvChild *source = s->mirror_top_bs->backing;
 
         if (QLIST_FIRST(&source->bs->parents) == source &&
             QLIST_NEXT(source, next_parent) == NULL)
@@ -1417,34 +1610,188 @@ static void coroutine_fn active_write_settle(MirrorOp *op)
              * operations are settled.
              * Note that we can only assert this if the mirror node
              * is the source node's only parent. */
-            assert(!bdrv_get_dirty_count(op->s->dirty_bitmap));
+            assert(!bdrv_get_dirty_count(s->dirty_bitmap));
+        }
+    }
+    bitmap_clear(s->in_flight_bitmap, start_chunk, end_chunk - start_chunk);
+    QTAILQ_REMOVE(&s->ops_in_flight, op, next);
+
+    if (s->copy_mode == MIRROR_COPY_MODE_WRITE_ASYNC) {
+        MirrorOp *other;
+
+        /* Other active writes may still cover part of the area */
+        QTAILQ_FOREACH(other, &s->ops_in_flight, next) {
+            uint64_t other_start = other->offset / s->granularity;
+            uint64_t other_end = DIV_ROUND_UP(other->offset + other->bytes,
+                                              s->granularity);
+
+            if (other->is_active_write &&
+                other_start < end_chunk && start_chunk < other_end) {
+                bitmap_set(s->in_flight_bitmap, other_start,
+                           other_end - other_start);
+            }
         }
+
+        s->async_bytes_queued -= op->bytes;
+        qemu_co_queue_restart_all(&s->async_write_done);
     }
-    bitmap_clear(op->s->in_flight_bitmap, start_chunk, end_chunk - start_chunk);
-    QTAILQ_REMOVE(&op->s->ops_in_flight, op, next);
+
     qemu_co_queue_restart_all(&op->waiting_requests);
     g_free(op);
 }
 
+/*
+ * Write the queued active writes to the target, oldest first.  Contiguous
+ * writes of data are merged into a single request.
+ */
+static void coroutine_fn mirror_async_writer(void *opaque)
+{
+    MirrorBlockJob *s = opaque;
+
+    while (s->async_pending) {
+        MirrorOp *first = s->async_pending;
+        MirrorOp *last = first;
+        MirrorOp *op, *next;
+        QEMUIOVector qiov;
+        uint64_t bytes = first->target_bytes;
+        int niov = first->qiov.niov;
+        bool waited;
+
+        if (first->method == MIRROR_METHOD_COPY) {
+            while ((next = QTAILQ_NEXT(last, async_next)) &&
+                   next->method == MIRROR_METHOD_COPY &&
+                   next->flags == first->flags &&
+                   next->target_offset == first->target_offset + bytes &&
+                   bytes + next->target_bytes <= MAX_IO_BYTES &&
+                   niov + next->qiov.niov <= s->max_iov)
+            {
+                bytes += next->target_bytes;
+                niov += next->qiov.niov;
+                last = next;
+            }
+        }
+        s->async_pending = QTAILQ_NEXT(last, async_next);
+
+        /*
+         * Writes that were queued earlier and overlap with this one must
+         * reach the target first.
+         */
+        do {
+            waited = false;
+            QTAILQ_FOREACH(op, &s->async_ops, async_next) {
+                if (op == first) {
+                    break;
+                }
+                if (ranges_overlap(first->target_offset, bytes,
+                                   op->target_offset, op->target_bytes)) {
+                    qemu_co_queue_wait(&op->waiting_requests, NULL);
+                    waited = true;
+                    break;
+                }
+            }
+        } while (waited);
+
+        trace_mirror_async_write(s, first->target_offset, bytes);
+
+        qemu_iovec_init(&qiov, niov);
+        for (op = first; op != QTAILQ_NEXT(last, async_next);
+             op = QTAILQ_NEXT(op, async_next)) {
+            qemu_iovec_concat(&qiov, &op->qiov, 0, op->qiov.size);
+        }
+        active_write_to_target(s, first->method, first->target_offset, bytes,
+                               first->method == MIRROR_METHOD_COPY ?
+                               &qiov : NULL,
+                               0, first->flags);
+        qemu_iovec_destroy(&qiov);
+
+        for (op = first; op; op = next) {
+            next = op == last ? NULL : QTAILQ_NEXT(op, async_next);
+
+            QTAILQ_REMOVE(&s->async_ops, op, async_next);
+            qemu_iovec_destroy(&op->qiov);
+            qemu_vfree(op->bounce_buf);
+            active_write_settle(op);
+        }
+    }
+
+    s->async_writers--;
+}
+
+/*
+ * Queue an active write in write-async mode.  On success, the queue takes
+ * over @op and, for MIRROR_METHOD_COPY, *@bounce_buf, which is set to NULL.
+ * Returns false if nothing needs to be copied to the target.
+ */
+static bool coroutine_fn mirror_async_enqueue(MirrorOp *op,
+                                              MirrorMethod method,
+                                              QEMUIOVector *qiov,
+                                              void **bounce_buf, int flags)
+{
+    MirrorBlockJob *s = op->s;
+    uint64_t offset = op->offset;
+    uint64_t bytes = op->bytes;
+    size_t qiov_offset;
+
+    if (!active_write_shrink(s, &offset, &bytes, &qiov_offset)) {
+        return false;
+    }
+
+    op->method = method;
+    op->flags = flags;
+    op->target_offset = offset;
+    op->target_bytes = bytes;
+    qemu_iovec_init(&op->qiov, 1);
+    if (method == MIRROR_METHOD_COPY) {
+        qemu_iovec_concat(&op->qiov, qiov, qiov_offset, bytes);
+        op->bounce_buf = *bounce_buf;
+        *bounce_buf = NULL;
+    }
+
+    op->is_queued = true;
+    QTAILQ_INSERT_TAIL(&s->async_ops, op, async_next);
+    if (!s->async_pending) {
+        s->async_pending = op;
+    }
+
+    /* Writes to the same area that waited for us can be queued now */
+    qemu_co_queue_restart_all(&op->waiting_requests);
+
+    if (s->async_writers < MAX_IN_FLIGHT) {
+        Coroutine *co = qemu_coroutine_create(mirror_async_writer, s);
+
+        s->async_writers++;
+        qemu_coroutine_enter(co);
+    }
+    return true;
+}
+
 static int coroutine_fn bdrv_mirror_top_preadv(BlockDriverState *bs,
     int64_t offset, int64_t bytes, QEMUIOVector *qiov, BdrvRequestFlags flags)
 {
     return bdrv_co_preadv(bs->backing, offset, bytes, qiov, flags);
 }
 
+/*
+ * In write-async mode, the data of a MIRROR_METHOD_COPY write must be in a
+ * bounce buffer, which is passed in @bounce_buf.  If the write is queued for
+ * the target, the queue takes over the buffer and *@bounce_buf is set to
+ * NULL.
+ */
 static int coroutine_fn bdrv_mirror_top_do_write(BlockDriverState *bs,
     MirrorMethod method, uint64_t offset, uint64_t bytes, QEMUIOVector *qiov,
-    int flags)
+    int flags, void **bounce_buf)
 {
     MirrorOp *op = NULL;
     MirrorBDSOpaque *s = bs->opaque;
+    int64_t start_ns = 0;
     int ret = 0;
     bool copy_to_target = false;
 
     if (s->job) {
         copy_to_target = s->job->ret >= 0 &&
                          !job_is_cancelled(&s->job->common.job) &&
-                         s->job->copy_mode == MIRROR_COPY_MODE_WRITE_BLOCKING;
+                         s->job->copy_mode != MIRROR_COPY_MODE_BACKGROUND;
+        start_ns = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
     }
 
     if (copy_to_target) {
@@ -1473,13 +1820,24 @@ static int coroutine_fn bdrv_mirror_top_do_write(BlockDriverState *bs,
     }
 
     if (copy_to_target) {
-        do_sync_target_write(s->job, method, offset, bytes, qiov, flags);
+        if (s->job->copy_mode == MIRROR_COPY_MODE_WRITE_ASYNC) {
+            if (mirror_async_enqueue(op, method, qiov, bounce_buf, flags)) {
+                op = NULL;
+            }
+        } else {
+            do_sync_target_write(s->job, method, offset, bytes, qiov, flags);
+        }
     }
 
 out:
-    if (copy_to_target) {
+    if (op) {
         active_write_settle(op);
     }
+    if (s->job) {
+        uint64_t ns = qemu_clock_get_ns(QEMU_CLOCK_REALTIME) - start_ns;
+
+        stat64_add(&s->job->write_latency[mirror_latency_bucket(ns)], 1);
+    }
     return ret;
 }
 
@@ -1488,14 +1846,14 @@ static int coroutine_fn bdrv_mirror_top_pwritev(BlockDriverState *bs,
 {
     MirrorBDSOpaque *s = bs->opaque;
     QEMUIOVector bounce_qiov;
-    void *bounce_buf;
+    void *bounce_buf = NULL;
     int ret = 0;
     bool copy_to_target = false;
 
     if (s->job) {
         copy_to_target = s->job->ret >= 0 &&
                          !job_is_cancelled(&s->job->common.job) &&
-                         s->job->copy_mode == MIRROR_COPY_MODE_WRITE_BLOCKING;
+                         s->job->copy_mode != MIRROR_COPY_MODE_BACKGROUND;
     }
 
     if (copy_to_target) {
@@ -1514,7 +1872,7 @@ static int coroutine_fn bdrv_mirror_top_pwritev(BlockDriverState *bs,
     }
 
     ret = bdrv_mirror_top_do_write(bs, MIRROR_METHOD_COPY, offset, bytes, qiov,
-                                   flags);
+                                   flags, &bounce_buf);
 
     if (copy_to_target) {
         qemu_iovec_destroy(&bounce_qiov);
@@ -1537,14 +1895,14 @@ static int coroutine_fn bdrv_mirror_top_pwrite_zeroes(BlockDriverState *bs,
     int64_t offset, int64_t bytes, BdrvRequestFlags flags)
 {
     return bdrv_mirror_top_do_write(bs, MIRROR_METHOD_ZERO, offset, bytes, NULL,
-                                    flags);
+                                    flags, NULL);
 }
 
 static int coroutine_fn bdrv_mirror_top_pdiscard(BlockDriverState *bs,
     int64_t offset, int64_t bytes)
 {
     return bdrv_mirror_top_do_write(bs, MIRROR_METHOD_DISCARD, offset, bytes,
-                                    NULL, 0);
+                                    NULL, 0, NULL);
 }
 
 static void bdrv_mirror_top_refresh_filename(BlockDriverState *bs)
@@ -1792,7 +2150,7 @@ static BlockJob *mirror_start_job(
     if (!s->dirty_bitmap) {
         goto fail;
     }
-    if (s->copy_mode == MIRROR_COPY_MODE_WRITE_BLOCKING) {
+    if (s->copy_mode != MIRROR_COPY_MODE_BACKGROUND) {
         bdrv_disable_dirty_bitmap(s->dirty_bitmap);
     }
 
@@ -1855,6 +2213,8 @@ static BlockJob *mirror_start_job(
     }
 
     QTAILQ_INIT(&s->ops_in_flight);
+    QTAILQ_INIT(&s->async_ops);
+    qemu_co_queue_init(&s->async_write_done);
 
     trace_mirror_start(bs, s, opaque);
     job_start(&s->common.job);
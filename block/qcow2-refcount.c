@@ -30,6 +30,7 @@
 #include "qemu/bswap.h"
 #include "qemu/cutils.h"
 #include "qemu/memalign.h"
+#include "block/aio_task.h"
 #include "trace.h"
 
 static int64_t alloc_clusters_noref(BlockDriverState *bs, uint64_t size,
@@ -1242,25 +1243,325 @@ int qcow2_flush_caches(BlockDriverState *bs)
 
 
 
-/* update the refcounts of snapshots and the copied flag */
+/*
+ * Functions that walk all L2 tables of an L1 table read them in batches of
+ * at most L2_READ_BATCH tables and L2_READ_BATCH_BYTES bytes, with several
+ * reads in flight, and then process the batch in L1 order.
+ */
+#define L2_READ_BATCH           64
+#define L2_READ_BATCH_BYTES     (16 * MiB)
+
+typedef struct Qcow2ReadL2Task {
+    AioTask task;
+
+    BlockDriverState *bs;
+    uint64_t l2_offset;
+    uint64_t *l2_table;
+    int *ret;
+} Qcow2ReadL2Task;
+
+typedef struct Qcow2ReadL2Co {
+    BlockDriverState *bs;
+    const uint64_t *l1_table;
+    int n;
+    uint64_t *l2_tables;
+    int *l2_ret;
+    bool in_progress;
+} Qcow2ReadL2Co;
+
+static int l2_read_batch_size(BDRVQcow2State *s, int l1_size)
+{
+    size_t l2_size_bytes = s->l2_size * l2_entry_size(s);
+
+    return MAX(1, MIN(MIN(L2_READ_BATCH, L2_READ_BATCH_BYTES / l2_size_bytes),
+                      l1_size));
+}
+
+static uint64_t *l2_table_in_batch(BDRVQcow2State *s, uint64_t *l2_tables,
+                                   int index)
+{
+    return l2_tables + (size_t)index * s->l2_size *
+                       (l2_entry_size(s) / sizeof(uint64_t));
+}
+
+static coroutine_fn int read_l2_task_entry(AioTask *task)
+{
+    Qcow2ReadL2Task *t = container_of(task, Qcow2ReadL2Task, task);
+    BDRVQcow2State *s = t->bs->opaque;
+
+    *t->ret = bdrv_co_pread(t->bs->file, t->l2_offset,
+                            s->l2_size * l2_entry_size(s), t->l2_table, 0);
+    return 0;
+}
+
+static void coroutine_fn read_l2_tables_entry(void *opaque)
+{
+    Qcow2ReadL2Co *rc = opaque;
+    BDRVQcow2State *s = rc->bs->opaque;
+    AioTaskPool *pool = aio_task_pool_new(QCOW2_MAX_WORKERS);
+    int i;
+
+    for (i = 0; i < rc->n; i++) {
+        Qcow2ReadL2Task *task;
+
+        rc->l2_ret[i] = 0;
+        if (!rc->l1_table[i]) {
+            continue;
+        }
+
+        task = g_new(Qcow2ReadL2Task, 1);
+        *task = (Qcow2ReadL2Task) {
+            .task.func = read_l2_task_entry,
+            .bs = rc->bs,
+            .l2_offset = rc->l1_table[i] & L1E_OFFSET_MASK,
+            .l2_table = l2_table_in_batch(s, rc->l2_tables, i),
+            .ret = &rc->l2_ret[i],
+        };
+        aio_task_pool_start_task(pool, &task->task);
+    }
+
+    aio_task_pool_wait_all(pool);
+    aio_task_pool_free(pool);
+
+    rc->in_progress = false;
+    aio_wait_kick();
+}
+
+/*
+ * Reads the L2 tables referenced by the @n entries of @l1_table into
+ * consecutive tables of @l2_tables (see l2_table_in_batch()), and the result
+ * of each read into @l2_ret.  Up to QCOW2_MAX_WORKERS tables are read in
+ * parallel.  Unused L1 entries are skipped and get a result of 0.
+ *
+ * The tables are read from the image file, so the caller must make sure that
+ * the L2 table cache holds no dirty tables.
+ */
+static void read_l2_tables(BlockDriverState *bs, const uint64_t *l1_table,
+                           int n, uint64_t *l2_tables, int *l2_ret)
+{
+    Qcow2ReadL2Co rc = {
+        .bs = bs,
+        .l1_table = l1_table,
+        .n = n,
+        .l2_tables = l2_tables,
+        .l2_ret = l2_ret,
+        .in_progress = true,
+    };
+
+    if (qemu_in_coroutine()) {
+        read_l2_tables_entry(&rc);
+    } else {
+        Coroutine *co = qemu_coroutine_create(read_l2_tables_entry, &rc);
+        bdrv_coroutine_enter(bs, co);
+        BDRV_POLL_WHILE(bs, rc.in_progress);
+    }
+}
+
+static gint compare_cluster_indices(gconstpointer a, gconstpointer b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/*
+ * Adds @addend to the refcounts of the clusters in @clusters (an array of
+ * cluster indices, which may contain duplicates).  The array is sorted so
+ * that each run of contiguous clusters takes a single update_refcount() call,
+ * which goes through the refcount blocks in order.
+ */
+static int update_sorted_cluster_refcounts(BlockDriverState *bs,
+                                           GArray *clusters, int addend)
+{
+    BDRVQcow2State *s = bs->opaque;
+    guint i, start;
+    int ret;
+
+    g_array_sort(clusters, compare_cluster_indices);
+
+    for (start = 0; start < clusters->len; start = i) {
+        uint64_t first = g_array_index(clusters, uint64_t, start);
+
+        for (i = start + 1; i < clusters->len; i++) {
+            if (g_array_index(clusters, uint64_t, i) != first + (i - start)) {
+                break;
+            }
+        }
+
+        ret = update_refcount(bs, first << s->cluster_bits,
+                              (uint64_t)(i - start) << s->cluster_bits,
+                              abs(addend), addend < 0, QCOW2_DISCARD_SNAPSHOT);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Adds the clusters referenced by @l2_table to @clusters.  Returns -EIO after
+ * signalling corruption if an entry is unaligned.
+ */
+static int collect_l2_clusters(BlockDriverState *bs, uint64_t l2_offset,
+                               uint64_t *l2_table, GArray *clusters)
+{
+    BDRVQcow2State *s = bs->opaque;
+    int j;
+
+    for (j = 0; j < s->l2_size; j++) {
+        uint64_t entry = get_l2_entry(s, l2_table, j);
+        uint64_t offset = entry & L2E_OFFSET_MASK;
+        uint64_t cluster_index, last;
+        uint64_t coffset;
+        int csize;
+
+        switch (qcow2_get_cluster_type(bs, entry)) {
+        case QCOW2_CLUSTER_COMPRESSED:
+            qcow2_parse_compressed_l2_entry(bs, entry, &coffset, &csize);
+            last = (coffset + csize - 1) >> s->cluster_bits;
+            for (cluster_index = coffset >> s->cluster_bits;
+                 cluster_index <= last; cluster_index++) {
+                g_array_append_val(clusters, cluster_index);
+            }
+            break;
+
+        case QCOW2_CLUSTER_NORMAL:
+        case QCOW2_CLUSTER_ZERO_ALLOC:
+            if (offset_into_cluster(s, offset)) {
+                qcow2_signal_corruption(bs, true, -1, -1, "Cluster "
+                                        "allocation offset %#" PRIx64
+                                        " unaligned (L2 offset: %#"
+                                        PRIx64 ", L2 index: %#x)",
+                                        offset, l2_offset, j);
+                return -EIO;
+            }
+
+            cluster_index = offset >> s->cluster_bits;
+            assert(cluster_index);
+            g_array_append_val(clusters, cluster_index);
+            break;
+
+        case QCOW2_CLUSTER_ZERO_PLAIN:
+        case QCOW2_CLUSTER_UNALLOCATED:
+            break;
+
+        default:
+            abort();
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Sets QCOW_OFLAG_COPIED in the entries of @l2_table whose cluster has a
+ * refcount of 1 and clears it in all others.  Slices that change are
+ * updated in the L2 table cache.
+ */
+static int update_l2_copied_flags(BlockDriverState *bs, uint64_t l2_offset,
+                                  uint64_t *l2_table, int addend)
+{
+    BDRVQcow2State *s = bs->opaque;
+    unsigned slice, slice_size2, n_slices;
+    uint64_t *l2_slice = NULL;
+    int j, ret;
+
+    slice_size2 = s->l2_slice_size * l2_entry_size(s);
+    n_slices = s->cluster_size / slice_size2;
+
+    for (slice = 0; slice < n_slices; slice++) {
+        for (j = 0; j < s->l2_slice_size; j++) {
+            int l2_index = slice * s->l2_slice_size + j;
+            uint64_t old_entry = get_l2_entry(s, l2_table, l2_index);
+            uint64_t entry = old_entry & ~QCOW_OFLAG_COPIED;
+            uint64_t refcount;
+
+            switch (qcow2_get_cluster_type(bs, entry)) {
+            case QCOW2_CLUSTER_COMPRESSED:
+                /* compressed clusters are never modified */
+                refcount = 2;
+                break;
+
+            case QCOW2_CLUSTER_NORMAL:
+            case QCOW2_CLUSTER_ZERO_ALLOC:
+                ret = qcow2_get_refcount(bs, (entry & L2E_OFFSET_MASK) >>
+                                             s->cluster_bits, &refcount);
+                if (ret < 0) {
+                    goto fail;
+                }
+                break;
+
+            case QCOW2_CLUSTER_ZERO_PLAIN:
+            case QCOW2_CLUSTER_UNALLOCATED:
+                refcount = 0;
+                break;
+
+            default:
+                abort();
+            }
+
+            if (refcount == 1) {
+                entry |= QCOW_OFLAG_COPIED;
+            }
+            if (entry == old_entry) {
+                continue;
+            }
+
+            if (!l2_slice) {
+                ret = qcow2_cache_get(bs, s->l2_table_cache,
+                                      l2_offset + slice * slice_size2,
+                                      (void **) &l2_slice);
+                if (ret < 0) {
+                    goto fail;
+                }
+                if (addend > 0) {
+                    qcow2_cache_set_dependency(bs, s->l2_table_cache,
+                                               s->refcount_block_cache);
+                }
+                qcow2_cache_entry_mark_dirty(s->l2_table_cache, l2_slice);
+            }
+            set_l2_entry(s, l2_slice, j, entry);
+        }
+
+        if (l2_slice) {
+            qcow2_cache_put(s->l2_table_cache, (void **) &l2_slice);
+        }
+    }
+
+    ret = 0;
+fail:
+    if (l2_slice) {
+        qcow2_cache_put(s->l2_table_cache, (void **) &l2_slice);
+    }
+    return ret;
+}
+
+/*
+ * update the refcounts of snapshots and the copied flag
+ *
+ * The L2 tables are read in parallel, a batch at a time, and the refcounts of
+ * all clusters referenced by a batch are updated in a single sorted pass
+ * before the copied flags are fixed up.
+ */
 int qcow2_update_snapshot_refcount(BlockDriverState *bs,
     int64_t l1_table_offset, int l1_size, int addend)
 {
     BDRVQcow2State *s = bs->opaque;
-    uint64_t *l1_table, *l2_slice, l2_offset, entry, l1_size2, refcount;
+    uint64_t *l1_table, *l2_tables, *l2_table, l2_offset, l1_size2, refcount;
     bool l1_allocated = false;
-    int64_t old_entry, old_l2_offset;
-    unsigned slice, slice_size2, n_slices;
-    int i, j, l1_modified = 0;
+    int64_t old_l2_offset;
+    g_autofree int *l2_ret = NULL;
+    g_autoptr(GArray) clusters = NULL;
+    int i, j, n, batch, l1_modified = 0;
     int ret;
 
     assert(addend >= -1 && addend <= 1);
 
-    l2_slice = NULL;
+    l2_tables = NULL;
     l1_table = NULL;
     l1_size2 = l1_size * L1E_SIZE;
-    slice_size2 = s->l2_slice_size * l2_entry_size(s);
-    n_slices = s->cluster_size / slice_size2;
 
     s->cache_discards = true;
 
@@ -1289,113 +1590,74 @@ int qcow2_update_snapshot_refcount(BlockDriverState *bs,
         l1_allocated = false;
     }
 
-    for (i = 0; i < l1_size; i++) {
-        l2_offset = l1_table[i];
-        if (l2_offset) {
-            old_l2_offset = l2_offset;
-            l2_offset &= L1E_OFFSET_MASK;
+    /* L2 tables are read from the image file, bypassing the cache */
+    ret = qcow2_cache_write(bs, s->l2_table_cache);
+    if (ret < 0) {
+        goto fail;
+    }
 
+    batch = l2_read_batch_size(s, l1_size);
+    l2_tables = qemu_try_blockalign(bs->file->bs,
+                                    batch * s->l2_size * l2_entry_size(s));
+    if (l2_tables == NULL) {
+        ret = -ENOMEM;
+        goto fail;
+    }
+    l2_ret = g_new(int, batch);
+    clusters = g_array_new(false, false, sizeof(uint64_t));
+
+    for (i = 0; i < l1_size; i += n) {
+        n = MIN(batch, l1_size - i);
+
+        for (j = 0; j < n; j++) {
+            l2_offset = l1_table[i + j] & L1E_OFFSET_MASK;
             if (offset_into_cluster(s, l2_offset)) {
                 qcow2_signal_corruption(bs, true, -1, -1, "L2 table offset %#"
                                         PRIx64 " unaligned (L1 index: %#x)",
-                                        l2_offset, i);
+                                        l2_offset, i + j);
                 ret = -EIO;
                 goto fail;
             }
+        }
 
-            for (slice = 0; slice < n_slices; slice++) {
-                ret = qcow2_cache_get(bs, s->l2_table_cache,
-                                      l2_offset + slice * slice_size2,
-                                      (void **) &l2_slice);
+        read_l2_tables(bs, &l1_table[i], n, l2_tables, l2_ret);
+
+        g_array_set_size(clusters, 0);
+        for (j = 0; j < n; j++) {
+            if (!l1_table[i + j]) {
+                continue;
+            }
+            ret = l2_ret[j];
+            if (ret < 0) {
+                goto fail;
+            }
+            if (addend != 0) {
+                ret = collect_l2_clusters(bs, l1_table[i + j] & L1E_OFFSET_MASK,
+                                          l2_table_in_batch(s, l2_tables, j),
+                                          clusters);
                 if (ret < 0) {
                     goto fail;
                 }
+            }
+        }
 
-                for (j = 0; j < s->l2_slice_size; j++) {
-                    uint64_t cluster_index;
-                    uint64_t offset;
-
-                    entry = get_l2_entry(s, l2_slice, j);
-                    old_entry = entry;
-                    entry &= ~QCOW_OFLAG_COPIED;
-                    offset = entry & L2E_OFFSET_MASK;
-
-                    switch (qcow2_get_cluster_type(bs, entry)) {
-                    case QCOW2_CLUSTER_COMPRESSED:
-                        if (addend != 0) {
-                            uint64_t coffset;
-                            int csize;
-
-                            qcow2_parse_compressed_l2_entry(bs, entry,
-                                                            &coffset, &csize);
-                            ret = update_refcount(
-                                bs, coffset, csize,
-                                abs(addend), addend < 0,
-                                QCOW2_DISCARD_SNAPSHOT);
-                            if (ret < 0) {
-                                goto fail;
-                            }
-                        }
-                        /* compressed clusters are never modified */
-                        refcount = 2;
-                        break;
-
-                    case QCOW2_CLUSTER_NORMAL:
-                    case QCOW2_CLUSTER_ZERO_ALLOC:
-                        if (offset_into_cluster(s, offset)) {
-                            /* Here l2_index means table (not slice) index */
-                            int l2_index = slice * s->l2_slice_size + j;
-                            qcow2_signal_corruption(
-                                bs, true, -1, -1, "Cluster "
-                                "allocation offset %#" PRIx64
-                                " unaligned (L2 offset: %#"
-                                PRIx64 ", L2 index: %#x)",
-                                offset, l2_offset, l2_index);
-                            ret = -EIO;
-                            goto fail;
-                        }
-
-                        cluster_index = offset >> s->cluster_bits;
-                        assert(cluster_index);
-                        if (addend != 0) {
-                            ret = qcow2_update_cluster_refcount(
-                                bs, cluster_index, abs(addend), addend < 0,
-                                QCOW2_DISCARD_SNAPSHOT);
-                            if (ret < 0) {
-                                goto fail;
-                            }
-                        }
-
-                        ret = qcow2_get_refcount(bs, cluster_index, &refcount);
-                        if (ret < 0) {
-                            goto fail;
-                        }
-                        break;
-
-                    case QCOW2_CLUSTER_ZERO_PLAIN:
-                    case QCOW2_CLUSTER_UNALLOCATED:
-                        refcount = 0;
-                        break;
-
-                    default:
-                        abort();
-                    }
+        ret = update_sorted_cluster_refcounts(bs, clusters, addend);
+        if (ret < 0) {
+            goto fail;
+        }
 
-                    if (refcount == 1) {
-                        entry |= QCOW_OFLAG_COPIED;
-                    }
-                    if (entry != old_entry) {
-                        if (addend > 0) {
-                            qcow2_cache_set_dependency(bs, s->l2_table_cache,
-                                                       s->refcount_block_cache);
-                        }
-                        set_l2_entry(s, l2_slice, j, entry);
-                        qcow2_cache_entry_mark_dirty(s->l2_table_cache,
-                                                     l2_slice);
-                    }
-                }
+        for (j = 0; j < n; j++) {
+            l2_offset = l1_table[i + j];
+            if (!l2_offset) {
+                continue;
+            }
+            old_l2_offset = l2_offset;
+            l2_offset &= L1E_OFFSET_MASK;
+            l2_table = l2_table_in_batch(s, l2_tables, j);
 
-                qcow2_cache_put(s->l2_table_cache, (void **) &l2_slice);
+            ret = update_l2_copied_flags(bs, l2_offset, l2_table, addend);
+            if (ret < 0) {
+                goto fail;
             }
 
             if (addend != 0) {
@@ -1415,7 +1677,7 @@ int qcow2_update_snapshot_refcount(BlockDriverState *bs,
                 l2_offset |= QCOW_OFLAG_COPIED;
             }
             if (l2_offset != old_l2_offset) {
-                l1_table[i] = l2_offset;
+                l1_table[i + j] = l2_offset;
                 l1_modified = 1;
             }
         }
@@ -1423,9 +1685,7 @@ int qcow2_update_snapshot_refcount(BlockDriverState *bs,
 
     ret = bdrv_flush(bs);
 fail:
-    if (l2_slice) {
-        qcow2_cache_put(s->l2_table_cache, (void **) &l2_slice);
-    }
+    qemu_vfree(l2_tables);
 
     s->cache_discards = false;
     qcow2_process_discards(bs, ret);
@@ -1591,6 +1851,14 @@ enum {
     CHECK_FRAG_INFO = 0x2,      /* update BlockFragInfo counters */
 };
 
+/* Progress of qcow2_check_refcounts(), counted in L1 entries */
+typedef struct Qcow2CheckProgress {
+    BdrvCheckStatusCB *cb;
+    void *opaque;
+    int64_t done;
+    int64_t total;
+} Qcow2CheckProgress;
+
 /*
  * Fix L2 entry by making it QCOW2_CLUSTER_ZERO_PLAIN (or making all its present
  * subclusters QCOW2_SUBCLUSTER_ZERO_PLAIN).
@@ -1653,8 +1921,8 @@ fail:
 
 /*
  * Increases the refcount in the given refcount table for the all clusters
- * referenced in the L2 table. While doing so, performs some checks on L2
- * entries.
+ * referenced in the L2 table, which the caller has read from @l2_offset.
+ * While doing so, performs some checks on L2 entries.
  *
  * Returns the number of errors found by the checks or -errno if an internal
  * error occurred.
@@ -1662,24 +1930,15 @@ fail:
 static int check_refcounts_l2(BlockDriverState *bs, BdrvCheckResult *res,
                               void **refcount_table,
                               int64_t *refcount_table_size, int64_t l2_offset,
-                              int flags, BdrvCheckMode fix, bool active)
+                              uint64_t *l2_table, int flags, BdrvCheckMode fix,
+                              bool active)
 {
     BDRVQcow2State *s = bs->opaque;
     uint64_t l2_entry, l2_bitmap;
     uint64_t next_contiguous_offset = 0;
     int i, ret;
-    size_t l2_size_bytes = s->l2_size * l2_entry_size(s);
-    g_autofree uint64_t *l2_table = g_malloc(l2_size_bytes);
     bool metadata_overlap;
 
-    /* Read L2 table from disk */
-    ret = bdrv_pread(bs->file, l2_offset, l2_size_bytes, l2_table, 0);
-    if (ret < 0) {
-        fprintf(stderr, "ERROR: I/O error in check_refcounts_l2\n");
-        res->check_errors++;
-        return ret;
-    }
-
     /* Do the actual checks */
     for (i = 0; i < s->l2_size; i++) {
         uint64_t coffset;
@@ -1863,13 +2122,18 @@ static int check_refcounts_l1(BlockDriverState *bs,
                               void **refcount_table,
                               int64_t *refcount_table_size,
                               int64_t l1_table_offset, int l1_size,
-                              int flags, BdrvCheckMode fix, bool active)
+                              int flags, BdrvCheckMode fix, bool active,
+                              Qcow2CheckProgress *progress)
 {
     BDRVQcow2State *s = bs->opaque;
     size_t l1_size_bytes = l1_size * L1E_SIZE;
+    size_t l2_size_bytes = s->l2_size * l2_entry_size(s);
     g_autofree uint64_t *l1_table = NULL;
+    g_autofree int *l2_ret = NULL;
+    uint64_t *l2_tables = NULL;
+    uint64_t *l2_table;
     uint64_t l2_offset;
-    int i, ret;
+    int i, batch, ret;
 
     if (!l1_size) {
         return 0;
@@ -1900,8 +2164,32 @@ static int check_refcounts_l1(BlockDriverState *bs,
         be64_to_cpus(&l1_table[i]);
     }
 
+    /*
+     * Checking is cheap compared to reading the L2 tables, so read a batch of
+     * them at a time, in parallel, and then check them in order.
+     */
+    batch = l2_read_batch_size(s, l1_size);
+    l2_tables = qemu_try_blockalign(bs->file->bs, batch * l2_size_bytes);
+    if (l2_tables == NULL) {
+        res->check_errors++;
+        return -ENOMEM;
+    }
+    l2_ret = g_new(int, batch);
+
     /* Do the actual checks */
     for (i = 0; i < l1_size; i++) {
+        if (i % batch == 0) {
+            int n = MIN(batch, l1_size - i);
+
+            if (progress && progress->cb) {
+                progress->cb(bs, progress->done, progress->total,
+                             progress->opaque);
+                progress->done += n;
+            }
+            read_l2_tables(bs, &l1_table[i], n, l2_tables, l2_ret);
+        }
+        l2_table = l2_table_in_batch(s, l2_tables, i % batch);
+
         if (!l1_table[i]) {
             continue;
         }
@@ -1919,7 +2207,7 @@ static int check_refcounts_l1(BlockDriverState *bs,
                                        refcount_table, refcount_table_size,
                                        l2_offset, s->cluster_size);
         if (ret < 0) {
-            return ret;
+            goto out;
         }
 
         /* L2 tables are cluster aligned */
@@ -1929,16 +2217,26 @@ static int check_refcounts_l1(BlockDriverState *bs,
             res->corruptions++;
         }
 
+        ret = l2_ret[i % batch];
+        if (ret < 0) {
+            fprintf(stderr, "ERROR: I/O error in check_refcounts_l2\n");
+            res->check_errors++;
+            goto out;
+        }
+
         /* Process and check L2 entries */
         ret = check_refcounts_l2(bs, res, refcount_table,
-                                 refcount_table_size, l2_offset, flags,
-                                 fix, active);
+                                 refcount_table_size, l2_offset, l2_table,
+                                 flags, fix, active);
         if (ret < 0) {
-            return ret;
+            goto out;
         }
     }
 
-    return 0;
+    ret = 0;
+out:
+    qemu_vfree(l2_tables);
+    return ret;
 }
 
 /*
@@ -2199,13 +2497,21 @@ resize_fail:
  */
 static int calculate_refcounts(BlockDriverState *bs, BdrvCheckResult *res,
                                BdrvCheckMode fix, bool *rebuild,
-                               void **refcount_table, int64_t *nb_clusters)
+                               void **refcount_table, int64_t *nb_clusters,
+                               Qcow2CheckProgress *progress)
 {
     BDRVQcow2State *s = bs->opaque;
     int64_t i;
     QCowSnapshot *sn;
     int ret;
 
+    /* Progress is counted in L1 entries of the active and snapshot tables */
+    progress->done = 0;
+    progress->total = s->l1_size;
+    for (i = 0; i < s->nb_snapshots; i++) {
+        progress->total += s->snapshots[i].l1_size;
+    }
+
     if (!*refcount_table) {
         int64_t old_size = 0;
         ret = realloc_refcount_array(s, refcount_table,
@@ -2226,7 +2532,7 @@ static int calculate_refcounts(BlockDriverState *bs, BdrvCheckResult *res,
     /* current L1 table */
     ret = check_refcounts_l1(bs, res, refcount_table, nb_clusters,
                              s->l1_table_offset, s->l1_size, CHECK_FRAG_INFO,
-                             fix, true);
+                             fix, true, progress);
     if (ret < 0) {
         return ret;
     }
@@ -2256,7 +2562,7 @@ static int calculate_refcounts(BlockDriverState *bs, BdrvCheckResult *res,
         }
         ret = check_refcounts_l1(bs, res, refcount_table, nb_clusters,
                                  sn->l1_table_offset, sn->l1_size, 0, fix,
-                                 false);
+                                 false, progress);
         if (ret < 0) {
             return ret;
         }
@@ -2778,12 +3084,17 @@ fail:
  * detected as corrupted, and -errno when an internal error occurred.
  */
 int qcow2_check_refcounts(BlockDriverState *bs, BdrvCheckResult *res,
-                          BdrvCheckMode fix)
+                          BdrvCheckMode fix, BdrvCheckStatusCB *status_cb,
+                          void *cb_opaque)
 {
     BDRVQcow2State *s = bs->opaque;
     BdrvCheckResult pre_compare_res;
     int64_t size, highest_cluster, nb_clusters;
     void *refcount_table = NULL;
+    Qcow2CheckProgress progress = {
+        .cb = status_cb,
+        .opaque = cb_opaque,
+    };
     bool rebuild = false;
     int ret;
 
@@ -2803,7 +3114,7 @@ int qcow2_check_refcounts(BlockDriverState *bs, BdrvCheckResult *res,
         size_to_clusters(s, bs->total_sectors * BDRV_SECTOR_SIZE);
 
     ret = calculate_refcounts(bs, res, fix, &rebuild, &refcount_table,
-                              &nb_clusters);
+                              &nb_clusters, &progress);
     if (ret < 0) {
         goto fail;
     }
@@ -2835,8 +3146,9 @@ int qcow2_check_refcounts(BlockDriverState *bs, BdrvCheckResult *res,
          * references have to be recalculated */
         rebuild = false;
         memset(refcount_table, 0, refcount_array_byte_size(s, nb_clusters));
+        progress.cb = NULL;
         ret = calculate_refcounts(bs, res, 0, &rebuild, &refcount_table,
-                                  &nb_clusters);
+                                  &nb_clusters, &progress);
         if (ret < 0) {
             goto fail;
         }
@@ -603,7 +603,9 @@ static void qcow2_add_check_result(BdrvCheckResult *out,
 
 static int coroutine_fn qcow2_co_check_locked(BlockDriverState *bs,
                                               BdrvCheckResult *result,
-                                              BdrvCheckMode fix)
+                                              BdrvCheckMode fix,
+                                              BdrvCheckStatusCB *status_cb,
+                                              void *cb_opaque)
 {
     BdrvCheckResult snapshot_res = {};
     BdrvCheckResult refcount_res = {};
@@ -617,7 +619,7 @@ static int coroutine_fn qcow2_co_check_locked(BlockDriverState *bs,
         return ret;
     }
 
-    ret = qcow2_check_refcounts(bs, &refcount_res, fix);
+    ret = qcow2_check_refcounts(bs, &refcount_res, fix, status_cb, cb_opaque);
     qcow2_add_check_result(result, &refcount_res, true);
     if (ret < 0) {
         qcow2_add_check_result(result, &snapshot_res, false);
@@ -642,13 +644,15 @@ static int coroutine_fn qcow2_co_check_locked(BlockDriverState *bs,
 
 static int coroutine_fn qcow2_co_check(BlockDriverState *bs,
                                        BdrvCheckResult *result,
-                                       BdrvCheckMode fix)
+                                       BdrvCheckMode fix,
+                                       BdrvCheckStatusCB *status_cb,
+                                       void *cb_opaque)
 {
     BDRVQcow2State *s = bs->opaque;
     int ret;
 
     qemu_co_mutex_lock(&s->lock);
-    ret = qcow2_co_check_locked(bs, result, fix);
+    ret = qcow2_co_check_locked(bs, result, fix, status_cb, cb_opaque);
     qemu_co_mutex_unlock(&s->lock);
     return ret;
 }
@@ -1830,7 +1834,8 @@ static int coroutine_fn qcow2_do_open(BlockDriverState *bs, QDict *options,
         BdrvCheckResult result = {0};
 
         ret = qcow2_co_check_locked(bs, &result,
-                                    BDRV_FIX_ERRORS | BDRV_FIX_LEAKS);
+                                    BDRV_FIX_ERRORS | BDRV_FIX_LEAKS,
+                                    NULL, NULL);
         if (ret < 0 || result.check_errors) {
             if (ret >= 0) {
                 ret = -EIO;
@@ -1843,7 +1848,7 @@ static int coroutine_fn qcow2_do_open(BlockDriverState *bs, QDict *options,
 #ifdef DEBUG_ALLOC
     {
         BdrvCheckResult result = {0};
-        qcow2_check_refcounts(bs, &result, 0);
+        qcow2_check_refcounts(bs, &result, 0, NULL, NULL);
     }
 #endif
 
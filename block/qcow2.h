@@ -877,7 +877,8 @@ int qcow2_update_snapshot_refcount(BlockDriverState *bs,
 int qcow2_flush_caches(BlockDriverState *bs);
 int qcow2_write_caches(BlockDriverState *bs);
 int qcow2_check_refcounts(BlockDriverState *bs, BdrvCheckResult *res,
-                          BdrvCheckMode fix);
+                          BdrvCheckMode fix, BdrvCheckStatusCB *status_cb,
+                          void *cb_opaque);
 
 void qcow2_process_discards(BlockDriverState *bs, int ret);
 
@@ -21,6 +21,7 @@
 #include "qemu/ratelimit.h"
 #include "sysemu/block-backend.h"
 #include "block/copy-on-read.h"
+#include "block/aio_task.h"
 
 enum {
     /*
@@ -29,6 +30,15 @@ enum {
      * that populating contiguous regions of the image is efficient.
      */
     STREAM_CHUNK = 512 * 1024, /* in bytes */
+
+    /*
+     * The chunk size doubles with every chunk that is copied successfully,
+     * up to this limit.
+     */
+    STREAM_MAX_CHUNK = 8 * 1024 * 1024, /* in bytes */
+
+    /* Maximum number of chunks that are copied in parallel */
+    STREAM_MAX_WORKERS = 8,
 };
 
 typedef struct StreamBlockJob {
@@ -41,8 +51,23 @@ typedef struct StreamBlockJob {
     BlockdevOnError on_error;
     char *backing_file_str;
     bool bs_read_only;
+
+    int64_t chunk;      /* current chunk size, in bytes */
 } StreamBlockJob;
 
+typedef struct StreamChunk {
+    int64_t offset;
+    int64_t bytes;
+    bool done;          /* copied successfully */
+    int ret;            /* result of the last attempt to copy it */
+} StreamChunk;
+
+typedef struct StreamTask {
+    AioTask task;
+    StreamBlockJob *s;
+    StreamChunk *chunk;
+} StreamTask;
+
 static int coroutine_fn stream_populate(BlockBackend *blk,
                                         int64_t offset, uint64_t bytes)
 {
@@ -51,6 +76,37 @@ static int coroutine_fn stream_populate(BlockBackend *blk,
     return blk_co_preadv(blk, offset, bytes, NULL, BDRV_REQ_PREFETCH);
 }
 
+static coroutine_fn int stream_task_entry(AioTask *task)
+{
+    StreamTask *t = container_of(task, StreamTask, task);
+    StreamBlockJob *s = t->s;
+    StreamChunk *c = t->chunk;
+
+    c->ret = stream_populate(s->blk, c->offset, c->bytes);
+    c->done = c->ret >= 0;
+    if (c->done) {
+        s->chunk = MIN(s->chunk * 2, STREAM_MAX_CHUNK);
+    } else {
+        s->chunk = STREAM_CHUNK;
+    }
+
+    /* Errors are handled by stream_run() */
+    return 0;
+}
+
+/*
+ * Number of bytes that are copied before the job yields, i.e. what the rate
+ * limit allows in a time slice
+ */
+static int64_t stream_window_size(StreamBlockJob *s)
+{
+    if (s->common.speed) {
+        return MAX(STREAM_CHUNK, s->common.speed * BLOCK_JOB_SLICE_TIME /
+                                 NANOSECONDS_PER_SECOND);
+    }
+    return INT64_MAX;
+}
+
 static int stream_prepare(Job *job)
 {
     StreamBlockJob *s = container_of(job, StreamBlockJob, common.job);
@@ -130,8 +186,13 @@ static int coroutine_fn stream_run(Job *job, Error **errp)
 {
     StreamBlockJob *s = container_of(job, StreamBlockJob, common.job);
     BlockDriverState *unfiltered_bs = bdrv_skip_filters(s->target_bs);
+    StreamChunk chunks[STREAM_MAX_WORKERS];
+    int nb_chunks = 0; /* chunks from @offset on, not published yet */
+    AioTaskPool *pool;
     int64_t len;
     int64_t offset = 0;
+    int64_t extent_end = 0; /* end of the area whose allocation is known */
+    bool copy = false;
     uint64_t delay_ns = 0;
     int error = 0;
     int64_t n = 0; /* bytes */
@@ -147,9 +208,12 @@ static int coroutine_fn stream_run(Job *job, Error **errp)
     }
     job_progress_set_remaining(&s->common.job, len);
 
-    for ( ; offset < len; offset += n) {
-        bool copy;
-        int ret;
+    s->chunk = STREAM_CHUNK;
+    pool = aio_task_pool_new(STREAM_MAX_WORKERS);
+
+    while (offset < len) {
+        int64_t window_end, window_size, copied;
+        int ret, i;
 
         /* Note that even when no rate limit is applied we need to yield
          * with no pending I/O here so that bdrv_drain_all() returns.
@@ -158,53 +222,142 @@ static int coroutine_fn stream_run(Job *job, Error **errp)
         if (job_is_cancelled(&s->common.job)) {
             break;
         }
-
-        copy = false;
-
-        ret = bdrv_is_allocated(unfiltered_bs, offset, STREAM_CHUNK, &n);
-        if (ret == 1) {
-            /* Allocated in the top, no need to copy.  */
-        } else if (ret >= 0) {
-            /* Copy if allocated in the intermediate images.  Limit to the
-             * known-unallocated area [offset, offset+n*BDRV_SECTOR_SIZE).  */
-            ret = bdrv_is_allocated_above(bdrv_cow_bs(unfiltered_bs),
-                                          s->base_overlay, true,
-                                          offset, n, &n);
-            /* Finish early if end of backing file has been reached */
-            if (ret == 0 && n == 0) {
-                n = len - offset;
+        delay_ns = 0;
+
+        if (offset >= extent_end) {
+            /*
+             * Look up the allocation status of the whole remaining area; it
+             * is then copied in chunks.
+             */
+            assert(nb_chunks == 0);
+            copy = false;
+            ret = bdrv_is_allocated(unfiltered_bs, offset, len - offset, &n);
+            if (ret == 1) {
+                /* Allocated in the top, no need to copy.  */
+            } else if (ret >= 0) {
+                /*
+                 * Copy if allocated in the intermediate images.  Limit to
+                 * the known-unallocated area [offset, offset + n).
+                 */
+                ret = bdrv_is_allocated_above(bdrv_cow_bs(unfiltered_bs),
+                                              s->base_overlay, true,
+                                              offset, n, &n);
+                /* Finish early if end of backing file has been reached */
+                if (ret == 0 && n == 0) {
+                    n = len - offset;
+                }
+
+                copy = (ret > 0);
             }
+            trace_stream_one_iteration(s, offset, n, ret);
+            if (ret < 0) {
+                BlockErrorAction action =
+                    block_job_error_action(&s->common, s->on_error, true,
+                                           -ret);
+                if (action == BLOCK_ERROR_ACTION_STOP) {
+                    continue;
+                }
+                if (error == 0) {
+                    error = ret;
+                }
+                if (action == BLOCK_ERROR_ACTION_REPORT) {
+                    break;
+                }
+                /* Skip a chunk, as if copying it had failed */
+                n = MIN(STREAM_CHUNK, len - offset);
+                job_progress_update(&s->common.job, n);
+                offset += n;
+                continue;
+            }
+            extent_end = offset + n;
+        }
 
-            copy = (ret > 0);
+        if (!copy) {
+            /* Publish progress */
+            job_progress_update(&s->common.job, extent_end - offset);
+            offset = extent_end;
+            continue;
         }
-        trace_stream_one_iteration(s, offset, n, ret);
-        if (copy) {
-            ret = stream_populate(s->blk, offset, n);
+
+        /*
+         * Chunks left over from the last round either failed and are copied
+         * again, or wait for a failed one before them.  Add new chunks after
+         * them, up to the end of the extent.
+         */
+        window_end = offset;
+        if (nb_chunks) {
+            window_end = chunks[nb_chunks - 1].offset +
+                         chunks[nb_chunks - 1].bytes;
         }
-        if (ret < 0) {
-            BlockErrorAction action =
-                block_job_error_action(&s->common, s->on_error, true, -ret);
-            if (action == BLOCK_ERROR_ACTION_STOP) {
-                n = 0;
+        window_size = stream_window_size(s);
+        while (nb_chunks < STREAM_MAX_WORKERS && window_end < extent_end &&
+               window_end - offset < window_size) {
+            n = MIN(s->chunk, MIN(extent_end - window_end, window_size));
+            chunks[nb_chunks++] = (StreamChunk) {
+                .offset = window_end,
+                .bytes = n,
+            };
+            window_end += n;
+        }
+
+        /* Only account what is copied in this round to the rate limit */
+        copied = 0;
+        for (i = 0; i < nb_chunks; i++) {
+            StreamTask *task;
+
+            if (chunks[i].done) {
+                copied -= chunks[i].bytes;
                 continue;
             }
-            if (error == 0) {
-                error = ret;
-            }
-            if (action == BLOCK_ERROR_ACTION_REPORT) {
-                break;
+            task = g_new(StreamTask, 1);
+            *task = (StreamTask) {
+                .task.func = stream_task_entry,
+                .s = s,
+                .chunk = &chunks[i],
+            };
+            aio_task_pool_start_task(pool, &task->task);
+        }
+        aio_task_pool_wait_all(pool);
+
+        for (i = 0; i < nb_chunks; i++) {
+            if (chunks[i].done) {
+                copied += chunks[i].bytes;
             }
         }
+        delay_ns = block_job_ratelimit_get_delay(&s->common, copied);
 
-        /* Publish progress */
-        job_progress_update(&s->common.job, n);
-        if (copy) {
-            delay_ns = block_job_ratelimit_get_delay(&s->common, n);
-        } else {
-            delay_ns = 0;
+        /*
+         * Publish progress up to the first chunk that failed, and apply the
+         * error policy to it, as if the chunks were copied one by one.
+         * Chunks after it are kept until it is done.
+         */
+        for (i = 0; i < nb_chunks; i++) {
+            StreamChunk *c = &chunks[i];
+
+            if (!c->done) {
+                BlockErrorAction action =
+                    block_job_error_action(&s->common, s->on_error, true,
+                                           -c->ret);
+                if (action == BLOCK_ERROR_ACTION_STOP) {
+                    break;
+                }
+                if (error == 0) {
+                    error = c->ret;
+                }
+                if (action == BLOCK_ERROR_ACTION_REPORT) {
+                    goto out;
+                }
+            }
+            job_progress_update(&s->common.job, c->bytes);
+            offset += c->bytes;
         }
+        nb_chunks -= i;
+        memmove(chunks, &chunks[i], nb_chunks * sizeof(chunks[0]));
     }
 
+out:
+    aio_task_pool_free(pool);
+
     /* Do not remove the backing file if an error was there but ignored. */
     return error;
 }
@@ -2158,7 +2158,9 @@ fail:
  */
 static int coroutine_fn vhdx_co_check(BlockDriverState *bs,
                                       BdrvCheckResult *result,
-                                      BdrvCheckMode fix)
+                                      BdrvCheckMode fix,
+                                      BdrvCheckStatusCB *status_cb,
+                                      void *cb_opaque)
 {
     BDRVVHDXState *s = bs->opaque;
 
@@ -2918,7 +2918,9 @@ static VmdkExtentInfo *vmdk_get_extent_info(VmdkExtent *extent)
 
 static int coroutine_fn vmdk_co_check(BlockDriverState *bs,
                                       BdrvCheckResult *result,
-                                      BdrvCheckMode fix)
+                                      BdrvCheckMode fix,
+                                      BdrvCheckStatusCB *status_cb,
+                                      void *cb_opaque)
 {
     BDRVVmdkState *s = bs->opaque;
     VmdkExtent *extent = NULL;
@@ -327,6 +327,7 @@ int64_t block_job_ratelimit_get_delay(BlockJob *job, uint64_t n)
 
 BlockJobInfo *block_job_query_locked(BlockJob *job, Error **errp)
 {
+    const BlockJobDriver *drv = block_job_driver(job);
     BlockJobInfo *info;
     uint64_t progress_current, progress_total;
 
@@ -358,6 +359,9 @@ BlockJobInfo *block_job_query_locked(BlockJob *job, Error **errp)
                         g_strdup(error_get_pretty(job->job.err)) :
                         g_strdup(strerror(-job->job.ret));
     }
+    if (drv->query) {
+        drv->query(job, info);
+    }
     return info;
 }
 
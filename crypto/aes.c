@@ -29,6 +29,7 @@
  */
 #include "qemu/osdep.h"
 #include "crypto/aes.h"
+#include "crypto/aes-round.h"
 
 typedef uint32_t u32;
 typedef uint8_t u8;
@@ -1063,6 +1064,120 @@ static const u32 rcon[] = {
         0x1B000000, 0x36000000, /* for 128-bit blocks, Rijndael never uses more than 10 rcon values */
 };
 
+/*
+ * AES round fragments for the emulation of guest instructions, see
+ * crypto/aes-round.h.  The state is kept in FIPS-197 byte order, so the
+ * big-endian AES_Te and AES_Td entries are stored with cpu_to_be32.
+ */
+
+/* Multiply each of the four bytes of @x by 2 in GF(2^8) */
+static inline uint32_t aes_xtime4(uint32_t x)
+{
+    return ((x & 0x7f7f7f7fu) << 1) ^ (((x >> 7) & 0x01010101u) * 0x1b);
+}
+
+/* MixColumns on one column, byte 0 in the least significant bits */
+static uint32_t aes_mix_column(uint32_t c)
+{
+    uint32_t t = c ^ ror32(c, 8);
+
+    return aes_xtime4(t) ^ ror32(c, 8) ^ ror32(c, 16) ^ ror32(c, 24);
+}
+
+/*
+ * InvMixColumns is MixColumns applied after multiplying the column by
+ * 04x^2 + 05 (The Design of Rijndael, 4.1.3), which is cheap to do here.
+ */
+static uint32_t aes_inv_mix_column(uint32_t c)
+{
+    uint32_t t = c ^ ror32(c, 16);
+
+    return aes_mix_column(c ^ aes_xtime4(aes_xtime4(t)));
+}
+
+void aesenc_SB_gen(AESState *ret, const AESState *st)
+{
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        ret->b[i] = AES_sbox[st->b[i]];
+    }
+}
+
+void aesenc_MC_gen(AESState *ret, const AESState *st)
+{
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        ret->w[i] = cpu_to_le32(aes_mix_column(le32_to_cpu(st->w[i])));
+    }
+}
+
+void aesenc_SB_SR_AK_gen(AESState *ret, const AESState *st,
+                         const AESState *rk)
+{
+    AESState t;
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        t.b[i] = AES_sbox[st->b[AES_shifts[i]]];
+    }
+    ret->d[0] = t.d[0] ^ rk->d[0];
+    ret->d[1] = t.d[1] ^ rk->d[1];
+}
+
+void aesenc_SB_SR_MC_AK_gen(AESState *ret, const AESState *st,
+                            const AESState *rk)
+{
+    AESState t;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        t.w[i] = rk->w[i] ^ cpu_to_be32(AES_Te0[st->b[AES_shifts[4 * i + 0]]] ^
+                                        AES_Te1[st->b[AES_shifts[4 * i + 1]]] ^
+                                        AES_Te2[st->b[AES_shifts[4 * i + 2]]] ^
+                                        AES_Te3[st->b[AES_shifts[4 * i + 3]]]);
+    }
+    *ret = t;
+}
+
+void aesdec_IMC_gen(AESState *ret, const AESState *st)
+{
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        ret->w[i] = cpu_to_le32(aes_inv_mix_column(le32_to_cpu(st->w[i])));
+    }
+}
+
+void aesdec_ISB_ISR_AK_gen(AESState *ret, const AESState *st,
+                           const AESState *rk)
+{
+    AESState t;
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        t.b[i] = AES_isbox[st->b[AES_ishifts[i]]];
+    }
+    ret->d[0] = t.d[0] ^ rk->d[0];
+    ret->d[1] = t.d[1] ^ rk->d[1];
+}
+
+void aesdec_ISB_ISR_IMC_AK_gen(AESState *ret, const AESState *st,
+                               const AESState *rk)
+{
+    AESState t;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        t.w[i] = rk->w[i] ^ cpu_to_be32(AES_Td0[st->b[AES_ishifts[4 * i + 0]]] ^
+                                        AES_Td1[st->b[AES_ishifts[4 * i + 1]]] ^
+                                        AES_Td2[st->b[AES_ishifts[4 * i + 2]]] ^
+                                        AES_Td3[st->b[AES_ishifts[4 * i + 3]]]);
+    }
+    *ret = t;
+}
+
 /**
  * Expand the cipher key into the encryption key schedule.
  */
@@ -0,0 +1,271 @@
+/*
+ * Host acceleration of the crypto building blocks used by TCG frontends
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "crypto/host-crypto.h"
+#include "crypto/aes.h"
+#include "crypto/aes-round.h"
+#include "crypto/clmul.h"
+#include "crypto/sha-round.h"
+
+unsigned host_crypto_accel;
+
+#ifdef CONFIG_X86_CRYPTO_OPT
+#include <immintrin.h>
+#include "qemu/cpuid.h"
+
+/*
+ * AESState is in the same byte order as an XMM register, so the x86
+ * instructions can be applied directly.  The state may be unaligned.
+ */
+
+#define ATTR_AES_ACCEL      __attribute__((target("aes,ssse3")))
+#define ATTR_CLMUL_ACCEL    __attribute__((target("pclmul")))
+#define ATTR_SHA_ACCEL      __attribute__((target("sha,sse4.1")))
+
+static inline __m128i aes_load(const AESState *st)
+{
+    return _mm_loadu_si128((const __m128i *)st);
+}
+
+static inline void aes_store(AESState *ret, __m128i v)
+{
+    _mm_storeu_si128((__m128i *)ret, v);
+}
+
+void ATTR_AES_ACCEL aesenc_SB_accel(AESState *ret, const AESState *st)
+{
+    /* Undo the ShiftRows that AESENCLAST will do */
+    __m128i ishifts = _mm_loadu_si128((const __m128i *)AES_ishifts);
+    __m128i t = _mm_shuffle_epi8(aes_load(st), ishifts);
+
+    aes_store(ret, _mm_aesenclast_si128(t, _mm_setzero_si128()));
+}
+
+void ATTR_AES_ACCEL aesenc_MC_accel(AESState *ret, const AESState *st)
+{
+    /* AESENC does SR+SB before MC, so undo them first */
+    __m128i z = _mm_setzero_si128();
+    __m128i t = _mm_aesdeclast_si128(aes_load(st), z);
+
+    aes_store(ret, _mm_aesenc_si128(t, z));
+}
+
+void ATTR_AES_ACCEL aesenc_SB_SR_AK_accel(AESState *ret, const AESState *st,
+                                          const AESState *rk)
+{
+    aes_store(ret, _mm_aesenclast_si128(aes_load(st), aes_load(rk)));
+}
+
+void ATTR_AES_ACCEL aesenc_SB_SR_MC_AK_accel(AESState *ret,
+                                             const AESState *st,
+                                             const AESState *rk)
+{
+    aes_store(ret, _mm_aesenc_si128(aes_load(st), aes_load(rk)));
+}
+
+void ATTR_AES_ACCEL aesdec_IMC_accel(AESState *ret, const AESState *st)
+{
+    aes_store(ret, _mm_aesimc_si128(aes_load(st)));
+}
+
+void ATTR_AES_ACCEL aesdec_ISB_ISR_AK_accel(AESState *ret,
+                                            const AESState *st,
+                                            const AESState *rk)
+{
+    aes_store(ret, _mm_aesdeclast_si128(aes_load(st), aes_load(rk)));
+}
+
+void ATTR_AES_ACCEL aesdec_ISB_ISR_IMC_AK_accel(AESState *ret,
+                                                const AESState *st,
+                                                const AESState *rk)
+{
+    aes_store(ret, _mm_aesdec_si128(aes_load(st), aes_load(rk)));
+}
+
+Int128 ATTR_CLMUL_ACCEL clmul_64_accel(uint64_t n, uint64_t m)
+{
+    __m128i r = _mm_clmulepi64_si128(_mm_set_epi64x(0, n),
+                                     _mm_set_epi64x(0, m), 0);
+    uint64_t d[2];
+
+    _mm_storeu_si128((__m128i *)d, r);
+    return int128_make128(d[0], d[1]);
+}
+
+/*
+ * SHA-NI keeps A (or W[t]) in the most significant word of the
+ * register, i.e. in the opposite order from the arrays.
+ */
+#define SHA_REVERSE     0x1b
+
+void ATTR_SHA_ACCEL sha1_rounds4_accel(uint32_t abcd[4], uint32_t e,
+                                       const uint32_t wk[4], SHA1Func f)
+{
+    /* SHA1RNDS4 adds the round constant itself, so take it out of @wk */
+    static const uint32_t k[3] = { 0x5a827999, 0x6ed9eba1, 0x8f1bbcdc };
+    __m128i s = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)abcd),
+                                  SHA_REVERSE);
+    __m128i w = _mm_loadu_si128((const __m128i *)wk);
+
+    w = _mm_sub_epi32(w, _mm_set1_epi32(k[f]));
+    w = _mm_add_epi32(w, _mm_setr_epi32(e, 0, 0, 0));
+    w = _mm_shuffle_epi32(w, SHA_REVERSE);
+
+    switch (f) {
+    case SHA1_CHOOSE:
+        s = _mm_sha1rnds4_epu32(s, w, 0);
+        break;
+    case SHA1_PARITY:
+        s = _mm_sha1rnds4_epu32(s, w, 1);
+        break;
+    case SHA1_MAJORITY:
+        s = _mm_sha1rnds4_epu32(s, w, 2);
+        break;
+    default:
+        g_assert_not_reached();
+    }
+
+    _mm_storeu_si128((__m128i *)abcd, _mm_shuffle_epi32(s, SHA_REVERSE));
+}
+
+void ATTR_SHA_ACCEL sha256_rounds4_accel(uint32_t abcd[4], uint32_t efgh[4],
+                                         const uint32_t wk[4])
+{
+    __m128i a = _mm_loadu_si128((const __m128i *)abcd);
+    __m128i e = _mm_loadu_si128((const __m128i *)efgh);
+    __m128i w = _mm_loadu_si128((const __m128i *)wk);
+    __m128i abef, cdgh, abef1, abef2;
+
+    /*
+     * SHA256RNDS2 wants the state as ABEF and CDGH, most significant
+     * word first, and does two rounds; C, D, G, H after two rounds are
+     * the A, B, E, F from before them.
+     */
+    abef = _mm_shuffle_epi32(_mm_unpacklo_epi64(e, a), 0xb1);
+    cdgh = _mm_shuffle_epi32(_mm_unpackhi_epi64(e, a), 0xb1);
+
+    abef1 = _mm_sha256rnds2_epu32(cdgh, abef, w);
+    abef2 = _mm_sha256rnds2_epu32(abef, abef1, _mm_shuffle_epi32(w, 0x0e));
+
+    _mm_storeu_si128((__m128i *)abcd,
+                     _mm_shuffle_epi32(_mm_unpackhi_epi64(abef2, abef1), 0xb1));
+    _mm_storeu_si128((__m128i *)efgh,
+                     _mm_shuffle_epi32(_mm_unpacklo_epi64(abef2, abef1), 0xb1));
+}
+
+void ATTR_SHA_ACCEL sha256_msg1_accel(uint32_t w[4], const uint32_t w4[4])
+{
+    __m128i r = _mm_sha256msg1_epu32(_mm_loadu_si128((const __m128i *)w),
+                                     _mm_loadu_si128((const __m128i *)w4));
+
+    _mm_storeu_si128((__m128i *)w, r);
+}
+
+void ATTR_SHA_ACCEL sha256_msg2_accel(uint32_t w[4], const uint32_t w12[4])
+{
+    __m128i r = _mm_sha256msg2_epu32(_mm_loadu_si128((const __m128i *)w),
+                                     _mm_loadu_si128((const __m128i *)w12));
+
+    _mm_storeu_si128((__m128i *)w, r);
+}
+
+static void __attribute__((constructor)) init_host_crypto_accel(void)
+{
+    unsigned max = __get_cpuid_max(0, NULL);
+    int a, b, c, d;
+    unsigned accel = 0;
+
+    if (max >= 1) {
+        __cpuid(1, a, b, c, d);
+        if ((c & bit_AES) && (c & bit_SSSE3)) {
+            accel |= HOST_CRYPTO_AES;
+        }
+        if (c & bit_PCLMUL) {
+            accel |= HOST_CRYPTO_CLMUL;
+        }
+        if (max >= 7 && (c & bit_SSE4_1)) {
+            __cpuid_count(7, 0, a, b, c, d);
+            if (b & bit_SHA) {
+                accel |= HOST_CRYPTO_SHA;
+            }
+        }
+    }
+    host_crypto_accel = accel;
+}
+
+#else
+
+/* Never called, HAVE_*_ACCEL is false.  */
+
+void aesenc_SB_accel(AESState *ret, const AESState *st)
+{
+    g_assert_not_reached();
+}
+
+void aesenc_MC_accel(AESState *ret, const AESState *st)
+{
+    g_assert_not_reached();
+}
+
+void aesenc_SB_SR_AK_accel(AESState *ret, const AESState *st,
+                           const AESState *rk)
+{
+    g_assert_not_reached();
+}
+
+void aesenc_SB_SR_MC_AK_accel(AESState *ret, const AESState *st,
+                              const AESState *rk)
+{
+    g_assert_not_reached();
+}
+
+void aesdec_IMC_accel(AESState *ret, const AESState *st)
+{
+    g_assert_not_reached();
+}
+
+void aesdec_ISB_ISR_AK_accel(AESState *ret, const AESState *st,
+                             const AESState *rk)
+{
+    g_assert_not_reached();
+}
+
+void aesdec_ISB_ISR_IMC_AK_accel(AESState *ret, const AESState *st,
+                                 const AESState *rk)
+{
+    g_assert_not_reached();
+}
+
+Int128 clmul_64_accel(uint64_t n, uint64_t m)
+{
+    g_assert_not_reached();
+}
+
+void sha1_rounds4_accel(uint32_t abcd[4], uint32_t e, const uint32_t wk[4],
+                        SHA1Func f)
+{
+    g_assert_not_reached();
+}
+
+void sha256_rounds4_accel(uint32_t abcd[4], uint32_t efgh[4],
+                          const uint32_t wk[4])
+{
+    g_assert_not_reached();
+}
+
+void sha256_msg1_accel(uint32_t w[4], const uint32_t w4[4])
+{
+    g_assert_not_reached();
+}
+
+void sha256_msg2_accel(uint32_t w[4], const uint32_t w12[4])
+{
+    g_assert_not_reached();
+}
+
+#endif /* CONFIG_X86_CRYPTO_OPT */
@@ -0,0 +1,131 @@
+/*
+ * SHA-1 and SHA-256 rounds
+ *
+ * The logical functions are from FIPS 180-4, "Secure Hash Standard".
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bitops.h"
+#include "crypto/sha-round.h"
+
+static uint32_t cho(uint32_t x, uint32_t y, uint32_t z)
+{
+    return (x & (y ^ z)) ^ z;
+}
+
+static uint32_t par(uint32_t x, uint32_t y, uint32_t z)
+{
+    return x ^ y ^ z;
+}
+
+static uint32_t maj(uint32_t x, uint32_t y, uint32_t z)
+{
+    return (x & y) | ((x | y) & z);
+}
+
+void sha1_rounds4_gen(uint32_t abcd[4], uint32_t e, const uint32_t wk[4],
+                      SHA1Func f)
+{
+    uint32_t a = abcd[0], b = abcd[1], c = abcd[2], d = abcd[3];
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        uint32_t t;
+
+        switch (f) {
+        case SHA1_CHOOSE:
+            t = cho(b, c, d);
+            break;
+        case SHA1_PARITY:
+            t = par(b, c, d);
+            break;
+        case SHA1_MAJORITY:
+            t = maj(b, c, d);
+            break;
+        default:
+            g_assert_not_reached();
+        }
+        t += rol32(a, 5) + e + wk[i];
+
+        e = d;
+        d = c;
+        c = ror32(b, 2);
+        b = a;
+        a = t;
+    }
+
+    abcd[0] = a;
+    abcd[1] = b;
+    abcd[2] = c;
+    abcd[3] = d;
+}
+
+static uint32_t S0(uint32_t x)
+{
+    return ror32(x, 2) ^ ror32(x, 13) ^ ror32(x, 22);
+}
+
+static uint32_t S1(uint32_t x)
+{
+    return ror32(x, 6) ^ ror32(x, 11) ^ ror32(x, 25);
+}
+
+static uint32_t s0(uint32_t x)
+{
+    return ror32(x, 7) ^ ror32(x, 18) ^ (x >> 3);
+}
+
+static uint32_t s1(uint32_t x)
+{
+    return ror32(x, 17) ^ ror32(x, 19) ^ (x >> 10);
+}
+
+void sha256_rounds4_gen(uint32_t abcd[4], uint32_t efgh[4],
+                        const uint32_t wk[4])
+{
+    uint32_t a = abcd[0], b = abcd[1], c = abcd[2], d = abcd[3];
+    uint32_t e = efgh[0], f = efgh[1], g = efgh[2], h = efgh[3];
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        uint32_t t1 = h + S1(e) + cho(e, f, g) + wk[i];
+        uint32_t t2 = S0(a) + maj(a, b, c);
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    abcd[0] = a;
+    abcd[1] = b;
+    abcd[2] = c;
+    abcd[3] = d;
+    efgh[0] = e;
+    efgh[1] = f;
+    efgh[2] = g;
+    efgh[3] = h;
+}
+
+void sha256_msg1_gen(uint32_t w[4], const uint32_t w4[4])
+{
+    w[0] += s0(w[1]);
+    w[1] += s0(w[2]);
+    w[2] += s0(w[3]);
+    w[3] += s0(w4[0]);
+}
+
+void sha256_msg2_gen(uint32_t w[4], const uint32_t w12[4])
+{
+    w[0] += s1(w12[2]);
+    w[1] += s1(w12[3]);
+    w[2] += s1(w[0]);
+    w[3] += s1(w[1]);
+}
@@ -24,6 +24,7 @@
 #include "crypto/tlscredspsk.h"
 #include "crypto/tlscredsx509.h"
 #include "qapi/error.h"
+#include "qemu/iov.h"
 #include "authz/base.h"
 #include "tlscredspriv.h"
 #include "trace.h"
@@ -33,6 +34,23 @@
 
 #include <gnutls/x509.h>
 
+#ifdef CONFIG_GNUTLS_KTLS
+#include <linux/tls.h>
+#include <netinet/tcp.h>
+
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+
+/* Record content types, as passed in TLS_{GET,SET}_RECORD_TYPE */
+#define QCRYPTO_TLS_RECORD_ALERT 21
+#define QCRYPTO_TLS_RECORD_HANDSHAKE 22
+#define QCRYPTO_TLS_RECORD_APPLICATION_DATA 23
+#endif
+
 
 struct QCryptoTLSSession {
     QCryptoTLSCreds *creds;
@@ -44,6 +62,13 @@ struct QCryptoTLSSession {
     QCryptoTLSSessionReadFunc readFunc;
     void *opaque;
     char *peername;
+    /* Mask of QCryptoTLSSessionKTLS directions handled by the kernel */
+    int ktls;
+    int ktlsFd;
+    /* The peer asked for a TLS 1.3 key update that we haven't sent yet */
+    bool ktlsKeyUpdate;
+    /* GNUTLS is building a record that the kernel has already sent */
+    bool ktlsDiscard;
 };
 
 
@@ -73,6 +98,18 @@ qcrypto_tls_session_push(void *opaque, const void *buf, size_t len)
         return -1;
     };
 
+    /*
+     * Once the kernel owns the transmit state, records built by
+     * GNUTLS carry a stale sequence number and can't go on the wire.
+     */
+    if (session->ktls & QCRYPTO_TLS_KTLS_TX) {
+        if (session->ktlsDiscard) {
+            return len;
+        }
+        errno = EIO;
+        return -1;
+    }
+
     return session->writeFunc(buf, len, session->opaque);
 }
 
@@ -555,6 +592,367 @@ qcrypto_tls_session_get_peer_name(QCryptoTLSSession *session)
 }
 
 
+#ifdef CONFIG_GNUTLS_KTLS
+
+typedef union {
+    struct tls_crypto_info info;
+    struct tls12_crypto_info_aes_gcm_128 aes_gcm_128;
+    struct tls12_crypto_info_aes_gcm_256 aes_gcm_256;
+#ifdef TLS_CIPHER_CHACHA20_POLY1305
+    struct tls12_crypto_info_chacha20_poly1305 chacha20_poly1305;
+#endif
+} QCryptoTLSKTLSInfo;
+
+/*
+ * For AES-GCM the first bytes of the GNUTLS IV are the implicit
+ * salt.  TLS 1.3 derives the nonce from the rest of the IV, while
+ * TLS 1.2 sends an explicit nonce, which GNUTLS takes from the
+ * record sequence number.
+ */
+#define QCRYPTO_TLS_KTLS_GCM(ci)                                        \
+    do {                                                                \
+        if (key.size != sizeof((ci)->key) ||                            \
+            iv.size < sizeof((ci)->salt) ||                             \
+            (version != TLS_1_2_VERSION &&                              \
+             iv.size != sizeof((ci)->salt) + sizeof((ci)->iv))) {       \
+            goto unsupported;                                           \
+        }                                                               \
+        memcpy((ci)->key, key.data, sizeof((ci)->key));                 \
+        memcpy((ci)->salt, iv.data, sizeof((ci)->salt));                \
+        if (version == TLS_1_2_VERSION) {                               \
+            memcpy((ci)->iv, seq, sizeof((ci)->iv));                    \
+        } else {                                                        \
+            memcpy((ci)->iv, iv.data + sizeof((ci)->salt),              \
+                   sizeof((ci)->iv));                                   \
+        }                                                               \
+        memcpy((ci)->rec_seq, seq, sizeof((ci)->rec_seq));              \
+        len = sizeof(*(ci));                                            \
+    } while (0)
+
+static int
+qcrypto_tls_session_set_ktls_state(QCryptoTLSSession *session,
+                                   int fd,
+                                   bool read,
+                                   Error **errp)
+{
+    QCryptoTLSKTLSInfo crypto = {};
+    gnutls_datum_t iv, key;
+    unsigned char seq[8];
+    uint16_t version;
+    size_t len;
+    int ret;
+
+    switch (gnutls_protocol_get_version(session->handle)) {
+    case GNUTLS_TLS1_2:
+        version = TLS_1_2_VERSION;
+        break;
+#ifdef TLS_1_3_VERSION
+    case GNUTLS_TLS1_3:
+        version = TLS_1_3_VERSION;
+        break;
+#endif
+    default:
+        error_setg(errp, "TLS protocol version not supported by kTLS");
+        return -1;
+    }
+
+    ret = gnutls_record_get_state(session->handle, read,
+                                  NULL, &iv, &key, seq);
+    if (ret < 0) {
+        error_setg(errp, "Cannot get TLS record state: %s",
+                   gnutls_strerror(ret));
+        return -1;
+    }
+
+    crypto.info.version = version;
+    switch (gnutls_cipher_get(session->handle)) {
+    case GNUTLS_CIPHER_AES_128_GCM:
+        crypto.info.cipher_type = TLS_CIPHER_AES_GCM_128;
+        QCRYPTO_TLS_KTLS_GCM(&crypto.aes_gcm_128);
+        break;
+    case GNUTLS_CIPHER_AES_256_GCM:
+        crypto.info.cipher_type = TLS_CIPHER_AES_GCM_256;
+        QCRYPTO_TLS_KTLS_GCM(&crypto.aes_gcm_256);
+        break;
+#ifdef TLS_CIPHER_CHACHA20_POLY1305
+    case GNUTLS_CIPHER_CHACHA20_POLY1305:
+        crypto.info.cipher_type = TLS_CIPHER_CHACHA20_POLY1305;
+        if (key.size != sizeof(crypto.chacha20_poly1305.key) ||
+            iv.size != sizeof(crypto.chacha20_poly1305.iv)) {
+            goto unsupported;
+        }
+        memcpy(crypto.chacha20_poly1305.key, key.data, key.size);
+        memcpy(crypto.chacha20_poly1305.iv, iv.data, iv.size);
+        memcpy(crypto.chacha20_poly1305.rec_seq, seq,
+               sizeof(crypto.chacha20_poly1305.rec_seq));
+        len = sizeof(crypto.chacha20_poly1305);
+        break;
+#endif
+    default:
+        goto unsupported;
+    }
+
+    ret = setsockopt(fd, SOL_TLS, read ? TLS_RX : TLS_TX, &crypto, len);
+    memset(&crypto, 0, sizeof(crypto));
+    if (ret < 0) {
+        error_setg_errno(errp, errno, "Cannot set kTLS %s state",
+                         read ? "receive" : "transmit");
+        return -1;
+    }
+    return 0;
+
+ unsupported:
+    memset(&crypto, 0, sizeof(crypto));
+    error_setg(errp, "TLS cipher %s not supported by kTLS",
+               gnutls_cipher_get_name(gnutls_cipher_get(session->handle)));
+    return -1;
+}
+
+#undef QCRYPTO_TLS_KTLS_GCM
+
+
+static int
+qcrypto_tls_session_ktls_hook(gnutls_session_t handle,
+                              unsigned int htype,
+                              unsigned int when,
+                              unsigned int incoming,
+                              const gnutls_datum_t *msg)
+{
+    QCryptoTLSSession *session = gnutls_session_get_ptr(handle);
+
+    /*
+     * GNUTLS would answer with its own key update before the next
+     * record it sends, but the kernel sends the records now, so
+     * leave a note for qcrypto_tls_session_ktls_key_update().
+     */
+    if (htype == GNUTLS_HANDSHAKE_KEY_UPDATE && incoming &&
+        msg->size == 1 && msg->data[0] == 1) {
+        qatomic_set(&session->ktlsKeyUpdate, true);
+    }
+    return 0;
+}
+
+
+int
+qcrypto_tls_session_enable_ktls(QCryptoTLSSession *session,
+                                int fd,
+                                Error **errp)
+{
+    Error *err = NULL;
+    int ret;
+
+    if (!session->creds->ktls) {
+        return 0;
+    }
+
+    if (!session->handshakeComplete) {
+        error_setg(errp, "TLS handshake has not completed");
+        return -1;
+    }
+
+    if (setsockopt(fd, IPPROTO_TCP, TCP_ULP, "tls", sizeof("tls")) < 0) {
+        error_setg_errno(errp, errno, "Cannot enable kTLS on socket");
+        return -1;
+    }
+
+    /*
+     * The socket now has the TLS ULP attached, but without any
+     * crypto state it still passes data through unchanged, so
+     * GNUTLS can carry on if this fails.
+     */
+    if (qcrypto_tls_session_set_ktls_state(session, fd, false, errp) < 0) {
+        return -1;
+    }
+    ret = QCRYPTO_TLS_KTLS_TX;
+
+    if (gnutls_protocol_get_version(session->handle) == GNUTLS_TLS1_3) {
+        gnutls_session_set_ptr(session->handle, session);
+        gnutls_handshake_set_hook_function(session->handle,
+                                           GNUTLS_HANDSHAKE_KEY_UPDATE,
+                                           GNUTLS_HOOK_POST,
+                                           qcrypto_tls_session_ktls_hook);
+    }
+
+    /*
+     * Records that GNUTLS has already read off the socket can't be
+     * handed over, and TLS 1.3 may still deliver handshake messages
+     * (session tickets, key updates) that the kernel won't process.
+     */
+    if (gnutls_protocol_get_version(session->handle) == GNUTLS_TLS1_2 &&
+        !gnutls_record_check_pending(session->handle)) {
+        if (qcrypto_tls_session_set_ktls_state(session, fd, true, &err) < 0) {
+            error_free(err);
+        } else {
+            ret |= QCRYPTO_TLS_KTLS_RX;
+        }
+    }
+
+    session->ktls = ret;
+    session->ktlsFd = fd;
+    trace_qcrypto_tls_session_enable_ktls(session, ret);
+    return ret;
+}
+
+
+int
+qcrypto_tls_session_ktls_key_update(QCryptoTLSSession *session)
+{
+    /* A key_update handshake message with update_not_requested */
+    static const unsigned char msg[] = { GNUTLS_HANDSHAKE_KEY_UPDATE,
+                                         0, 0, 1, 0 };
+    char control[CMSG_SPACE(1)] = { 0 };
+    struct iovec iov = { .iov_base = (void *)msg, .iov_len = sizeof(msg) };
+    struct msghdr mh = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control,
+        .msg_controllen = sizeof(control),
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&mh);
+    Error *err = NULL;
+    ssize_t ret;
+
+    if (!qatomic_read(&session->ktlsKeyUpdate)) {
+        return 0;
+    }
+
+    /* The message itself is encrypted with the old key */
+    cmsg->cmsg_level = SOL_TLS;
+    cmsg->cmsg_type = TLS_SET_RECORD_TYPE;
+    cmsg->cmsg_len = CMSG_LEN(1);
+    *CMSG_DATA(cmsg) = QCRYPTO_TLS_RECORD_HANDSHAKE;
+
+    do {
+        ret = sendmsg(session->ktlsFd, &mh, 0);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0) {
+        return -1;
+    }
+    qatomic_set(&session->ktlsKeyUpdate, false);
+    if (ret != sizeof(msg)) {
+        error_setg(&err, "Short write of TLS key update");
+        goto error;
+    }
+
+    /*
+     * Let GNUTLS derive the next transmit key; the copy of the
+     * message that it encrypts is dropped by the push function.
+     */
+    session->ktlsDiscard = true;
+    ret = gnutls_session_key_update(session->handle, 0);
+    session->ktlsDiscard = false;
+    if (ret < 0) {
+        error_setg(&err, "Cannot update TLS keys: %s", gnutls_strerror(ret));
+        goto error;
+    }
+
+    /*
+     * The peer has switched keys by now, so there is no way back if
+     * the kernel does not support rekeying.
+     */
+    if (qcrypto_tls_session_set_ktls_state(session, session->ktlsFd,
+                                           false, &err) < 0) {
+        goto error;
+    }
+    trace_qcrypto_tls_session_ktls_key_update(session);
+    return 0;
+
+ error:
+    trace_qcrypto_tls_session_ktls_error(session, error_get_pretty(err));
+    error_free(err);
+    errno = EIO;
+    return -1;
+}
+
+
+ssize_t
+qcrypto_tls_session_ktls_readv(QCryptoTLSSession *session,
+                               const struct iovec *iov,
+                               size_t niov)
+{
+    char control[CMSG_SPACE(1)];
+    struct msghdr mh = {
+        .msg_iov = (struct iovec *)iov,
+        .msg_iovlen = niov,
+        .msg_control = control,
+        .msg_controllen = sizeof(control),
+    };
+    struct cmsghdr *cmsg;
+    unsigned char alert[2];
+    ssize_t ret;
+
+    do {
+        ret = recvmsg(session->ktlsFd, &mh, 0);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0) {
+        return -1;
+    }
+
+    /*
+     * The kernel returns each non-data record on its own, with its
+     * type attached; it fails the read if there is nowhere to put it.
+     */
+    cmsg = CMSG_FIRSTHDR(&mh);
+    if (!cmsg || cmsg->cmsg_level != SOL_TLS ||
+        cmsg->cmsg_type != TLS_GET_RECORD_TYPE ||
+        *CMSG_DATA(cmsg) == QCRYPTO_TLS_RECORD_APPLICATION_DATA) {
+        return ret;
+    }
+
+    if (*CMSG_DATA(cmsg) != QCRYPTO_TLS_RECORD_ALERT || ret != sizeof(alert)) {
+        trace_qcrypto_tls_session_ktls_error(session,
+                                             "Unexpected TLS record");
+        errno = EIO;
+        return -1;
+    }
+
+    iov_to_buf(iov, niov, 0, alert, sizeof(alert));
+    if (alert[1] == GNUTLS_A_CLOSE_NOTIFY) {
+        return 0;
+    }
+
+    /* Like gnutls_record_recv(), fail on any other alert */
+    trace_qcrypto_tls_session_ktls_error(session,
+                                         gnutls_alert_get_strname(alert[1]));
+    errno = EIO;
+    return -1;
+}
+
+#else /* ! CONFIG_GNUTLS_KTLS */
+
+int
+qcrypto_tls_session_enable_ktls(QCryptoTLSSession *session,
+                                int fd G_GNUC_UNUSED,
+                                Error **errp)
+{
+    if (!session->creds->ktls) {
+        return 0;
+    }
+
+    error_setg(errp, "kTLS is not supported by this build");
+    return -1;
+}
+
+
+int
+qcrypto_tls_session_ktls_key_update(QCryptoTLSSession *session G_GNUC_UNUSED)
+{
+    return 0;
+}
+
+
+ssize_t
+qcrypto_tls_session_ktls_readv(QCryptoTLSSession *session G_GNUC_UNUSED,
+                               const struct iovec *iov G_GNUC_UNUSED,
+                               size_t niov G_GNUC_UNUSED)
+{
+    errno = EIO;
+    return -1;
+}
+
+#endif /* ! CONFIG_GNUTLS_KTLS */
+
+
 #else /* ! CONFIG_GNUTLS */
 
 
@@ -646,4 +1044,31 @@ qcrypto_tls_session_get_peer_name(QCryptoTLSSession *sess)
     return NULL;
 }
 
+
+int
+qcrypto_tls_session_enable_ktls(QCryptoTLSSession *sess,
+                                int fd,
+                                Error **errp)
+{
+    error_setg(errp, "TLS requires GNUTLS support");
+    return -1;
+}
+
+
+int
+qcrypto_tls_session_ktls_key_update(QCryptoTLSSession *sess)
+{
+    return 0;
+}
+
+
+ssize_t
+qcrypto_tls_session_ktls_readv(QCryptoTLSSession *sess,
+                               const struct iovec *iov,
+                               size_t niov)
+{
+    errno = EIO;
+    return -1;
+}
+
 #endif
@@ -401,6 +401,92 @@ float64_gen2(float64 xa, float64 xb, float_status *s,
     return soft(ua.s, ub.s, s);
 }
 
+/*
+ * Lane-batched versions of the above, for vector helpers. The can_use_fpu()
+ * test is hoisted out of the loop: the inexact flag is sticky and nothing
+ * in the loop changes the rounding mode, so once it passes it holds for
+ * every remaining lane. Lanes whose inputs or result need special handling
+ * (denormals, NaNs, infinities, possible underflow) drop to the soft path
+ * individually, so flags accumulate exactly as for per-lane calls.
+ */
+static inline void
+float32_gen2_vec(float32 *d, const float32 *a, const float32 *b, size_t n,
+                 float_status *s, hard_f32_op2_fn hard, soft_f32_op2_fn soft,
+                 f32_check_fn pre, f32_check_fn post)
+{
+    size_t i;
+
+    if (unlikely(!can_use_fpu(s))) {
+        for (i = 0; i < n; i++) {
+            d[i] = float32_gen2(a[i], b[i], s, hard, soft, pre, post);
+        }
+        return;
+    }
+
+    for (i = 0; i < n; i++) {
+        union_float32 ua, ub, ur;
+
+        ua.s = a[i];
+        ub.s = b[i];
+
+        float32_input_flush2(&ua.s, &ub.s, s);
+        if (unlikely(!pre(ua, ub))) {
+            goto soft;
+        }
+
+        ur.h = hard(ua.h, ub.h);
+        if (unlikely(f32_is_inf(ur))) {
+            float_raise(float_flag_overflow, s);
+        } else if (unlikely(fabsf(ur.h) <= FLT_MIN) && post(ua, ub)) {
+            goto soft;
+        }
+        d[i] = ur.s;
+        continue;
+
+    soft:
+        d[i] = soft(ua.s, ub.s, s);
+    }
+}
+
+static inline void
+float64_gen2_vec(float64 *d, const float64 *a, const float64 *b, size_t n,
+                 float_status *s, hard_f64_op2_fn hard, soft_f64_op2_fn soft,
+                 f64_check_fn pre, f64_check_fn post)
+{
+    size_t i;
+
+    if (unlikely(!can_use_fpu(s))) {
+        for (i = 0; i < n; i++) {
+            d[i] = float64_gen2(a[i], b[i], s, hard, soft, pre, post);
+        }
+        return;
+    }
+
+    for (i = 0; i < n; i++) {
+        union_float64 ua, ub, ur;
+
+        ua.s = a[i];
+        ub.s = b[i];
+
+        float64_input_flush2(&ua.s, &ub.s, s);
+        if (unlikely(!pre(ua, ub))) {
+            goto soft;
+        }
+
+        ur.h = hard(ua.h, ub.h);
+        if (unlikely(f64_is_inf(ur))) {
+            float_raise(float_flag_overflow, s);
+        } else if (unlikely(fabs(ur.h) <= DBL_MIN) && post(ua, ub)) {
+            goto soft;
+        }
+        d[i] = ur.s;
+        continue;
+
+    soft:
+        d[i] = soft(ua.s, ub.s, s);
+    }
+}
+
 /*
  * Classify a floating point number. Everything above float_class_qnan
  * is a NaN so cls >= float_class_qnan is any NaN.
@@ -1986,6 +2072,38 @@ float64_sub(float64 a, float64 b, float_status *s)
     return float64_addsub(a, b, s, hard_f64_sub, soft_f64_sub);
 }
 
+void QEMU_FLATTEN
+float32_add_vec(float32 *d, const float32 *a, const float32 *b, size_t n,
+                float_status *s)
+{
+    float32_gen2_vec(d, a, b, n, s, hard_f32_add, soft_f32_add,
+                     f32_is_zon2, f32_addsubmul_post);
+}
+
+void QEMU_FLATTEN
+float32_sub_vec(float32 *d, const float32 *a, const float32 *b, size_t n,
+                float_status *s)
+{
+    float32_gen2_vec(d, a, b, n, s, hard_f32_sub, soft_f32_sub,
+                     f32_is_zon2, f32_addsubmul_post);
+}
+
+void QEMU_FLATTEN
+float64_add_vec(float64 *d, const float64 *a, const float64 *b, size_t n,
+                float_status *s)
+{
+    float64_gen2_vec(d, a, b, n, s, hard_f64_add, soft_f64_add,
+                     f64_is_zon2, f64_addsubmul_post);
+}
+
+void QEMU_FLATTEN
+float64_sub_vec(float64 *d, const float64 *a, const float64 *b, size_t n,
+                float_status *s)
+{
+    float64_gen2_vec(d, a, b, n, s, hard_f64_sub, soft_f64_sub,
+                     f64_is_zon2, f64_addsubmul_post);
+}
+
 static float64 float64r32_addsub(float64 a, float64 b, float_status *status,
                                  bool subtract)
 {
@@ -2139,6 +2257,22 @@ float64_mul(float64 a, float64 b, float_status *s)
                         f64_is_zon2, f64_addsubmul_post);
 }
 
+void QEMU_FLATTEN
+float32_mul_vec(float32 *d, const float32 *a, const float32 *b, size_t n,
+                float_status *s)
+{
+    float32_gen2_vec(d, a, b, n, s, hard_f32_mul, soft_f32_mul,
+                     f32_is_zon2, f32_addsubmul_post);
+}
+
+void QEMU_FLATTEN
+float64_mul_vec(float64 *d, const float64 *a, const float64 *b, size_t n,
+                float_status *s)
+{
+    float64_gen2_vec(d, a, b, n, s, hard_f64_mul, soft_f64_mul,
+                     f64_is_zon2, f64_addsubmul_post);
+}
+
 float64 float64r32_mul(float64 a, float64 b, float_status *status)
 {
     FloatParts64 pa, pb, *pr;
@@ -2513,6 +2647,22 @@ float64_div(float64 a, float64 b, float_status *s)
                         f64_div_pre, f64_div_post);
 }
 
+void QEMU_FLATTEN
+float32_div_vec(float32 *d, const float32 *a, const float32 *b, size_t n,
+                float_status *s)
+{
+    float32_gen2_vec(d, a, b, n, s, hard_f32_div, soft_f32_div,
+                     f32_div_pre, f32_div_post);
+}
+
+void QEMU_FLATTEN
+float64_div_vec(float64 *d, const float64 *a, const float64 *b, size_t n,
+                float_status *s)
+{
+    float64_gen2_vec(d, a, b, n, s, hard_f64_div, soft_f64_div,
+                     f64_div_pre, f64_div_post);
+}
+
 float64 float64r32_div(float64 a, float64 b, float_status *status)
 {
     FloatParts64 pa, pb, *pr;
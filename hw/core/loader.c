@@ -894,8 +894,8 @@ static FWCfgState *fw_cfg;
 static QTAILQ_HEAD(, Rom) roms = QTAILQ_HEAD_INITIALIZER(roms);
 
 /*
- * rom->data can be heap-allocated or memory-mapped (e.g. when added with
- * rom_add_elf_program())
+ * rom->data can be heap-allocated or memory-mapped (when added with
+ * rom_add_elf_program(), or with rom_add_file() and map-rom-files=on)
  */
 static void rom_free_data(Rom *rom)
 {
@@ -983,6 +983,7 @@ ssize_t rom_add_file(const char *file, const char *fw_dir,
 {
     MachineClass *mc = MACHINE_GET_CLASS(qdev_get_machine());
     Rom *rom;
+    GError *gerr = NULL;
     ssize_t rc;
     int fd = -1;
     char devpath[100];
@@ -1022,13 +1023,33 @@ ssize_t rom_add_file(const char *file, const char *fw_dir,
     }
 
     rom->datasize = rom->romsize;
-    rom->data     = g_malloc0(rom->datasize);
-    lseek(fd, 0, SEEK_SET);
-    rc = read(fd, rom->data, rom->datasize);
-    if (rc != rom->datasize) {
-        fprintf(stderr, "rom: file %-20s: read error: rc=%zd (expected %zd)\n",
-                rom->name, rc, rom->datasize);
-        goto err;
+    if (machine_map_rom_files(MACHINE(qdev_get_machine()))) {
+        /*
+         * Map the file instead of reading it: the pages are then shared with
+         * the page cache, and with other QEMU processes loading the same
+         * file, and are only read in when the image is copied to guest
+         * memory.  As for ELF files, the mapping is private and writable in
+         * case a board patches the image through rom_ptr().  The file must
+         * not be truncated or rewritten while the VM runs.
+         */
+        rom->mapped_file = g_mapped_file_new_from_fd(fd, true, &gerr);
+        if (!rom->mapped_file) {
+            fprintf(stderr, "rom: file %-20s: map error: %s\n",
+                    rom->name, gerr->message);
+            g_error_free(gerr);
+            goto err;
+        }
+        rom->data = (uint8_t *)g_mapped_file_get_contents(rom->mapped_file);
+    } else {
+        rom->data = g_malloc0(rom->datasize);
+        lseek(fd, 0, SEEK_SET);
+        rc = read(fd, rom->data, rom->datasize);
+        if (rc != rom->datasize) {
+            fprintf(stderr,
+                    "rom: file %-20s: read error: rc=%zd (expected %zd)\n",
+                    rom->name, rc, rom->datasize);
+            goto err;
+        }
     }
     close(fd);
     rom_insert(rom);
@@ -1049,6 +1070,11 @@ ssize_t rom_add_file(const char *file, const char *fw_dir,
 
         if ((!option_rom || mc->option_rom_has_mr) && mc->rom_file_has_mr) {
             data = rom_set_mr(rom, OBJECT(fw_cfg), devpath, true);
+            /*
+             * rom_reset() skips fw_cfg files, so the MemoryRegion now holds
+             * the only copy that is ever used.
+             */
+            rom_free_data(rom);
         } else {
             data = rom->data;
         }
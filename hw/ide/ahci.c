@@ -586,15 +586,23 @@ static void ahci_reg_init(AHCIState *s)
 static void check_cmd(AHCIState *s, int port)
 {
     AHCIPortRegs *pr = &s->dev[port].port_regs;
+    BlockBackend *blk = s->dev[port].port.ifs[0].blk;
     uint8_t slot;
 
     if ((pr->cmd & PORT_CMD_START) && pr->cmd_issue) {
+        /* Submit all NCQ commands issued together in one batch */
+        if (blk) {
+            blk_io_plug(blk);
+        }
         for (slot = 0; (slot < 32) && pr->cmd_issue; slot++) {
             if ((pr->cmd_issue & (1U << slot)) &&
                 !handle_cmd(s, port, slot)) {
                 pr->cmd_issue &= ~(1U << slot);
             }
         }
+        if (blk) {
+            blk_io_unplug(blk);
+        }
     }
 }
 
@@ -686,6 +694,8 @@ static void ahci_reset_port(AHCIState *s, int port)
         qemu_sglist_destroy(&ncq_tfs->sglist);
         ncq_tfs->used = 0;
     }
+    qemu_bh_cancel(d->sdb_bh);
+    d->finished = 0;
 
     s->dev[port].port_state = STATE_RUN;
     if (ide_state->drive_kind == IDE_CD) {
@@ -770,9 +780,8 @@ static void ahci_unmap_clb_address(AHCIDevice *ad)
     ad->lst = NULL;
 }
 
-static void ahci_write_fis_sdb(AHCIState *s, NCQTransferState *ncq_tfs)
+static void ahci_write_fis_sdb(AHCIState *s, AHCIDevice *ad)
 {
-    AHCIDevice *ad = ncq_tfs->drive;
     AHCIPortRegs *pr = &ad->port_regs;
     IDEState *ide_state;
     SDBFIS *sdb_fis;
@@ -806,6 +815,27 @@ static void ahci_write_fis_sdb(AHCIState *s, NCQTransferState *ncq_tfs)
     }
 }
 
+/*
+ * NCQ commands that complete in the same main loop iteration, e.g. because
+ * the block layer reaped them from the same batch, are reported to the guest
+ * with a single Set Device Bits FIS and interrupt.
+ */
+static void ahci_sdb_bh(void *opaque)
+{
+    AHCIDevice *ad = opaque;
+
+    if (ad->finished) {
+        ahci_write_fis_sdb(ad->hba, ad);
+    }
+}
+
+/* Report completions that are still waiting for ahci_sdb_bh() right away */
+static void ahci_flush_sdb(AHCIDevice *ad)
+{
+    qemu_bh_cancel(ad->sdb_bh);
+    ahci_sdb_bh(ad);
+}
+
 static void ahci_write_fis_pio(AHCIDevice *ad, uint16_t len, bool pio_fis_i)
 {
     AHCIPortRegs *pr = &ad->port_regs;
@@ -995,6 +1025,9 @@ static void ncq_err(NCQTransferState *ncq_tfs)
 {
     IDEState *ide_state = &ncq_tfs->drive->port.ifs[0];
 
+    /* Don't report earlier, successful commands with this one's status */
+    ahci_flush_sdb(ncq_tfs->drive);
+
     ide_state->error = ABRT_ERR;
     ide_state->status = READY_STAT | ERR_STAT;
     ncq_tfs->drive->port_regs.scr_err |= (1 << ncq_tfs->tag);
@@ -1009,10 +1042,11 @@ static void ncq_finish(NCQTransferState *ncq_tfs)
      * clear the outstanding bit in scr_act (PxSACT). */
     if (!(ncq_tfs->drive->port_regs.scr_err & (1 << ncq_tfs->tag))) {
         ncq_tfs->drive->finished |= (1 << ncq_tfs->tag);
+        qemu_bh_schedule(ncq_tfs->drive->sdb_bh);
+    } else {
+        ahci_write_fis_sdb(ncq_tfs->drive->hba, ncq_tfs->drive);
     }
 
-    ahci_write_fis_sdb(ncq_tfs->drive->hba, ncq_tfs);
-
     trace_ncq_finish(ncq_tfs->drive->hba, ncq_tfs->drive->port_no,
                      ncq_tfs->tag);
 
@@ -1559,6 +1593,7 @@ void ahci_realize(AHCIState *s, DeviceState *qdev, AddressSpace *as, int ports)
         ad->port_no = i;
         ad->port.dma = &ad->dma;
         ad->port.dma->ops = &ahci_dma_ops;
+        ad->sdb_bh = qemu_bh_new(ahci_sdb_bh, ad);
         ide_register_restart_cb(&ad->port);
     }
     g_free(irqs);
@@ -1576,6 +1611,7 @@ void ahci_uninit(AHCIState *s)
 
             ide_exit(s);
         }
+        qemu_bh_delete(ad->sdb_bh);
         object_unparent(OBJECT(&ad->port));
     }
 
@@ -1726,6 +1762,10 @@ static int ahci_state_post_load(void *opaque, int version_id)
          * In the case where no error was present, busy_slot will be -1,
          * and we should check to see if there are additional commands waiting.
          */
+        if (ad->finished) {
+            qemu_bh_schedule(ad->sdb_bh);
+        }
+
         if (ad->busy_slot == -1) {
             check_cmd(s, i);
         } else {
@@ -18,6 +18,7 @@
  */
 #include "qemu/osdep.h"
 #include "qemu/thread.h"
+#include "qemu/main-loop.h"
 #include "hw/i386/apic_internal.h"
 #include "hw/i386/apic.h"
 #include "hw/i386/ioapic.h"
@@ -26,6 +27,7 @@
 #include "hw/pci/msi.h"
 #include "qemu/host-utils.h"
 #include "sysemu/kvm.h"
+#include "sysemu/tcg.h"
 #include "trace.h"
 #include "hw/i386/apic-msidef.h"
 #include "qapi/error.h"
@@ -70,6 +72,20 @@ static inline void apic_reset_bit(uint32_t *tab, int index)
     tab[i] &= ~mask;
 }
 
+/*
+ * IRR and TMR may be updated by other vCPUs without the BQL, see
+ * apic_deliver_ipi_lockless(), so every update to them must be atomic.
+ */
+static inline void apic_set_bit_atomic(uint32_t *tab, int index)
+{
+    qatomic_or(&tab[index >> 5], 1U << (index & 0x1f));
+}
+
+static inline void apic_reset_bit_atomic(uint32_t *tab, int index)
+{
+    qatomic_and(&tab[index >> 5], ~(1U << (index & 0x1f)));
+}
+
 /* return -1 if no bit is set */
 static int get_highest_priority_int(uint32_t *tab)
 {
@@ -181,7 +197,7 @@ void apic_deliver_pic_intr(DeviceState *dev, int level)
         case APIC_DM_FIXED:
             if (!(lvt & APIC_LVT_LEVEL_TRIGGER))
                 break;
-            apic_reset_bit(s->irr, lvt & 0xff);
+            apic_reset_bit_atomic(s->irr, lvt & 0xff);
             /* fall through */
         case APIC_DM_EXTINT:
             apic_update_irq(s);
@@ -402,11 +418,11 @@ static void apic_set_irq(APICCommonState *s, int vector_num, int trigger_mode)
 {
     kvm_report_irq_delivered(!apic_get_bit(s->irr, vector_num));
 
-    apic_set_bit(s->irr, vector_num);
+    apic_set_bit_atomic(s->irr, vector_num);
     if (trigger_mode)
-        apic_set_bit(s->tmr, vector_num);
+        apic_set_bit_atomic(s->tmr, vector_num);
     else
-        apic_reset_bit(s->tmr, vector_num);
+        apic_reset_bit_atomic(s->tmr, vector_num);
     if (s->vapic_paddr) {
         apic_sync_vapic(s, SYNC_ISR_IRR_TO_VAPIC);
         /*
@@ -434,17 +450,22 @@ static void apic_eoi(APICCommonState *s)
     apic_update_irq(s);
 }
 
+/*
+ * The destination of an IPI is looked up by other vCPUs without the BQL,
+ * see apic_deliver_ipi_lockless(), so id, log_dest and dest_mode are read
+ * and written atomically.
+ */
 static int apic_find_dest(uint8_t dest)
 {
     APICCommonState *apic = local_apics[dest];
     int i;
 
-    if (apic && apic->id == dest)
+    if (apic && qatomic_read(&apic->id) == dest)
         return dest;  /* shortcut in case apic->id == local_apics[dest]->id */
 
     for (i = 0; i < MAX_APICS; i++) {
         apic = local_apics[i];
-        if (apic && apic->id == dest)
+        if (apic && qatomic_read(&apic->id) == dest)
             return i;
         if (!apic)
             break;
@@ -474,12 +495,15 @@ static void apic_get_delivery_bitmask(uint32_t *deliver_bitmask,
         for(i = 0; i < MAX_APICS; i++) {
             apic_iter = local_apics[i];
             if (apic_iter) {
-                if (apic_iter->dest_mode == 0xf) {
-                    if (dest & apic_iter->log_dest)
+                uint8_t log_dest = qatomic_read(&apic_iter->log_dest);
+                uint8_t iter_dest_mode = qatomic_read(&apic_iter->dest_mode);
+
+                if (iter_dest_mode == 0xf) {
+                    if (dest & log_dest)
                         apic_set_bit(deliver_bitmask, i);
-                } else if (apic_iter->dest_mode == 0x0) {
-                    if ((dest & 0xf0) == (apic_iter->log_dest & 0xf0) &&
-                        (dest & apic_iter->log_dest & 0x0f)) {
+                } else if (iter_dest_mode == 0x0) {
+                    if ((dest & 0xf0) == (log_dest & 0xf0) &&
+                        (dest & log_dest & 0x0f)) {
                         apic_set_bit(deliver_bitmask, i);
                     }
                 }
@@ -508,31 +532,38 @@ void apic_sipi(DeviceState *dev)
     s->wait_for_sipi = 0;
 }
 
-static void apic_deliver(DeviceState *dev, uint8_t dest, uint8_t dest_mode,
-                         uint8_t delivery_mode, uint8_t vector_num,
-                         uint8_t trigger_mode)
+static void apic_get_ipi_bitmask(APICCommonState *s, uint32_t *deliver_bitmask,
+                                 int dest_shorthand, uint8_t dest,
+                                 uint8_t dest_mode)
 {
-    APICCommonState *s = APIC(dev);
-    uint32_t deliver_bitmask[MAX_APIC_WORDS];
-    int dest_shorthand = (s->icr[0] >> 18) & 3;
-    APICCommonState *apic_iter;
-
     switch (dest_shorthand) {
     case 0:
         apic_get_delivery_bitmask(deliver_bitmask, dest, dest_mode);
         break;
     case 1:
-        memset(deliver_bitmask, 0x00, sizeof(deliver_bitmask));
+        memset(deliver_bitmask, 0x00, MAX_APIC_WORDS * sizeof(uint32_t));
         apic_set_bit(deliver_bitmask, s->id);
         break;
     case 2:
-        memset(deliver_bitmask, 0xff, sizeof(deliver_bitmask));
+        memset(deliver_bitmask, 0xff, MAX_APIC_WORDS * sizeof(uint32_t));
         break;
     case 3:
-        memset(deliver_bitmask, 0xff, sizeof(deliver_bitmask));
+        memset(deliver_bitmask, 0xff, MAX_APIC_WORDS * sizeof(uint32_t));
         apic_reset_bit(deliver_bitmask, s->id);
         break;
     }
+}
+
+static void apic_deliver(DeviceState *dev, uint8_t dest, uint8_t dest_mode,
+                         uint8_t delivery_mode, uint8_t vector_num,
+                         uint8_t trigger_mode)
+{
+    APICCommonState *s = APIC(dev);
+    uint32_t deliver_bitmask[MAX_APIC_WORDS];
+    int dest_shorthand = (s->icr[0] >> 18) & 3;
+    APICCommonState *apic_iter;
+
+    apic_get_ipi_bitmask(s, deliver_bitmask, dest_shorthand, dest, dest_mode);
 
     switch (delivery_mode) {
         case APIC_DM_INIT:
@@ -556,6 +587,59 @@ static void apic_deliver(DeviceState *dev, uint8_t dest, uint8_t dest_mode,
     apic_bus_deliver(deliver_bitmask, delivery_mode, vector_num, trigger_mode);
 }
 
+/*
+ * Fixed-mode, edge-triggered IPIs to other vCPUs (TLB shootdowns,
+ * reschedule and function call IPIs) are posted without the BQL when
+ * vCPUs run in parallel: the vector is set in the target's IRR
+ * atomically and the target is kicked with CPU_INTERRUPT_POLL, which
+ * makes it re-evaluate its APIC state from its own thread.
+ *
+ * Returns false, having done nothing, if the IPI needs the slow path.
+ */
+static bool apic_deliver_ipi_lockless(uint32_t icr_lo)
+{
+    uint32_t deliver_bitmask[MAX_APIC_WORDS];
+    APICCommonState *s, *apic_iter;
+    DeviceState *dev;
+
+    if (!tcg_enabled() || !qemu_tcg_mttcg_enabled()) {
+        return false;
+    }
+    if (((icr_lo >> 8) & 7) != APIC_DM_FIXED || ((icr_lo >> 15) & 1)) {
+        return false;
+    }
+
+    dev = cpu_get_current_apic();
+    if (!dev) {
+        return false;
+    }
+    s = APIC(dev);
+
+    /* An INIT IPI from another vCPU may reset icr under the BQL */
+    apic_get_ipi_bitmask(s, deliver_bitmask, (icr_lo >> 18) & 3,
+                         (qatomic_read(&s->icr[1]) >> 24) & 0xff,
+                         (icr_lo >> 11) & 1);
+
+    /*
+     * Self IPIs must raise CPU_INTERRUPT_HARD directly, and the VAPIC
+     * needs IRR mirrored into guest memory; leave those to the slow path.
+     */
+    foreach_apic(apic_iter, deliver_bitmask,
+                 if (apic_iter == s ||
+                     qatomic_read(&apic_iter->vapic_enabled)) {
+                     return false;
+                 });
+
+    trace_apic_deliver_ipi_lockless(icr_lo & 0xff);
+    qatomic_set(&s->icr[0], icr_lo);
+    foreach_apic(apic_iter, deliver_bitmask, {
+        apic_set_bit_atomic(apic_iter->irr, icr_lo & 0xff);
+        apic_reset_bit_atomic(apic_iter->tmr, icr_lo & 0xff);
+        cpu_interrupt_lockless(CPU(apic_iter->cpu), CPU_INTERRUPT_POLL);
+    });
+    return true;
+}
+
 static bool apic_check_pic(APICCommonState *s)
 {
     DeviceState *dev = (DeviceState *)s;
@@ -592,7 +676,7 @@ int apic_get_interrupt(DeviceState *dev)
         apic_sync_vapic(s, SYNC_TO_VAPIC);
         return s->spurious_vec & 0xff;
     }
-    apic_reset_bit(s->irr, intno);
+    apic_reset_bit_atomic(s->irr, intno);
     apic_set_bit(s->isr, intno);
     apic_sync_vapic(s, SYNC_TO_VAPIC);
 
@@ -635,7 +719,8 @@ static void apic_timer(void *opaque)
     apic_timer_update(s, s->next_time);
 }
 
-static uint64_t apic_mem_read(void *opaque, hwaddr addr, unsigned size)
+static uint64_t apic_mem_read_locked(void *opaque, hwaddr addr,
+                                     unsigned size)
 {
     DeviceState *dev;
     APICCommonState *s;
@@ -723,6 +808,13 @@ static uint64_t apic_mem_read(void *opaque, hwaddr addr, unsigned size)
     return val;
 }
 
+static uint64_t apic_mem_read(void *opaque, hwaddr addr, unsigned size)
+{
+    QEMU_IOTHREAD_LOCK_GUARD();
+
+    return apic_mem_read_locked(opaque, addr, size);
+}
+
 static void apic_send_msi(MSIMessage *msi)
 {
     uint64_t addr = msi->address;
@@ -736,8 +828,8 @@ static void apic_send_msi(MSIMessage *msi)
     apic_deliver_irq(dest, dest_mode, delivery, vector, trigger_mode);
 }
 
-static void apic_mem_write(void *opaque, hwaddr addr, uint64_t val,
-                           unsigned size)
+static void apic_mem_write_locked(void *opaque, hwaddr addr, uint64_t val,
+                                  unsigned size)
 {
     DeviceState *dev;
     APICCommonState *s;
@@ -768,7 +860,7 @@ static void apic_mem_write(void *opaque, hwaddr addr, uint64_t val,
 
     switch(index) {
     case 0x02:
-        s->id = (val >> 24);
+        qatomic_set(&s->id, val >> 24);
         break;
     case 0x03:
         break;
@@ -787,10 +879,10 @@ static void apic_mem_write(void *opaque, hwaddr addr, uint64_t val,
         apic_eoi(s);
         break;
     case 0x0d:
-        s->log_dest = val >> 24;
+        qatomic_set(&s->log_dest, val >> 24);
         break;
     case 0x0e:
-        s->dest_mode = val >> 28;
+        qatomic_set(&s->dest_mode, val >> 28);
         break;
     case 0x0f:
         s->spurious_vec = val & 0x1ff;
@@ -802,13 +894,13 @@ static void apic_mem_write(void *opaque, hwaddr addr, uint64_t val,
     case 0x28:
         break;
     case 0x30:
-        s->icr[0] = val;
+        qatomic_set(&s->icr[0], val);
         apic_deliver(dev, (s->icr[1] >> 24) & 0xff, (s->icr[0] >> 11) & 1,
                      (s->icr[0] >> 8) & 7, (s->icr[0] & 0xff),
                      (s->icr[0] >> 15) & 1);
         break;
     case 0x31:
-        s->icr[1] = val;
+        qatomic_set(&s->icr[1], val);
         break;
     case 0x32 ... 0x37:
         {
@@ -842,6 +934,23 @@ static void apic_mem_write(void *opaque, hwaddr addr, uint64_t val,
     }
 }
 
+/*
+ * The APIC region does not take the BQL on its own (see apic_realize),
+ * so that IPIs between vCPUs can be delivered lock-free.  Everything else
+ * is handled under the BQL.
+ */
+static void apic_mem_write(void *opaque, hwaddr addr, uint64_t val,
+                           unsigned size)
+{
+    if (size == 4 && addr <= 0xfff && ((addr >> 4) & 0xff) == 0x30 &&
+        apic_deliver_ipi_lockless(val)) {
+        return;
+    }
+
+    QEMU_IOTHREAD_LOCK_GUARD();
+    apic_mem_write_locked(opaque, addr, val, size);
+}
+
 static void apic_pre_save(APICCommonState *s)
 {
     apic_sync_vapic(s, SYNC_FROM_VAPIC);
@@ -883,6 +992,7 @@ static void apic_realize(DeviceState *dev, Error **errp)
 
     memory_region_init_io(&s->io_memory, OBJECT(s), &apic_io_ops, s, "apic-msi",
                           APIC_SPACE_SIZE);
+    memory_region_clear_global_locking(&s->io_memory);
 
     s->timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, apic_timer, s);
     local_apics[s->id] = s;
@@ -111,6 +111,7 @@ void apic_enable_vapic(DeviceState *dev, hwaddr paddr)
     APICCommonClass *info = APIC_COMMON_GET_CLASS(s);
 
     s->vapic_paddr = paddr;
+    qatomic_set(&s->vapic_enabled, paddr != 0);
     info->vapic_base_update(s);
 }
 
@@ -194,8 +195,8 @@ void apic_init_reset(DeviceState *dev)
     s = APIC_COMMON(dev);
     s->tpr = 0;
     s->spurious_vec = 0xff;
-    s->log_dest = 0;
-    s->dest_mode = 0xf;
+    qatomic_set(&s->log_dest, 0);
+    qatomic_set(&s->dest_mode, 0xf);
     memset(s->isr, 0, sizeof(s->isr));
     memset(s->tmr, 0, sizeof(s->tmr));
     memset(s->irr, 0, sizeof(s->irr));
@@ -203,7 +204,8 @@ void apic_init_reset(DeviceState *dev)
         s->lvt[i] = APIC_LVT_MASKED;
     }
     s->esr = 0;
-    memset(s->icr, 0, sizeof(s->icr));
+    qatomic_set(&s->icr[0], 0);
+    qatomic_set(&s->icr[1], 0);
     s->divide_conf = 0;
     s->count_shift = 0;
     s->initial_count = 0;
@@ -244,11 +246,12 @@ static void apic_reset_common(DeviceState *dev)
 
     bsp = s->apicbase & MSR_IA32_APICBASE_BSP;
     s->apicbase = APIC_DEFAULT_ADDRESS | bsp | MSR_IA32_APICBASE_ENABLE;
-    s->id = s->initial_apic_id;
+    qatomic_set(&s->id, s->initial_apic_id);
 
     kvm_reset_irq_delivered();
 
     s->vapic_paddr = 0;
+    qatomic_set(&s->vapic_enabled, false);
     info->vapic_base_update(s);
 
     apic_init_reset(dev);
@@ -19,6 +19,8 @@
 #include "hw/remote/memory.h"
 #include "hw/remote/iohub.h"
 #include "sysemu/reset.h"
+#include "hw/remote/mpqemu-ring.h"
+#include "qemu/error-report.h"
 
 static void process_config_write(QIOChannel *ioc, PCIDevice *dev,
                                  MPQemuMsg *msg, Error **errp);
@@ -28,6 +30,8 @@ static void process_bar_write(QIOChannel *ioc, MPQemuMsg *msg, Error **errp);
 static void process_bar_read(QIOChannel *ioc, MPQemuMsg *msg, Error **errp);
 static void process_device_reset_msg(QIOChannel *ioc, PCIDevice *dev,
                                      Error **errp);
+static void process_set_ring_msg(RemoteCommDev *com, MPQemuMsg *msg,
+                                 Error **errp);
 
 void coroutine_fn mpqemu_remote_msg_loop_co(void *data)
 {
@@ -74,6 +78,9 @@ void coroutine_fn mpqemu_remote_msg_loop_co(void *data)
         case MPQEMU_CMD_DEVICE_RESET:
             process_device_reset_msg(com->ioc, pci_dev, &local_err);
             break;
+        case MPQEMU_CMD_SET_RING:
+            process_set_ring_msg(com, &msg, &local_err);
+            break;
         default:
             error_setg(&local_err,
                        "Unknown command (%d) received for device %s"
@@ -82,6 +89,8 @@ void coroutine_fn mpqemu_remote_msg_loop_co(void *data)
         }
     }
 
+    mpqemu_ring_detach(com->ring);
+
     if (local_err) {
         error_report_err(local_err);
         qemu_system_shutdown_request(SHUTDOWN_CAUSE_HOST_ERROR);
@@ -227,3 +236,35 @@ static void process_device_reset_msg(QIOChannel *ioc, PCIDevice *dev,
 
     mpqemu_msg_send(&ret, ioc, errp);
 }
+
+/*
+ * Failing to set up the ring is not fatal, the proxy keeps using the
+ * socket for BAR accesses.
+ */
+static void process_set_ring_msg(RemoteCommDev *com, MPQemuMsg *msg,
+                                 Error **errp)
+{
+    ERRP_GUARD();
+    MPQemuMsg ret = { 0 };
+    Error *local_err = NULL;
+    int i;
+
+    mpqemu_ring_detach(com->ring);
+    com->ring = mpqemu_ring_attach(msg->fds[0], msg->fds[1], msg->fds[2],
+                                   &local_err);
+    if (!com->ring) {
+        error_report_err(local_err);
+        for (i = 0; i < msg->num_fds; i++) {
+            close(msg->fds[i]);
+        }
+        ret.data.u64 = UINT64_MAX;
+    }
+
+    ret.cmd = MPQEMU_CMD_RET;
+    ret.size = sizeof(ret.data.u64);
+
+    if (!mpqemu_msg_send(&ret, com->ioc, NULL)) {
+        error_prepend(errp, "Error returning code to proxy, pid "FMT_pid": ",
+                      getpid());
+    }
+}
@@ -195,6 +195,10 @@ uint64_t mpqemu_msg_send_and_await_reply(MPQemuMsg *msg, PCIProxyDev *pdev,
     assert(!qemu_in_coroutine());
 
     QEMU_LOCK_GUARD(&pdev->io_mutex);
+    if (pdev->ring.ring && !mpqemu_ring_flush(&pdev->ring, errp)) {
+        return ret;
+    }
+
     if (!mpqemu_msg_send(msg, pdev->ioc, errp)) {
         return ret;
     }
@@ -255,6 +259,11 @@ bool mpqemu_msg_valid(MPQemuMsg *msg)
             return false;
         }
         break;
+    case MPQEMU_CMD_SET_RING:
+        if (msg->size || (msg->num_fds != 3)) {
+            return false;
+        }
+        break;
     default:
         break;
     }
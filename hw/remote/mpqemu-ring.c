@@ -0,0 +1,302 @@
+/*
+ * Shared memory ring between QEMU and remote device process
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ *
+ */
+
+#include "qemu/osdep.h"
+
+#include <poll.h>
+
+#include "hw/remote/mpqemu-ring.h"
+#include "qapi/error.h"
+#include "qemu/bswap.h"
+#include "qemu/error-report.h"
+#include "qemu/host-utils.h"
+#include "qemu/main-loop.h"
+#include "qemu/memfd.h"
+#include "qemu/processor.h"
+#include "qemu/timer.h"
+#include "exec/address-spaces.h"
+#include "exec/memattrs.h"
+
+static bool mpqemu_ring_done(MPQemuRing *ring, uint32_t idx)
+{
+    return (int32_t)(qatomic_load_acquire(&ring->cons) - idx) > 0;
+}
+
+/*
+ * Wait until the remote process has completed request @idx, polling for
+ * up to @poll_ns before going to sleep on the response eventfd.
+ * Called with the proxy's io_mutex held.
+ */
+static bool mpqemu_ring_wait(MPQemuRingDev *r, uint32_t idx, Error **errp)
+{
+    MPQemuRing *ring = r->ring;
+    int64_t deadline = get_clock() + r->poll_ns;
+    struct pollfd pfd[2] = {
+        { .fd = event_notifier_get_fd(&r->resp), .events = POLLIN },
+        { .fd = r->hup_fd, .events = 0 },
+    };
+    bool ret = true;
+
+    while (!mpqemu_ring_done(ring, idx)) {
+        if (get_clock() < deadline) {
+            cpu_relax();
+            continue;
+        }
+
+        qatomic_set(&ring->proxy_waiting, 1);
+        /* Pairs with the barrier in mpqemu_ring_process() */
+        smp_mb();
+        if (mpqemu_ring_done(ring, idx)) {
+            break;
+        }
+
+        if (poll(pfd, G_N_ELEMENTS(pfd), -1) < 0 && errno != EINTR) {
+            error_setg_errno(errp, errno, "Failed to wait for remote process");
+            ret = false;
+            break;
+        }
+        if (pfd[1].revents) {
+            error_setg(errp, "Remote process hung up");
+            ret = false;
+            break;
+        }
+        event_notifier_test_and_clear(&r->resp);
+    }
+
+    qatomic_set(&ring->proxy_waiting, 0);
+    return ret;
+}
+
+/*
+ * Wait for all queued requests, including posted ones, to complete.
+ * Called with the proxy's io_mutex held before any message goes over
+ * the socket, so that it is ordered after earlier BAR accesses.
+ * Like mpqemu_msg_send(), drop the BQL if we have to wait.
+ */
+bool mpqemu_ring_flush(MPQemuRingDev *r, Error **errp)
+{
+    uint32_t idx = r->ring->prod - 1;
+    bool iolock;
+    bool ret;
+
+    if (mpqemu_ring_done(r->ring, idx)) {
+        return true;
+    }
+
+    iolock = qemu_mutex_iothread_locked();
+    if (iolock) {
+        qemu_mutex_unlock_iothread();
+    }
+
+    ret = mpqemu_ring_wait(r, idx, errp);
+
+    if (iolock) {
+        qemu_mutex_lock_iothread();
+    }
+
+    return ret;
+}
+
+bool mpqemu_ring_init(MPQemuRingDev *r, int hup_fd, Error **errp)
+{
+    int ret;
+
+    r->ring = qemu_memfd_alloc("mpqemu-ring", sizeof(MPQemuRing),
+                               F_SEAL_GROW | F_SEAL_SHRINK | F_SEAL_SEAL,
+                               &r->fd, errp);
+    if (!r->ring) {
+        return false;
+    }
+
+    ret = event_notifier_init(&r->req, 0);
+    if (ret < 0) {
+        error_setg_errno(errp, -ret, "Failed to create ring notifier");
+        goto fail;
+    }
+    ret = event_notifier_init(&r->resp, 0);
+    if (ret < 0) {
+        error_setg_errno(errp, -ret, "Failed to create ring notifier");
+        event_notifier_cleanup(&r->req);
+        goto fail;
+    }
+
+    r->hup_fd = hup_fd;
+    return true;
+
+fail:
+    qemu_memfd_free(r->ring, sizeof(MPQemuRing), r->fd);
+    r->ring = NULL;
+    return false;
+}
+
+void mpqemu_ring_cleanup(MPQemuRingDev *r)
+{
+    if (!r->ring) {
+        return;
+    }
+
+    event_notifier_cleanup(&r->req);
+    event_notifier_cleanup(&r->resp);
+    qemu_memfd_free(r->ring, sizeof(MPQemuRing), r->fd);
+    r->ring = NULL;
+}
+
+/*
+ * Queue a BAR access and, unless it is @posted, wait for its completion.
+ * Returns the value read, or UINT64_MAX on error.
+ * Called with the proxy's io_mutex held.
+ */
+uint64_t mpqemu_ring_bar_access(MPQemuRingDev *r, hwaddr addr, uint64_t val,
+                                unsigned size, bool memory, bool write,
+                                bool posted, Error **errp)
+{
+    MPQemuRing *ring = r->ring;
+    uint32_t idx = ring->prod;
+    MPQemuRingEntry *e;
+
+    if (idx - qatomic_load_acquire(&ring->cons) >= MPQEMU_RING_SIZE &&
+        !mpqemu_ring_wait(r, idx - MPQEMU_RING_SIZE, errp)) {
+        return UINT64_MAX;
+    }
+
+    e = &ring->entries[idx % MPQEMU_RING_SIZE];
+    e->addr = addr;
+    e->val = write ? val : 0;
+    e->size = size;
+    e->write = write;
+    e->memory = memory;
+    qatomic_store_release(&ring->prod, idx + 1);
+
+    /* Pairs with the barrier in mpqemu_ring_process() */
+    smp_mb();
+    if (qatomic_read(&ring->remote_idle)) {
+        event_notifier_set(&r->req);
+    }
+
+    if (posted) {
+        return 0;
+    }
+    if (!mpqemu_ring_wait(r, idx, errp)) {
+        return UINT64_MAX;
+    }
+    return e->val;
+}
+
+static void mpqemu_ring_do_access(MPQemuRingEntry *entry)
+{
+    MPQemuRingEntry e = *entry;
+    AddressSpace *as = e.memory ? &address_space_memory : &address_space_io;
+    MemTxResult res;
+    uint64_t val = 0;
+
+    if (!is_power_of_2(e.size) || e.size > sizeof(uint64_t)) {
+        entry->val = UINT64_MAX;
+        return;
+    }
+
+    if (e.write) {
+        val = cpu_to_le64(e.val);
+    }
+
+    res = address_space_rw(as, e.addr, MEMTXATTRS_UNSPECIFIED,
+                           (void *)&val, e.size, e.write);
+    if (res != MEMTX_OK) {
+        error_report("Bad address %"PRIx64" for mem %s, pid "FMT_pid".",
+                     e.addr, e.write ? "write" : "read", getpid());
+        entry->val = UINT64_MAX;
+        return;
+    }
+
+    if (!e.write) {
+        entry->val = le64_to_cpu(val);
+    }
+}
+
+static void mpqemu_ring_process(void *opaque)
+{
+    MPQemuRingDev *r = opaque;
+    MPQemuRing *ring = r->ring;
+    uint32_t cons = qatomic_read(&ring->cons);
+
+    event_notifier_test_and_clear(&r->req);
+    qatomic_set(&ring->remote_idle, 0);
+
+    for (;;) {
+        if (qatomic_load_acquire(&ring->prod) == cons) {
+            qatomic_set(&ring->remote_idle, 1);
+            /* Pairs with the barrier in mpqemu_ring_bar_access() */
+            smp_mb();
+            if (qatomic_read(&ring->prod) == cons) {
+                break;
+            }
+            qatomic_set(&ring->remote_idle, 0);
+            continue;
+        }
+
+        mpqemu_ring_do_access(&ring->entries[cons % MPQEMU_RING_SIZE]);
+        qatomic_store_release(&ring->cons, ++cons);
+
+        /* Pairs with the barrier in mpqemu_ring_wait() */
+        smp_mb();
+        if (qatomic_read(&ring->proxy_waiting)) {
+            event_notifier_set(&r->resp);
+        }
+    }
+}
+
+/*
+ * Map the ring set up by the proxy and start serving it from the main
+ * loop.  On success the ring owns @req_fd and @resp_fd, and @fd is closed.
+ */
+MPQemuRingDev *mpqemu_ring_attach(int fd, int req_fd, int resp_fd,
+                                  Error **errp)
+{
+    MPQemuRingDev *r;
+    struct stat st;
+    void *ring;
+
+    if (fstat(fd, &st) < 0 || st.st_size < sizeof(MPQemuRing)) {
+        error_setg(errp, "Invalid ring memory, pid "FMT_pid".", getpid());
+        return NULL;
+    }
+
+    ring = mmap(NULL, sizeof(MPQemuRing), PROT_READ | PROT_WRITE, MAP_SHARED,
+                fd, 0);
+    if (ring == MAP_FAILED) {
+        error_setg_errno(errp, errno, "Failed to map ring, pid "FMT_pid".",
+                         getpid());
+        return NULL;
+    }
+    close(fd);
+
+    r = g_new0(MPQemuRingDev, 1);
+    r->ring = ring;
+    r->fd = -1;
+    r->hup_fd = -1;
+    event_notifier_init_fd(&r->req, req_fd);
+    event_notifier_init_fd(&r->resp, resp_fd);
+
+    qatomic_set(&r->ring->remote_idle, 1);
+    qemu_set_fd_handler(req_fd, mpqemu_ring_process, NULL, r);
+
+    return r;
+}
+
+/* Stop serving the ring, once the proxy has gone away or replaced it */
+void mpqemu_ring_detach(MPQemuRingDev *r)
+{
+    if (!r) {
+        return;
+    }
+
+    qemu_set_fd_handler(event_notifier_get_fd(&r->req), NULL, NULL, NULL);
+    event_notifier_cleanup(&r->req);
+    event_notifier_cleanup(&r->resp);
+    munmap(r->ring, sizeof(MPQemuRing));
+    g_free(r);
+}
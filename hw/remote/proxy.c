@@ -18,6 +18,7 @@
 #include "qemu/sockets.h"
 #include "hw/remote/mpqemu-link.h"
 #include "qemu/error-report.h"
+#include "qemu/main-loop.h"
 #include "hw/remote/proxy-memory-listener.h"
 #include "qom/object.h"
 #include "qemu/event_notifier.h"
@@ -75,6 +76,34 @@ static void setup_irqfd(PCIProxyDev *dev)
     pci_device_set_intx_routing_notifier(pci_dev, proxy_intx_update);
 }
 
+static void setup_ring(PCIProxyDev *dev, int fd)
+{
+    MPQemuMsg msg = { 0 };
+    Error *local_err = NULL;
+
+    if (!mpqemu_ring_init(&dev->ring, fd, &local_err)) {
+        goto fail;
+    }
+
+    msg.cmd = MPQEMU_CMD_SET_RING;
+    msg.num_fds = 3;
+    msg.fds[0] = dev->ring.fd;
+    msg.fds[1] = event_notifier_get_fd(&dev->ring.req);
+    msg.fds[2] = event_notifier_get_fd(&dev->ring.resp);
+    msg.size = 0;
+
+    if (mpqemu_msg_send_and_await_reply(&msg, dev, &local_err) == 0) {
+        return;
+    }
+
+fail:
+    warn_report("proxy: shared memory ring unavailable, using the socket");
+    if (local_err) {
+        warn_report_err(local_err);
+    }
+    mpqemu_ring_cleanup(&dev->ring);
+}
+
 static void pci_proxy_dev_realize(PCIDevice *device, Error **errp)
 {
     ERRP_GUARD();
@@ -124,6 +153,10 @@ static void pci_proxy_dev_realize(PCIDevice *device, Error **errp)
 
     setup_irqfd(dev);
 
+    if (dev->shm_ring) {
+        setup_ring(dev, fd);
+    }
+
     probe_pci_info(PCI_DEVICE(dev), errp);
 }
 
@@ -143,6 +176,8 @@ static void pci_proxy_dev_exit(PCIDevice *pdev)
 
     event_notifier_cleanup(&dev->intr);
     event_notifier_cleanup(&dev->resample);
+
+    mpqemu_ring_cleanup(&dev->ring);
 }
 
 static void config_op_send(PCIProxyDev *pdev, uint32_t addr, uint32_t *val,
@@ -197,6 +232,9 @@ static void pci_proxy_write_config(PCIDevice *d, uint32_t addr, uint32_t val,
 
 static Property proxy_properties[] = {
     DEFINE_PROP_STRING("fd", PCIProxyDev, fd),
+    DEFINE_PROP_BOOL("x-shm-ring", PCIProxyDev, shm_ring, false),
+    DEFINE_PROP_UINT32("x-ring-poll-ns", PCIProxyDev, ring.poll_ns, 0),
+    DEFINE_PROP_BOOL("x-posted-writes", PCIProxyDev, posted_writes, true),
     DEFINE_PROP_END_OF_LIST(),
 };
 
@@ -233,6 +271,35 @@ static void pci_proxy_dev_register_types(void)
 
 type_init(pci_proxy_dev_register_types)
 
+/*
+ * BAR accesses through the ring drop the BQL while waiting for io_mutex,
+ * like the socket path does while waiting for the reply.  MMIO writes are
+ * posted, as they are on PCI, unless x-posted-writes is off.
+ */
+static uint64_t send_bar_access_ring(PCIProxyDev *pdev, hwaddr addr,
+                                     uint64_t val, unsigned size, bool memory,
+                                     bool write, Error **errp)
+{
+    bool posted = write && memory && pdev->posted_writes;
+    bool iolock = qemu_mutex_iothread_locked();
+    uint64_t ret;
+
+    if (iolock) {
+        qemu_mutex_unlock_iothread();
+    }
+
+    qemu_mutex_lock(&pdev->io_mutex);
+    ret = mpqemu_ring_bar_access(&pdev->ring, addr, val, size, memory, write,
+                                 posted, errp);
+    qemu_mutex_unlock(&pdev->io_mutex);
+
+    if (iolock) {
+        qemu_mutex_lock_iothread();
+    }
+
+    return ret;
+}
+
 static void send_bar_access_msg(PCIProxyDev *pdev, MemoryRegion *mr,
                                 bool write, hwaddr addr, uint64_t *val,
                                 unsigned size, bool memory)
@@ -241,6 +308,12 @@ static void send_bar_access_msg(PCIProxyDev *pdev, MemoryRegion *mr,
     long ret = -EINVAL;
     Error *local_err = NULL;
 
+    if (pdev->ring.ring) {
+        ret = send_bar_access_ring(pdev, mr->addr + addr, write ? *val : 0,
+                                   size, memory, write, &local_err);
+        goto out;
+    }
+
     msg.size = sizeof(BarAccessMsg);
     msg.data.bar_access.addr = mr->addr + addr;
     msg.data.bar_access.size = size;
@@ -254,6 +327,8 @@ static void send_bar_access_msg(PCIProxyDev *pdev, MemoryRegion *mr,
     }
 
     ret = mpqemu_msg_send_and_await_reply(&msg, pdev, &local_err);
+
+out:
     if (local_err) {
         error_report_err(local_err);
     }
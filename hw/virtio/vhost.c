@@ -27,6 +27,7 @@
 #include "migration/blocker.h"
 #include "migration/qemu-file-types.h"
 #include "sysemu/dma.h"
+#include "exec/ram_addr.h"
 #include "trace.h"
 
 /* enabled until disconnected backend stabilizes */
@@ -74,6 +75,7 @@ static void vhost_dev_sync_region(struct vhost_dev *dev,
     vhost_log_chunk_t *from = log + start / VHOST_LOG_CHUNK;
     vhost_log_chunk_t *to = log + end / VHOST_LOG_CHUNK + 1;
     uint64_t addr = QEMU_ALIGN_DOWN(start, VHOST_LOG_CHUNK);
+    ram_addr_t ram_addr;
 
     if (end < start) {
         return;
@@ -81,6 +83,33 @@ static void vhost_dev_sync_region(struct vhost_dev *dev,
     assert(end / VHOST_LOG_CHUNK < dev->log_size);
     assert(start / VHOST_LOG_CHUNK < dev->log_size);
 
+    /*
+     * If the log pages map directly to host pages of RAM, merge the log
+     * into the dirty bitmaps of the RAMBlock a whole word at a time.
+     */
+    ram_addr = memory_region_get_ram_addr(section->mr);
+    if (ram_addr != RAM_ADDR_INVALID &&
+        qemu_real_host_page_size() == VHOST_LOG_PAGE &&
+        QEMU_IS_ALIGNED(section->offset_within_address_space |
+                        section->offset_within_region, VHOST_LOG_PAGE)) {
+        uint64_t first_page = start / VHOST_LOG_PAGE;
+        uint64_t last_page = end / VHOST_LOG_PAGE;
+        uint64_t npages = last_page - first_page + 1;
+        g_autofree unsigned long *bitmap = NULL;
+
+        /* The log is an array of host longs, like QEMU's own bitmaps */
+        QEMU_BUILD_BUG_ON(sizeof(vhost_log_chunk_t) != sizeof(unsigned long));
+        bitmap = bitmap_fetch_and_clear_atomic(log, first_page, npages);
+        if (bitmap) {
+            ram_addr += section->offset_within_region +
+                        first_page * VHOST_LOG_PAGE -
+                        section->offset_within_address_space;
+            bitmap_to_le(bitmap, bitmap, npages);
+            cpu_physical_memory_set_dirty_lebitmap(bitmap, ram_addr, npages);
+        }
+        return;
+    }
+
     for (;from < to; ++from) {
         vhost_log_chunk_t log;
         /* We first check with non-atomic: much cheaper,
@@ -17,8 +17,10 @@
 #include "qemu/module.h"
 #include "qapi/error.h"
 #include "qemu/error-report.h"
+#include "block/aio-wait.h"
 
 #include "hw/virtio/virtio.h"
+#include "hw/virtio/virtio-bus.h"
 #include "hw/virtio/virtio-crypto.h"
 #include "hw/qdev-properties.h"
 #include "hw/virtio/virtio-access.h"
@@ -70,6 +72,15 @@ static inline int virtio_crypto_vq2q(int queue_index)
     return queue_index;
 }
 
+static void virtio_crypto_notify(VirtIOCrypto *vcrypto, VirtQueue *vq)
+{
+    if (vcrypto->dataplane_started) {
+        virtio_notify_irqfd(VIRTIO_DEVICE(vcrypto), vq);
+    } else {
+        virtio_notify(VIRTIO_DEVICE(vcrypto), vq);
+    }
+}
+
 static int
 virtio_crypto_cipher_session_helper(VirtIODevice *vdev,
            CryptoDevBackendSymSessionInfo *info,
@@ -299,7 +310,7 @@ static void virtio_crypto_create_session_completion(void *opaque, int ret)
         goto out;
     }
     virtqueue_push(vq, elem, sizeof(input));
-    virtio_notify(vdev, vq);
+    virtio_crypto_notify(VIRTIO_CRYPTO(vdev), vq);
 
 out:
     g_free(elem);
@@ -329,7 +340,7 @@ static void virtio_crypto_destroy_session_completion(void *opaque, int ret)
         goto out;
     }
     virtqueue_push(vq, elem, sizeof(status));
-    virtio_notify(vdev, vq);
+    virtio_crypto_notify(VIRTIO_CRYPTO(vdev), vq);
 
 out:
     g_free(elem);
@@ -442,7 +453,7 @@ static void virtio_crypto_handle_ctrl(VirtIODevice *vdev, VirtQueue *vq)
                 virtqueue_detach_element(vq, elem, 0);
             } else {
                 virtqueue_push(vq, elem, sizeof(input));
-                virtio_notify(vdev, vq);
+                virtio_crypto_notify(vcrypto, vq);
             }
             g_free(sreq);
             g_free(elem);
@@ -464,13 +475,18 @@ static void virtio_crypto_init_request(VirtIOCrypto *vcrypto, VirtQueue *vq,
     req->in_len = 0;
     req->flags = CRYPTODEV_BACKEND_ALG__MAX;
     memset(&req->op_info, 0x00, sizeof(req->op_info));
+    req->ctx = qemu_get_current_aio_context();
+    qatomic_inc(&vcrypto->inflight);
 }
 
 static void virtio_crypto_free_request(VirtIOCryptoReq *req)
 {
+    VirtIOCrypto *vcrypto;
+
     if (!req) {
         return;
     }
+    vcrypto = req->vcrypto;
 
     if (req->flags == CRYPTODEV_BACKEND_ALG_SYM) {
         size_t max_len;
@@ -497,6 +513,26 @@ static void virtio_crypto_free_request(VirtIOCryptoReq *req)
 
     g_free(req->in_iov);
     g_free(req);
+
+    qatomic_dec(&vcrypto->inflight);
+    aio_wait_kick();
+}
+
+static bool virtio_crypto_drain_poll(VirtIOCrypto *vcrypto)
+{
+    /*
+     * Backends such as lkcf complete requests from fd handlers in the
+     * iohandler context, which AIO_WAIT_WHILE() does not poll by itself.
+     * They call aio_wait_kick() to get us here.
+     */
+    aio_poll(iohandler_get_aio_context(), false);
+    return qatomic_read(&vcrypto->inflight) > 0;
+}
+
+/* Wait for the backend to complete all requests that were submitted to it */
+static void virtio_crypto_drain(VirtIOCrypto *vcrypto)
+{
+    AIO_WAIT_WHILE(qemu_get_aio_context(), virtio_crypto_drain_poll(vcrypto));
 }
 
 static void
@@ -563,6 +599,8 @@ virtio_crypto_akcipher_input_data_helper(VirtIODevice *vdev,
     req->in_len = sizeof(struct virtio_crypto_inhdr) + asym_op_info->dst_len;
 }
 
+static void virtio_crypto_req_complete_bh(void *opaque);
+
 static void virtio_crypto_req_complete(void *opaque, int ret)
 {
     VirtIOCryptoReq *req = (VirtIOCryptoReq *)opaque;
@@ -570,6 +608,16 @@ static void virtio_crypto_req_complete(void *opaque, int ret)
     VirtIODevice *vdev = VIRTIO_DEVICE(vcrypto);
     uint8_t status = -ret;
 
+    /*
+     * Backends that complete requests from their own event handlers call
+     * us in the main loop, but the virtqueue may belong to an IOThread.
+     */
+    if (qemu_get_current_aio_context() != req->ctx) {
+        req->ret = ret;
+        aio_bh_schedule_oneshot(req->ctx, virtio_crypto_req_complete_bh, req);
+        return;
+    }
+
     if (req->flags == CRYPTODEV_BACKEND_ALG_SYM) {
         virtio_crypto_sym_input_data_helper(vdev, req, status,
                                             req->op_info.u.sym_op_info);
@@ -579,10 +627,17 @@ static void virtio_crypto_req_complete(void *opaque, int ret)
     }
     stb_p(&req->in->status, status);
     virtqueue_push(req->vq, &req->elem, req->in_len);
-    virtio_notify(vdev, req->vq);
+    virtio_crypto_notify(vcrypto, req->vq);
     virtio_crypto_free_request(req);
 }
 
+static void virtio_crypto_req_complete_bh(void *opaque)
+{
+    VirtIOCryptoReq *req = opaque;
+
+    virtio_crypto_req_complete(req, req->ret);
+}
+
 static VirtIOCryptoReq *
 virtio_crypto_get_request(VirtIOCrypto *s, VirtQueue *vq)
 {
@@ -975,6 +1030,12 @@ virtio_crypto_handle_dataq_bh(VirtIODevice *vdev, VirtQueue *vq)
         return;
     }
     virtio_queue_set_notification(vq, 0);
+
+    /* Already in the IOThread, there is no vCPU to get out of the way of */
+    if (vcrypto->dataplane_started) {
+        virtio_crypto_dataq_bh(q);
+        return;
+    }
     qemu_bh_schedule(q->dataq_bh);
 }
 
@@ -1019,10 +1080,151 @@ static void virtio_crypto_init_config(VirtIODevice *vdev)
     vcrypto->conf.max_size = vcrypto->conf.cryptodev->conf.max_size;
 }
 
+/* Context: QEMU global mutex held */
+static int virtio_crypto_start_ioeventfd(VirtIODevice *vdev)
+{
+    VirtIOCrypto *vcrypto = VIRTIO_CRYPTO(vdev);
+    BusState *qbus = qdev_get_parent_bus(DEVICE(vdev));
+    VirtioBusClass *k = VIRTIO_BUS_GET_CLASS(qbus);
+    unsigned nvqs = vcrypto->max_queues + 1;
+    unsigned i;
+    int r;
+
+    if (!vcrypto->ctx) {
+        return VIRTIO_DEVICE_CLASS(VIRTIO_CRYPTO_GET_PARENT_CLASS(vdev))
+                   ->start_ioeventfd(vdev);
+    }
+
+    /* Set up guest notifier (irq) */
+    r = k->set_guest_notifiers(qbus->parent, nvqs, true);
+    if (r != 0) {
+        error_report("virtio-crypto failed to set guest notifier (%d), "
+                     "ensure -accel kvm is set.", r);
+        return -ENOSYS;
+    }
+
+    /*
+     * Batch all the host notifiers in a single transaction to avoid
+     * quadratic time complexity in address_space_update_ioeventfds().
+     */
+    memory_region_transaction_begin();
+
+    for (i = 0; i < nvqs; i++) {
+        r = virtio_bus_set_host_notifier(VIRTIO_BUS(qbus), i, true);
+        if (r != 0) {
+            int j = i;
+
+            error_report("virtio-crypto failed to set host notifier (%d)", r);
+            while (i--) {
+                virtio_bus_set_host_notifier(VIRTIO_BUS(qbus), i, false);
+            }
+
+            /*
+             * The transaction expects the ioeventfds to be open when it
+             * commits. Do it now, before the cleanup loop.
+             */
+            memory_region_transaction_commit();
+
+            while (j--) {
+                virtio_bus_cleanup_host_notifier(VIRTIO_BUS(qbus), j);
+            }
+            k->set_guest_notifiers(qbus->parent, nvqs, false);
+            return -ENOSYS;
+        }
+    }
+
+    memory_region_transaction_commit();
+
+    /*
+     * Visible to the IOThread, we rely on the implicit barriers in
+     * aio_context_acquire() and aio_notify_accept().
+     */
+    vcrypto->dataplane_started = true;
+
+    /* Kick right away to begin processing requests already in vring */
+    for (i = 0; i < nvqs; i++) {
+        VirtQueue *vq = virtio_get_queue(vdev, i);
+
+        event_notifier_set(virtio_queue_get_host_notifier(vq));
+    }
+
+    aio_context_acquire(vcrypto->ctx);
+    for (i = 0; i < nvqs; i++) {
+        virtio_queue_aio_attach_host_notifier(virtio_get_queue(vdev, i),
+                                              vcrypto->ctx);
+    }
+    aio_context_release(vcrypto->ctx);
+    return 0;
+}
+
+/* Context: BH in IOThread */
+static void virtio_crypto_stop_ioeventfd_bh(void *opaque)
+{
+    VirtIOCrypto *vcrypto = opaque;
+    VirtIODevice *vdev = VIRTIO_DEVICE(vcrypto);
+    unsigned i;
+
+    for (i = 0; i < vcrypto->max_queues + 1; i++) {
+        virtio_queue_aio_detach_host_notifier(virtio_get_queue(vdev, i),
+                                              vcrypto->ctx);
+    }
+}
+
+/* Context: QEMU global mutex held */
+static void virtio_crypto_stop_ioeventfd(VirtIODevice *vdev)
+{
+    VirtIOCrypto *vcrypto = VIRTIO_CRYPTO(vdev);
+    BusState *qbus = qdev_get_parent_bus(DEVICE(vdev));
+    VirtioBusClass *k = VIRTIO_BUS_GET_CLASS(qbus);
+    unsigned nvqs = vcrypto->max_queues + 1;
+    unsigned i;
+
+    if (!vcrypto->ctx) {
+        VIRTIO_DEVICE_CLASS(VIRTIO_CRYPTO_GET_PARENT_CLASS(vdev))
+            ->stop_ioeventfd(vdev);
+        return;
+    }
+
+    if (!vcrypto->dataplane_started) {
+        return;
+    }
+
+    aio_context_acquire(vcrypto->ctx);
+    aio_wait_bh_oneshot(vcrypto->ctx, virtio_crypto_stop_ioeventfd_bh,
+                        vcrypto);
+
+    /* The backend completes the requests in flight in the IOThread */
+    AIO_WAIT_WHILE(vcrypto->ctx, qatomic_read(&vcrypto->inflight) > 0);
+    aio_context_release(vcrypto->ctx);
+
+    memory_region_transaction_begin();
+
+    for (i = 0; i < nvqs; i++) {
+        virtio_bus_set_host_notifier(VIRTIO_BUS(qbus), i, false);
+    }
+
+    /*
+     * The transaction expects the ioeventfds to be open when it
+     * commits. Do it now, before the cleanup loop.
+     */
+    memory_region_transaction_commit();
+
+    for (i = 0; i < nvqs; i++) {
+        virtio_bus_cleanup_host_notifier(VIRTIO_BUS(qbus), i);
+    }
+
+    /* Clean up guest notifier (irq) */
+    k->set_guest_notifiers(qbus->parent, nvqs, false);
+
+    vcrypto->dataplane_started = false;
+}
+
 static void virtio_crypto_device_realize(DeviceState *dev, Error **errp)
 {
     VirtIODevice *vdev = VIRTIO_DEVICE(dev);
     VirtIOCrypto *vcrypto = VIRTIO_CRYPTO(dev);
+    BusState *qbus = qdev_get_parent_bus(dev);
+    VirtioBusClass *k = VIRTIO_BUS_GET_CLASS(qbus);
     int i;
 
     vcrypto->cryptodev = vcrypto->conf.cryptodev;
@@ -1043,6 +1245,27 @@ static void virtio_crypto_device_realize(DeviceState *dev, Error **errp)
         return;
     }
 
+    if (vcrypto->conf.iothread) {
+        CryptoDevBackendClient *cc = vcrypto->cryptodev->conf.peers.ccs[0];
+
+        if (cc && cc->type == CRYPTODEV_BACKEND_TYPE_VHOST_USER) {
+            error_setg(errp, "iothread is not supported with a "
+                       "vhost-user cryptodev backend");
+            return;
+        }
+        if (!k->set_guest_notifiers || !k->ioeventfd_assign) {
+            error_setg(errp,
+                       "device is incompatible with iothread "
+                       "(transport does not support notifiers)");
+            return;
+        }
+        if (!virtio_device_ioeventfd_enabled(vdev)) {
+            error_setg(errp, "ioeventfd is required for iothread");
+            return;
+        }
+        vcrypto->ctx = iothread_get_aio_context(vcrypto->conf.iothread);
+    }
+
     virtio_init(vdev, VIRTIO_ID_CRYPTO, vcrypto->config_size);
     vcrypto->curr_queues = 1;
     vcrypto->vqs = g_new0(VirtIOCryptoQueue, vcrypto->max_queues);
@@ -1070,10 +1293,11 @@ static void virtio_crypto_device_unrealize(DeviceState *dev)
     VirtIODevice *vdev = VIRTIO_DEVICE(dev);
     VirtIOCrypto *vcrypto = VIRTIO_CRYPTO(dev);
     VirtIOCryptoQueue *q;
-    int i, max_queues;
+    int i;
+
+    virtio_crypto_drain(vcrypto);
 
-    max_queues = vcrypto->multiqueue ? vcrypto->max_queues : 1;
-    for (i = 0; i < max_queues; i++) {
+    for (i = 0; i < vcrypto->max_queues; i++) {
         virtio_delete_queue(vcrypto->vqs[i].dataq);
         q = &vcrypto->vqs[i];
         qemu_bh_delete(q->dataq_bh);
@@ -1100,6 +1324,8 @@ static const VMStateDescription vmstate_virtio_crypto = {
 static Property virtio_crypto_properties[] = {
     DEFINE_PROP_LINK("cryptodev", VirtIOCrypto, conf.cryptodev,
                      TYPE_CRYPTODEV_BACKEND, CryptoDevBackend *),
+    DEFINE_PROP_LINK("iothread", VirtIOCrypto, conf.iothread, TYPE_IOTHREAD,
+                     IOThread *),
     DEFINE_PROP_END_OF_LIST(),
 };
 
@@ -1171,6 +1397,11 @@ static void virtio_crypto_set_status(VirtIODevice *vdev, uint8_t status)
 {
     VirtIOCrypto *vcrypto = VIRTIO_CRYPTO(vdev);
 
+    /* Requests must not complete while the device is stopped or reset */
+    if (!(status & VIRTIO_CONFIG_S_DRIVER_OK) || !vdev->vm_running) {
+        virtio_crypto_drain(vcrypto);
+    }
+
     virtio_crypto_vhost_status(vcrypto, status);
 }
 
@@ -1236,6 +1467,8 @@ static void virtio_crypto_class_init(ObjectClass *klass, void *data)
     vdc->get_features = virtio_crypto_get_features;
     vdc->reset = virtio_crypto_reset;
     vdc->set_status = virtio_crypto_set_status;
+    vdc->start_ioeventfd = virtio_crypto_start_ioeventfd;
+    vdc->stop_ioeventfd = virtio_crypto_stop_ioeventfd;
     vdc->guest_notifier_mask = virtio_crypto_guest_notifier_mask;
     vdc->guest_notifier_pending = virtio_crypto_guest_notifier_pending;
     vdc->get_vhost = virtio_crypto_get_vhost;
@@ -22,6 +22,7 @@
 #include "qemu/event_notifier.h"
 #include "qemu/thread.h"
 #include "qemu/timer.h"
+#include "qemu/stats64.h"
 #include "block/graph-lock.h"
 
 typedef struct BlockAIOCB BlockAIOCB;
@@ -53,6 +54,7 @@ typedef bool AioPollFn(void *opaque);
 typedef void IOHandler(void *opaque);
 
 struct ThreadPool;
+struct BdrvBusyCount;
 struct LinuxAioState;
 struct LuringState;
 
@@ -121,6 +123,22 @@ struct BHListSlice {
 
 typedef QSLIST_HEAD(, AioHandler) AioHandlerSList;
 
+/*
+ * Event loop statistics.  They are only updated by the thread that runs
+ * the AioContext, and can be read from any thread.  Times are only accounted
+ * by aio_poll() on POSIX hosts, and only once AioContext.account_time is set,
+ * except for polling which reads the clock anyway.
+ */
+typedef struct AioContextStats {
+    Stat64 dispatch_ns;         /* running handlers, bottom halves and timers */
+    Stat64 poll_success_ns;     /* userspace polling that found an event */
+    Stat64 poll_wasted_ns;      /* userspace polling that found nothing */
+    Stat64 blocked_ns;          /* waiting for file descriptors */
+    Stat64 fd_dispatches;       /* ->io_read() and ->io_write() calls */
+    Stat64 poll_dispatches;     /* ->io_poll_ready() calls */
+    Stat64 bh_runs;             /* bottom halves run */
+} AioContextStats;
+
 struct AioContext {
     GSource source;
 
@@ -135,6 +153,13 @@ struct AioContext {
      */
     BdrvGraphRWlock *bdrv_graph;
 
+    /*
+     * Count of block nodes and BlockBackends that became busy, minus those
+     * that became idle, in the thread of this AioContext.  Only the sum over
+     * all AioContexts is meaningful, see bdrv_drain_all_poll().
+     */
+    struct BdrvBusyCount *bdrv_busy;
+
     /* The list of registered AIO handlers.  Protected by ctx->list_lock. */
     AioHandlerList aio_handlers;
 
@@ -245,6 +270,11 @@ struct AioContext {
     /* AIO engine parameters */
     int64_t aio_max_batch;  /* maximum number of requests in a batch */
 
+    AioContextStats stats;
+
+    /* Read the clock in aio_poll() to account times in @stats */
+    bool account_time;
+
     /*
      * List of handlers participating in userspace polling.  Protected by
      * ctx->list_lock.  Iterated and modified mostly by the event loop thread
@@ -438,6 +438,13 @@ typedef enum {
     BDRV_FIX_ERRORS   = 2,
 } BdrvCheckMode;
 
+/*
+ * Progress callback for bdrv_check().  The units of done and total are chosen
+ * by the block driver; total may change during the course of the check.
+ */
+typedef void BdrvCheckStatusCB(BlockDriverState *bs, int64_t done,
+                               int64_t total, void *opaque);
+
 typedef struct BlockSizes {
     uint32_t phys;
     uint32_t log;
@@ -720,10 +720,12 @@ struct BlockDriver {
 
     /*
      * Returns 0 for completed check, -errno for internal errors.
-     * The check results are stored in result.
+     * The check results are stored in result.  Progress may be reported
+     * through status_cb, which can be NULL.
      */
     int coroutine_fn GRAPH_RDLOCK_PTR (*bdrv_co_check)(
-        BlockDriverState *bs, BdrvCheckResult *result, BdrvCheckMode fix);
+        BlockDriverState *bs, BdrvCheckResult *result, BdrvCheckMode fix,
+        BdrvCheckStatusCB *status_cb, void *cb_opaque);
 
     void coroutine_fn (*bdrv_co_debug_event)(BlockDriverState *bs,
                                              BlkdebugEvent event);
@@ -313,4 +313,14 @@ void bdrv_remove_aio_context_notifier(BlockDriverState *bs,
  */
 void bdrv_drain_all_end_quiesce(BlockDriverState *bs);
 
+/*
+ * bdrv_register_busy_count/bdrv_unregister_busy_count:
+ * Set up or tear down the count of busy nodes and BlockBackends kept in
+ * @ctx for bdrv_busy_inc() and bdrv_busy_dec().  When @ctx goes away its
+ * balance is kept, so that the total over all AioContexts stays exact.
+ * Called by register_aiocontext() and unregister_aiocontext().
+ */
+void bdrv_register_busy_count(AioContext *ctx);
+void bdrv_unregister_busy_count(AioContext *ctx);
+
 #endif /* BLOCK_INT_GLOBAL_STATE_H */
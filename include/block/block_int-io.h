@@ -111,6 +111,19 @@ void bdrv_dirty_bitmap_merge_internal(BdrvDirtyBitmap *dest,
 void bdrv_inc_in_flight(BlockDriverState *bs);
 void bdrv_dec_in_flight(BlockDriverState *bs);
 
+/*
+ * bdrv_busy_inc/bdrv_busy_dec:
+ * @in_flight: The in-flight request counter of a node or BlockBackend
+ *
+ * Increment or decrement @in_flight, and keep track of how many counters
+ * are nonzero in the whole process, so that bdrv_drain_all_begin() does
+ * not have to poll every node while requests are still running.  The
+ * count is kept in the AioContext of the calling thread.
+ * bdrv_busy_dec() does not call aio_wait_kick(), the caller must do it.
+ */
+void bdrv_busy_inc(unsigned int *in_flight);
+void bdrv_busy_dec(unsigned int *in_flight);
+
 int coroutine_fn bdrv_co_copy_range_from(BdrvChild *src, int64_t src_offset,
                                          BdrvChild *dst, int64_t dst_offset,
                                          int64_t bytes,
@@ -67,6 +67,13 @@ struct BlockJobDriver {
     void (*attached_aio_context)(BlockJob *job, AioContext *new_context);
 
     void (*set_speed)(BlockJob *job, int64_t speed);
+
+    /*
+     * If the callback is not NULL, it will be invoked when querying the job
+     * to fill in job-type specific information.  Called with the job lock
+     * held.
+     */
+    void (*query)(BlockJob *job, BlockJobInfo *info);
 };
 
 /*
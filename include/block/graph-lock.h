@@ -89,7 +89,8 @@ extern BdrvGraphLock graph_lock;
  * register_aiocontext:
  * Add AioContext @ctx to the list of AioContext.
  * This list is used to obtain the total number of readers
- * currently running the graph.
+ * currently running the graph.  Also set up the count of busy
+ * nodes of @ctx, see bdrv_register_busy_count().
  */
 void register_aiocontext(AioContext *ctx);
 
@@ -0,0 +1,127 @@
+/*
+ * AES round fragments, for the emulation of guest AES instructions
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+
+#ifndef CRYPTO_AES_ROUND_H
+#define CRYPTO_AES_ROUND_H
+
+#include "crypto/host-crypto.h"
+
+/*
+ * The AES state, in the byte order of the FIPS-197 input and output
+ * arrays (column by column).  This is the layout of the state in a
+ * vector register for the x86, Arm and RISC-V instructions, when the
+ * register is stored in little-endian order; frontends on big-endian
+ * hosts convert each 64-bit half with cpu_to_le64() and le64_to_cpu().
+ *
+ * The functions are named after the steps of the AES round that they
+ * perform, in order: SB (SubBytes), SR (ShiftRows), MC (MixColumns),
+ * AK (AddRoundKey) and their inverses ISB, ISR and IMC.  The output may
+ * overlap the inputs.
+ */
+typedef union {
+    uint8_t b[16];
+    uint32_t w[4];
+    uint64_t d[2];
+} AESState;
+
+void aesenc_SB_gen(AESState *ret, const AESState *st);
+void aesenc_MC_gen(AESState *ret, const AESState *st);
+void aesenc_SB_SR_AK_gen(AESState *ret, const AESState *st,
+                         const AESState *rk);
+void aesenc_SB_SR_MC_AK_gen(AESState *ret, const AESState *st,
+                            const AESState *rk);
+void aesdec_IMC_gen(AESState *ret, const AESState *st);
+void aesdec_ISB_ISR_AK_gen(AESState *ret, const AESState *st,
+                           const AESState *rk);
+void aesdec_ISB_ISR_IMC_AK_gen(AESState *ret, const AESState *st,
+                               const AESState *rk);
+
+void aesenc_SB_accel(AESState *ret, const AESState *st);
+void aesenc_MC_accel(AESState *ret, const AESState *st);
+void aesenc_SB_SR_AK_accel(AESState *ret, const AESState *st,
+                           const AESState *rk);
+void aesenc_SB_SR_MC_AK_accel(AESState *ret, const AESState *st,
+                              const AESState *rk);
+void aesdec_IMC_accel(AESState *ret, const AESState *st);
+void aesdec_ISB_ISR_AK_accel(AESState *ret, const AESState *st,
+                             const AESState *rk);
+void aesdec_ISB_ISR_IMC_AK_accel(AESState *ret, const AESState *st,
+                                 const AESState *rk);
+
+/* SubBytes alone, as used by the key expansion */
+static inline void aesenc_SB(AESState *ret, const AESState *st)
+{
+    if (HAVE_AES_ACCEL) {
+        aesenc_SB_accel(ret, st);
+    } else {
+        aesenc_SB_gen(ret, st);
+    }
+}
+
+static inline void aesenc_MC(AESState *ret, const AESState *st)
+{
+    if (HAVE_AES_ACCEL) {
+        aesenc_MC_accel(ret, st);
+    } else {
+        aesenc_MC_gen(ret, st);
+    }
+}
+
+/* The last round of encryption */
+static inline void aesenc_SB_SR_AK(AESState *ret, const AESState *st,
+                                   const AESState *rk)
+{
+    if (HAVE_AES_ACCEL) {
+        aesenc_SB_SR_AK_accel(ret, st, rk);
+    } else {
+        aesenc_SB_SR_AK_gen(ret, st, rk);
+    }
+}
+
+/* A middle round of encryption */
+static inline void aesenc_SB_SR_MC_AK(AESState *ret, const AESState *st,
+                                      const AESState *rk)
+{
+    if (HAVE_AES_ACCEL) {
+        aesenc_SB_SR_MC_AK_accel(ret, st, rk);
+    } else {
+        aesenc_SB_SR_MC_AK_gen(ret, st, rk);
+    }
+}
+
+static inline void aesdec_IMC(AESState *ret, const AESState *st)
+{
+    if (HAVE_AES_ACCEL) {
+        aesdec_IMC_accel(ret, st);
+    } else {
+        aesdec_IMC_gen(ret, st);
+    }
+}
+
+/* The last round of decryption */
+static inline void aesdec_ISB_ISR_AK(AESState *ret, const AESState *st,
+                                     const AESState *rk)
+{
+    if (HAVE_AES_ACCEL) {
+        aesdec_ISB_ISR_AK_accel(ret, st, rk);
+    } else {
+        aesdec_ISB_ISR_AK_gen(ret, st, rk);
+    }
+}
+
+/* A middle round of decryption, with the equivalent inverse cipher */
+static inline void aesdec_ISB_ISR_IMC_AK(AESState *ret, const AESState *st,
+                                         const AESState *rk)
+{
+    if (HAVE_AES_ACCEL) {
+        aesdec_ISB_ISR_IMC_AK_accel(ret, st, rk);
+    } else {
+        aesdec_ISB_ISR_IMC_AK_gen(ret, st, rk);
+    }
+}
+
+#endif /* CRYPTO_AES_ROUND_H */
@@ -0,0 +1,31 @@
+/*
+ * Carry-less multiply, for the emulation of guest instructions
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+
+#ifndef CRYPTO_CLMUL_H
+#define CRYPTO_CLMUL_H
+
+#include "qemu/int128.h"
+#include "crypto/host-crypto.h"
+
+Int128 clmul_64_gen(uint64_t n, uint64_t m);
+Int128 clmul_64_accel(uint64_t n, uint64_t m);
+
+/**
+ * clmul_64:
+ *
+ * Perform a 64x64->128 carry-less multiply of @n and @m, i.e. multiply
+ * them as polynomials over GF(2).
+ */
+static inline Int128 clmul_64(uint64_t n, uint64_t m)
+{
+    if (HAVE_CLMUL_ACCEL) {
+        return clmul_64_accel(n, m);
+    }
+    return clmul_64_gen(n, m);
+}
+
+#endif /* CRYPTO_CLMUL_H */
@@ -0,0 +1,35 @@
+/*
+ * Host acceleration of the crypto building blocks used by TCG frontends
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+
+#ifndef CRYPTO_HOST_CRYPTO_H
+#define CRYPTO_HOST_CRYPTO_H
+
+/*
+ * The AES round, carry-less multiply and SHA round functions in
+ * crypto/aes-round.h, crypto/clmul.h and crypto/sha-round.h have a
+ * generic C implementation and, on x86 hosts, one that uses the host's
+ * AES-NI, PCLMULQDQ and SHA extensions.  The choice is made at startup
+ * from cpuid, and can be checked with the HAVE_*_ACCEL macros below.
+ */
+
+#define HOST_CRYPTO_AES         1
+#define HOST_CRYPTO_CLMUL       2
+#define HOST_CRYPTO_SHA         4
+
+extern unsigned host_crypto_accel;
+
+#ifdef CONFIG_X86_CRYPTO_OPT
+#define HAVE_AES_ACCEL      likely(host_crypto_accel & HOST_CRYPTO_AES)
+#define HAVE_CLMUL_ACCEL    likely(host_crypto_accel & HOST_CRYPTO_CLMUL)
+#define HAVE_SHA_ACCEL      likely(host_crypto_accel & HOST_CRYPTO_SHA)
+#else
+#define HAVE_AES_ACCEL      false
+#define HAVE_CLMUL_ACCEL    false
+#define HAVE_SHA_ACCEL      false
+#endif
+
+#endif /* CRYPTO_HOST_CRYPTO_H */
@@ -0,0 +1,104 @@
+/*
+ * SHA-1 and SHA-256 rounds, for the emulation of guest SHA instructions
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+
+#ifndef CRYPTO_SHA_ROUND_H
+#define CRYPTO_SHA_ROUND_H
+
+#include "crypto/host-crypto.h"
+
+/*
+ * The state and message words are in their natural order, i.e. abcd[0]
+ * is A and wk[0] is the first round's word.  This is the order used by
+ * the Arm instructions; x86 SHA-NI keeps them reversed.
+ */
+
+typedef enum {
+    SHA1_CHOOSE,
+    SHA1_PARITY,
+    SHA1_MAJORITY,
+} SHA1Func;
+
+void sha1_rounds4_gen(uint32_t abcd[4], uint32_t e, const uint32_t wk[4],
+                      SHA1Func f);
+void sha256_rounds4_gen(uint32_t abcd[4], uint32_t efgh[4],
+                        const uint32_t wk[4]);
+void sha256_msg1_gen(uint32_t w[4], const uint32_t w4[4]);
+void sha256_msg2_gen(uint32_t w[4], const uint32_t w12[4]);
+
+void sha1_rounds4_accel(uint32_t abcd[4], uint32_t e, const uint32_t wk[4],
+                        SHA1Func f);
+void sha256_rounds4_accel(uint32_t abcd[4], uint32_t efgh[4],
+                          const uint32_t wk[4]);
+void sha256_msg1_accel(uint32_t w[4], const uint32_t w4[4]);
+void sha256_msg2_accel(uint32_t w[4], const uint32_t w12[4]);
+
+/**
+ * sha1_rounds4:
+ *
+ * Perform four SHA-1 rounds with logical function @f on the state @abcd
+ * and @e.  @wk holds the message words with the round constant already
+ * added.  Only A-D are returned, the new E can be computed from the
+ * old A.
+ */
+static inline void sha1_rounds4(uint32_t abcd[4], uint32_t e,
+                                const uint32_t wk[4], SHA1Func f)
+{
+    if (HAVE_SHA_ACCEL) {
+        sha1_rounds4_accel(abcd, e, wk, f);
+    } else {
+        sha1_rounds4_gen(abcd, e, wk, f);
+    }
+}
+
+/**
+ * sha256_rounds4:
+ *
+ * Perform four SHA-256 rounds on the state @abcd and @efgh, with the
+ * message words plus round constants in @wk.
+ */
+static inline void sha256_rounds4(uint32_t abcd[4], uint32_t efgh[4],
+                                  const uint32_t wk[4])
+{
+    if (HAVE_SHA_ACCEL) {
+        sha256_rounds4_accel(abcd, efgh, wk);
+    } else {
+        sha256_rounds4_gen(abcd, efgh, wk);
+    }
+}
+
+/**
+ * sha256_msg1:
+ *
+ * First half of the SHA-256 message schedule: add sigma0 of the next
+ * word to each of W[t..t+3] in @w, where W[t+4] is @w4[0].
+ */
+static inline void sha256_msg1(uint32_t w[4], const uint32_t w4[4])
+{
+    if (HAVE_SHA_ACCEL) {
+        sha256_msg1_accel(w, w4);
+    } else {
+        sha256_msg1_gen(w, w4);
+    }
+}
+
+/**
+ * sha256_msg2:
+ *
+ * Second half of the SHA-256 message schedule: add sigma1 of W[t-2] to
+ * each of W[t..t+3] in @w, where W[t-4..t-1] is @w12.  @w must already
+ * include W[t-16], sigma0(W[t-15]) and W[t-7].
+ */
+static inline void sha256_msg2(uint32_t w[4], const uint32_t w12[4])
+{
+    if (HAVE_SHA_ACCEL) {
+        sha256_msg2_accel(w, w12);
+    } else {
+        sha256_msg2_gen(w, w12);
+    }
+}
+
+#endif /* CRYPTO_SHA_ROUND_H */
@@ -304,6 +304,73 @@ qcrypto_tls_session_get_handshake_status(QCryptoTLSSession *sess);
 int qcrypto_tls_session_get_key_size(QCryptoTLSSession *sess,
                                      Error **errp);
 
+typedef enum {
+    QCRYPTO_TLS_KTLS_TX = (1 << 0),
+    QCRYPTO_TLS_KTLS_RX = (1 << 1),
+} QCryptoTLSSessionKTLS;
+
+/**
+ * qcrypto_tls_session_enable_ktls:
+ * @sess: the TLS session object
+ * @fd: the TCP socket carrying the session
+ * @errp: pointer to a NULL-initialized error object
+ *
+ * If the credentials of @sess have the 'ktls' property
+ * set, hand the record layer of the established session
+ * over to the kernel, so that data can be sent and
+ * received in the clear on @fd. This must be called
+ * after the handshake has completed and before any
+ * data is exchanged.
+ *
+ * Transmission is offloaded for TLS 1.2 and 1.3; reception
+ * only for TLS 1.2, since TLS 1.3 post-handshake messages
+ * must still be processed by GNUTLS. After a successful
+ * call, qcrypto_tls_session_write() must not be used
+ * anymore: data is written to @fd directly, after calling
+ * qcrypto_tls_session_ktls_key_update(). If reception was
+ * offloaded, qcrypto_tls_session_ktls_readv() replaces
+ * qcrypto_tls_session_read().
+ *
+ * Returns: a mask of QCryptoTLSSessionKTLS values for the
+ * offloaded directions, 0 if kernel TLS was not requested,
+ * or -1 if it is not supported for this session, in which
+ * case @fd can still be used through the session
+ */
+int qcrypto_tls_session_enable_ktls(QCryptoTLSSession *sess,
+                                    int fd,
+                                    Error **errp);
+
+/**
+ * qcrypto_tls_session_ktls_key_update:
+ * @sess: the TLS session object
+ *
+ * If the peer of a TLS 1.3 session whose transmission is
+ * offloaded to the kernel asked for a key update, send it
+ * through the kernel and install the new key. This must be
+ * called before writing data to the socket.
+ *
+ * Returns: 0 on success, or -1 with errno set on error,
+ * EAGAIN meaning that the socket can't be written to yet
+ */
+int qcrypto_tls_session_ktls_key_update(QCryptoTLSSession *sess);
+
+/**
+ * qcrypto_tls_session_ktls_readv:
+ * @sess: the TLS session object
+ * @iov: the array of memory regions to read into
+ * @niov: the length of @iov
+ *
+ * Read data from the socket of a session whose reception is
+ * offloaded to the kernel. A close_notify alert from the
+ * peer is reported as end of file, other alerts as errors.
+ *
+ * Returns: the number of bytes read, 0 at end of file,
+ * or -1 with errno set on error
+ */
+ssize_t qcrypto_tls_session_ktls_readv(QCryptoTLSSession *sess,
+                                       const struct iovec *iov,
+                                       size_t niov);
+
 /**
  * qcrypto_tls_session_get_peer_name:
  * @sess: the TLS session object
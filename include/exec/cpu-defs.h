@@ -214,6 +214,21 @@ typedef struct CPUTLBDescFast {
     CPUTLBEntry *table;
 } CPUTLBDescFast QEMU_ALIGNED(2 * sizeof(void *));
 
+/*
+ * A page or range flush requested by another cpu, waiting to be
+ * performed by the owner of the tlb.  A single page is described
+ * by @len == TARGET_PAGE_SIZE and @bits == TARGET_LONG_BITS.
+ */
+typedef struct CPUTLBPendingFlush {
+    target_ulong addr;
+    target_ulong len;
+    uint16_t idxmap;
+    uint16_t bits;
+} CPUTLBPendingFlush;
+
+/* Number of page/range flushes that may be batched before a full flush. */
+#define CPU_TLB_PENDING_FLUSHES 16
+
 /*
  * Data elements that are shared between all MMU modes.
  */
@@ -226,6 +241,17 @@ typedef struct CPUTLBCommon {
      * Protected by tlb_c.lock.
      */
     uint16_t dirty;
+    /*
+     * Flushes queued by other cpus and not yet performed: a set of
+     * mmu_idx to be flushed entirely, plus up to CPU_TLB_PENDING_FLUSHES
+     * page or range flushes.  They are all drained by a single work item,
+     * queued when pending_queued goes from false to true.
+     * Protected by tlb_c.lock.
+     */
+    bool pending_queued;
+    uint16_t pending_full;
+    uint16_t n_pending;
+    CPUTLBPendingFlush pending[CPU_TLB_PENDING_FLUSHES];
     /*
      * Statistics.  These are not lock protected, but are read and
      * written atomically.  This allows the monitor to print a snapshot
@@ -234,6 +260,7 @@ typedef struct CPUTLBCommon {
     size_t full_flush_count;
     size_t part_flush_count;
     size_t elide_flush_count;
+    size_t batch_flush_count;
 } CPUTLBCommon;
 
 /*
@@ -239,7 +239,9 @@ static inline bool cpu_physical_memory_is_clean(ram_addr_t addr)
     bool code = cpu_physical_memory_get_dirty_flag(addr, DIRTY_MEMORY_CODE);
     bool migration =
         cpu_physical_memory_get_dirty_flag(addr, DIRTY_MEMORY_MIGRATION);
-    return !(vga && code && migration);
+    bool dirty_limit = !(global_dirty_tracking & GLOBAL_DIRTY_LIMIT) ||
+        cpu_physical_memory_get_dirty_flag(addr, DIRTY_MEMORY_DIRTY_LIMIT);
+    return !(vga && code && migration && dirty_limit);
 }
 
 static inline uint8_t cpu_physical_memory_range_includes_clean(ram_addr_t start,
@@ -321,6 +323,11 @@ static inline void cpu_physical_memory_set_dirty_range(ram_addr_t start,
                 bitmap_set_atomic(blocks[DIRTY_MEMORY_CODE]->blocks[idx],
                                   offset, next - page);
             }
+            if (unlikely(mask & (1 << DIRTY_MEMORY_DIRTY_LIMIT))) {
+                bitmap_set_atomic(
+                    blocks[DIRTY_MEMORY_DIRTY_LIMIT]->blocks[idx],
+                    offset, next - page);
+            }
 
             page = next;
             idx++;
@@ -430,6 +437,8 @@ bool cpu_physical_memory_test_and_clear_dirty(ram_addr_t start,
                                               ram_addr_t length,
                                               unsigned client);
 
+void cpu_physical_memory_rearm_dirty_limit(void);
+
 DirtyBitmapSnapshot *cpu_physical_memory_snapshot_and_clear_dirty
     (MemoryRegion *mr, hwaddr offset, hwaddr length, unsigned client);
 
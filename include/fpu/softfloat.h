@@ -598,6 +598,21 @@ float32 float32_minnummag(float32, float32, float_status *status);
 float32 float32_maxnummag(float32, float32, float_status *status);
 float32 float32_minimum_number(float32, float32, float_status *status);
 float32 float32_maximum_number(float32, float32, float_status *status);
+
+/*----------------------------------------------------------------------------
+| Lane-batched single-precision operations.  Each computes d[i] = a[i] op b[i]
+| for 0 <= i < n with exactly the results and exception flags of calling the
+| scalar operation once per lane, in ascending lane order.  @d may alias
+| @a or @b.
+*----------------------------------------------------------------------------*/
+void float32_add_vec(float32 *d, const float32 *a, const float32 *b,
+                     size_t n, float_status *status);
+void float32_sub_vec(float32 *d, const float32 *a, const float32 *b,
+                     size_t n, float_status *status);
+void float32_mul_vec(float32 *d, const float32 *a, const float32 *b,
+                     size_t n, float_status *status);
+void float32_div_vec(float32 *d, const float32 *a, const float32 *b,
+                     size_t n, float_status *status);
 bool float32_is_quiet_nan(float32, float_status *status);
 bool float32_is_signaling_nan(float32, float_status *status);
 float32 float32_silence_nan(float32, float_status *status);
@@ -789,6 +804,18 @@ float64 float64_minnummag(float64, float64, float_status *status);
 float64 float64_maxnummag(float64, float64, float_status *status);
 float64 float64_minimum_number(float64, float64, float_status *status);
 float64 float64_maximum_number(float64, float64, float_status *status);
+
+/*----------------------------------------------------------------------------
+| Lane-batched double-precision operations; see float32_add_vec().
+*----------------------------------------------------------------------------*/
+void float64_add_vec(float64 *d, const float64 *a, const float64 *b,
+                     size_t n, float_status *status);
+void float64_sub_vec(float64 *d, const float64 *a, const float64 *b,
+                     size_t n, float_status *status);
+void float64_mul_vec(float64 *d, const float64 *a, const float64 *b,
+                     size_t n, float_status *status);
+void float64_div_vec(float64 *d, const float64 *a, const float64 *b,
+                     size_t n, float_status *status);
 bool float64_is_quiet_nan(float64 a, float_status *status);
 bool float64_is_signaling_nan(float64, float_status *status);
 float64 float64_silence_nan(float64, float_status *status);
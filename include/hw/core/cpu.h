@@ -317,6 +317,7 @@ struct qemu_work_item;
  *    ring is enabled.
  * @kvm_fetch_index: Keeps the index that we last fetched from the per-vCPU
  *    dirty ring structure.
+ * @tcg_halt_poll: Halt polling state and statistics of an MTTCG vCPU.
  *
  * State of one CPU core or thread.
  */
@@ -338,6 +339,7 @@ struct CPUState {
     int thread_id;
     bool running, has_waiter;
     struct QemuCond *halt_cond;
+    struct MttcgHaltPoll *tcg_halt_poll;
     bool thread_kicked;
     bool created;
     bool stop;
@@ -801,6 +803,17 @@ CPUState *cpu_by_arch_id(int64_t id);
 
 void cpu_interrupt(CPUState *cpu, int mask);
 
+/**
+ * cpu_interrupt_lockless:
+ * @cpu: The CPU to set an interrupt on.
+ * @mask: The interrupts to set.
+ *
+ * Like cpu_interrupt(), but may be called without the BQL.  Only
+ * available with TCG, whose interrupt handler sets the request bits
+ * atomically.
+ */
+void cpu_interrupt_lockless(CPUState *cpu, int mask);
+
 /**
  * cpu_set_pc:
  * @cpu: The CPU to set the program counter for.
@@ -186,6 +186,7 @@ struct APICCommonState {
     uint32_t vapic_control;
     DeviceState *vapic;
     hwaddr vapic_paddr; /* note: persistence via kvmvapic */
+    bool vapic_enabled; /* vapic_paddr != 0, for readers without the BQL */
     bool legacy_instance_id;
 };
 
@@ -16,6 +16,7 @@
 #include "hw/pci-host/remote.h"
 #include "io/channel.h"
 #include "hw/remote/iohub.h"
+#include "hw/remote/mpqemu-ring.h"
 
 struct RemoteMachineState {
     MachineState parent_obj;
@@ -32,6 +33,8 @@ struct RemoteMachineState {
 typedef struct RemoteCommDev {
     PCIDevice *dev;
     QIOChannel *ioc;
+    /* Ring for BAR accesses, if the proxy set one up */
+    MPQemuRingDev *ring;
 } RemoteCommDev;
 
 #define TYPE_REMOTE_MACHINE "x-remote-machine"
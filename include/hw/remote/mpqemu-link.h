@@ -41,6 +41,7 @@ typedef enum {
     MPQEMU_CMD_BAR_READ,
     MPQEMU_CMD_SET_IRQFD,
     MPQEMU_CMD_DEVICE_RESET,
+    MPQEMU_CMD_SET_RING,
     MPQEMU_CMD_MAX,
 } MPQemuCmd;
 
@@ -0,0 +1,80 @@
+/*
+ * Shared memory ring between QEMU and remote device process
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ *
+ */
+
+#ifndef MPQEMU_RING_H
+#define MPQEMU_RING_H
+
+#include "exec/hwaddr.h"
+#include "qemu/event_notifier.h"
+
+/*
+ * BAR accesses can bypass the socket and go through a ring of requests in
+ * memory shared by the proxy and the remote process.  The proxy produces
+ * requests and the remote process completes them in order, writing the
+ * result of reads back into the request.  Each side only notifies the
+ * other through an eventfd if it has announced that it is about to sleep.
+ *
+ * Posted requests (MMIO writes) do not wait for their completion; since
+ * requests complete in order, a later read still observes their effects.
+ */
+
+#define MPQEMU_RING_SIZE 64
+
+typedef struct {
+    uint64_t addr;
+    uint64_t val;
+    uint32_t size;
+    uint8_t write;
+    uint8_t memory;
+} MPQemuRingEntry;
+
+typedef struct {
+    /* Written by the proxy */
+    uint32_t prod QEMU_ALIGNED(64);
+    uint32_t proxy_waiting;
+
+    /* Written by the remote process */
+    uint32_t cons QEMU_ALIGNED(64);
+    uint32_t remote_idle;
+
+    MPQemuRingEntry entries[MPQEMU_RING_SIZE] QEMU_ALIGNED(64);
+} MPQemuRing;
+
+/**
+ * MPQemuRingDev:
+ * @ring: The shared ring
+ * @fd: memfd backing @ring
+ * @req: Notifies the remote process of new requests
+ * @resp: Notifies the proxy of completed requests
+ * @hup_fd: Socket to the remote process, watched while waiting so that
+ *          the proxy notices if the remote process goes away
+ * @poll_ns: How long the proxy polls for a completion before sleeping
+ */
+typedef struct MPQemuRingDev {
+    MPQemuRing *ring;
+    int fd;
+    EventNotifier req;
+    EventNotifier resp;
+    int hup_fd;
+    uint32_t poll_ns;
+} MPQemuRingDev;
+
+/* Proxy side */
+bool mpqemu_ring_init(MPQemuRingDev *r, int hup_fd, Error **errp);
+void mpqemu_ring_cleanup(MPQemuRingDev *r);
+bool mpqemu_ring_flush(MPQemuRingDev *r, Error **errp);
+uint64_t mpqemu_ring_bar_access(MPQemuRingDev *r, hwaddr addr, uint64_t val,
+                                unsigned size, bool memory, bool write,
+                                bool posted, Error **errp);
+
+/* Remote side */
+MPQemuRingDev *mpqemu_ring_attach(int fd, int req_fd, int resp_fd,
+                                  Error **errp);
+void mpqemu_ring_detach(MPQemuRingDev *r);
+
+#endif
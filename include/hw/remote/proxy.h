@@ -12,6 +12,7 @@
 #include "hw/pci/pci_device.h"
 #include "io/channel.h"
 #include "hw/remote/proxy-memory-listener.h"
+#include "hw/remote/mpqemu-ring.h"
 #include "qemu/event_notifier.h"
 
 #define TYPE_PCI_PROXY_DEV "x-pci-proxy-dev"
@@ -43,6 +44,14 @@ struct PCIProxyDev {
     EventNotifier intr;
     EventNotifier resample;
     ProxyMemoryRegion region[PCI_NUM_REGIONS];
+
+    /*
+     * Optional shared memory ring for BAR accesses, also protected
+     * by io_mutex.
+     */
+    bool shm_ring;
+    bool posted_writes;
+    MPQemuRingDev ring;
 };
 
 #endif /* PROXY_H */
@@ -39,6 +39,7 @@ OBJECT_DECLARE_SIMPLE_TYPE(VirtIOCrypto, VIRTIO_CRYPTO)
 
 typedef struct VirtIOCryptoConf {
     CryptoDevBackend *cryptodev;
+    IOThread *iothread;
 
     /* Supported service mask */
     uint32_t crypto_services;
@@ -73,6 +74,9 @@ typedef struct VirtIOCryptoReq {
     VirtQueue *vq;
     struct VirtIOCrypto *vcrypto;
     CryptoDevBackendOpInfo op_info;
+    /* Context that the request was popped in, and must be completed in */
+    AioContext *ctx;
+    int ret;
 } VirtIOCryptoReq;
 
 typedef struct VirtIOCryptoQueue {
@@ -96,6 +100,12 @@ struct VirtIOCrypto {
     uint32_t curr_queues;
     size_t config_size;
     uint8_t vhost_started;
+
+    /* IOThread context that the virtqueues run in, if any */
+    AioContext *ctx;
+    bool dataplane_started;
+    /* Data queue requests popped but not yet completed */
+    unsigned int inflight;
 };
 
 #endif /* QEMU_VIRTIO_CRYPTO_H */
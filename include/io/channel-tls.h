@@ -41,6 +41,11 @@ OBJECT_DECLARE_SIMPLE_TYPE(QIOChannelTLS, QIO_CHANNEL_TLS)
  *
  * This channel object is capable of running as either a
  * TLS server or TLS client.
+ *
+ * If the credentials request it and the master channel is
+ * a socket, encryption is handed over to the kernel once the
+ * handshake completes, and I/O in the offloaded directions
+ * goes straight to the master channel.
  */
 
 struct QIOChannelTLS {
@@ -48,6 +53,8 @@ struct QIOChannelTLS {
     QIOChannel *master;
     QCryptoTLSSession *session;
     QIOChannelShutdown shutdown;
+    /* Mask of QCryptoTLSSessionKTLS directions handled by the kernel */
+    int ktls;
 };
 
 /**
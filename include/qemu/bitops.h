@@ -173,6 +173,11 @@ unsigned long find_next_zero_bit(const unsigned long *addr,
                                  unsigned long size,
                                  unsigned long offset);
 
+/* Select the next accelerated implementation of the bitmap search and
+ * population count functions, for testing; returns false if there is none.
+ */
+bool test_bitops_next_accel(void);
+
 /**
  * find_first_bit - find the first set bit in a memory region
  * @addr: The address to start the search at
@@ -380,6 +380,23 @@ void timerlistgroup_deinit(QEMUTimerListGroup *tlg);
  */
 bool timerlistgroup_run_timers(QEMUTimerListGroup *tlg);
 
+#define QEMU_TIMER_LATENESS_BUCKETS 32
+
+/**
+ * timerlistgroup_get_stats:
+ * @tlg: the timer list group
+ * @timers_run: set to the number of timers that have run
+ * @lateness: array of QEMU_TIMER_LATENESS_BUCKETS elements
+ *
+ * Retrieve how many timers of the timer list group have run, and a
+ * log2 histogram of how late they ran compared to their expiry time,
+ * in nanoseconds of their clock.  Bucket 0 counts the timers that ran
+ * on time, bucket i > 0 those that ran between 2^(i-1) and 2^i - 1
+ * nanoseconds late; the last bucket also counts any later ones.
+ */
+void timerlistgroup_get_stats(QEMUTimerListGroup *tlg, uint64_t *timers_run,
+                              uint64_t *lateness);
+
 /**
  * timerlistgroup_deadline_ns:
  * @tlg: the timer list group
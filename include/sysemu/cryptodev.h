@@ -363,6 +363,12 @@ int cryptodev_backend_close_session(
  * Do crypto operation, such as encryption and
  * decryption
  *
+ * The operation may complete asynchronously.  @cb is then called either
+ * in the AioContext of the caller, or in the main loop for backends that
+ * do the work in their own threads; callers that run in an IOThread must
+ * be prepared for the latter.  The operation data must stay valid until
+ * @cb is called.
+ *
  * Returns: 0 for success and cb will be called when creation is completed,
  * negative value for error, and cb will not be called.
  */
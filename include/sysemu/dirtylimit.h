@@ -34,4 +34,5 @@ void dirtylimit_set_vcpu(int cpu_index,
 void dirtylimit_set_all(uint64_t quota,
                         bool enable);
 void dirtylimit_vcpu_execute(CPUState *cpu);
+void dirtylimit_tcg_page_dirtied(CPUState *cpu);
 #endif
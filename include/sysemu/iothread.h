@@ -49,6 +49,9 @@ IOThread *iothread_by_id(const char *id);
 AioContext *iothread_get_aio_context(IOThread *iothread);
 GMainContext *iothread_get_g_main_context(IOThread *iothread);
 
+/* Register the "iothread" provider of query-stats */
+void iothread_register_stats(void);
+
 /*
  * Helpers used to allocate iothreads for internal use.  These
  * iothreads will not be seen by monitor clients when query using
@@ -1032,6 +1032,29 @@ bool tcg_op_supported(TCGOpcode op);
 
 void tcg_gen_callN(void *func, TCGTemp *ret, int nargs, TCGTemp **args);
 
+/**
+ * TCGHelperInlineFn:
+ * @ret: the output temp of the call, or NULL for a void helper
+ * @args: the input temps of the call, in helper argument order
+ *
+ * Emit TCG ops computing exactly what the helper would, in place of
+ * the call.  Return false, having emitted nothing, if the expansion
+ * is not profitable for these arguments or this host, in which case
+ * the call is emitted as usual.
+ */
+typedef bool (*TCGHelperInlineFn)(TCGTemp *ret, TCGTemp **args);
+
+/**
+ * tcg_register_helper_inline:
+ * @func: the helper function, i.e. HELPER(name)
+ * @gen: the inline expansion
+ *
+ * Make tcg_gen_callN() try @gen before emitting a call to @func.
+ * Only helpers that do not access env through globals, and so whose
+ * semantics are fully described by their arguments, may be inlined.
+ */
+void tcg_register_helper_inline(void *func, TCGHelperInlineFn gen);
+
 TCGOp *tcg_emit_op(TCGOpcode opc, unsigned nargs);
 void tcg_op_remove(TCGContext *s, TCGOp *op);
 TCGOp *tcg_op_insert_before(TCGContext *s, TCGOp *op,
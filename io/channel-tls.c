@@ -22,6 +22,7 @@
 #include "qapi/error.h"
 #include "qemu/module.h"
 #include "io/channel-tls.h"
+#include "io/channel-socket.h"
 #include "trace.h"
 #include "qemu/atomic.h"
 
@@ -152,6 +153,30 @@ static gboolean qio_channel_tls_handshake_io(QIOChannel *ioc,
                                              GIOCondition condition,
                                              gpointer user_data);
 
+static void qio_channel_tls_enable_ktls(QIOChannelTLS *ioc)
+{
+    Error *err = NULL;
+    int ret;
+
+    if (!object_dynamic_cast(OBJECT(ioc->master), TYPE_QIO_CHANNEL_SOCKET)) {
+        return;
+    }
+
+    ret = qcrypto_tls_session_enable_ktls(ioc->session,
+                                          QIO_CHANNEL_SOCKET(ioc->master)->fd,
+                                          &err);
+    if (ret < 0) {
+        trace_qio_channel_tls_ktls_fallback(ioc, error_get_pretty(err));
+        error_free(err);
+        return;
+    }
+
+    ioc->ktls = ret;
+    if (ret) {
+        trace_qio_channel_tls_ktls_enabled(ioc, ret);
+    }
+}
+
 static void qio_channel_tls_handshake_task(QIOChannelTLS *ioc,
                                            QIOTask *task,
                                            GMainContext *context)
@@ -175,6 +200,7 @@ static void qio_channel_tls_handshake_task(QIOChannelTLS *ioc,
             qio_task_set_error(task, err);
         } else {
             trace_qio_channel_tls_credentials_allow(ioc);
+            qio_channel_tls_enable_ktls(ioc);
         }
         qio_task_complete(task);
     } else {
@@ -267,6 +293,19 @@ static ssize_t qio_channel_tls_readv(QIOChannel *ioc,
     size_t i;
     ssize_t got = 0;
 
+    if (tioc->ktls & QCRYPTO_TLS_KTLS_RX) {
+        got = qcrypto_tls_session_ktls_readv(tioc->session, iov, niov);
+        if (got < 0) {
+            if (errno == EAGAIN) {
+                return QIO_CHANNEL_ERR_BLOCK;
+            }
+            error_setg_errno(errp, errno,
+                             "Cannot read from TLS channel");
+            return -1;
+        }
+        return got;
+    }
+
     for (i = 0 ; i < niov ; i++) {
         ssize_t ret = qcrypto_tls_session_read(tioc->session,
                                                iov[i].iov_base,
@@ -309,6 +348,19 @@ static ssize_t qio_channel_tls_writev(QIOChannel *ioc,
     size_t i;
     ssize_t done = 0;
 
+    if (tioc->ktls & QCRYPTO_TLS_KTLS_TX) {
+        if (qcrypto_tls_session_ktls_key_update(tioc->session) < 0) {
+            if (errno == EAGAIN) {
+                return QIO_CHANNEL_ERR_BLOCK;
+            }
+            error_setg_errno(errp, errno,
+                             "Cannot write to TLS channel");
+            return -1;
+        }
+        return qio_channel_writev_full(tioc->master, iov, niov,
+                                       NULL, 0, flags, errp);
+    }
+
     for (i = 0 ; i < niov ; i++) {
         ssize_t ret = qcrypto_tls_session_write(tioc->session,
                                                 iov[i].iov_base,
@@ -219,6 +219,7 @@ void help(void)
            "  '-f' first image format\n"
            "  '-F' second image format\n"
            "  '-s' run in Strict mode - fail on different image size or sector allocation\n"
+           "  '-m' specifies how many coroutines compare data in parallel (defaults to 8)\n"
            "\n"
            "Parameters to dd subcommand:\n"
            "  'bs=BYTES' read and write up to BYTES bytes at a time "
@@ -668,6 +669,12 @@ static void dump_human_image_check(ImageCheck *check, bool quiet)
     }
 }
 
+static void check_status_cb(BlockDriverState *bs, int64_t done,
+                            int64_t total, void *opaque)
+{
+    qemu_progress_print(100.f * done / total, 0);
+}
+
 static int collect_image_check(BlockDriverState *bs,
                    ImageCheck *check,
                    const char *filename,
@@ -677,7 +684,9 @@ static int collect_image_check(BlockDriverState *bs,
     int ret;
     BdrvCheckResult result;
 
-    ret = bdrv_check(bs, &result, fix);
+    qemu_progress_print(0.f, 0);
+    ret = bdrv_check(bs, &result, fix, check_status_cb, NULL);
+    qemu_progress_print(100.f, 0);
     if (ret < 0) {
         return ret;
     }
@@ -728,6 +737,7 @@ static int img_check(int argc, char **argv)
     bool writethrough;
     ImageCheck *check;
     bool quiet = false;
+    bool progress = false;
     bool image_opts = false;
     bool force_share = false;
 
@@ -747,7 +757,7 @@ static int img_check(int argc, char **argv)
             {"force-share", no_argument, 0, 'U'},
             {0, 0, 0, 0}
         };
-        c = getopt_long(argc, argv, ":hf:r:T:qU",
+        c = getopt_long(argc, argv, ":hf:r:T:pqU",
                         long_options, &option_index);
         if (c == -1) {
             break;
@@ -783,6 +793,9 @@ static int img_check(int argc, char **argv)
         case 'T':
             cache = optarg;
             break;
+        case 'p':
+            progress = true;
+            break;
         case 'q':
             quiet = true;
             break;
@@ -817,6 +830,12 @@ static int img_check(int argc, char **argv)
         return 1;
     }
 
+    /* The progress is printed to stdout, where it would corrupt the JSON */
+    if (quiet || output_format == OFORMAT_JSON) {
+        progress = false;
+    }
+    qemu_progress_init(progress, 1.f);
+
     blk = img_open(image_opts, filename, fmt, flags, writethrough, quiet,
                    force_share);
     if (!blk) {
@@ -827,12 +846,6 @@ static int img_check(int argc, char **argv)
     check = g_new0(ImageCheck, 1);
     ret = collect_image_check(bs, check, filename, fmt, fix);
 
-    if (ret == -ENOTSUP) {
-        error_report("This image format does not support checks");
-        ret = 63;
-        goto fail;
-    }
-
     if (check->corruptions_fixed || check->leaks_fixed) {
         int corruptions_fixed, leaks_fixed;
         bool has_leaks_fixed, has_corruptions_fixed;
@@ -861,6 +874,13 @@ static int img_check(int argc, char **argv)
         check->corruptions_fixed    = corruptions_fixed;
         check->has_corruptions_fixed = has_corruptions_fixed;
     }
+    qemu_progress_end();
+
+    if (ret == -ENOTSUP) {
+        error_report("This image format does not support checks");
+        ret = 63;
+        goto fail;
+    }
 
     if (!ret) {
         switch (output_format) {
@@ -1280,6 +1300,8 @@ static int is_allocated_sectors_min(const uint8_t *buf, int n, int *pnum,
  * pnum is set to the sector-aligned size of the buffer prefix that
  * has the same matching status as the first sector.
  */
+#define COMPARE_BLOCK_SIZE (64 * KiB)
+
 static int compare_buffers(const uint8_t *buf1, const uint8_t *buf2,
                            int64_t bytes, int64_t *pnum)
 {
@@ -1289,6 +1311,20 @@ static int compare_buffers(const uint8_t *buf1, const uint8_t *buf2,
     assert(bytes > 0);
 
     res = !!memcmp(buf1, buf2, i);
+    if (!res) {
+        /*
+         * Skip over identical data in large blocks first; memcmp() is much
+         * faster on those than on individual sectors.
+         */
+        while (i < bytes) {
+            int64_t len = MIN(bytes - i, COMPARE_BLOCK_SIZE);
+
+            if (memcmp(buf1 + i, buf2 + i, len)) {
+                break;
+            }
+            i += len;
+        }
+    }
     while (i < bytes) {
         int64_t len = MIN(bytes - i, BDRV_SECTOR_SIZE);
 
@@ -1303,39 +1339,128 @@ static int compare_buffers(const uint8_t *buf1, const uint8_t *buf2,
 }
 
 #define IO_BUF_SIZE (2 * MiB)
+#define MAX_COROUTINES 16
+
+typedef struct ImgCompareState {
+    BlockBackend *blk[2];
+    const char *filename[2];
+    int64_t size[2];
+    int64_t total_size;         /* size of the smaller image */
+    int64_t progress_base;      /* size of the larger image */
+    bool strict;
+    bool quiet;
+    long num_coroutines;
+    int running_coroutines;
+
+    CoMutex lock;
+    int64_t offset;             /* start of the next chunk to compare */
+
+    /*
+     * Failure with the lowest offset so far.  Chunks are handed out in
+     * order and no new chunk is started after a failure, so once all
+     * coroutines have finished this is the failure that comparing the
+     * images sequentially would have stopped at.
+     */
+    int ret;
+    int64_t fail_offset;
+    char *fail_msg;
+} ImgCompareState;
+
+typedef enum ImgCompareOp {
+    COMPARE_SKIP,               /* zero or unallocated in both images */
+    COMPARE_DATA,               /* allocated in both images */
+    COMPARE_EMPTY,              /* allocated in image @index only */
+} ImgCompareOp;
+
+typedef struct ImgCompareChunk {
+    int64_t offset;
+    int64_t bytes;
+    ImgCompareOp op;
+    int index;
+} ImgCompareChunk;
+
+/*
+ * Records a failure at @offset with exit status @ret.  The message is printed
+ * with qprintf() if @ret is 1 (images differ), or with error_report().
+ */
+static void G_GNUC_PRINTF(4, 5)
+compare_fail(ImgCompareState *s, int64_t offset, int ret, const char *fmt, ...)
+{
+    va_list ap;
+
+    if (s->ret && s->fail_offset <= offset) {
+        return;
+    }
+
+    g_free(s->fail_msg);
+    va_start(ap, fmt);
+    s->fail_msg = g_strdup_vprintf(fmt, ap);
+    va_end(ap);
+    s->ret = ret;
+    s->fail_offset = offset;
+}
 
 /*
  * Check if passed sectors are empty (not allocated or contain only 0 bytes)
  *
  * Intended for use by 'qemu-img compare': Returns 0 in case sectors are
  * filled with 0, 1 if sectors contain non-zero data (this is a comparison
- * failure), and 4 on error (the exit status for read errors), after emitting
- * an error message.
+ * failure), and 4 on error (the exit status for read errors), after recording
+ * the failure with compare_fail().
  *
- * @param blk:  BlockBackend for the image
+ * @param s: State of the compare process
+ * @param index: Index of the image to check
  * @param offset: Starting offset to check
  * @param bytes: Number of bytes to check
- * @param filename: Name of disk file we are checking (logging purpose)
  * @param buffer: Allocated buffer for storing read data
- * @param quiet: Flag for quiet mode
  */
-static int check_empty_sectors(BlockBackend *blk, int64_t offset,
-                               int64_t bytes, const char *filename,
-                               uint8_t *buffer, bool quiet)
+static int coroutine_fn check_empty_sectors(ImgCompareState *s, int index,
+                                            int64_t offset, int64_t bytes,
+                                            uint8_t *buffer)
 {
     int ret = 0;
     int64_t idx;
 
-    ret = blk_pread(blk, offset, bytes, buffer, 0);
+    ret = blk_co_pread(s->blk[index], offset, bytes, buffer, 0);
     if (ret < 0) {
-        error_report("Error while reading offset %" PRId64 " of %s: %s",
-                     offset, filename, strerror(-ret));
+        compare_fail(s, offset, 4, "Error while reading offset %" PRId64
+                     " of %s: %s", offset, s->filename[index], strerror(-ret));
         return 4;
     }
     idx = find_nonzero(buffer, bytes);
     if (idx >= 0) {
-        qprintf(quiet, "Content mismatch at offset %" PRId64 "!\n",
-                offset + idx);
+        compare_fail(s, offset + idx, 1, "Content mismatch at offset %" PRId64
+                     "!\n", offset + idx);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int coroutine_fn compare_data(ImgCompareState *s, int64_t offset,
+                                     int64_t bytes, uint8_t *buf1,
+                                     uint8_t *buf2)
+{
+    int64_t pnum;
+    int ret;
+
+    ret = blk_co_pread(s->blk[0], offset, bytes, buf1, 0);
+    if (ret < 0) {
+        compare_fail(s, offset, 4, "Error while reading offset %" PRId64
+                     " of %s: %s", offset, s->filename[0], strerror(-ret));
+        return 4;
+    }
+    ret = blk_co_pread(s->blk[1], offset, bytes, buf2, 0);
+    if (ret < 0) {
+        compare_fail(s, offset, 4, "Error while reading offset %" PRId64
+                     " of %s: %s", offset, s->filename[1], strerror(-ret));
+        return 4;
+    }
+    ret = compare_buffers(buf1, buf2, bytes, &pnum);
+    if (ret || pnum != bytes) {
+        offset += ret ? 0 : pnum;
+        compare_fail(s, offset, 1, "Content mismatch at offset %" PRId64 "!\n",
+                     offset);
         return 1;
     }
 
@@ -1343,32 +1468,151 @@ static int check_empty_sectors(BlockBackend *blk, int64_t offset,
 }
 
 /*
- * Compares two images. Exit codes:
- *
- * 0 - Images are identical or the requested help was printed
- * 1 - Images differ
- * >1 - Error occurred
+ * Determines the next chunk that needs to be read, skipping over areas that
+ * are zero or unallocated in both images.  Returns false if there is nothing
+ * left to read or comparing must stop.  Called with s->lock held.
  */
+static bool coroutine_fn compare_next_chunk(ImgCompareState *s,
+                                            ImgCompareChunk *chunk)
+{
+    while (!s->ret && s->offset < s->progress_base) {
+        int64_t offset = s->offset;
+        int64_t pnum1, pnum2, bytes;
+        int status1, status2;
+        ImgCompareOp op;
+        int index = 0;
+
+        if (offset < s->total_size) {
+            status1 = bdrv_block_status_above(blk_bs(s->blk[0]), NULL, offset,
+                                              s->size[0] - offset, &pnum1,
+                                              NULL, NULL);
+            if (status1 < 0) {
+                compare_fail(s, offset, 3,
+                             "Sector allocation test failed for %s",
+                             s->filename[0]);
+                return false;
+            }
+
+            status2 = bdrv_block_status_above(blk_bs(s->blk[1]), NULL, offset,
+                                              s->size[1] - offset, &pnum2,
+                                              NULL, NULL);
+            if (status2 < 0) {
+                compare_fail(s, offset, 3,
+                             "Sector allocation test failed for %s",
+                             s->filename[1]);
+                return false;
+            }
+
+            assert(pnum1 && pnum2);
+            bytes = MIN(pnum1, pnum2);
+
+            if (s->strict && status1 != status2) {
+                compare_fail(s, offset, 1, "Strict mode: Offset %" PRId64
+                             " block status mismatch!\n", offset);
+                return false;
+            }
+
+            if ((status1 & BDRV_BLOCK_ZERO) && (status2 & BDRV_BLOCK_ZERO)) {
+                op = COMPARE_SKIP;
+            } else if ((status1 & BDRV_BLOCK_ALLOCATED) ==
+                       (status2 & BDRV_BLOCK_ALLOCATED)) {
+                op = (status1 & BDRV_BLOCK_ALLOCATED) ? COMPARE_DATA
+                                                      : COMPARE_SKIP;
+            } else {
+                op = COMPARE_EMPTY;
+                index = (status1 & BDRV_BLOCK_ALLOCATED) ? 0 : 1;
+            }
+        } else {
+            /* Area after the end of the smaller image */
+            index = s->size[0] > s->size[1] ? 0 : 1;
+            status1 = bdrv_block_status_above(blk_bs(s->blk[index]), NULL,
+                                              offset,
+                                              s->progress_base - offset,
+                                              &bytes, NULL, NULL);
+            if (status1 < 0) {
+                compare_fail(s, offset, 3,
+                             "Sector allocation test failed for %s",
+                             s->filename[index]);
+                return false;
+            }
+
+            if (status1 & BDRV_BLOCK_ALLOCATED &&
+                !(status1 & BDRV_BLOCK_ZERO)) {
+                op = COMPARE_EMPTY;
+            } else {
+                op = COMPARE_SKIP;
+            }
+        }
+
+        if (op != COMPARE_SKIP) {
+            bytes = MIN(bytes, IO_BUF_SIZE);
+        }
+        s->offset += bytes;
+
+        if (op == COMPARE_SKIP) {
+            qemu_progress_print(((float) bytes / s->progress_base) * 100, 100);
+            continue;
+        }
+
+        *chunk = (ImgCompareChunk) {
+            .offset = offset,
+            .bytes = bytes,
+            .op = op,
+            .index = index,
+        };
+        return true;
+    }
+
+    return false;
+}
+
+static void coroutine_fn img_compare_co(void *opaque)
+{
+    ImgCompareState *s = opaque;
+    ImgCompareChunk chunk;
+    uint8_t *buf1, *buf2;
+
+    s->running_coroutines++;
+    buf1 = blk_blockalign(s->blk[0], IO_BUF_SIZE);
+    buf2 = blk_blockalign(s->blk[1], IO_BUF_SIZE);
+
+    while (1) {
+        qemu_co_mutex_lock(&s->lock);
+        if (!compare_next_chunk(s, &chunk)) {
+            qemu_co_mutex_unlock(&s->lock);
+            break;
+        }
+        qemu_co_mutex_unlock(&s->lock);
+
+        if (chunk.op == COMPARE_DATA) {
+            compare_data(s, chunk.offset, chunk.bytes, buf1, buf2);
+        } else {
+            check_empty_sectors(s, chunk.index, chunk.offset, chunk.bytes,
+                                buf1);
+        }
+        qemu_progress_print(((float) chunk.bytes / s->progress_base) * 100,
+                            100);
+    }
+
+    qemu_vfree(buf1);
+    qemu_vfree(buf2);
+    s->running_coroutines--;
+}
+
 static int img_compare(int argc, char **argv)
 {
     const char *fmt1 = NULL, *fmt2 = NULL, *cache, *filename1, *filename2;
     BlockBackend *blk1, *blk2;
-    BlockDriverState *bs1, *bs2;
     int64_t total_size1, total_size2;
-    uint8_t *buf1 = NULL, *buf2 = NULL;
-    int64_t pnum1, pnum2;
-    int allocated1, allocated2;
     int ret = 0; /* return value - 0 Ident, 1 Different, >1 Error */
     bool progress = false, quiet = false, strict = false;
     int flags;
     bool writethrough;
-    int64_t total_size;
-    int64_t offset = 0;
-    int64_t chunk;
-    int c;
-    uint64_t progress_base;
+    int c, i;
     bool image_opts = false;
     bool force_share = false;
+    long num_coroutines = 8;
+    ImgCompareState s;
 
     cache = BDRV_DEFAULT_CACHE;
     for (;;) {
@@ -1379,7 +1623,7 @@ static int img_compare(int argc, char **argv)
             {"force-share", no_argument, 0, 'U'},
             {0, 0, 0, 0}
         };
-        c = getopt_long(argc, argv, ":hf:F:T:pqsU",
+        c = getopt_long(argc, argv, ":hf:F:T:pqsUm:",
                         long_options, NULL);
         if (c == -1) {
             break;
@@ -1415,6 +1659,14 @@ static int img_compare(int argc, char **argv)
         case 'U':
             force_share = true;
             break;
+        case 'm':
+            if (qemu_strtol(optarg, NULL, 0, &num_coroutines) ||
+                num_coroutines < 1 || num_coroutines > MAX_COROUTINES) {
+                error_report("Invalid number of coroutines. Allowed number of"
+                             " coroutines is between 1 and %d", MAX_COROUTINES);
+                exit(2);
+            }
+            break;
         case OPTION_OBJECT:
             {
                 Error *local_err = NULL;
@@ -1472,11 +1724,7 @@ static int img_compare(int argc, char **argv)
         ret = 2;
         goto out2;
     }
-    bs1 = blk_bs(blk1);
-    bs2 = blk_bs(blk2);
 
-    buf1 = blk_blockalign(blk1, IO_BUF_SIZE);
-    buf2 = blk_blockalign(blk2, IO_BUF_SIZE);
     total_size1 = blk_getlength(blk1);
     if (total_size1 < 0) {
         error_report("Can't get size of %s: %s",
@@ -1491,8 +1739,6 @@ static int img_compare(int argc, char **argv)
         ret = 4;
         goto out;
     }
-    total_size = MIN(total_size1, total_size2);
-    progress_base = MAX(total_size1, total_size2);
 
     qemu_progress_print(0, 100);
 
@@ -1502,131 +1748,41 @@ static int img_compare(int argc, char **argv)
         goto out;
     }
 
-    while (offset < total_size) {
-        int status1, status2;
-
-        status1 = bdrv_block_status_above(bs1, NULL, offset,
-                                          total_size1 - offset, &pnum1, NULL,
-                                          NULL);
-        if (status1 < 0) {
-            ret = 3;
-            error_report("Sector allocation test failed for %s", filename1);
-            goto out;
-        }
-        allocated1 = status1 & BDRV_BLOCK_ALLOCATED;
-
-        status2 = bdrv_block_status_above(bs2, NULL, offset,
-                                          total_size2 - offset, &pnum2, NULL,
-                                          NULL);
-        if (status2 < 0) {
-            ret = 3;
-            error_report("Sector allocation test failed for %s", filename2);
-            goto out;
-        }
-        allocated2 = status2 & BDRV_BLOCK_ALLOCATED;
-
-        assert(pnum1 && pnum2);
-        chunk = MIN(pnum1, pnum2);
-
-        if (strict) {
-            if (status1 != status2) {
-                ret = 1;
-                qprintf(quiet, "Strict mode: Offset %" PRId64
-                        " block status mismatch!\n", offset);
-                goto out;
-            }
-        }
-        if ((status1 & BDRV_BLOCK_ZERO) && (status2 & BDRV_BLOCK_ZERO)) {
-            /* nothing to do */
-        } else if (allocated1 == allocated2) {
-            if (allocated1) {
-                int64_t pnum;
+    s = (ImgCompareState) {
+        .blk            = { blk1, blk2 },
+        .filename       = { filename1, filename2 },
+        .size           = { total_size1, total_size2 },
+        .total_size     = MIN(total_size1, total_size2),
+        .progress_base  = MAX(total_size1, total_size2),
+        .strict         = strict,
+        .quiet          = quiet,
+        .num_coroutines = num_coroutines,
+    };
+    qemu_co_mutex_init(&s.lock);
 
-                chunk = MIN(chunk, IO_BUF_SIZE);
-                ret = blk_pread(blk1, offset, chunk, buf1, 0);
-                if (ret < 0) {
-                    error_report("Error while reading offset %" PRId64
-                                 " of %s: %s",
-                                 offset, filename1, strerror(-ret));
-                    ret = 4;
-                    goto out;
-                }
-                ret = blk_pread(blk2, offset, chunk, buf2, 0);
-                if (ret < 0) {
-                    error_report("Error while reading offset %" PRId64
-                                 " of %s: %s",
-                                 offset, filename2, strerror(-ret));
-                    ret = 4;
-                    goto out;
-                }
-                ret = compare_buffers(buf1, buf2, chunk, &pnum);
-                if (ret || pnum != chunk) {
-                    qprintf(quiet, "Content mismatch at offset %" PRId64 "!\n",
-                            offset + (ret ? 0 : pnum));
-                    ret = 1;
-                    goto out;
-                }
-            }
-        } else {
-            chunk = MIN(chunk, IO_BUF_SIZE);
-            if (allocated1) {
-                ret = check_empty_sectors(blk1, offset, chunk,
-                                          filename1, buf1, quiet);
-            } else {
-                ret = check_empty_sectors(blk2, offset, chunk,
-                                          filename2, buf1, quiet);
-            }
-            if (ret) {
-                goto out;
-            }
-        }
-        offset += chunk;
-        qemu_progress_print(((float) chunk / progress_base) * 100, 100);
+    for (i = 0; i < s.num_coroutines; i++) {
+        qemu_coroutine_enter(qemu_coroutine_create(img_compare_co, &s));
+    }
+    while (s.running_coroutines) {
+        main_loop_wait(false);
     }
 
-    if (total_size1 != total_size2) {
-        BlockBackend *blk_over;
-        const char *filename_over;
-
+    if (total_size1 != total_size2 &&
+        (!s.ret || s.fail_offset >= s.total_size)) {
         qprintf(quiet, "Warning: Image size mismatch!\n");
-        if (total_size1 > total_size2) {
-            blk_over = blk1;
-            filename_over = filename1;
-        } else {
-            blk_over = blk2;
-            filename_over = filename2;
-        }
-
-        while (offset < progress_base) {
-            ret = bdrv_block_status_above(blk_bs(blk_over), NULL, offset,
-                                          progress_base - offset, &chunk,
-                                          NULL, NULL);
-            if (ret < 0) {
-                ret = 3;
-                error_report("Sector allocation test failed for %s",
-                             filename_over);
-                goto out;
-
-            }
-            if (ret & BDRV_BLOCK_ALLOCATED && !(ret & BDRV_BLOCK_ZERO)) {
-                chunk = MIN(chunk, IO_BUF_SIZE);
-                ret = check_empty_sectors(blk_over, offset, chunk,
-                                          filename_over, buf1, quiet);
-                if (ret) {
-                    goto out;
-                }
-            }
-            offset += chunk;
-            qemu_progress_print(((float) chunk / progress_base) * 100, 100);
-        }
     }
 
-    qprintf(quiet, "Images are identical.\n");
-    ret = 0;
+    ret = s.ret;
+    if (ret == 1) {
+        qprintf(quiet, "%s", s.fail_msg);
+    } else if (ret) {
+        error_report("%s", s.fail_msg);
+    } else {
+        qprintf(quiet, "Images are identical.\n");
+    }
+    g_free(s.fail_msg);
 
 out:
-    qemu_vfree(buf1);
-    qemu_vfree(buf2);
     blk_unref(blk2);
 out2:
     blk_unref(blk1);
@@ -1658,7 +1814,6 @@ enum ImgConvertBlockStatus {
     BLK_BACKING_FILE,
 };
 
-#define MAX_COROUTINES 16
 #define CONVERT_THROTTLE_GROUP "img_convert"
 
 typedef struct ImgConvertState {
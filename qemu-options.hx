@@ -30,6 +30,7 @@ DEF("machine", HAS_ARG, QEMU_OPTION_machine, \
     "                vmport=on|off|auto controls emulation of vmport (default: auto)\n"
     "                dump-guest-core=on|off include guest memory in a core dump (default=on)\n"
     "                mem-merge=on|off controls memory merge support (default: on)\n"
+    "                map-rom-files=on|off maps firmware, kernel and initrd files instead of reading them (default=off)\n"
     "                aes-key-wrap=on|off controls support for AES key wrapping (default=on)\n"
     "                dea-key-wrap=on|off controls support for DEA key wrapping (default=on)\n"
     "                suppress-vmdesc=on|off disables self-describing migration (default=off)\n"
@@ -77,6 +78,16 @@ SRST
         supported by the host, de-duplicates identical memory pages
         among VMs instances (enabled by default).
 
+    ``map-rom-files=on|off``
+        Map firmware, option ROM, kernel and initrd files into QEMU's
+        address space instead of reading them into memory. Unmodified
+        pages are then shared through the host page cache by all VMs
+        that load the same file, which saves resident memory with large
+        images. The files must not be truncated or modified while the
+        VM runs: a truncated file makes QEMU crash on the next reset,
+        and a modified file is what the guest sees after it. The
+        default is off.
+
     ``aes-key-wrap=on|off``
         Enables or disables AES key wrapping support on s390-ccw hosts.
         This feature controls whether AES wrapping keys will be created
@@ -184,6 +195,8 @@ DEF("accel", HAS_ARG, QEMU_OPTION_accel,
     "                kvm-shadow-mem=size of KVM shadow MMU in bytes\n"
     "                split-wx=on|off (enable TCG split w^x mapping)\n"
     "                tb-size=n (TCG translation block cache size)\n"
+    "                halt-poll-ns=n (maximum TCG halt polling window, default 0)\n"
+    "                halt-poll-budget=n (percentage of vCPU time spent halt polling, default 10)\n"
     "                dirty-ring-size=n (KVM dirty ring GFN count, default 0)\n"
     "                notify-vmexit=run|internal-error|disable,notify-window=n (enable notify VM exit and set notify window, x86 only)\n"
     "                thread=single|multi (enable multi-threaded TCG)\n", QEMU_ARCH_ALL)
@@ -219,6 +232,18 @@ SRST
     ``tb-size=n``
         Controls the size (in MiB) of the TCG translation block cache.
 
+    ``halt-poll-ns=n``
+        When multi-threaded TCG is used, a halted vCPU polls for wakeups
+        for up to n nanoseconds before putting its thread to sleep, which
+        reduces the latency of IPIs and of short I/O waits at the cost of
+        host CPU time. The polling window adapts to the guest's halt
+        durations, and n is its upper bound. The default of 0 disables
+        polling.
+
+    ``halt-poll-budget=n``
+        Limits the time each vCPU thread spends halt polling to n percent
+        of every second. The default is 10.
+
     ``thread=single|multi``
         Controls number of TCG threads. When the TCG is multi-threaded
         there will be one thread per vCPU therefore taking advantage of
@@ -5297,6 +5322,19 @@ SRST
                    -device virtio-crypto-pci,id=crypto0,cryptodev=cryptodev0 \\
                [...]
 
+        Operations run in the thread pool of the AioContext that submits
+        them, so the ``virtio-crypto`` device can be given an IOThread to
+        take its virtqueues out of the main loop:
+
+        .. parsed-literal::
+
+             # |qemu_system| \\
+               [...] \\
+                   -object iothread,id=iothread0 \\
+                   -object cryptodev-backend-builtin,id=cryptodev0,queues=4 \\
+                   -device virtio-crypto-pci,id=crypto0,cryptodev=cryptodev0,iothread=iothread0 \\
+               [...]
+
     ``-object cryptodev-vhost-user,id=id,chardev=chardevid[,queues=queues]``
         Creates a vhost-user cryptodev backend, backed by a chardev
         chardevid. The id parameter is a unique ID that will be used to
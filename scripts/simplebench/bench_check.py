@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+#
+# Benchmark "qemu-img check" on large qcow2 images
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+
+import sys
+import os
+import subprocess
+import time
+
+import simplebench
+from results_to_text import results_to_text
+
+
+def qemu_img(*args):
+    subprocess.run(args, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE,
+                   universal_newlines=True, check=True)
+
+
+def bench_func(env, case):
+    """ Time "qemu-img check" on a fully allocated image """
+    fname = f"{case['dir']}/check-test.qcow2"
+    try:
+        os.remove(fname)
+    except OSError:
+        pass
+
+    try:
+        qemu_img(env['qemu-img-binary'], 'create', '-f', 'qcow2',
+                 '-o', f"cluster_size={case['cluster-size']},"
+                 'preallocation=metadata', fname, case['size'])
+
+        # With -T none the L2 tables are read from the disk rather than from
+        # the page cache, which is what parallel reads are meant to help with
+        start = time.time()
+        qemu_img(env['qemu-img-binary'], 'check', '-f', 'qcow2',
+                 '-T', case['cache'], fname)
+        return {'seconds': time.time() - start}
+    except subprocess.CalledProcessError as e:
+        return {'error': f'qemu-img failed: {e.returncode}: {e.stderr}'}
+    finally:
+        os.remove(fname)
+
+
+if __name__ == '__main__':
+    if len(sys.argv) < 3:
+        print(f'USAGE: {sys.argv[0]} DIR_PATH '
+              'NAME:QEMU_IMG_BINARY [NAME:QEMU_IMG_BINARY ...]')
+        exit(1)
+
+    envs = []
+    for arg in sys.argv[2:]:
+        name, binary = arg.split(':', 1)
+        envs.append({'id': name, 'qemu-img-binary': binary})
+
+    cases = []
+    for cache in ('writeback', 'none'):
+        for size, cluster_size in (('1T', '64k'), ('4T', '64k'),
+                                   ('4T', '2M')):
+            cases.append({
+                'id': f'{size} image, {cluster_size} clusters, '
+                      f'cache={cache}',
+                'cache': cache,
+                'size': size,
+                'cluster-size': cluster_size,
+                'dir': sys.argv[1]
+            })
+
+    result = simplebench.bench(bench_func, envs, cases, count=3)
+    print(results_to_text(result))
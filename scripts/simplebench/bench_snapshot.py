@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+#
+# Benchmark creation and deletion of qcow2 internal snapshots
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+
+import sys
+import os
+import subprocess
+import time
+
+import simplebench
+from results_to_text import results_to_text
+
+
+def qemu_img(*args):
+    subprocess.run(args, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE,
+                   universal_newlines=True, check=True)
+
+
+def bench_func(env, case):
+    """ Time "qemu-img snapshot -c" or "-d" on a fully allocated image """
+    fname = f"{case['dir']}/snapshot-test.qcow2"
+    try:
+        os.remove(fname)
+    except OSError:
+        pass
+
+    try:
+        qemu_img(env['qemu-img-binary'], 'create', '-f', 'qcow2',
+                 '-o', f"cluster_size={case['cluster-size']},"
+                 'preallocation=metadata', fname, case['size'])
+        if case['op'] == 'delete':
+            qemu_img(env['qemu-img-binary'], 'snapshot', '-c', 'snap', fname)
+
+        start = time.time()
+        qemu_img(env['qemu-img-binary'], 'snapshot',
+                 '-c' if case['op'] == 'create' else '-d', 'snap', fname)
+        return {'seconds': time.time() - start}
+    except subprocess.CalledProcessError as e:
+        return {'error': f'qemu-img failed: {e.returncode}: {e.stderr}'}
+    finally:
+        os.remove(fname)
+
+
+if __name__ == '__main__':
+    if len(sys.argv) < 3:
+        print(f'USAGE: {sys.argv[0]} DIR_PATH '
+              'NAME:QEMU_IMG_BINARY [NAME:QEMU_IMG_BINARY ...]')
+        exit(1)
+
+    envs = []
+    for arg in sys.argv[2:]:
+        name, binary = arg.split(':', 1)
+        envs.append({'id': name, 'qemu-img-binary': binary})
+
+    cases = []
+    for op in ('create', 'delete'):
+        for size, cluster_size in (('1T', '64k'), ('4T', '64k'),
+                                   ('4T', '2M')):
+            cases.append({
+                'id': f'{op}, {size} image, {cluster_size} clusters',
+                'op': op,
+                'size': size,
+                'cluster-size': cluster_size,
+                'dir': sys.argv[1]
+            })
+
+    result = simplebench.bench(bench_func, envs, cases, count=3)
+    print(results_to_text(result))
@@ -252,6 +252,23 @@ void cpu_interrupt(CPUState *cpu, int mask)
     }
 }
 
+void cpu_interrupt_lockless(CPUState *cpu, int mask)
+{
+    cpu_interrupt(cpu, mask);
+
+    /*
+     * A halted vCPU looks for work under the BQL and then sleeps on
+     * halt_cond, which the kick above may have signalled in between.
+     * Pairs with the smp_mb() after setting cpu->halted: either the vCPU
+     * sees our request bit, or we see it halted and wake it up for sure.
+     */
+    smp_mb();
+    if (qatomic_read(&cpu->halted)) {
+        QEMU_IOTHREAD_LOCK_GUARD();
+        qemu_cond_broadcast(cpu->halt_cond);
+    }
+}
+
 static int do_vm_stop(RunState state, bool send_stop)
 {
     int ret = 0;
@@ -21,8 +21,11 @@
 #include "monitor/hmp.h"
 #include "monitor/monitor.h"
 #include "exec/memory.h"
+#include "exec/ram_addr.h"
 #include "hw/boards.h"
+#include "hw/core/cpu.h"
 #include "sysemu/kvm.h"
+#include "sysemu/tcg.h"
 #include "trace.h"
 
 /*
@@ -42,6 +45,11 @@
  * composed of dirty ring full and sleep time.
  */
 #define DIRTYLIMIT_THROTTLE_PCT_MAX 99
+/*
+ * TCG has no dirty ring: the vCPU is throttled every time it dirties
+ * this many pages, as if a ring of that size had filled up.
+ */
+#define DIRTYLIMIT_TCG_RING_SIZE    4096
 
 struct {
     VcpuStat stat;
@@ -78,6 +86,16 @@ static void vcpu_dirty_rate_stat_collect(void)
     VcpuStat stat;
     int i = 0;
 
+    /*
+     * TCG only accounts the first write to a page in each period, like
+     * a harvest of the KVM dirty ring would.
+     */
+    if (tcg_enabled()) {
+        qemu_mutex_lock_iothread();
+        cpu_physical_memory_rearm_dirty_limit();
+        qemu_mutex_unlock_iothread();
+    }
+
     /* calculate vcpu dirtyrate */
     vcpu_calculate_dirtyrate(DIRTYLIMIT_CALC_TIME_MS,
                              &stat,
@@ -232,10 +250,20 @@ bool dirtylimit_vcpu_index_valid(int cpu_index)
              cpu_index >= ms->smp.max_cpus);
 }
 
+static bool dirtylimit_supported(void)
+{
+    return (kvm_enabled() && kvm_dirty_ring_enabled()) || tcg_enabled();
+}
+
+static inline uint32_t dirtylimit_dirty_ring_size(void)
+{
+    return kvm_enabled() ? kvm_dirty_ring_size() : DIRTYLIMIT_TCG_RING_SIZE;
+}
+
 static inline int64_t dirtylimit_dirty_ring_full_time(uint64_t dirtyrate)
 {
     static uint64_t max_dirtyrate;
-    uint32_t dirty_ring_size = kvm_dirty_ring_size();
+    uint32_t dirty_ring_size = dirtylimit_dirty_ring_size();
     uint64_t dirty_ring_size_meory_MB =
         dirty_ring_size * TARGET_PAGE_SIZE >> 20;
 
@@ -410,6 +438,37 @@ void dirtylimit_vcpu_execute(CPUState *cpu)
     }
 }
 
+static void dirtylimit_tcg_throttle(CPUState *cpu, run_on_cpu_data data)
+{
+    int64_t sleep_us = 0;
+
+    dirtylimit_state_lock();
+    if (dirtylimit_in_service() &&
+        dirtylimit_vcpu_get_state(cpu->cpu_index)->enabled) {
+        sleep_us = cpu->throttle_us_per_full;
+    }
+    dirtylimit_state_unlock();
+
+    if (sleep_us) {
+        trace_dirtylimit_vcpu_execute(cpu->cpu_index, sleep_us);
+        qemu_mutex_unlock_iothread();
+        g_usleep(sleep_us);
+        qemu_mutex_lock_iothread();
+    }
+}
+
+/*
+ * Called by TCG for the first write of @cpu to a page since the last
+ * sampling period, while the dirty page rate limit is running.
+ */
+void dirtylimit_tcg_page_dirtied(CPUState *cpu)
+{
+    cpu->dirty_pages++;
+    if (cpu->dirty_pages % DIRTYLIMIT_TCG_RING_SIZE == 0) {
+        async_run_on_cpu(cpu, dirtylimit_tcg_throttle, RUN_ON_CPU_NULL);
+    }
+}
+
 static void dirtylimit_init(void)
 {
     dirtylimit_state_initialize();
@@ -430,7 +489,7 @@ void qmp_cancel_vcpu_dirty_limit(bool has_cpu_index,
                                  int64_t cpu_index,
                                  Error **errp)
 {
-    if (!kvm_enabled() || !kvm_dirty_ring_enabled()) {
+    if (!dirtylimit_supported()) {
         return;
     }
 
@@ -478,8 +537,8 @@ void qmp_set_vcpu_dirty_limit(bool has_cpu_index,
                               uint64_t dirty_rate,
                               Error **errp)
 {
-    if (!kvm_enabled() || !kvm_dirty_ring_enabled()) {
-        error_setg(errp, "dirty page limit feature requires KVM with"
+    if (!dirtylimit_supported()) {
+        error_setg(errp, "dirty page limit feature requires TCG, or KVM with"
                    " accelerator property 'dirty-ring-size' set'");
         return;
     }
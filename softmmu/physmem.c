@@ -1080,6 +1080,27 @@ bool cpu_physical_memory_test_and_clear_dirty(ram_addr_t start,
     return dirty;
 }
 
+/*
+ * Clear DIRTY_MEMORY_DIRTY_LIMIT, so that the next TCG write to every
+ * RAM page goes through notdirty_write() again and is accounted to the
+ * writing vCPU.  Other clients, migration included, are unaffected.
+ */
+void cpu_physical_memory_rearm_dirty_limit(void)
+{
+    RAMBlock *block;
+
+    assert(tcg_enabled());
+    RCU_READ_LOCK_GUARD();
+    RAMBLOCK_FOREACH(block) {
+        if (!block->used_length) {
+            continue;
+        }
+        cpu_physical_memory_test_and_clear_dirty(block->offset,
+                                                 block->used_length,
+                                                 DIRTY_MEMORY_DIRTY_LIMIT);
+    }
+}
+
 DirtyBitmapSnapshot *cpu_physical_memory_snapshot_and_clear_dirty
     (MemoryRegion *mr, hwaddr offset, hwaddr length, unsigned client)
 {
@@ -2762,7 +2783,7 @@ bool prepare_mmio_access(MemoryRegion *mr)
 {
     bool release_lock = false;
 
-    if (!qemu_mutex_iothread_locked()) {
+    if (mr->global_locking && !qemu_mutex_iothread_locked()) {
         qemu_mutex_lock_iothread();
         release_lock = true;
     }
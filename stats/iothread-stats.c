@@ -0,0 +1,170 @@
+/*
+ * IOThread event loop statistics
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.
+ */
+
+#include "qemu/osdep.h"
+#include "qom/object.h"
+#include "sysemu/iothread.h"
+#include "sysemu/stats.h"
+
+static const struct {
+    const char *name;
+    size_t offset;
+    bool ns;
+} iothread_stats[] = {
+    { "dispatch_ns", offsetof(AioContextStats, dispatch_ns), true },
+    { "poll_success_ns", offsetof(AioContextStats, poll_success_ns), true },
+    { "poll_wasted_ns", offsetof(AioContextStats, poll_wasted_ns), true },
+    { "blocked_ns", offsetof(AioContextStats, blocked_ns), true },
+    { "fd_dispatches", offsetof(AioContextStats, fd_dispatches), false },
+    { "poll_dispatches", offsetof(AioContextStats, poll_dispatches), false },
+    { "bh_runs", offsetof(AioContextStats, bh_runs), false },
+};
+
+typedef struct IOThreadStatsArgs {
+    StatsResultList **result;
+    strList *names;
+    strList *targets;
+} IOThreadStatsArgs;
+
+static StatsList *add_iothread_stat(StatsList *list, strList *names,
+                                    const char *name, StatsValue *value)
+{
+    Stats *stats;
+
+    if (!apply_str_list_filter(name, names)) {
+        qapi_free_StatsValue(value);
+        return list;
+    }
+    stats = g_new0(Stats, 1);
+    stats->name = g_strdup(name);
+    stats->value = value;
+    QAPI_LIST_PREPEND(list, stats);
+    return list;
+}
+
+static StatsValue *stats_value_scalar(uint64_t scalar)
+{
+    StatsValue *value = g_new0(StatsValue, 1);
+
+    value->type = QTYPE_QNUM;
+    value->u.scalar = scalar;
+    return value;
+}
+
+static int query_one_iothread_stats(Object *obj, void *opaque)
+{
+    IOThreadStatsArgs *args = opaque;
+    IOThread *iothread = (IOThread *)object_dynamic_cast(obj, TYPE_IOTHREAD);
+    uint64_t lateness[QEMU_TIMER_LATENESS_BUCKETS];
+    g_autofree char *path = NULL;
+    StatsList *stats_list = NULL;
+    StatsValue *value;
+    uint64_t timers_run;
+    int i;
+
+    if (!iothread || !iothread->ctx) {
+        return 0;
+    }
+    path = object_get_canonical_path(obj);
+    if (!apply_str_list_filter(path, args->targets)) {
+        return 0;
+    }
+
+    /*
+     * Nobody asked for the times until now, so aio_poll() has not been
+     * reading the clock for them.  Start from here on.
+     */
+    qatomic_set(&iothread->ctx->account_time, true);
+
+    for (i = 0; i < ARRAY_SIZE(iothread_stats); i++) {
+        Stat64 *stat = (void *)&iothread->ctx->stats + iothread_stats[i].offset;
+
+        stats_list = add_iothread_stat(stats_list, args->names,
+                                       iothread_stats[i].name,
+                                       stats_value_scalar(stat64_get(stat)));
+    }
+
+    timerlistgroup_get_stats(&iothread->ctx->tlg, &timers_run, lateness);
+    stats_list = add_iothread_stat(stats_list, args->names, "timer_runs",
+                                   stats_value_scalar(timers_run));
+
+    value = g_new0(StatsValue, 1);
+    value->type = QTYPE_QLIST;
+    for (i = QEMU_TIMER_LATENESS_BUCKETS - 1; i >= 0; i--) {
+        QAPI_LIST_PREPEND(value->u.list, lateness[i]);
+    }
+    stats_list = add_iothread_stat(stats_list, args->names,
+                                   "timer_lateness_ns", value);
+
+    if (stats_list) {
+        add_stats_entry(args->result, STATS_PROVIDER_IOTHREAD, path,
+                        stats_list);
+    }
+    return 0;
+}
+
+static void iothread_query_stats(StatsResultList **result, StatsTarget target,
+                                 strList *names, strList *targets,
+                                 Error **errp)
+{
+    IOThreadStatsArgs args = {
+        .result = result,
+        .names = names,
+        .targets = targets,
+    };
+
+    if (target != STATS_TARGET_IOTHREAD) {
+        return;
+    }
+
+    object_child_foreach(object_get_objects_root(), query_one_iothread_stats,
+                         &args);
+}
+
+static StatsSchemaValueList *add_iothread_schema(StatsSchemaValueList *list,
+                                                 const char *name,
+                                                 StatsType type, bool ns)
+{
+    StatsSchemaValue *value = g_new0(StatsSchemaValue, 1);
+
+    value->name = g_strdup(name);
+    value->type = type;
+    if (ns) {
+        value->has_unit = true;
+        value->unit = STATS_UNIT_SECONDS;
+        value->has_base = true;
+        value->base = 10;
+        value->exponent = -9;
+    }
+    QAPI_LIST_PREPEND(list, value);
+    return list;
+}
+
+static void iothread_query_stats_schemas(StatsSchemaList **result,
+                                         Error **errp)
+{
+    StatsSchemaValueList *stats_list = NULL;
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(iothread_stats); i++) {
+        stats_list = add_iothread_schema(stats_list, iothread_stats[i].name,
+                                         STATS_TYPE_CUMULATIVE,
+                                         iothread_stats[i].ns);
+    }
+    stats_list = add_iothread_schema(stats_list, "timer_runs",
+                                     STATS_TYPE_CUMULATIVE, false);
+    stats_list = add_iothread_schema(stats_list, "timer_lateness_ns",
+                                     STATS_TYPE_LOG2_HISTOGRAM, true);
+    add_stats_schema(result, STATS_PROVIDER_IOTHREAD, STATS_TARGET_IOTHREAD,
+                     stats_list);
+}
+
+void iothread_register_stats(void)
+{
+    add_stats_callbacks(STATS_PROVIDER_IOTHREAD, iothread_query_stats,
+                        iothread_query_stats_schemas);
+}
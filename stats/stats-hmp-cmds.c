@@ -87,6 +87,10 @@ static void print_stats_results(Monitor *mon, StatsTarget target,
         return;
     }
 
+    if (target == STATS_TARGET_IOTHREAD && result->qom_path) {
+        monitor_printf(mon, "%s:\n", result->qom_path);
+    }
+
     if (show_provider) {
         monitor_printf(mon, "provider: %s\n",
                        StatsProvider_str(result->provider));
@@ -226,6 +230,9 @@ void hmp_info_stats(Monitor *mon, const QDict *qdict)
         int cpu_index = monitor_get_cpu_index(mon);
         filter = stats_filter(target, names, cpu_index, provider);
         break;
+    case STATS_TARGET_IOTHREAD:
+        filter = stats_filter(target, names, -1, provider);
+        break;
     default:
         abort();
     }
@@ -64,6 +64,15 @@ static bool invoke_stats_cb(StatsCallbacks *entry,
             targets = filter->u.vcpu.vcpus;
         }
         break;
+    case STATS_TARGET_IOTHREAD:
+        if (filter->u.iothread.has_iothreads) {
+            if (!filter->u.iothread.iothreads) {
+                /* No targets allowed?  Return no statistics.  */
+                return true;
+            }
+            targets = filter->u.iothread.iothreads;
+        }
+        break;
     default:
         abort();
     }
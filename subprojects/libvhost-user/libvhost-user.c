@@ -24,6 +24,7 @@
 #include <stdarg.h>
 #include <errno.h>
 #include <string.h>
+#include <time.h>
 #include <assert.h>
 #include <inttypes.h>
 #include <sys/types.h>
@@ -68,6 +69,9 @@
             _min1 < _min2 ? _min1 : _min2; })
 #endif
 
+/* Initial busy polling time once a kick showed that polling pays off */
+#define VU_POLL_NS_INITIAL 4000
+
 /* Round number down to multiple */
 #define ALIGN_DOWN(n, m) ((n) / (m) * (m))
 
@@ -1980,6 +1984,16 @@ end:
     return success;
 }
 
+static void
+vu_queue_elem_pool_destroy(VuVirtq *vq)
+{
+    VuVirtqElemPool *pool = &vq->elem_pool;
+
+    free(pool->buf);
+    free(pool->free);
+    *pool = (VuVirtqElemPool) { 0 };
+}
+
 void
 vu_deinit(VuDev *dev)
 {
@@ -2018,6 +2032,9 @@ vu_deinit(VuDev *dev)
             vq->resubmit_list = NULL;
         }
 
+        assert(vq->elem_pool.nfree == vq->elem_pool.count);
+        vu_queue_elem_pool_destroy(vq);
+
         vq->inflight = NULL;
     }
 
@@ -2542,17 +2559,79 @@ virtqueue_map_desc(VuDev *dev,
     return true;
 }
 
+bool
+vu_queue_set_elem_pool(VuVirtq *vq, size_t sz, unsigned int max_sg,
+                       unsigned int count)
+{
+    VuVirtqElemPool *pool = &vq->elem_pool;
+    size_t stride;
+    unsigned int i;
+
+    assert(sz >= sizeof(VuVirtqElement));
+    if (pool->sz == sz && pool->max_sg == max_sg && pool->count == count) {
+        return true;
+    }
+    if (pool->nfree != pool->count) {
+        return false;
+    }
+    vu_queue_elem_pool_destroy(vq);
+    if (!count) {
+        return true;
+    }
+
+    stride = ALIGN_UP(sz, __alignof__(struct iovec)) +
+             max_sg * sizeof(struct iovec);
+    /* Keep each element as aligned as malloc() would */
+    stride = ALIGN_UP(stride, 2 * sizeof(void *));
+    pool->buf = malloc(stride * count);
+    pool->free = malloc(count * sizeof(pool->free[0]));
+    if (!pool->buf || !pool->free) {
+        vu_queue_elem_pool_destroy(vq);
+        return false;
+    }
+
+    pool->stride = stride;
+    pool->sz = sz;
+    pool->max_sg = max_sg;
+    pool->count = count;
+    for (i = 0; i < count; i++) {
+        pool->free[i] = count - 1 - i;
+    }
+    pool->nfree = count;
+    return true;
+}
+
+void
+vu_queue_elem_free(VuVirtq *vq, void *elem)
+{
+    VuVirtqElemPool *pool = &vq->elem_pool;
+    char *p = elem;
+
+    if (pool->buf && p >= pool->buf &&
+        p < pool->buf + pool->count * pool->stride) {
+        assert(pool->nfree < pool->count);
+        pool->free[pool->nfree++] = (p - pool->buf) / pool->stride;
+    } else {
+        free(elem);
+    }
+}
+
 static void *
-virtqueue_alloc_element(size_t sz,
-                                     unsigned out_num, unsigned in_num)
+virtqueue_alloc_element(VuVirtq *vq, size_t sz,
+                        unsigned out_num, unsigned in_num)
 {
+    VuVirtqElemPool *pool = &vq->elem_pool;
     VuVirtqElement *elem;
     size_t in_sg_ofs = ALIGN_UP(sz, __alignof__(elem->in_sg[0]));
     size_t out_sg_ofs = in_sg_ofs + in_num * sizeof(elem->in_sg[0]);
     size_t out_sg_end = out_sg_ofs + out_num * sizeof(elem->out_sg[0]);
 
     assert(sz >= sizeof(VuVirtqElement));
-    elem = malloc(out_sg_end);
+    if (pool->nfree && pool->sz == sz && out_num + in_num <= pool->max_sg) {
+        elem = (void *)(pool->buf + pool->free[--pool->nfree] * pool->stride);
+    } else {
+        elem = malloc(out_sg_end);
+    }
     elem->out_num = out_num;
     elem->in_num = in_num;
     elem->in_sg = (void *)elem + in_sg_ofs;
@@ -2638,7 +2717,7 @@ vu_queue_map_desc(VuDev *dev, VuVirtq *vq, unsigned int idx, size_t sz)
     }
 
     /* Now copy what we have collected and mapped */
-    elem = virtqueue_alloc_element(sz, out_num, in_num);
+    elem = virtqueue_alloc_element(vq, sz, out_num, in_num);
     elem->index = idx;
     for (i = 0; i < out_num; i++) {
         elem->out_sg[i] = iov[i];
@@ -2764,6 +2843,144 @@ vu_queue_pop(VuDev *dev, VuVirtq *vq, size_t sz)
     return elem;
 }
 
+unsigned int
+vu_queue_pop_batch(VuDev *dev, VuVirtq *vq, size_t sz,
+                   void **elems, unsigned int max)
+{
+    unsigned int n = 0, head, num;
+    int num_heads;
+
+    if (unlikely(dev->broken) ||
+        unlikely(!vq->vring.avail)) {
+        return 0;
+    }
+
+    /* Requests that are resubmitted after a reconnect come first */
+    while (n < max && unlikely(vq->resubmit_list && vq->resubmit_num > 0)) {
+        elems[n] = vu_queue_pop(dev, vq, sz);
+        if (!elems[n]) {
+            return n;
+        }
+        n++;
+    }
+
+    num_heads = virtqueue_num_heads(dev, vq, vq->last_avail_idx);
+    if (num_heads <= 0) {
+        return n;
+    }
+    num = MIN((unsigned int)num_heads, max - n);
+
+    if (vq->inuse + num > vq->vring.num) {
+        vu_panic(dev, "Virtqueue size exceeded");
+        return n;
+    }
+
+    while (num--) {
+        VuVirtqElement *elem;
+
+        if (!virtqueue_get_head(dev, vq, vq->last_avail_idx, &head)) {
+            break;
+        }
+        elem = vu_queue_map_desc(dev, vq, head, sz);
+        if (!elem) {
+            break;
+        }
+
+        vq->last_avail_idx++;
+        vq->inuse++;
+        vu_queue_inflight_get(dev, vq, head);
+        elems[n++] = elem;
+    }
+
+    if (vu_has_feature(dev, VIRTIO_RING_F_EVENT_IDX)) {
+        vring_set_avail_event(vq, vq->last_avail_idx);
+    }
+
+    return n;
+}
+
+void
+vu_queue_set_busy_poll(VuVirtq *vq, uint64_t max_ns)
+{
+    vq->poll_max_ns = max_ns;
+    vq->poll_ns = MIN(vq->poll_ns, max_ns);
+    vq->poll_stopped_ns = 0;
+}
+
+static uint64_t
+vu_get_clock_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void
+vu_queue_busy_poll_begin(VuDev *dev, VuVirtq *vq)
+{
+    uint64_t now;
+
+    if (!vq->poll_max_ns) {
+        return;
+    }
+
+    now = vu_get_clock_ns();
+    if (vq->poll_stopped_ns) {
+        /* Polling a bit longer would have avoided the last kick */
+        if (now - vq->poll_stopped_ns <= vq->poll_max_ns) {
+            vq->poll_ns = vq->poll_ns ? vq->poll_ns * 2 : VU_POLL_NS_INITIAL;
+            vq->poll_ns = MIN(vq->poll_ns, vq->poll_max_ns);
+        }
+        vq->poll_stopped_ns = 0;
+    }
+
+    vu_queue_set_notification(dev, vq, 0);
+    vq->poll_deadline_ns = now + vq->poll_ns;
+}
+
+bool
+vu_queue_busy_poll(VuDev *dev, VuVirtq *vq)
+{
+    volatile uint16_t *avail_idx;
+
+    if (!vq->poll_max_ns ||
+        unlikely(dev->broken) ||
+        unlikely(!vq->vring.avail)) {
+        return true;
+    }
+
+    /*
+     * Unlike vu_queue_empty(), do not update the shadow index: this can
+     * run concurrently with vu_queue_notify() on other threads.
+     */
+    avail_idx = &vq->vring.avail->idx;
+    if (le16toh(*avail_idx) != vq->last_avail_idx) {
+        return true;
+    }
+
+    return vu_get_clock_ns() >= vq->poll_deadline_ns;
+}
+
+bool
+vu_queue_busy_poll_end(VuDev *dev, VuVirtq *vq)
+{
+    if (!vu_queue_empty(dev, vq)) {
+        return true;
+    }
+    if (!vq->poll_max_ns) {
+        return false;
+    }
+
+    /* Time out: shrink the polling time and wait for the next kick */
+    vq->poll_ns /= 2;
+    vq->poll_stopped_ns = vu_get_clock_ns();
+    vu_queue_set_notification(dev, vq, 1);
+
+    /* Buffers may have been added before the guest saw notifications on */
+    return !vu_queue_empty(dev, vq);
+}
+
 static void
 vu_queue_detach_element(VuDev *dev, VuVirtq *vq, VuVirtqElement *elem,
                         size_t len)
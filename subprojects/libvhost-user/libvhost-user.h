@@ -315,6 +315,17 @@ typedef struct VuVirtqInflightDesc {
     uint64_t counter;
 } VuVirtqInflightDesc;
 
+/* Preallocated elements, see vu_queue_set_elem_pool() */
+typedef struct VuVirtqElemPool {
+    char *buf;              /* @count elements, @stride bytes apart */
+    size_t stride;
+    size_t sz;              /* size of the struct embedding VuVirtqElement */
+    unsigned int max_sg;    /* maximum in_num + out_num of an element */
+    unsigned int count;
+    unsigned int *free;     /* indices of the free elements */
+    unsigned int nfree;
+} VuVirtqElemPool;
+
 typedef struct VuVirtq {
     VuRing vring;
 
@@ -355,6 +366,14 @@ typedef struct VuVirtq {
 
     /* Guest addresses of our ring */
     struct vhost_vring_addr vra;
+
+    VuVirtqElemPool elem_pool;
+
+    /* Busy polling, see vu_queue_busy_poll() */
+    uint64_t poll_max_ns;
+    uint64_t poll_ns;
+    uint64_t poll_stopped_ns;   /* when polling last timed out, or 0 */
+    uint64_t poll_deadline_ns;
 } VuVirtq;
 
 enum VuWatchCondtion {
@@ -602,10 +621,118 @@ void vu_queue_notify_sync(VuDev *dev, VuVirtq *vq);
  * @sz: the size of struct to return (must be >= VuVirtqElement)
  *
  * Returns: a VuVirtqElement filled from the queue or NULL. The
- * returned element must be free()-d by the caller.
+ * returned element must be freed by the caller with vu_queue_elem_free().
+ * Elements that do not come from the pool of the queue may also be
+ * free()-d.
  */
 void *vu_queue_pop(VuDev *dev, VuVirtq *vq, size_t sz);
 
+/**
+ * vu_queue_pop_batch:
+ * @dev: a VuDev context
+ * @vq: a VuVirtq queue
+ * @sz: the size of struct to return (must be >= VuVirtqElement)
+ * @elems: array receiving the elements
+ * @max: size of @elems
+ *
+ * Like vu_queue_pop(), but retrieves up to @max elements at once.  The
+ * available ring index is read, and the avail event is updated, only once
+ * for the whole batch.
+ *
+ * Returns: the number of elements stored in @elems.
+ */
+unsigned int vu_queue_pop_batch(VuDev *dev, VuVirtq *vq, size_t sz,
+                                void **elems, unsigned int max);
+
+/**
+ * vu_queue_set_elem_pool:
+ * @vq: a VuVirtq queue
+ * @sz: the size of struct that vu_queue_pop() will be called with
+ * @max_sg: maximum number of in and out buffers of an element
+ * @count: number of elements to preallocate
+ *
+ * Preallocate @count elements for the queue, so that popping elements of
+ * size @sz with up to @max_sg buffers does not need to allocate memory.
+ * Elements that do not fit, or that are popped while the pool is empty,
+ * are still allocated separately.  Elements from the pool must be freed
+ * with vu_queue_elem_free(), and all of them must have been freed before
+ * the pool is changed or vu_deinit() is called.
+ *
+ * Returns: true on success, false if elements from the current pool are
+ * still in use or memory could not be allocated.
+ */
+bool vu_queue_set_elem_pool(VuVirtq *vq, size_t sz, unsigned int max_sg,
+                            unsigned int count);
+
+/**
+ * vu_queue_elem_free:
+ * @vq: the VuVirtq queue the element was popped from
+ * @elem: an element returned by vu_queue_pop() or vu_queue_pop_batch()
+ *
+ * Free @elem, or return it to the element pool of @vq.  Must be called
+ * with the same serialization as vu_queue_pop() for @vq.
+ */
+void vu_queue_elem_free(VuVirtq *vq, void *elem);
+
+/**
+ * vu_queue_set_busy_poll:
+ * @vq: a VuVirtq queue
+ * @max_ns: maximum time that busy polling lasts, 0 to disable
+ *
+ * Configure busy polling for the queue.
+ */
+void vu_queue_set_busy_poll(VuVirtq *vq, uint64_t max_ns);
+
+/**
+ * vu_queue_busy_poll_begin:
+ * @dev: a VuDev context
+ * @vq: a VuVirtq queue
+ *
+ * Start waiting for available buffers by polling the available ring with
+ * guest notifications suppressed, instead of waiting for a kick.  Backends
+ * that opt into busy polling call this once they have popped all elements,
+ * then call vu_queue_busy_poll() until it returns true, and finally
+ * vu_queue_busy_poll_end().
+ *
+ * The polling time adapts to the workload: it grows when a kick arrives
+ * shortly after polling gave up, and shrinks every time polling times out.
+ * It is never longer than the maximum set with vu_queue_set_busy_poll().
+ *
+ * Must be called with the same serialization as vu_queue_pop() for @vq.
+ */
+void vu_queue_busy_poll_begin(VuDev *dev, VuVirtq *vq);
+
+/**
+ * vu_queue_busy_poll:
+ * @dev: a VuDev context
+ * @vq: a VuVirtq queue
+ *
+ * Check the available ring once, as part of busy polling.  This only reads
+ * the ring, so it does not need the serialization of vu_queue_pop() and
+ * can run concurrently with vu_queue_push() and vu_queue_notify().  The
+ * caller must still make sure that the ring stays mapped, and must not pop
+ * from @vq from another thread.
+ *
+ * Returns: true if buffers are available or the polling time is over,
+ * false if the caller should call vu_queue_busy_poll() again.
+ */
+bool vu_queue_busy_poll(VuDev *dev, VuVirtq *vq);
+
+/**
+ * vu_queue_busy_poll_end:
+ * @dev: a VuDev context
+ * @vq: a VuVirtq queue
+ *
+ * Finish busy polling.  Must be called with the same serialization as
+ * vu_queue_pop() for @vq.
+ *
+ * Returns: true if buffers are available, and the caller should pop them
+ * and start polling again; false if polling timed out, in which case
+ * notifications are enabled again and the caller should wait for the next
+ * kick.
+ */
+bool vu_queue_busy_poll_end(VuDev *dev, VuVirtq *vq);
+
 
 /**
  * vu_queue_unpop:
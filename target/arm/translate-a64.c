@@ -67,6 +67,60 @@ typedef struct AArch64DecodeTable {
     AArch64DecodeFn *disas_fn;
 } AArch64DecodeTable;
 
+/*
+ * Inline expansions of the division helpers, for hosts that divide in
+ * hardware.  The architecture defines x / 0 == 0 and, for signed
+ * division, INT64_MIN / -1 == INT64_MIN, where the host instruction
+ * may trap; substitute a safe divisor and patch up the result instead.
+ */
+static bool gen_inline_udiv64(TCGTemp *ret, TCGTemp **args)
+{
+    TCGv_i64 rd = temp_tcgv_i64(ret);
+    TCGv_i64 n = temp_tcgv_i64(args[0]);
+    TCGv_i64 m = temp_tcgv_i64(args[1]);
+    TCGv_i64 zero = tcg_constant_i64(0);
+    TCGv_i64 t;
+
+    if (!TCG_TARGET_HAS_div_i64 && !TCG_TARGET_HAS_div2_i64) {
+        return false;
+    }
+
+    t = tcg_temp_new_i64();
+    tcg_gen_movcond_i64(TCG_COND_EQ, t, m, zero, tcg_constant_i64(1), m);
+    tcg_gen_divu_i64(t, n, t);
+    tcg_gen_movcond_i64(TCG_COND_EQ, rd, m, zero, zero, t);
+    tcg_temp_free_i64(t);
+    return true;
+}
+
+static bool gen_inline_sdiv64(TCGTemp *ret, TCGTemp **args)
+{
+    TCGv_i64 rd = temp_tcgv_i64(ret);
+    TCGv_i64 n = temp_tcgv_i64(args[0]);
+    TCGv_i64 m = temp_tcgv_i64(args[1]);
+    TCGv_i64 zero = tcg_constant_i64(0);
+    TCGv_i64 one = tcg_constant_i64(1);
+    TCGv_i64 t, u;
+
+    if (!TCG_TARGET_HAS_div_i64 && !TCG_TARGET_HAS_div2_i64) {
+        return false;
+    }
+
+    t = tcg_temp_new_i64();
+    u = tcg_temp_new_i64();
+    /* Divide by 1 instead of 0 or -1: m + 1 <= 1 unsigned. */
+    tcg_gen_addi_i64(t, m, 1);
+    tcg_gen_movcond_i64(TCG_COND_LEU, t, t, one, one, m);
+    tcg_gen_div_i64(t, n, t);
+    /* x / -1 == -x, which wraps for INT64_MIN as required. */
+    tcg_gen_neg_i64(u, n);
+    tcg_gen_movcond_i64(TCG_COND_EQ, t, m, tcg_constant_i64(-1), u, t);
+    tcg_gen_movcond_i64(TCG_COND_EQ, rd, m, zero, zero, t);
+    tcg_temp_free_i64(u);
+    tcg_temp_free_i64(t);
+    return true;
+}
+
 /* initialize TCG globals.  */
 void a64_translate_init(void)
 {
@@ -83,6 +137,9 @@ void a64_translate_init(void)
 
     cpu_exclusive_high = tcg_global_mem_new_i64(cpu_env,
         offsetof(CPUARMState, exclusive_high), "exclusive_high");
+
+    tcg_register_helper_inline(helper_udiv64, gen_inline_udiv64);
+    tcg_register_helper_inline(helper_sdiv64, gen_inline_sdiv64);
 }
 
 /*
@@ -18,7 +18,8 @@
  * License along with this library; if not, see <http://www.gnu.org/licenses/>.
  */
 
-#include "crypto/aes.h"
+#include "crypto/aes-round.h"
+#include "crypto/clmul.h"
 
 #if SHIFT == 0
 #define Reg MMXReg
@@ -480,11 +481,41 @@ void glue(helper_pshufhw, SUFFIX)(Reg *d, Reg *s, int order)
         }                                                               \
     }
 
-#if SHIFT == 1
+/*
+ * Packed ops with a lane-batched softfloat entry point.  The operation is
+ * lane-wise, so we only need the lowest-addressed of the first N lanes,
+ * which on a big-endian host is the highest-numbered one.
+ */
+#if HOST_BIG_ENDIAN
+#define ZMM_S_LANES(r, n) (&(r)->ZMM_S((n) - 1))
+#define ZMM_D_LANES(r, n) (&(r)->ZMM_D((n) - 1))
+#else
+#define ZMM_S_LANES(r, n) (&(r)->ZMM_S(0))
+#define ZMM_D_LANES(r, n) (&(r)->ZMM_D(0))
+#endif
 
-#define SSE_HELPER_S(name, F)                                           \
-    SSE_HELPER_P(name, F)                                               \
+#define SSE_HELPER_PV(name)                                             \
+    void glue(helper_ ## name ## ps, SUFFIX)(CPUX86State *env,          \
+            Reg *d, Reg *v, Reg *s)                                     \
+    {                                                                   \
+        float32_ ## name ## _vec(ZMM_S_LANES(d, 2 << SHIFT),            \
+                                 ZMM_S_LANES(v, 2 << SHIFT),            \
+                                 ZMM_S_LANES(s, 2 << SHIFT),            \
+                                 2 << SHIFT, &env->sse_status);         \
+    }                                                                   \
                                                                         \
+    void glue(helper_ ## name ## pd, SUFFIX)(CPUX86State *env,          \
+            Reg *d, Reg *v, Reg *s)                                     \
+    {                                                                   \
+        float64_ ## name ## _vec(ZMM_D_LANES(d, 1 << SHIFT),            \
+                                 ZMM_D_LANES(v, 1 << SHIFT),            \
+                                 ZMM_D_LANES(s, 1 << SHIFT),            \
+                                 1 << SHIFT, &env->sse_status);         \
+    }
+
+#if SHIFT == 1
+
+#define SSE_HELPER_SS(name, F)                                          \
     void helper_ ## name ## ss(CPUX86State *env, Reg *d, Reg *v, Reg *s)\
     {                                                                   \
         int i;                                                          \
@@ -503,9 +534,13 @@ void glue(helper_pshufhw, SUFFIX)(Reg *d, Reg *s, int order)
         }                                                               \
     }
 
+#define SSE_HELPER_S(name, F) SSE_HELPER_P(name, F) SSE_HELPER_SS(name, F)
+#define SSE_HELPER_SV(name, F) SSE_HELPER_PV(name) SSE_HELPER_SS(name, F)
+
 #else
 
 #define SSE_HELPER_S(name, F) SSE_HELPER_P(name, F)
+#define SSE_HELPER_SV(name, F) SSE_HELPER_PV(name)
 
 #endif
 
@@ -523,10 +558,10 @@ void glue(helper_pshufhw, SUFFIX)(Reg *d, Reg *s, int order)
 #define FPU_MAX(size, a, b)                                     \
     (float ## size ## _lt(b, a, &env->sse_status) ? (a) : (b))
 
-SSE_HELPER_S(add, FPU_ADD)
-SSE_HELPER_S(sub, FPU_SUB)
-SSE_HELPER_S(mul, FPU_MUL)
-SSE_HELPER_S(div, FPU_DIV)
+SSE_HELPER_SV(add, FPU_ADD)
+SSE_HELPER_SV(sub, FPU_SUB)
+SSE_HELPER_SV(mul, FPU_MUL)
+SSE_HELPER_SV(div, FPU_DIV)
 SSE_HELPER_S(min, FPU_MIN)
 SSE_HELPER_S(max, FPU_MAX)
 
@@ -2121,122 +2156,117 @@ target_ulong helper_crc32(uint32_t crc1, target_ulong msg, uint32_t len)
 
 #endif
 
-#if SHIFT == 1
-static void clmulq(uint64_t *dest_l, uint64_t *dest_h,
-                          uint64_t a, uint64_t b)
+void glue(helper_pclmulqdq, SUFFIX)(CPUX86State *env, Reg *d, Reg *v, Reg *s,
+                                    uint32_t ctrl)
 {
-    uint64_t al, ah, resh, resl;
+    int a_idx = (ctrl & 1) != 0;
+    int b_idx = (ctrl & 16) != 0;
+    int i;
 
-    ah = 0;
-    al = a;
-    resh = resl = 0;
+    for (i = 0; i < 1 << SHIFT; i += 2) {
+        Int128 r = clmul_64(v->Q(a_idx + i), s->Q(b_idx + i));
 
-    while (b) {
-        if (b & 1) {
-            resl ^= al;
-            resh ^= ah;
-        }
-        ah = (ah << 1) | (al >> 63);
-        al <<= 1;
-        b >>= 1;
+        d->Q(i) = int128_getlo(r);
+        d->Q(i + 1) = int128_gethi(r);
     }
-
-    *dest_l = resl;
-    *dest_h = resh;
 }
-#endif
 
-void glue(helper_pclmulqdq, SUFFIX)(CPUX86State *env, Reg *d, Reg *v, Reg *s,
-                                    uint32_t ctrl)
+#if SHIFT == 1
+/* The AES state is in the byte order of a little-endian XMM register */
+static void zmm_to_aes_state(AESState *st, const ZMMReg *r, int lane)
 {
-    uint64_t a, b;
-    int i;
+    st->d[0] = cpu_to_le64(r->ZMM_Q(2 * lane));
+    st->d[1] = cpu_to_le64(r->ZMM_Q(2 * lane + 1));
+}
 
-    for (i = 0; i < 1 << SHIFT; i += 2) {
-        a = v->Q(((ctrl & 1) != 0) + i);
-        b = s->Q(((ctrl & 16) != 0) + i);
-        clmulq(&d->Q(i), &d->Q(i + 1), a, b);
-    }
+static void aes_state_to_zmm(ZMMReg *r, const AESState *st, int lane)
+{
+    r->ZMM_Q(2 * lane) = le64_to_cpu(st->d[0]);
+    r->ZMM_Q(2 * lane + 1) = le64_to_cpu(st->d[1]);
 }
+#endif
 
 void glue(helper_aesdec, SUFFIX)(CPUX86State *env, Reg *d, Reg *v, Reg *s)
 {
     int i;
-    Reg st = *v;
-    Reg rk = *s;
 
-    for (i = 0 ; i < 2 << SHIFT ; i++) {
-        int j = i & 3;
-        d->L(i) = rk.L(i) ^ bswap32(AES_Td0[st.B(AES_ishifts[4 * j + 0])] ^
-                                    AES_Td1[st.B(AES_ishifts[4 * j + 1])] ^
-                                    AES_Td2[st.B(AES_ishifts[4 * j + 2])] ^
-                                    AES_Td3[st.B(AES_ishifts[4 * j + 3])]);
+    for (i = 0; i < SHIFT; i++) {
+        AESState st, rk;
+
+        zmm_to_aes_state(&st, v, i);
+        zmm_to_aes_state(&rk, s, i);
+        aesdec_ISB_ISR_IMC_AK(&st, &st, &rk);
+        aes_state_to_zmm(d, &st, i);
     }
 }
 
 void glue(helper_aesdeclast, SUFFIX)(CPUX86State *env, Reg *d, Reg *v, Reg *s)
 {
     int i;
-    Reg st = *v;
-    Reg rk = *s;
 
-    for (i = 0; i < 8 << SHIFT; i++) {
-        d->B(i) = rk.B(i) ^ (AES_isbox[st.B(AES_ishifts[i & 15] + (i & ~15))]);
+    for (i = 0; i < SHIFT; i++) {
+        AESState st, rk;
+
+        zmm_to_aes_state(&st, v, i);
+        zmm_to_aes_state(&rk, s, i);
+        aesdec_ISB_ISR_AK(&st, &st, &rk);
+        aes_state_to_zmm(d, &st, i);
     }
 }
 
 void glue(helper_aesenc, SUFFIX)(CPUX86State *env, Reg *d, Reg *v, Reg *s)
 {
     int i;
-    Reg st = *v;
-    Reg rk = *s;
 
-    for (i = 0 ; i < 2 << SHIFT ; i++) {
-        int j = i & 3;
-        d->L(i) = rk.L(i) ^ bswap32(AES_Te0[st.B(AES_shifts[4 * j + 0])] ^
-                                    AES_Te1[st.B(AES_shifts[4 * j + 1])] ^
-                                    AES_Te2[st.B(AES_shifts[4 * j + 2])] ^
-                                    AES_Te3[st.B(AES_shifts[4 * j + 3])]);
+    for (i = 0; i < SHIFT; i++) {
+        AESState st, rk;
+
+        zmm_to_aes_state(&st, v, i);
+        zmm_to_aes_state(&rk, s, i);
+        aesenc_SB_SR_MC_AK(&st, &st, &rk);
+        aes_state_to_zmm(d, &st, i);
     }
 }
 
 void glue(helper_aesenclast, SUFFIX)(CPUX86State *env, Reg *d, Reg *v, Reg *s)
 {
     int i;
-    Reg st = *v;
-    Reg rk = *s;
 
-    for (i = 0; i < 8 << SHIFT; i++) {
-        d->B(i) = rk.B(i) ^ (AES_sbox[st.B(AES_shifts[i & 15] + (i & ~15))]);
+    for (i = 0; i < SHIFT; i++) {
+        AESState st, rk;
+
+        zmm_to_aes_state(&st, v, i);
+        zmm_to_aes_state(&rk, s, i);
+        aesenc_SB_SR_AK(&st, &st, &rk);
+        aes_state_to_zmm(d, &st, i);
     }
 }
 
 #if SHIFT == 1
 void glue(helper_aesimc, SUFFIX)(CPUX86State *env, Reg *d, Reg *s)
 {
-    int i;
-    Reg tmp = *s;
+    AESState st;
 
-    for (i = 0 ; i < 4 ; i++) {
-        d->L(i) = bswap32(AES_imc[tmp.B(4 * i + 0)][0] ^
-                          AES_imc[tmp.B(4 * i + 1)][1] ^
-                          AES_imc[tmp.B(4 * i + 2)][2] ^
-                          AES_imc[tmp.B(4 * i + 3)][3]);
-    }
+    zmm_to_aes_state(&st, s, 0);
+    aesdec_IMC(&st, &st);
+    aes_state_to_zmm(d, &st, 0);
 }
 
 void glue(helper_aeskeygenassist, SUFFIX)(CPUX86State *env, Reg *d, Reg *s,
                                           uint32_t ctrl)
 {
-    int i;
-    Reg tmp = *s;
+    AESState st;
+    uint32_t x1, x3;
 
-    for (i = 0 ; i < 4 ; i++) {
-        d->B(i) = AES_sbox[tmp.B(i + 4)];
-        d->B(i + 8) = AES_sbox[tmp.B(i + 12)];
-    }
-    d->L(1) = (d->L(0) << 24 | d->L(0) >> 8) ^ ctrl;
-    d->L(3) = (d->L(2) << 24 | d->L(2) >> 8) ^ ctrl;
+    zmm_to_aes_state(&st, s, 0);
+    aesenc_SB(&st, &st);
+    x1 = le32_to_cpu(st.w[1]);
+    x3 = le32_to_cpu(st.w[3]);
+
+    d->L(0) = x1;
+    d->L(1) = (x1 << 24 | x1 >> 8) ^ ctrl;
+    d->L(2) = x3;
+    d->L(3) = (x3 << 24 | x3 >> 8) ^ ctrl;
 }
 #endif
 #endif
@@ -2554,6 +2584,8 @@ SSE_HELPER_FMAP(helper_fma4pd,  ZMM_D, 1 << SHIFT, float64_muladd)
 #endif
 
 #undef SSE_HELPER_S
+#undef SSE_HELPER_SV
+#undef SSE_HELPER_SS
 
 #undef LANE_WIDTH
 #undef SHIFT
@@ -482,7 +482,9 @@ void do_hlt(CPUX86State *env)
     CPUState *cs = env_cpu(env);
 
     env->hflags &= ~HF_INHIBIT_IRQ_MASK; /* needed if sti is just before */
-    cs->halted = 1;
+    qatomic_set(&cs->halted, 1);
+    /* Pairs with cpu_interrupt_lockless(). */
+    smp_mb();
     cs->exception_index = EXCP_HLT;
     cpu_loop_exit(cs);
 }
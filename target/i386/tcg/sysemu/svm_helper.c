@@ -389,7 +389,7 @@ void helper_vmrun(CPUX86State *env, int aflag, int next_eip_addend)
     if (ctl_has_irq(env)) {
         CPUState *cs = env_cpu(env);
 
-        cs->interrupt_request |= CPU_INTERRUPT_VIRQ;
+        qatomic_or(&cs->interrupt_request, CPU_INTERRUPT_VIRQ);
     }
 
     if (virtual_gif_set(env)) {
@@ -798,7 +798,7 @@ void do_vmexit(CPUX86State *env)
     env->hflags &= ~HF_GUEST_MASK;
     env->intercept = 0;
     env->intercept_exceptions = 0;
-    cs->interrupt_request &= ~CPU_INTERRUPT_VIRQ;
+    qatomic_and(&cs->interrupt_request, ~CPU_INTERRUPT_VIRQ);
     env->int_ctl = 0;
     env->tsc_offset = 0;
 
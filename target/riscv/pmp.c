@@ -195,6 +195,8 @@ void pmp_update_rule_nums(CPURISCVState *env)
 {
     int i;
 
+    /* The decision table is rebuilt on the next lookup */
+    env->pmp_state.num_intervals = 0;
     env->pmp_state.num_rules = 0;
     for (i = 0; i < MAX_RISCV_PMPS; i++) {
         const uint8_t a_field =
@@ -285,49 +287,237 @@ static bool pmp_hart_has_privs_default(CPURISCVState *env, target_ulong addr,
     return ret;
 }
 
+/*
+ * Privileges granted by a matching rule to an access from @mode.
+ */
+static pmp_priv_t pmp_rule_privs(CPURISCVState *env, int pmp_index,
+                                 target_ulong mode)
+{
+    const uint8_t cfg = env->pmp_state.pmp[pmp_index].cfg_reg;
+    pmp_priv_t allowed_privs;
+
+    /*
+     * Convert the PMP permissions to match the truth table in the
+     * ePMP spec.
+     */
+    const uint8_t epmp_operation =
+        ((cfg & PMP_LOCK) >> 4) |
+        ((cfg & PMP_READ) << 2) |
+        (cfg & PMP_WRITE) |
+        ((cfg & PMP_EXEC) >> 2);
+
+    if (!MSECCFG_MML_ISSET(env)) {
+        /*
+         * If mseccfg.MML Bit is not set, do pmp priv check
+         * This will always apply to regular PMP.
+         */
+        allowed_privs = PMP_READ | PMP_WRITE | PMP_EXEC;
+        if ((mode != PRV_M) || pmp_is_locked(env, pmp_index)) {
+            allowed_privs &= cfg;
+        }
+    } else {
+        /*
+         * If mseccfg.MML Bit set, do the enhanced pmp priv check
+         */
+        if (mode == PRV_M) {
+            switch (epmp_operation) {
+            case 0:
+            case 1:
+            case 4:
+            case 5:
+            case 6:
+            case 7:
+            case 8:
+                allowed_privs = 0;
+                break;
+            case 2:
+            case 3:
+            case 14:
+                allowed_privs = PMP_READ | PMP_WRITE;
+                break;
+            case 9:
+            case 10:
+                allowed_privs = PMP_EXEC;
+                break;
+            case 11:
+            case 13:
+                allowed_privs = PMP_READ | PMP_EXEC;
+                break;
+            case 12:
+            case 15:
+                allowed_privs = PMP_READ;
+                break;
+            default:
+                g_assert_not_reached();
+            }
+        } else {
+            switch (epmp_operation) {
+            case 0:
+            case 8:
+            case 9:
+            case 12:
+            case 13:
+            case 14:
+                allowed_privs = 0;
+                break;
+            case 1:
+            case 10:
+            case 11:
+                allowed_privs = PMP_EXEC;
+                break;
+            case 2:
+            case 4:
+            case 15:
+                allowed_privs = PMP_READ;
+                break;
+            case 3:
+            case 6:
+                allowed_privs = PMP_READ | PMP_WRITE;
+                break;
+            case 5:
+                allowed_privs = PMP_READ | PMP_EXEC;
+                break;
+            case 7:
+                allowed_privs = PMP_READ | PMP_WRITE | PMP_EXEC;
+                break;
+            default:
+                g_assert_not_reached();
+            }
+        }
+    }
+
+    return allowed_privs;
+}
 
 /*
- * Public Interface
+ * Lowest index of a rule that starts or ends just before @addr, or
+ * MAX_RISCV_PMPS if none does.
  */
+static int pmp_boundary_rule(CPURISCVState *env, target_ulong addr)
+{
+    int i;
+
+    for (i = 0; i < MAX_RISCV_PMPS; i++) {
+        if (env->pmp_state.addr[i].sa == addr ||
+            env->pmp_state.addr[i].ea + 1 == addr) {
+            return i;
+        }
+    }
+    return MAX_RISCV_PMPS;
+}
 
 /*
- * Check if the address has required RWX privs to complete desired operation
- * Return PMP rule index if a pmp rule match
- * Return MAX_RISCV_PMPS if default match
- * Return negtive value if no match
+ * Split the address space at the start and end of every rule, including
+ * the ones that are off (their range is still compared), and record the
+ * first matching rule of each piece.  Neighbouring pieces are merged when
+ * they have the same matching rule and no rule before it has a boundary
+ * between them, because then no access can tell them apart.
  */
-int pmp_hart_has_privs(CPURISCVState *env, target_ulong addr,
-    target_ulong size, pmp_priv_t privs, pmp_priv_t *allowed_privs,
-    target_ulong mode)
+static void pmp_build_decision_table(CPURISCVState *env)
 {
-    int i = 0;
-    int ret = -1;
-    int pmp_size = 0;
-    target_ulong s = 0;
-    target_ulong e = 0;
+    pmp_table_t *t = &env->pmp_state;
+    target_ulong bounds[MAX_RISCV_PMPS * 2 + 1];
+    int n = 0, num = 0;
+    int i, j;
 
-    /* Short cut if no rules */
-    if (0 == pmp_get_num_rules(env)) {
-        if (pmp_hart_has_privs_default(env, addr, size, privs,
-                                       allowed_privs, mode)) {
-            ret = MAX_RISCV_PMPS;
+    bounds[n++] = 0;
+    for (i = 0; i < MAX_RISCV_PMPS; i++) {
+        bounds[n++] = t->addr[i].sa;
+        if (t->addr[i].ea != (target_ulong)-1) {
+            bounds[n++] = t->addr[i].ea + 1;
         }
     }
 
-    if (size == 0) {
-        if (riscv_feature(env, RISCV_FEATURE_MMU)) {
-            /*
-             * If size is unknown (0), assume that all bytes
-             * from addr to the end of the page will be accessed.
-             */
-            pmp_size = -(addr | TARGET_PAGE_MASK);
+    /* Insertion sort, there are at most 33 of them */
+    for (i = 1; i < n; i++) {
+        target_ulong b = bounds[i];
+
+        for (j = i; j > 0 && bounds[j - 1] > b; j--) {
+            bounds[j] = bounds[j - 1];
+        }
+        bounds[j] = b;
+    }
+
+    for (i = 0; i < n; i++) {
+        pmp_interval_t *iv;
+        int rule = -1;
+
+        if (i > 0 && bounds[i] == bounds[i - 1]) {
+            continue;
+        }
+
+        /* Rules either cover the whole piece or none of it */
+        for (j = 0; j < MAX_RISCV_PMPS; j++) {
+            if (pmp_get_a_field(t->pmp[j].cfg_reg) != PMP_AMATCH_OFF &&
+                pmp_is_in_range(env, j, bounds[i])) {
+                rule = j;
+                break;
+            }
+        }
+
+        if (num > 0 && rule >= 0 && t->intervals[num - 1].rule == rule &&
+            pmp_boundary_rule(env, bounds[i]) > rule) {
+            continue;
+        }
+
+        iv = &t->intervals[num++];
+        iv->sa = bounds[i];
+        iv->rule = rule;
+        iv->privs[0] = rule >= 0 ? pmp_rule_privs(env, rule, PRV_S) : 0;
+        iv->privs[1] = rule >= 0 ? pmp_rule_privs(env, rule, PRV_M) : 0;
+    }
+
+    /* Without an access type, this gives what the default allows */
+    pmp_hart_has_privs_default(env, 0, 0, 0, &t->default_privs[0], PRV_S);
+    pmp_hart_has_privs_default(env, 0, 0, 0, &t->default_privs[1], PRV_M);
+
+    t->num_intervals = num;
+}
+
+/*
+ * Find the decision table interval containing @addr.
+ */
+static const pmp_interval_t *pmp_find_interval(CPURISCVState *env,
+                                               target_ulong addr,
+                                               target_ulong *ea)
+{
+    pmp_table_t *t = &env->pmp_state;
+    uint32_t lo = 0, hi;
+
+    if (t->num_intervals == 0) {
+        pmp_build_decision_table(env);
+    }
+
+    /* intervals[0].sa is 0, so the last one starting at or below addr */
+    hi = t->num_intervals;
+    while (hi - lo > 1) {
+        uint32_t mid = (lo + hi) / 2;
+
+        if (t->intervals[mid].sa <= addr) {
+            lo = mid;
         } else {
-            pmp_size = sizeof(target_ulong);
+            hi = mid;
         }
-    } else {
-        pmp_size = size;
     }
 
+    *ea = lo + 1 < t->num_intervals ? t->intervals[lo + 1].sa - 1 : -1;
+    return &t->intervals[lo];
+}
+
+/*
+ * Find the first rule that matches the access by scanning the rules; used
+ * when the access spans several intervals of the decision table.  Return -1
+ * if no rule matches, or if the first one that does matches only part of
+ * the access.
+ */
+static int pmp_find_rule_scan(CPURISCVState *env, target_ulong addr,
+                              target_ulong pmp_size)
+{
+    int i = 0;
+    int ret = -1;
+    target_ulong s = 0;
+    target_ulong e = 0;
+
     /* 1.10 draft priv spec states there is an implicit order
          from low to high */
     for (i = 0; i < MAX_RISCV_PMPS; i++) {
@@ -346,117 +536,77 @@ int pmp_hart_has_privs(CPURISCVState *env, target_ulong addr,
         const uint8_t a_field =
             pmp_get_a_field(env->pmp_state.pmp[i].cfg_reg);
 
-        /*
-         * Convert the PMP permissions to match the truth table in the
-         * ePMP spec.
-         */
-        const uint8_t epmp_operation =
-            ((env->pmp_state.pmp[i].cfg_reg & PMP_LOCK) >> 4) |
-            ((env->pmp_state.pmp[i].cfg_reg & PMP_READ) << 2) |
-            (env->pmp_state.pmp[i].cfg_reg & PMP_WRITE) |
-            ((env->pmp_state.pmp[i].cfg_reg & PMP_EXEC) >> 2);
-
         if (((s + e) == 2) && (PMP_AMATCH_OFF != a_field)) {
+            ret = i;
+            break;
+        }
+    }
+
+    return ret;
+}
+
+
+/*
+ * Public Interface
+ */
+
+/*
+ * Check if the address has required RWX privs to complete desired operation
+ * Return PMP rule index if a pmp rule match
+ * Return MAX_RISCV_PMPS if default match
+ * Return negtive value if no match
+ */
+int pmp_hart_has_privs(CPURISCVState *env, target_ulong addr,
+    target_ulong size, pmp_priv_t privs, pmp_priv_t *allowed_privs,
+    target_ulong mode)
+{
+    const pmp_interval_t *iv;
+    int rule;
+    target_ulong pmp_size = 0;
+    target_ulong ea;
+
+    if (size == 0) {
+        if (riscv_feature(env, RISCV_FEATURE_MMU)) {
             /*
-             * If the PMP entry is not off and the address is in range,
-             * do the priv check
+             * If size is unknown (0), assume that all bytes
+             * from addr to the end of the page will be accessed.
              */
-            if (!MSECCFG_MML_ISSET(env)) {
-                /*
-                 * If mseccfg.MML Bit is not set, do pmp priv check
-                 * This will always apply to regular PMP.
-                 */
-                *allowed_privs = PMP_READ | PMP_WRITE | PMP_EXEC;
-                if ((mode != PRV_M) || pmp_is_locked(env, i)) {
-                    *allowed_privs &= env->pmp_state.pmp[i].cfg_reg;
-                }
-            } else {
-                /*
-                 * If mseccfg.MML Bit set, do the enhanced pmp priv check
-                 */
-                if (mode == PRV_M) {
-                    switch (epmp_operation) {
-                    case 0:
-                    case 1:
-                    case 4:
-                    case 5:
-                    case 6:
-                    case 7:
-                    case 8:
-                        *allowed_privs = 0;
-                        break;
-                    case 2:
-                    case 3:
-                    case 14:
-                        *allowed_privs = PMP_READ | PMP_WRITE;
-                        break;
-                    case 9:
-                    case 10:
-                        *allowed_privs = PMP_EXEC;
-                        break;
-                    case 11:
-                    case 13:
-                        *allowed_privs = PMP_READ | PMP_EXEC;
-                        break;
-                    case 12:
-                    case 15:
-                        *allowed_privs = PMP_READ;
-                        break;
-                    default:
-                        g_assert_not_reached();
-                    }
-                } else {
-                    switch (epmp_operation) {
-                    case 0:
-                    case 8:
-                    case 9:
-                    case 12:
-                    case 13:
-                    case 14:
-                        *allowed_privs = 0;
-                        break;
-                    case 1:
-                    case 10:
-                    case 11:
-                        *allowed_privs = PMP_EXEC;
-                        break;
-                    case 2:
-                    case 4:
-                    case 15:
-                        *allowed_privs = PMP_READ;
-                        break;
-                    case 3:
-                    case 6:
-                        *allowed_privs = PMP_READ | PMP_WRITE;
-                        break;
-                    case 5:
-                        *allowed_privs = PMP_READ | PMP_EXEC;
-                        break;
-                    case 7:
-                        *allowed_privs = PMP_READ | PMP_WRITE | PMP_EXEC;
-                        break;
-                    default:
-                        g_assert_not_reached();
-                    }
-                }
-            }
+            pmp_size = -(addr | TARGET_PAGE_MASK);
+        } else {
+            pmp_size = sizeof(target_ulong);
+        }
+    } else {
+        pmp_size = size;
+    }
 
-            if ((privs & *allowed_privs) == privs) {
-                ret = i;
-            }
-            break;
+    iv = pmp_find_interval(env, addr, &ea);
+    if (addr + pmp_size - 1 >= addr && addr + pmp_size - 1 <= ea) {
+        rule = iv->rule;
+        if (rule >= 0) {
+            *allowed_privs = iv->privs[mode == PRV_M];
         }
+    } else {
+        rule = pmp_find_rule_scan(env, addr, pmp_size);
+        if (rule >= 0) {
+            *allowed_privs = pmp_rule_privs(env, rule, mode);
+        }
+    }
+
+    /*
+     * A matching rule decides on its own: the default must not grant what
+     * the rule denies, or locked rules would not restrict M-mode.
+     */
+    if (rule >= 0) {
+        return (privs & *allowed_privs) == privs ? rule : -1;
     }
 
     /* No rule matched */
-    if (ret == -1) {
-        if (pmp_hart_has_privs_default(env, addr, size, privs,
-                                       allowed_privs, mode)) {
-            ret = MAX_RISCV_PMPS;
-        }
+    if (pmp_hart_has_privs_default(env, addr, size, privs,
+                                   allowed_privs, mode)) {
+        return MAX_RISCV_PMPS;
     }
 
-    return ret;
+    return -1;
 }
 
 /*
@@ -580,6 +730,9 @@ void mseccfg_csr_write(CPURISCVState *env, target_ulong val)
     val |= (env->mseccfg & (MSECCFG_MMWP | MSECCFG_MML));
 
     env->mseccfg = val;
+
+    /* mseccfg.MML changes the privileges of the rules */
+    env->pmp_state.num_intervals = 0;
 }
 
 /*
@@ -592,28 +745,61 @@ target_ulong mseccfg_csr_read(CPURISCVState *env)
 }
 
 /*
- * Calculate the TLB size if the start address or the end address of
- * PMP entry is presented in the TLB page.
+ * Privileges that an access from mode gets in the interval iv, from its
+ * rule or from the default.
+ */
+static pmp_priv_t pmp_interval_privs(CPURISCVState *env,
+                                     const pmp_interval_t *iv,
+                                     target_ulong mode)
+{
+    if (iv->rule >= 0) {
+        return iv->privs[mode == PRV_M];
+    }
+    return env->pmp_state.default_privs[mode == PRV_M];
+}
+
+/*
+ * Calculate the TLB size for the page containing addr, after an access from
+ * mode was granted privs.  The whole page can be mapped if every interval of
+ * the decision table that overlaps it grants mode exactly privs.  If there
+ * is more than one, privs must also be no more than what the default
+ * allows: an access that straddles two intervals may match a rule only in
+ * part, and then falls back to the default.
  */
-target_ulong pmp_get_tlb_size(CPURISCVState *env, int pmp_index,
-                              target_ulong tlb_sa, target_ulong tlb_ea)
+target_ulong pmp_get_tlb_size(CPURISCVState *env, target_ulong addr,
+                              pmp_priv_t privs, target_ulong mode)
 {
-    target_ulong pmp_sa = env->pmp_state.addr[pmp_index].sa;
-    target_ulong pmp_ea = env->pmp_state.addr[pmp_index].ea;
+    const pmp_table_t *t = &env->pmp_state;
+    target_ulong tlb_sa = addr & ~(TARGET_PAGE_SIZE - 1);
+    target_ulong tlb_ea = tlb_sa + TARGET_PAGE_SIZE - 1;
+    const pmp_interval_t *iv, *end;
+    target_ulong ea;
 
-    if (pmp_sa <= tlb_sa && pmp_ea >= tlb_ea) {
+    /*
+     * If the size is less then TARGET_PAGE_SIZE we drop the size to 1.
+     * This means the result isn't cached in the TLB and is only used for
+     * a single translation.
+     */
+    iv = pmp_find_interval(env, tlb_sa, &ea);
+    if (pmp_interval_privs(env, iv, mode) != privs) {
+        return 1;
+    }
+    if (ea >= tlb_ea) {
         return TARGET_PAGE_SIZE;
-    } else {
-        /*
-        * At this point we have a tlb_size that is the smallest possible size
-        * That fits within a TARGET_PAGE_SIZE and the PMP region.
-        *
-        * If the size is less then TARGET_PAGE_SIZE we drop the size to 1.
-        * This means the result isn't cached in the TLB and is only used for
-        * a single translation.
-        */
+    }
+    if (privs & ~t->default_privs[mode == PRV_M]) {
         return 1;
     }
+
+    end = &t->intervals[t->num_intervals];
+    while (ea < tlb_ea) {
+        iv++;
+        ea = iv + 1 < end ? iv[1].sa - 1 : -1;
+        if (pmp_interval_privs(env, iv, mode) != privs) {
+            return 1;
+        }
+    }
+    return TARGET_PAGE_SIZE;
 }
 
 /*
@@ -56,10 +56,25 @@ typedef struct {
     target_ulong ea;
 } pmp_addr_t;
 
+/*
+ * One interval of the decision table.  Every access that stays within an
+ * interval gets the same result from the rules, so it can be looked up
+ * instead of scanning them.  The interval ends where the next one starts.
+ */
+typedef struct {
+    target_ulong sa;
+    int rule;               /* First matching rule, -1 if none */
+    pmp_priv_t privs[2];    /* Privileges of @rule, indexed by mode == PRV_M */
+} pmp_interval_t;
+
 typedef struct {
     pmp_entry_t pmp[MAX_RISCV_PMPS];
     pmp_addr_t  addr[MAX_RISCV_PMPS];
     uint32_t num_rules;
+    /* Sorted decision table, rebuilt on demand when num_intervals is 0 */
+    pmp_interval_t intervals[MAX_RISCV_PMPS * 2 + 1];
+    uint32_t num_intervals;
+    pmp_priv_t default_privs[2];    /* Indexed by mode == PRV_M */
 } pmp_table_t;
 
 void pmpcfg_csr_write(CPURISCVState *env, uint32_t reg_index,
@@ -75,8 +90,8 @@ target_ulong pmpaddr_csr_read(CPURISCVState *env, uint32_t addr_index);
 int pmp_hart_has_privs(CPURISCVState *env, target_ulong addr,
     target_ulong size, pmp_priv_t privs, pmp_priv_t *allowed_privs,
     target_ulong mode);
-target_ulong pmp_get_tlb_size(CPURISCVState *env, int pmp_index,
-                              target_ulong tlb_sa, target_ulong tlb_ea);
+target_ulong pmp_get_tlb_size(CPURISCVState *env, target_ulong addr,
+                              pmp_priv_t privs, target_ulong mode);
 void pmp_update_rule_addr(CPURISCVState *env, uint32_t pmp_index);
 void pmp_update_rule_nums(CPURISCVState *env);
 uint32_t pmp_get_num_rules(CPURISCVState *env);
@@ -74,6 +74,16 @@ typedef struct TCGHelperInfo {
     unsigned nr_out             : 8;
     TCGCallReturnKind out_kind  : 8;
 
+    /* Optional expansion of the helper into TCG ops. */
+    TCGHelperInlineFn inline_gen;
+
+#ifdef CONFIG_PROFILER
+    /* Calls emitted, calls expanded inline, and calls executed. */
+    uint64_t gen_count;
+    uint64_t inline_count;
+    uint64_t exec_count;
+#endif
+
     /* Maximum physical arguments are constrained by TCG_TYPE_I128. */
     TCGCallArgumentLoc in[MAX_CALL_IARGS * (128 / TCG_TARGET_REG_BITS)];
 } TCGHelperInfo;
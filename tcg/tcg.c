@@ -1809,15 +1809,50 @@ bool tcg_op_supported(TCGOpcode op)
 
 static TCGOp *tcg_op_alloc(TCGOpcode opc, unsigned nargs);
 
+void tcg_register_helper_inline(void *func, TCGHelperInlineFn gen)
+{
+    TCGHelperInfo *info = g_hash_table_lookup(helper_table, (gpointer)func);
+
+    tcg_debug_assert(info != NULL);
+    tcg_debug_assert(info->flags & TCG_CALL_NO_READ_GLOBALS);
+    info->inline_gen = gen;
+}
+
 void tcg_gen_callN(void *func, TCGTemp *ret, int nargs, TCGTemp **args)
 {
-    const TCGHelperInfo *info;
+    TCGHelperInfo *info;
     TCGv_i64 extend_free[MAX_CALL_IARGS];
     int n_extend = 0;
     TCGOp *op;
     int i, n, pi = 0, total_args;
 
     info = g_hash_table_lookup(helper_table, (gpointer)func);
+
+    if (info->inline_gen && info->inline_gen(ret, args)) {
+#ifdef CONFIG_PROFILER
+        qatomic_set(&info->inline_count, info->inline_count + 1);
+#endif
+        return;
+    }
+
+#ifdef CONFIG_PROFILER
+    qatomic_set(&info->gen_count, info->gen_count + 1);
+    /* plugin-gen.c expects its callback calls to be emitted unadorned */
+    if (!(info->flags & TCG_CALL_PLUGIN)) {
+        /*
+         * Count executions with a plain load/add/store: concurrent vCPUs
+         * may lose the odd increment, which is fine for finding hot spots.
+         */
+        TCGv_ptr cnt = tcg_constant_ptr(&info->exec_count);
+        TCGv_i64 t = tcg_temp_new_i64();
+
+        tcg_gen_ld_i64(t, cnt, 0);
+        tcg_gen_addi_i64(t, t, 1);
+        tcg_gen_st_i64(t, cnt, 0);
+        tcg_temp_free_i64(t);
+    }
+#endif
+
     total_args = info->nr_out + info->nr_in + 2;
     op = tcg_op_alloc(INDEX_op_call, total_args);
 
@@ -4759,6 +4794,48 @@ static void tcg_profile_snapshot_table(TCGProfile *prof)
     tcg_profile_snapshot(prof, false, true);
 }
 
+static gint tcg_helper_exec_count_cmp(gconstpointer a, gconstpointer b)
+{
+    const TCGHelperInfo *ia = *(const TCGHelperInfo **)a;
+    const TCGHelperInfo *ib = *(const TCGHelperInfo **)b;
+    uint64_t ca = qatomic_read(&ia->exec_count);
+    uint64_t cb = qatomic_read(&ib->exec_count);
+
+    return ca < cb ? 1 : ca > cb ? -1 : 0;
+}
+
+/*
+ * Helpers sorted by how often their calls ran, hottest first: these
+ * are the candidates for tcg_register_helper_inline().
+ */
+static void tcg_dump_helper_count(GString *buf)
+{
+    g_autoptr(GPtrArray) helpers = g_ptr_array_new();
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(all_helpers); i++) {
+        TCGHelperInfo *info = &all_helpers[i];
+
+        if (qatomic_read(&info->gen_count) ||
+            qatomic_read(&info->inline_count)) {
+            g_ptr_array_add(helpers, info);
+        }
+    }
+    g_ptr_array_sort(helpers, tcg_helper_exec_count_cmp);
+
+    g_string_append_printf(buf, "\n%-32s %16s %10s %10s\n",
+                           "helper", "executed", "emitted", "inlined");
+    for (i = 0; i < helpers->len; i++) {
+        TCGHelperInfo *info = g_ptr_array_index(helpers, i);
+
+        g_string_append_printf(buf, "%-32s %16" PRIu64 " %10" PRIu64
+                               " %10" PRIu64 "\n", info->name,
+                               qatomic_read(&info->exec_count),
+                               qatomic_read(&info->gen_count),
+                               qatomic_read(&info->inline_count));
+    }
+}
+
 void tcg_dump_op_count(GString *buf)
 {
     TCGProfile prof = {};
@@ -4769,6 +4846,7 @@ void tcg_dump_op_count(GString *buf)
         g_string_append_printf(buf, "%s %" PRId64 "\n", tcg_op_defs[i].name,
                                prof.table_op_count[i]);
     }
+    tcg_dump_helper_count(buf);
 }
 
 int64_t tcg_cpu_exec_time(void)
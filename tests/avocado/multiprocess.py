@@ -19,7 +19,7 @@ class Multiprocess(QemuSystemTest):
     KERNEL_COMMON_COMMAND_LINE = 'printk.time=0 '
 
     def do_test(self, kernel_url, initrd_url, kernel_command_line,
-                machine_type):
+                machine_type, proxy_opts=''):
         """Main test method"""
         self.require_accelerator('kvm')
 
@@ -55,7 +55,7 @@ def do_test(self, kernel_url, initrd_url, kernel_command_line,
                          '-append', kernel_command_line)
         self.vm.add_args('-device',
                          'x-pci-proxy-dev,'
-                         'id=lsi1,fd='+str(proxy_sock.fileno()))
+                         'id=lsi1,fd='+str(proxy_sock.fileno())+proxy_opts)
         self.vm.launch()
         wait_for_console_pattern(self, 'as init process',
                                  'Kernel panic - not syncing')
@@ -64,6 +64,16 @@ def do_test(self, kernel_url, initrd_url, kernel_command_line,
                                           'cat /sys/bus/pci/devices/*/uevent',
                                           'PCI_ID=1000:0012')
 
+    def read_lsi_scntl0(self):
+        """Read SCNTL0 through the I/O BAR, which is 0xc0 after reset"""
+        exec_command(self, 'cd $(grep -l PCI_ID=1000:0012 '
+                           '/sys/bus/pci/devices/*/uevent | xargs dirname)')
+        exec_command(self, 'echo 1 > enable')
+        exec_command_and_wait_for_pattern(self,
+            'echo SCNTL0=$(dd if=resource0 bs=1 count=1 2>/dev/null | '
+            'od -An -tx1 | tr -d " ")',
+            'SCNTL0=c0')
+
     def test_multiprocess_x86_64(self):
         """
         :avocado: tags=arch:x86_64
@@ -79,6 +89,24 @@ def test_multiprocess_x86_64(self):
         machine_type = 'pc'
         self.do_test(kernel_url, initrd_url, kernel_command_line, machine_type)
 
+    def test_multiprocess_x86_64_shm_ring(self):
+        """
+        :avocado: tags=arch:x86_64
+        """
+        kernel_url = ('https://archives.fedoraproject.org/pub/archive/fedora'
+                      '/linux/releases/31/Everything/x86_64/os/images'
+                      '/pxeboot/vmlinuz')
+        initrd_url = ('https://archives.fedoraproject.org/pub/archive/fedora'
+                      '/linux/releases/31/Everything/x86_64/os/images'
+                      '/pxeboot/initrd.img')
+        kernel_command_line = (self.KERNEL_COMMON_COMMAND_LINE +
+                               'console=ttyS0 rdinit=/bin/bash')
+        machine_type = 'pc'
+        self.do_test(kernel_url, initrd_url, kernel_command_line, machine_type,
+                     ',x-shm-ring=on')
+        # BAR accesses now go through the ring
+        self.read_lsi_scntl0()
+
     def test_multiprocess_aarch64(self):
         """
         :avocado: tags=arch:aarch64
@@ -0,0 +1,153 @@
+/*
+ * Benchmark for the bitmap search and population count functions
+ *
+ * The bitmaps mimic migration dirty bitmaps, with one bit per page of
+ * guest RAM: "sparse" has few dirty pages, "dense" has few clean ones.
+ * The rare bits of each pattern are walked with find_next_bit() or
+ * find_next_zero_bit(), and all bits are counted with bitmap_count_one(),
+ * once for every implementation that the host supports.
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bitmap.h"
+#include "qemu/timer.h"
+
+static unsigned long nbits = 1UL << 28;  /* 1 TiB of 4 KiB pages */
+static unsigned long stride = 100000;
+static unsigned int repeat = 4;
+
+static const char commands_string[] =
+    " -n = number of bits in the bitmap\n"
+    " -s = average distance between the rare bits of each pattern\n"
+    " -r = number of repetitions";
+
+static void usage_complete(char *argv[])
+{
+    fprintf(stderr, "Usage: %s [options]\n", argv[0]);
+    fprintf(stderr, "options:\n%s\n", commands_string);
+}
+
+static uint64_t xorshift64star(uint64_t x)
+{
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    return x * UINT64_C(2685821657736338717);
+}
+
+/* Fill @bmap with @fill, and flip about one bit every @stride bits */
+static void init_pattern(unsigned long *bmap, bool fill)
+{
+    uint64_t r = 1;
+    unsigned long bit = 0;
+
+    if (fill) {
+        bitmap_fill(bmap, nbits);
+    } else {
+        bitmap_zero(bmap, nbits);
+    }
+
+    for (;;) {
+        r = xorshift64star(r);
+        bit += 1 + r % (2 * stride);
+        if (bit >= nbits) {
+            break;
+        }
+        change_bit(bit, bmap);
+    }
+}
+
+static void report(const char *pattern, int accel, const char *op,
+                   int64_t ns, unsigned long result)
+{
+    printf("%-7s accel %d  %-19s %8.3f ms  (%.2f GB/s, result %lu)\n",
+           pattern, accel, op, ns / 1e6 / repeat,
+           (double)nbits / 8 * repeat / ns, result);
+}
+
+/*
+ * Walk the rare bits of the pattern, i.e. the set bits of a sparse bitmap
+ * or the clear bits of a dense one, and count the set bits.
+ */
+static void bench_pattern(const char *pattern, unsigned long *bmap,
+                          bool dense, int accel)
+{
+    unsigned long (*find)(const unsigned long *, unsigned long,
+                          unsigned long);
+    unsigned long bit, result = 0;
+    int64_t start;
+    unsigned int i;
+
+    find = dense ? find_next_zero_bit : find_next_bit;
+    start = get_clock();
+    for (i = 0; i < repeat; i++) {
+        result = 0;
+        for (bit = find(bmap, nbits, 0); bit < nbits;
+             bit = find(bmap, nbits, bit + 1)) {
+            result++;
+        }
+    }
+    report(pattern, accel, dense ? "find_next_zero_bit" : "find_next_bit",
+           get_clock() - start, result);
+
+    start = get_clock();
+    for (i = 0; i < repeat; i++) {
+        result = bitmap_count_one(bmap, nbits);
+    }
+    report(pattern, accel, "bitmap_count_one", get_clock() - start, result);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long *sparse, *dense;
+    int accel = 0;
+    int c;
+
+    for (;;) {
+        c = getopt(argc, argv, "hn:s:r:");
+        if (c < 0) {
+            break;
+        }
+        switch (c) {
+        case 'h':
+            usage_complete(argv);
+            return EXIT_SUCCESS;
+        case 'n':
+            nbits = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            stride = strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            repeat = atoi(optarg);
+            break;
+        default:
+            usage_complete(argv);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!nbits || !stride || !repeat) {
+        usage_complete(argv);
+        return EXIT_FAILURE;
+    }
+
+    sparse = bitmap_new(nbits);
+    dense = bitmap_new(nbits);
+    init_pattern(sparse, false);
+    init_pattern(dense, true);
+
+    /* Accelerator 0 is the best one, the last one is plain C */
+    do {
+        bench_pattern("sparse", sparse, false, accel);
+        bench_pattern("dense", dense, true, accel);
+        accel++;
+    } while (test_bitops_next_accel());
+
+    g_free(sparse);
+    g_free(dense);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,187 @@
+/*
+ * Benchmark for draining a block graph with many nodes under load
+ *
+ * Every node is a null-co node with some latency, attached to its own
+ * BlockBackend that always has a few reads in flight.  The benchmark
+ * measures how long bdrv_drain_all_begin() takes while all these requests
+ * are running, which is what a QMP transaction or stopping the VM would
+ * see on a guest with many disks.
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "block/block.h"
+#include "sysemu/block-backend.h"
+#include "qapi/error.h"
+#include "qapi/qmp/qdict.h"
+#include "qemu/main-loop.h"
+#include "qemu/timer.h"
+
+static unsigned int n_nodes = 500;
+static unsigned int queue_depth = 4;
+static int64_t latency_ns = 1000000;
+static unsigned int iterations = 100;
+static int64_t run_ns = 10000000;
+
+typedef struct BenchDisk {
+    BlockBackend *blk;
+    uint64_t completed;
+} BenchDisk;
+
+static BenchDisk *disks;
+static bool stopping;
+static char buf[4096];
+static QEMUIOVector qiov;
+
+static const char commands_string[] =
+    " -n = number of nodes\n"
+    " -q = requests in flight per node\n"
+    " -l = latency of each request in ns\n"
+    " -i = number of drains\n"
+    " -r = time to run the requests between drains in ns";
+
+static void usage_complete(char *argv[])
+{
+    fprintf(stderr, "Usage: %s [options]\n", argv[0]);
+    fprintf(stderr, "options:\n%s\n", commands_string);
+}
+
+static void read_cb(void *opaque, int ret)
+{
+    BenchDisk *d = opaque;
+
+    assert(ret == 0);
+    d->completed++;
+    if (!stopping) {
+        blk_aio_preadv(d->blk, 0, &qiov, 0, read_cb, d);
+    }
+}
+
+static void create_disks(void)
+{
+    unsigned int i, j;
+
+    disks = g_new0(BenchDisk, n_nodes);
+    for (i = 0; i < n_nodes; i++) {
+        QDict *opts = qdict_new();
+        BlockDriverState *bs;
+
+        qdict_put_int(opts, "latency-ns", latency_ns);
+        bs = bdrv_open("null-co://", NULL, opts,
+                       BDRV_O_RDWR | BDRV_O_PROTOCOL, &error_abort);
+
+        disks[i].blk = blk_new(qemu_get_aio_context(),
+                               BLK_PERM_ALL, BLK_PERM_ALL);
+        blk_insert_bs(disks[i].blk, bs, &error_abort);
+        bdrv_unref(bs);
+
+        for (j = 0; j < queue_depth; j++) {
+            blk_aio_preadv(disks[i].blk, 0, &qiov, 0, read_cb, &disks[i]);
+        }
+    }
+}
+
+static void destroy_disks(void)
+{
+    unsigned int i;
+
+    stopping = true;
+    bdrv_drain_all();
+
+    for (i = 0; i < n_nodes; i++) {
+        blk_unref(disks[i].blk);
+    }
+    g_free(disks);
+}
+
+static uint64_t total_completed(void)
+{
+    uint64_t completed = 0;
+    unsigned int i;
+
+    for (i = 0; i < n_nodes; i++) {
+        completed += disks[i].completed;
+    }
+    return completed;
+}
+
+static void run_requests(int64_t ns)
+{
+    int64_t deadline = get_clock() + ns;
+
+    while (get_clock() < deadline) {
+        main_loop_wait(false);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int64_t drain_ns = 0, max_drain_ns = 0, start;
+    uint64_t completed;
+    unsigned int i;
+    int c;
+
+    for (;;) {
+        c = getopt(argc, argv, "hn:q:l:i:r:");
+        if (c < 0) {
+            break;
+        }
+        switch (c) {
+        case 'h':
+            usage_complete(argv);
+            return EXIT_SUCCESS;
+        case 'n':
+            n_nodes = atoi(optarg);
+            break;
+        case 'q':
+            queue_depth = atoi(optarg);
+            break;
+        case 'l':
+            latency_ns = atoll(optarg);
+            break;
+        case 'i':
+            iterations = atoi(optarg);
+            break;
+        case 'r':
+            run_ns = atoll(optarg);
+            break;
+        default:
+            usage_complete(argv);
+            return EXIT_FAILURE;
+        }
+    }
+
+    qemu_init_main_loop(&error_abort);
+    bdrv_init();
+    qemu_iovec_init_buf(&qiov, buf, sizeof(buf));
+
+    create_disks();
+    run_requests(run_ns);
+
+    completed = total_completed();
+    for (i = 0; i < iterations; i++) {
+        int64_t ns;
+
+        run_requests(run_ns);
+
+        start = get_clock();
+        bdrv_drain_all_begin();
+        ns = get_clock() - start;
+        bdrv_drain_all_end();
+
+        drain_ns += ns;
+        max_drain_ns = MAX(max_drain_ns, ns);
+    }
+    completed = total_completed() - completed;
+
+    printf("%u nodes, %u requests in flight per node, %" PRId64 " ns latency\n",
+           n_nodes, queue_depth, latency_ns);
+    printf("drain_all_begin: %.3f ms average, %.3f ms max over %u drains\n",
+           drain_ns / 1e6 / iterations, max_drain_ns / 1e6, iterations);
+    printf("%" PRIu64 " requests completed\n", completed);
+
+    destroy_disks();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,162 @@
+/*
+ * IPI ping-pong benchmark, to be run inside a Linux guest
+ *
+ * Two threads pinned to different vCPUs hand a token back and forth
+ * through a futex.  The waiting side sleeps in the kernel, so every
+ * hand-off is a wakeup of an idle vCPU by a reschedule IPI, which makes
+ * the round-trip time a good proxy for guest IPI latency.  With -m, each
+ * round trip instead issues an expedited membarrier, which IPIs every
+ * vCPU currently running a thread of the process, as TLB shootdowns do.
+ *
+ * Build statically with the guest's compiler, e.g.:
+ *   cc -O2 -static -pthread -o ipi-pingpong ipi-pingpong.c
+ *
+ * Usage: ipi-pingpong [-m] [-n ITERATIONS] [CPU_A CPU_B]
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <linux/futex.h>
+#include <linux/membarrier.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+static unsigned long iterations = 100000;
+static int cpu_a, cpu_b = 1;
+static int use_membarrier;
+static volatile int token;
+static volatile int spin_stop;
+
+static void futex_wait(volatile int *addr, int val)
+{
+    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+}
+
+static void futex_wake(volatile int *addr)
+{
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+static void pin(int cpu)
+{
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set)) {
+        perror("sched_setaffinity");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* Wait until the token becomes @val, then pass it on as @next. */
+static void hand_off(int val, int next)
+{
+    while (__atomic_load_n(&token, __ATOMIC_ACQUIRE) != val) {
+        futex_wait(&token, val ^ 1);
+    }
+    __atomic_store_n(&token, next, __ATOMIC_RELEASE);
+    futex_wake(&token);
+}
+
+static void *pong_thread(void *opaque)
+{
+    unsigned long i;
+
+    pin(cpu_b);
+    for (i = 0; i < iterations; i++) {
+        hand_off(1, 0);
+    }
+    return NULL;
+}
+
+/* Keeps the other vCPU busy in this process, so membarrier targets it. */
+static void *spin_thread(void *opaque)
+{
+    pin(cpu_b);
+    while (!__atomic_load_n(&spin_stop, __ATOMIC_RELAXED)) {
+        /* nothing */
+    }
+    return NULL;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-m] [-n ITERATIONS] [CPU_A CPU_B]\n", prog);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv)
+{
+    pthread_t thread;
+    unsigned long i;
+    uint64_t t0, t1;
+    int c;
+
+    while ((c = getopt(argc, argv, "mn:")) != -1) {
+        switch (c) {
+        case 'm':
+            use_membarrier = 1;
+            break;
+        case 'n':
+            iterations = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (argc - optind == 2) {
+        cpu_a = atoi(argv[optind]);
+        cpu_b = atoi(argv[optind + 1]);
+    } else if (argc != optind) {
+        usage(argv[0]);
+    }
+
+    pin(cpu_a);
+
+    if (use_membarrier) {
+        if (syscall(SYS_membarrier,
+                    MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0)) {
+            perror("membarrier");
+            return EXIT_FAILURE;
+        }
+        pthread_create(&thread, NULL, spin_thread, NULL);
+        t0 = now_ns();
+        for (i = 0; i < iterations; i++) {
+            syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0);
+        }
+        t1 = now_ns();
+        __atomic_store_n(&spin_stop, 1, __ATOMIC_RELAXED);
+    } else {
+        pthread_create(&thread, NULL, pong_thread, NULL);
+        t0 = now_ns();
+        for (i = 0; i < iterations; i++) {
+            hand_off(0, 1);
+        }
+        hand_off(0, 0);
+        t1 = now_ns();
+    }
+    pthread_join(thread, NULL);
+
+    printf("%s: %lu round trips between CPU %d and %d, %.2f us each\n",
+           use_membarrier ? "membarrier" : "futex", iterations, cpu_a, cpu_b,
+           (t1 - t0) / 1000.0 / iterations);
+    return EXIT_SUCCESS;
+}
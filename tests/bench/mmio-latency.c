@@ -0,0 +1,108 @@
+/*
+ * MMIO latency benchmark, to be run inside a Linux guest
+ *
+ * Maps a PCI memory BAR through its sysfs resource file and times 32-bit
+ * reads (or, with -w, writes) of one register.  Reads always wait for the
+ * device model, so they measure the round trip to it; writes show the
+ * benefit of posting them, e.g. for a device emulated in a remote process
+ * behind x-pci-proxy-dev.  Pick a register that is harmless to access.
+ *
+ * Build statically with the guest's compiler, e.g.:
+ *   cc -O2 -static -o mmio-latency mmio-latency.c
+ *
+ * Usage: mmio-latency [-w] [-n ITERATIONS] RESOURCE [OFFSET]
+ *   e.g. mmio-latency /sys/bus/pci/devices/0000:00:04.0/resource1 0x10
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static unsigned long iterations = 100000;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-w] [-n ITERATIONS] RESOURCE [OFFSET]\n",
+            prog);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv)
+{
+    volatile uint32_t *reg;
+    unsigned long offset = 0, i;
+    uint64_t t0, t1;
+    struct stat st;
+    int write = 0;
+    uint32_t val;
+    void *bar;
+    int c, fd;
+
+    while ((c = getopt(argc, argv, "wn:")) != -1) {
+        switch (c) {
+        case 'w':
+            write = 1;
+            break;
+        case 'n':
+            iterations = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (argc - optind == 2) {
+        offset = strtoul(argv[optind + 1], NULL, 0);
+    } else if (argc - optind != 1) {
+        usage(argv[0]);
+    }
+
+    fd = open(argv[optind], O_RDWR | O_SYNC);
+    if (fd < 0 || fstat(fd, &st)) {
+        perror(argv[optind]);
+        return EXIT_FAILURE;
+    }
+    if (offset & 3 || offset + 4 > st.st_size) {
+        fprintf(stderr, "Invalid offset 0x%lx\n", offset);
+        return EXIT_FAILURE;
+    }
+
+    bar = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (bar == MAP_FAILED) {
+        perror("mmap");
+        return EXIT_FAILURE;
+    }
+    reg = (volatile uint32_t *)((char *)bar + offset);
+
+    val = *reg;
+    t0 = now_ns();
+    for (i = 0; i < iterations; i++) {
+        if (write) {
+            *reg = val;
+        } else {
+            val = *reg;
+        }
+    }
+    /* Wait for posted writes to complete */
+    val = *reg;
+    t1 = now_ns();
+
+    printf("%s: %lu accesses at offset 0x%lx, %.2f us each\n",
+           write ? "write" : "read", iterations, offset,
+           (t1 - t0) / 1000.0 / iterations);
+    return EXIT_SUCCESS;
+}
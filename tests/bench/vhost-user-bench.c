@@ -0,0 +1,303 @@
+/*
+ * vhost-user loopback benchmark for libvhost-user virtqueue processing
+ *
+ * The benchmark plays both sides of a vhost-user connection in a single
+ * thread: it configures a libvhost-user device over a socketpair like a
+ * vhost-user master would, and then acts as the driver of a split
+ * virtqueue in shared memory while the device pops and pushes elements.
+ * This measures the cost of the libvhost-user element handling alone,
+ * without any guest or I/O involved.
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include <sys/eventfd.h>
+#include "qapi/error.h"
+#include "qemu/bswap.h"
+#include "qemu/memfd.h"
+#include "qemu/timer.h"
+#include "libvhost-user.h"
+
+#define MEM_SIZE        (16 * 1024 * 1024)
+#define DESC_OFFSET     0
+#define AVAIL_OFFSET    (64 * 1024)
+#define USED_OFFSET     (128 * 1024)
+#define BUF_OFFSET      (1024 * 1024)
+#define BUF_SIZE        512
+
+static unsigned int queue_size = 256;
+static unsigned int nsg = 3;
+static unsigned int batch = 32;
+static unsigned long requests = 10000000;
+
+static VuDev dev;
+static int master_fd;
+static void *mem;
+
+static void bench_panic(VuDev *d, const char *err)
+{
+    fprintf(stderr, "libvhost-user panic: %s\n", err);
+    exit(EXIT_FAILURE);
+}
+
+static void bench_set_watch(VuDev *d, int fd, int condition,
+                            vu_watch_cb cb, void *data)
+{
+}
+
+static void bench_remove_watch(VuDev *d, int fd)
+{
+}
+
+static void bench_queue_handler(VuDev *d, int qidx)
+{
+}
+
+static void bench_queue_set_started(VuDev *d, int qidx, bool started)
+{
+    vu_set_queue_handler(d, vu_get_queue(d, qidx),
+                         started ? bench_queue_handler : NULL);
+}
+
+static const VuDevIface bench_iface = {
+    .queue_set_started = bench_queue_set_started,
+};
+
+/* Send one message as the master, and let the device process it */
+static void send_msg(int request, const void *payload, size_t size, int fd)
+{
+    VhostUserMsg msg = {
+        .request = request,
+        .flags = 0x1,
+        .size = size,
+    };
+    char control[CMSG_SPACE(sizeof(int))] = {};
+    struct iovec iov = {
+        .iov_base = &msg,
+        .iov_len = VHOST_USER_HDR_SIZE + size,
+    };
+    struct msghdr mh = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+    };
+
+    memcpy(&msg.payload, payload, size);
+    if (fd >= 0) {
+        struct cmsghdr *cmsg;
+
+        mh.msg_control = control;
+        mh.msg_controllen = sizeof(control);
+        cmsg = CMSG_FIRSTHDR(&mh);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+
+    if (sendmsg(master_fd, &mh, 0) < 0) {
+        perror("sendmsg");
+        exit(EXIT_FAILURE);
+    }
+    if (!vu_dispatch(&dev)) {
+        fprintf(stderr, "vu_dispatch failed for request %d\n", request);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void setup(void)
+{
+    uint64_t features = 1ULL << VIRTIO_F_VERSION_1 |
+                        1ULL << VIRTIO_RING_F_EVENT_IDX;
+    VhostUserMemory memory = {
+        .nregions = 1,
+        .regions[0] = {
+            .guest_phys_addr = 0,
+            .memory_size = MEM_SIZE,
+            .mmap_offset = 0,
+        },
+    };
+    struct vhost_vring_state num = { .index = 0, .num = queue_size };
+    struct vhost_vring_state base = { .index = 0, .num = 0 };
+    struct vhost_vring_addr addr = { .index = 0 };
+    uint64_t vring_idx = 0;
+    int sv[2];
+    int memfd;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+        perror("socketpair");
+        exit(EXIT_FAILURE);
+    }
+    master_fd = sv[0];
+
+    mem = qemu_memfd_alloc("vhost-user-bench", MEM_SIZE, 0, &memfd,
+                           &error_fatal);
+
+    if (!vu_init(&dev, 1, sv[1], bench_panic, NULL, bench_set_watch,
+                 bench_remove_watch, &bench_iface)) {
+        fprintf(stderr, "vu_init failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    memory.regions[0].userspace_addr = (uintptr_t)mem;
+    addr.desc_user_addr = (uintptr_t)mem + DESC_OFFSET;
+    addr.avail_user_addr = (uintptr_t)mem + AVAIL_OFFSET;
+    addr.used_user_addr = (uintptr_t)mem + USED_OFFSET;
+
+    send_msg(VHOST_USER_SET_FEATURES, &features, sizeof(features), -1);
+    send_msg(VHOST_USER_SET_MEM_TABLE, &memory, sizeof(memory), memfd);
+    send_msg(VHOST_USER_SET_VRING_NUM, &num, sizeof(num), -1);
+    send_msg(VHOST_USER_SET_VRING_BASE, &base, sizeof(base), -1);
+    send_msg(VHOST_USER_SET_VRING_ADDR, &addr, sizeof(addr), -1);
+    send_msg(VHOST_USER_SET_VRING_KICK, &vring_idx, sizeof(vring_idx),
+             eventfd(0, EFD_CLOEXEC));
+    send_msg(VHOST_USER_SET_VRING_CALL, &vring_idx, sizeof(vring_idx),
+             eventfd(0, EFD_CLOEXEC));
+    close(memfd);
+}
+
+/* Build @batch descriptor chains of @nsg buffers, like virtio-blk requests */
+static void init_ring(void)
+{
+    struct vring_desc *desc = mem + DESC_OFFSET;
+    unsigned int i, j;
+
+    memset(mem, 0, BUF_OFFSET);
+    for (i = 0; i < batch; i++) {
+        for (j = 0; j < nsg; j++) {
+            unsigned int d = i * nsg + j;
+            uint16_t flags = j < nsg - 1 ? VRING_DESC_F_NEXT : 0;
+
+            if (j == nsg - 1) {
+                flags |= VRING_DESC_F_WRITE;
+            }
+            desc[d].addr = cpu_to_le64(BUF_OFFSET + d * BUF_SIZE);
+            desc[d].len = cpu_to_le32(BUF_SIZE);
+            desc[d].flags = cpu_to_le16(flags);
+            desc[d].next = cpu_to_le16(d + 1);
+        }
+    }
+}
+
+static void run(const char *name, bool use_batch)
+{
+    struct vring_avail *avail = mem + AVAIL_OFFSET;
+    struct vring_used *used = mem + USED_OFFSET;
+    VuVirtq *vq = vu_get_queue(&dev, 0);
+    void *elems[VIRTQUEUE_MAX_SIZE];
+    uint16_t avail_idx = le16_to_cpu(avail->idx);
+    uint16_t used_idx = le16_to_cpu(used->idx);
+    unsigned long done = 0;
+    int64_t start, ns;
+    unsigned int i, n;
+
+    if (use_batch) {
+        vu_queue_set_elem_pool(vq, sizeof(VuVirtqElement), nsg, batch);
+    }
+
+    start = get_clock();
+    while (done < requests) {
+        /* Driver: make a batch of requests available */
+        for (i = 0; i < batch; i++) {
+            avail->ring[avail_idx++ % queue_size] = cpu_to_le16(i * nsg);
+        }
+        smp_wmb();
+        avail->idx = cpu_to_le16(avail_idx);
+
+        /* Device: process them */
+        if (use_batch) {
+            n = vu_queue_pop_batch(&dev, vq, sizeof(VuVirtqElement),
+                                   elems, batch);
+            for (i = 0; i < n; i++) {
+                vu_queue_fill(&dev, vq, elems[i], BUF_SIZE, i);
+            }
+            vu_queue_flush(&dev, vq, n);
+            for (i = 0; i < n; i++) {
+                vu_queue_elem_free(vq, elems[i]);
+            }
+        } else {
+            VuVirtqElement *elem;
+
+            n = 0;
+            while ((elem = vu_queue_pop(&dev, vq, sizeof(*elem)))) {
+                vu_queue_push(&dev, vq, elem, BUF_SIZE);
+                free(elem);
+                n++;
+            }
+        }
+        assert(n == batch);
+
+        /* Driver: reclaim the used buffers */
+        smp_rmb();
+        while (used_idx != le16_to_cpu(used->idx)) {
+            used_idx++;
+            done++;
+        }
+    }
+    ns = get_clock() - start;
+
+    if (use_batch) {
+        vu_queue_set_elem_pool(vq, sizeof(VuVirtqElement), 0, 0);
+    }
+
+    printf("%-12s %lu requests in %.3f s: %.1f ns/request, "
+           "%.2f Mrequests/s\n", name, done, ns / 1e9,
+           (double)ns / done, done * 1e3 / ns);
+}
+
+static void usage(const char *progname)
+{
+    printf("Usage: %s [options]\n"
+           "  -n NUM   number of requests (default %lu)\n"
+           "  -q NUM   queue size (default %u)\n"
+           "  -s NUM   buffers per request (default %u)\n"
+           "  -b NUM   requests made available at once (default %u)\n",
+           progname, requests, queue_size, nsg, batch);
+}
+
+int main(int argc, char **argv)
+{
+    int c;
+
+    while ((c = getopt(argc, argv, "hn:q:s:b:")) != -1) {
+        switch (c) {
+        case 'n':
+            requests = atol(optarg);
+            break;
+        case 'q':
+            queue_size = atoi(optarg);
+            break;
+        case 's':
+            nsg = atoi(optarg);
+            break;
+        case 'b':
+            batch = atoi(optarg);
+            break;
+        case 'h':
+            usage(argv[0]);
+            return EXIT_SUCCESS;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!queue_size || queue_size > VIRTQUEUE_MAX_SIZE ||
+        (queue_size & (queue_size - 1)) || !nsg || !batch ||
+        batch * nsg > queue_size ||
+        BUF_OFFSET + (uint64_t)batch * nsg * BUF_SIZE > MEM_SIZE) {
+        fprintf(stderr, "Invalid queue size, buffer count or batch size\n");
+        return EXIT_FAILURE;
+    }
+
+    setup();
+    init_ring();
+
+    run("pop/push", false);
+    run("pop_batch", true);
+
+    vu_deinit(&dev);
+    close(master_fd);
+    return EXIT_SUCCESS;
+}
@@ -127,6 +127,7 @@ static enum op operation;
 static enum tester tester;
 static uint64_t n_completed_ops;
 static unsigned int duration = DEFAULT_DURATION_SECS;
+static unsigned int vec_lanes;
 static int64_t ns_elapsed;
 /* disable optimizations with volatile */
 static volatile union fp res;
@@ -423,6 +424,85 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
     }
 }
 
+#define MAX_VEC_LANES 64
+
+/*
+ * Benchmark the lane-batched softfloat entry points, as used by the
+ * vector helpers of the targets. Each call processes @vec_lanes lanes.
+ */
+static void bench_vec(enum precision prec, enum op op)
+{
+    int64_t tf = get_clock() + duration * 1000000000LL;
+
+    while (get_clock() < tf) {
+        union fp ops[MAX_OPERANDS];
+        float32 a32[MAX_VEC_LANES], b32[MAX_VEC_LANES], d32[MAX_VEC_LANES];
+        float64 a64[MAX_VEC_LANES], b64[MAX_VEC_LANES], d64[MAX_VEC_LANES];
+        int64_t t0;
+        int i, j;
+
+        for (j = 0; j < vec_lanes; j++) {
+            update_random_ops(2, prec);
+            fill_random(ops, 2, prec, false);
+            if (prec == PREC_FLOAT32) {
+                a32[j] = ops[0].f32;
+                b32[j] = ops[1].f32;
+            } else {
+                a64[j] = ops[0].f64;
+                b64[j] = ops[1].f64;
+            }
+        }
+
+        t0 = get_clock();
+        for (i = 0; i < OPS_PER_ITER; i += vec_lanes) {
+            switch (prec) {
+            case PREC_FLOAT32:
+                switch (op) {
+                case OP_ADD:
+                    float32_add_vec(d32, a32, b32, vec_lanes, &soft_status);
+                    break;
+                case OP_SUB:
+                    float32_sub_vec(d32, a32, b32, vec_lanes, &soft_status);
+                    break;
+                case OP_MUL:
+                    float32_mul_vec(d32, a32, b32, vec_lanes, &soft_status);
+                    break;
+                case OP_DIV:
+                    float32_div_vec(d32, a32, b32, vec_lanes, &soft_status);
+                    break;
+                default:
+                    g_assert_not_reached();
+                }
+                res.f32 = d32[0];
+                break;
+            case PREC_FLOAT64:
+                switch (op) {
+                case OP_ADD:
+                    float64_add_vec(d64, a64, b64, vec_lanes, &soft_status);
+                    break;
+                case OP_SUB:
+                    float64_sub_vec(d64, a64, b64, vec_lanes, &soft_status);
+                    break;
+                case OP_MUL:
+                    float64_mul_vec(d64, a64, b64, vec_lanes, &soft_status);
+                    break;
+                case OP_DIV:
+                    float64_div_vec(d64, a64, b64, vec_lanes, &soft_status);
+                    break;
+                default:
+                    g_assert_not_reached();
+                }
+                res.f64 = d64[0];
+                break;
+            default:
+                g_assert_not_reached();
+            }
+        }
+        ns_elapsed += get_clock() - t0;
+        n_completed_ops += i;
+    }
+}
+
 #define GEN_BENCH(name, type, prec, op, n_ops)          \
     static void __attribute__((flatten)) name(void)     \
     {                                                   \
@@ -488,6 +568,10 @@ static void run_bench(void)
 {
     bench_func_t f;
 
+    if (vec_lanes) {
+        bench_vec(precision, operation);
+        return;
+    }
     f = bench_funcs[operation][precision];
     g_assert(f);
     f();
@@ -524,6 +608,9 @@ static void usage_complete(int argc, char *argv[])
             "Default: even\n");
     fprintf(stderr, " -t = tester (%s). Default: %s\n",
             tester_list, tester_names[0]);
+    fprintf(stderr, " -v = number of lanes per call to the lane-batched "
+            "ops (add, sub, mul, div; soft tester only, max %d). "
+            "Default: 0 (scalar)\n", MAX_VEC_LANES);
     fprintf(stderr, " -z = flush inputs to zero (soft tester only). "
             "Default: disabled\n");
     fprintf(stderr, " -Z = flush output to zero (soft tester only). "
@@ -615,7 +702,7 @@ static void parse_args(int argc, char *argv[])
     int rounding = ROUND_EVEN;
 
     for (;;) {
-        c = getopt(argc, argv, "d:ho:p:r:t:zZ");
+        c = getopt(argc, argv, "d:ho:p:r:t:v:zZ");
         if (c < 0) {
             break;
         }
@@ -661,6 +748,14 @@ static void parse_args(int argc, char *argv[])
             }
             tester = val;
             break;
+        case 'v':
+            vec_lanes = atoi(optarg);
+            if (vec_lanes > MAX_VEC_LANES) {
+                fprintf(stderr, "fatal: at most %d lanes supported\n",
+                        MAX_VEC_LANES);
+                exit(EXIT_FAILURE);
+            }
+            break;
         case 'z':
             soft_status.flush_inputs_to_zero = 1;
             break;
@@ -670,6 +765,13 @@ static void parse_args(int argc, char *argv[])
         }
     }
 
+    if (vec_lanes && (tester != TESTER_SOFT || precision == PREC_QUAD ||
+                      operation > OP_DIV)) {
+        fprintf(stderr, "fatal: -v requires the soft tester, single or "
+                "double precision and one of add, sub, mul, div\n");
+        exit(EXIT_FAILURE);
+    }
+
     /* set precision and rounding mode based on the tester */
     switch (tester) {
     case TESTER_HOST:
@@ -1438,6 +1438,63 @@ static void test_ncq_simple(void)
     ahci_shutdown(ahci);
 }
 
+/*
+ * Issue several NCQ writes with a single write to PxCI, so that they are
+ * submitted and may complete together, then read them back one by one.
+ */
+static void test_ncq_batch(void)
+{
+    AHCIQState *ahci;
+    AHCICommand *cmd[4];
+    uint64_t ptr[ARRAY_SIZE(cmd)];
+    size_t bufsize = 4096;
+    unsigned char *tx = g_malloc(bufsize * ARRAY_SIZE(cmd));
+    unsigned char *rx = g_malloc(bufsize);
+    uint32_t mask = 0;
+    uint8_t port;
+    int i;
+
+    ahci = ahci_boot_and_enable(NULL);
+    port = ahci_port_select(ahci);
+    ahci_port_clear(ahci, port);
+    generate_pattern(tx, bufsize * ARRAY_SIZE(cmd), AHCI_SECTOR_SIZE);
+
+    for (i = 0; i < ARRAY_SIZE(cmd); i++) {
+        ptr[i] = ahci_alloc(ahci, bufsize);
+        g_assert(ptr[i]);
+        qtest_bufwrite(ahci->parent->qts, ptr[i], tx + i * bufsize, bufsize);
+
+        cmd[i] = ahci_command_create(WRITE_FPDMA_QUEUED);
+        ahci_command_set_buffer(cmd[i], ptr[i]);
+        ahci_command_set_size(cmd[i], bufsize);
+        ahci_command_set_offset(cmd[i], i * bufsize / AHCI_SECTOR_SIZE);
+        ahci_command_commit(ahci, cmd[i], port);
+        mask |= 1 << ahci_command_slot(cmd[i]);
+    }
+
+    ahci_px_wreg(ahci, port, AHCI_PX_SACT, mask);
+    ahci_px_wreg(ahci, port, AHCI_PX_CI, mask);
+    for (i = 0; i < ARRAY_SIZE(cmd); i++) {
+        ahci_command_wait(ahci, cmd[i]);
+    }
+    ahci_command_verify(ahci, cmd[ARRAY_SIZE(cmd) - 1]);
+
+    for (i = 0; i < ARRAY_SIZE(cmd); i++) {
+        ahci_port_check_nonbusy(ahci, port, ahci_command_slot(cmd[i]));
+        ahci_command_free(cmd[i]);
+        ahci_free(ahci, ptr[i]);
+
+        memset(rx, 0, bufsize);
+        ahci_io(ahci, port, READ_FPDMA_QUEUED, rx, bufsize,
+                i * bufsize / AHCI_SECTOR_SIZE);
+        g_assert_cmphex(memcmp(tx + i * bufsize, rx, bufsize), ==, 0);
+    }
+
+    ahci_shutdown(ahci);
+    g_free(tx);
+    g_free(rx);
+}
+
 static int prepare_iso(size_t size, unsigned char **buf, char **name)
 {
     g_autofree char *cdrom_path = NULL;
@@ -1949,6 +2006,7 @@ int main(int argc, char **argv)
     qtest_add_func("/ahci/reset", test_reset);
 
     qtest_add_func("/ahci/io/ncq/simple", test_ncq_simple);
+    qtest_add_func("/ahci/io/ncq/batch", test_ncq_batch);
     qtest_add_func("/ahci/migrate/ncq/simple", test_migrate_ncq);
     qtest_add_func("/ahci/io/ncq/retry", test_halted_ncq);
     qtest_add_func("/ahci/migrate/ncq/halted", test_migrate_halted_ncq);
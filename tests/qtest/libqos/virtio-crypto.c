@@ -0,0 +1,103 @@
+/*
+ * virtio-crypto nodes for testing
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "qemu/osdep.h"
+#include "../libqtest.h"
+#include "qemu/module.h"
+#include "qgraph.h"
+#include "virtio-crypto.h"
+
+/* virtio-crypto-device */
+static void *qvirtio_crypto_get_driver(QVirtioCrypto *v_crypto,
+                                       const char *interface)
+{
+    if (!g_strcmp0(interface, "virtio-crypto")) {
+        return v_crypto;
+    }
+    if (!g_strcmp0(interface, "virtio")) {
+        return v_crypto->vdev;
+    }
+
+    fprintf(stderr, "%s not present in virtio-crypto-device\n", interface);
+    g_assert_not_reached();
+}
+
+static void *qvirtio_crypto_device_get_driver(void *object,
+                                              const char *interface)
+{
+    QVirtioCryptoDevice *v_crypto = object;
+    return qvirtio_crypto_get_driver(&v_crypto->crypto, interface);
+}
+
+static void *virtio_crypto_device_create(void *virtio_dev,
+                                         QGuestAllocator *t_alloc,
+                                         void *addr)
+{
+    QVirtioCryptoDevice *virtio_cdevice = g_new0(QVirtioCryptoDevice, 1);
+    QVirtioCrypto *interface = &virtio_cdevice->crypto;
+
+    interface->vdev = virtio_dev;
+
+    virtio_cdevice->obj.get_driver = qvirtio_crypto_device_get_driver;
+
+    return &virtio_cdevice->obj;
+}
+
+/* virtio-crypto-pci */
+static void *qvirtio_crypto_pci_get_driver(void *object,
+                                           const char *interface)
+{
+    QVirtioCryptoPCI *v_crypto = object;
+    if (!g_strcmp0(interface, "pci-device")) {
+        return v_crypto->pci_vdev.pdev;
+    }
+    return qvirtio_crypto_get_driver(&v_crypto->crypto, interface);
+}
+
+static void *virtio_crypto_pci_create(void *pci_bus, QGuestAllocator *t_alloc,
+                                      void *addr)
+{
+    QVirtioCryptoPCI *virtio_cpci = g_new0(QVirtioCryptoPCI, 1);
+    QVirtioCrypto *interface = &virtio_cpci->crypto;
+    QOSGraphObject *obj = &virtio_cpci->pci_vdev.obj;
+
+    virtio_pci_init(&virtio_cpci->pci_vdev, pci_bus, addr);
+    interface->vdev = &virtio_cpci->pci_vdev.vdev;
+
+    obj->get_driver = qvirtio_crypto_pci_get_driver;
+
+    return obj;
+}
+
+static void virtio_crypto_register_nodes(void)
+{
+    QPCIAddress addr = {
+        .devfn = QPCI_DEVFN(4, 0),
+    };
+
+    QOSGraphEdgeOptions opts = {
+        .before_cmd_line = "-object cryptodev-backend-builtin,id=cryptodev0",
+    };
+
+    /* virtio-crypto-device */
+    opts.extra_device_opts = "cryptodev=cryptodev0";
+    qos_node_create_driver("virtio-crypto-device",
+                           virtio_crypto_device_create);
+    qos_node_consumes("virtio-crypto-device", "virtio-bus", &opts);
+    qos_node_produces("virtio-crypto-device", "virtio");
+    qos_node_produces("virtio-crypto-device", "virtio-crypto");
+
+    /* virtio-crypto-pci */
+    opts.extra_device_opts = "cryptodev=cryptodev0,addr=04.0";
+    add_qpci_address(&opts, &addr);
+    qos_node_create_driver("virtio-crypto-pci", virtio_crypto_pci_create);
+    qos_node_consumes("virtio-crypto-pci", "pci-bus", &opts);
+    qos_node_produces("virtio-crypto-pci", "pci-device");
+    qos_node_produces("virtio-crypto-pci", "virtio");
+    qos_node_produces("virtio-crypto-pci", "virtio-crypto");
+}
+
+libqos_init(virtio_crypto_register_nodes);
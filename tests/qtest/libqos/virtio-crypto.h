@@ -0,0 +1,32 @@
+/*
+ * virtio-crypto structures
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef TESTS_LIBQOS_VIRTIO_CRYPTO_H
+#define TESTS_LIBQOS_VIRTIO_CRYPTO_H
+
+#include "qgraph.h"
+#include "virtio.h"
+#include "virtio-pci.h"
+
+typedef struct QVirtioCrypto QVirtioCrypto;
+typedef struct QVirtioCryptoPCI QVirtioCryptoPCI;
+typedef struct QVirtioCryptoDevice QVirtioCryptoDevice;
+
+struct QVirtioCrypto {
+    QVirtioDevice *vdev;
+};
+
+struct QVirtioCryptoPCI {
+    QVirtioPCIDevice pci_vdev;
+    QVirtioCrypto crypto;
+};
+
+struct QVirtioCryptoDevice {
+    QOSGraphObject obj;
+    QVirtioCrypto crypto;
+};
+
+#endif
@@ -499,6 +499,8 @@ typedef struct {
     bool only_target;
     /* Use dirty ring if true; dirty logging otherwise */
     bool use_dirty_ring;
+    /* Use TCG even if KVM is available */
+    bool use_tcg;
     const char *opts_source;
     const char *opts_target;
 } MigrateStart;
@@ -593,6 +595,7 @@ static int test_migrate_start(QTestState **from, QTestState **to,
     const char *arch = qtest_get_arch();
     const char *machine_opts = NULL;
     const char *memory_size;
+    const char *accel;
 
     if (args->use_shmem) {
         if (!g_file_test("/dev/shm", G_FILE_TEST_IS_DIR)) {
@@ -672,13 +675,20 @@ static int test_migrate_start(QTestState **from, QTestState **to,
         shmem_opts = g_strdup("");
     }
 
-    cmd_source = g_strdup_printf("-accel kvm%s -accel tcg%s%s "
+    if (args->use_tcg) {
+        accel = "-accel tcg";
+    } else if (args->use_dirty_ring) {
+        accel = "-accel kvm,dirty-ring-size=4096 -accel tcg";
+    } else {
+        accel = "-accel kvm -accel tcg";
+    }
+
+    cmd_source = g_strdup_printf("%s%s%s "
                                  "-name source,debug-threads=on "
                                  "-m %s "
                                  "-serial file:%s/src_serial "
                                  "%s %s %s %s",
-                                 args->use_dirty_ring ?
-                                 ",dirty-ring-size=4096" : "",
+                                 accel,
                                  machine_opts ? " -machine " : "",
                                  machine_opts ? machine_opts : "",
                                  memory_size, tmpfs,
@@ -689,14 +699,13 @@ static int test_migrate_start(QTestState **from, QTestState **to,
         *from = qtest_init(cmd_source);
     }
 
-    cmd_target = g_strdup_printf("-accel kvm%s -accel tcg%s%s "
+    cmd_target = g_strdup_printf("%s%s%s "
                                  "-name target,debug-threads=on "
                                  "-m %s "
                                  "-serial file:%s/dest_serial "
                                  "-incoming %s "
                                  "%s %s %s %s",
-                                 args->use_dirty_ring ?
-                                 ",dirty-ring-size=4096" : "",
+                                 accel,
                                  machine_opts ? " -machine " : "",
                                  machine_opts ? machine_opts : "",
                                  memory_size, tmpfs, uri,
@@ -2290,7 +2299,7 @@ static int64_t get_dirty_rate(QTestState *who)
     return dirtyrate;
 }
 
-static int64_t get_limit_rate(QTestState *who)
+static int64_t get_limit_field(QTestState *who, const char *field)
 {
     QDict *rsp_return;
     QList *rates;
@@ -2310,12 +2319,17 @@ static int64_t get_limit_rate(QTestState *who)
     rate = qobject_to(QDict, qlist_entry_obj(entry));
     g_assert(rate);
 
-    dirtyrate = qdict_get_try_int(rate, "limit-rate", -1);
+    dirtyrate = qdict_get_try_int(rate, field, -1);
 
     qobject_unref(rsp_return);
     return dirtyrate;
 }
 
+static int64_t get_limit_rate(QTestState *who)
+{
+    return get_limit_field(who, "limit-rate");
+}
+
 static QTestState *dirtylimit_start_vm(void)
 {
     QTestState *vm = NULL;
@@ -2434,6 +2448,62 @@ static void test_vcpu_dirty_limit(void)
     dirtylimit_stop_vm(vm);
 }
 
+/*
+ * Limit the dirty page rate of a TCG guest while it is being migrated.
+ * With TCG the dirty pages are accounted per vCPU by the softmmu TLB,
+ * which must keep working while migration is tracking the same pages.
+ */
+static void test_migrate_dirty_limit_tcg(void)
+{
+    g_autofree char *uri = g_strdup_printf("unix:%s/migsocket", tmpfs);
+    MigrateStart args = {
+        .use_tcg = true,
+    };
+    QTestState *from, *to;
+    int max_try_count = 20;
+    int64_t rate = 0;
+
+    if (test_migrate_start(&from, &to, uri, &args)) {
+        return;
+    }
+
+    /* Keep the migration going until the limit has been checked */
+    migrate_ensure_non_converge(from);
+
+    /* Wait for the first serial output from the source */
+    wait_for_serial("src_serial");
+
+    migrate_qmp(from, uri, "{}");
+    wait_for_migration_pass(from);
+
+    dirtylimit_set_all(from, 1);
+    g_assert_cmpint(get_limit_rate(from), ==, 1);
+
+    /*
+     * The guest keeps rewriting pages that migration already found
+     * dirty; they must still be accounted to the vCPU.
+     */
+    while (--max_try_count && rate == 0) {
+        usleep(1000000);
+        rate = get_limit_field(from, "current-rate");
+    }
+    g_assert_cmpint(rate, >, 0);
+    g_assert_false(got_stop);
+
+    migrate_ensure_converge(from);
+
+    if (!got_stop) {
+        qtest_qmp_eventwait(from, "STOP");
+    }
+
+    qtest_qmp_eventwait(to, "RESUME");
+
+    wait_for_serial("dest_serial");
+    wait_for_migration_complete(from);
+
+    test_migrate_end(from, to, true);
+}
+
 static bool kvm_dirty_ring_supported(void)
 {
 #if defined(__linux__) && defined(HOST_X86_64)
@@ -2606,6 +2676,11 @@ int main(int argc, char **argv)
                        test_vcpu_dirty_limit);
     }
 
+    if (qtest_has_accel("tcg")) {
+        qtest_add_func("/migration/vcpu_dirty_limit/tcg",
+                       test_migrate_dirty_limit_tcg);
+    }
+
     ret = g_test_run();
 
     g_assert_cmpint(ret, ==, 0);
@@ -15,6 +15,7 @@
 #include "qapi/error.h"
 #include "qapi/qapi-visit-introspect.h"
 #include "qapi/qmp/qdict.h"
+#include "qapi/qmp/qlist.h"
 #include "qapi/qobject-input-visitor.h"
 
 const char common_args[] = "-nodefaults -machine none";
@@ -342,6 +343,80 @@ static void test_object_add_failure_modes(void)
     qtest_quit(qts);
 }
 
+static QDict *find_stat(QList *stats, const char *name)
+{
+    QListEntry *e;
+
+    QLIST_FOREACH_ENTRY(stats, e) {
+        QDict *stat = qobject_to(QDict, qlist_entry_obj(e));
+
+        if (!strcmp(qdict_get_str(stat, "name"), name)) {
+            return stat;
+        }
+    }
+    return NULL;
+}
+
+static void test_query_stats_iothread(void)
+{
+    QTestState *qts;
+    QDict *resp, *result, *stat;
+    QList *results, *stats;
+
+    qts = qtest_initf("%s -object iothread,id=iothread0", common_args);
+
+    /* all statistics of all IOThreads */
+    resp = qtest_qmp(qts, "{'execute': 'query-stats', 'arguments':"
+                     " {'target': 'iothread'} }");
+    results = qdict_get_qlist(resp, "return");
+    g_assert_cmpint(qlist_size(results), ==, 1);
+    result = qobject_to(QDict, qlist_peek(results));
+    g_assert_cmpstr(qdict_get_str(result, "provider"), ==, "iothread");
+    g_assert_cmpstr(qdict_get_str(result, "qom-path"), ==,
+                    "/objects/iothread0");
+    stats = qdict_get_qlist(result, "stats");
+    g_assert_nonnull(find_stat(stats, "dispatch_ns"));
+    g_assert_nonnull(find_stat(stats, "bh_runs"));
+    stat = find_stat(stats, "timer_lateness_ns");
+    g_assert_nonnull(stat);
+    g_assert_cmpint(qlist_size(qdict_get_qlist(stat, "value")), ==, 32);
+    qobject_unref(resp);
+
+    /* filter by IOThread and by name */
+    resp = qtest_qmp(qts, "{'execute': 'query-stats', 'arguments':"
+                     " {'target': 'iothread',"
+                     " 'iothreads': ['/objects/iothread0'],"
+                     " 'providers': [{'provider': 'iothread',"
+                     " 'names': ['blocked_ns']}] } }");
+    results = qdict_get_qlist(resp, "return");
+    g_assert_cmpint(qlist_size(results), ==, 1);
+    result = qobject_to(QDict, qlist_peek(results));
+    stats = qdict_get_qlist(result, "stats");
+    g_assert_cmpint(qlist_size(stats), ==, 1);
+    g_assert_nonnull(find_stat(stats, "blocked_ns"));
+    qobject_unref(resp);
+
+    /* IOThreads that do not exist are not reported */
+    resp = qtest_qmp(qts, "{'execute': 'query-stats', 'arguments':"
+                     " {'target': 'iothread',"
+                     " 'iothreads': ['/objects/iothread1'] } }");
+    g_assert_cmpint(qlist_size(qdict_get_qlist(resp, "return")), ==, 0);
+    qobject_unref(resp);
+
+    resp = qtest_qmp(qts, "{'execute': 'query-stats-schemas', 'arguments':"
+                     " {'provider': 'iothread'} }");
+    results = qdict_get_qlist(resp, "return");
+    g_assert_cmpint(qlist_size(results), ==, 1);
+    result = qobject_to(QDict, qlist_peek(results));
+    g_assert_cmpstr(qdict_get_str(result, "target"), ==, "iothread");
+    stat = find_stat(qdict_get_qlist(result, "stats"), "timer_lateness_ns");
+    g_assert_nonnull(stat);
+    g_assert_cmpstr(qdict_get_str(stat, "type"), ==, "log2-histogram");
+    qobject_unref(resp);
+
+    qtest_quit(qts);
+}
+
 int main(int argc, char *argv[])
 {
     QmpSchema schema;
@@ -354,6 +429,7 @@ int main(int argc, char *argv[])
 
     qtest_add_func("qmp/object-add-failure-modes",
                    test_object_add_failure_modes);
+    qtest_add_func("qmp/query-stats-iothread", test_query_stats_iothread);
 
     ret = g_test_run();
 
@@ -0,0 +1,358 @@
+/*
+ * QTest testcase for VirtIO Crypto
+ *
+ * The functional tests encrypt a known AES-CBC vector through the data
+ * queue of a cryptodev-backend-builtin device, with and without an
+ * IOThread.  When run with -m perf, a throughput test keeps batches of
+ * requests in flight on several sessions and reports the rate at which
+ * the device completes them.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest-single.h"
+#include "qemu/bswap.h"
+#include "qemu/module.h"
+#include "standard-headers/linux/virtio_crypto.h"
+#include "libqos/qgraph.h"
+#include "libqos/virtio-crypto.h"
+
+#define QVIRTIO_CRYPTO_TIMEOUT_US   (30 * 1000 * 1000)
+
+#define AES_BLOCK_SIZE              16
+
+/* Requests in flight in the throughput test, four descriptors each */
+#define PERF_BATCH                  64
+#define PERF_SESSIONS               8
+#define PERF_REQUEST_SIZE           (64 * 1024)
+#define PERF_DURATION_US            (5 * 1000 * 1000)
+
+/* AES-128-CBC, first block of NIST SP 800-38A F.2.1 */
+static const uint8_t aes_cbc_key[AES_BLOCK_SIZE] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+    0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c,
+};
+static const uint8_t aes_cbc_iv[AES_BLOCK_SIZE] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+};
+static const uint8_t aes_cbc_plaintext[AES_BLOCK_SIZE] = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+    0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+};
+static const uint8_t aes_cbc_ciphertext[AES_BLOCK_SIZE] = {
+    0x76, 0x49, 0xab, 0xac, 0x81, 0x19, 0xb2, 0x46,
+    0xce, 0xe9, 0x8e, 0x9b, 0x12, 0xe9, 0x19, 0x7d,
+};
+
+typedef struct QVirtioCryptoQueues {
+    QVirtQueue *dataq;
+    QVirtQueue *ctrlq;
+} QVirtioCryptoQueues;
+
+/* A cipher request laid out in guest memory */
+typedef struct QVirtioCryptoReq {
+    uint64_t addr;      /* struct virtio_crypto_op_data_req */
+    uint64_t src;       /* IV followed by the source data */
+    uint64_t dst;       /* destination data followed by the status byte */
+    uint32_t len;
+} QVirtioCryptoReq;
+
+static void crypto_setup(QVirtioDevice *dev, QGuestAllocator *alloc,
+                         QVirtioCryptoQueues *q)
+{
+    uint64_t features;
+    uint32_t max_dataqueues;
+
+    features = qvirtio_get_features(dev);
+    features &= ~(QVIRTIO_F_BAD_FEATURE |
+                  (1ull << VIRTIO_RING_F_INDIRECT_DESC) |
+                  (1ull << VIRTIO_RING_F_EVENT_IDX));
+    qvirtio_set_features(dev, features);
+
+    max_dataqueues = qvirtio_config_readl(dev,
+                        offsetof(struct virtio_crypto_config, max_dataqueues));
+    g_assert_cmpint(max_dataqueues, >=, 1);
+
+    q->dataq = qvirtqueue_setup(dev, alloc, 0);
+    q->ctrlq = qvirtqueue_setup(dev, alloc, max_dataqueues);
+
+    qvirtio_set_driver_ok(dev);
+}
+
+static void crypto_cleanup(QVirtioDevice *dev, QGuestAllocator *alloc,
+                           QVirtioCryptoQueues *q)
+{
+    qvirtqueue_cleanup(dev->bus, q->dataq, alloc);
+    qvirtqueue_cleanup(dev->bus, q->ctrlq, alloc);
+}
+
+/* All requests were returned by the device, reuse the descriptors */
+static void crypto_recycle_descs(QVirtQueue *vq)
+{
+    vq->free_head = 0;
+    vq->num_free = vq->size;
+}
+
+static uint64_t crypto_create_session(QVirtioDevice *dev,
+                                      QGuestAllocator *alloc,
+                                      QVirtQueue *ctrlq)
+{
+    QTestState *qts = global_qtest;
+    struct virtio_crypto_op_ctrl_req ctrl = {};
+    struct virtio_crypto_cipher_session_para *para =
+        &ctrl.u.sym_create_session.u.cipher.para;
+    struct virtio_crypto_session_input input;
+    uint64_t req_addr, key_addr, input_addr;
+    uint32_t free_head;
+
+    ctrl.header.opcode = cpu_to_le32(VIRTIO_CRYPTO_CIPHER_CREATE_SESSION);
+    ctrl.header.algo = cpu_to_le32(VIRTIO_CRYPTO_CIPHER_AES_CBC);
+    ctrl.header.queue_id = 0;
+    para->algo = cpu_to_le32(VIRTIO_CRYPTO_CIPHER_AES_CBC);
+    para->keylen = cpu_to_le32(sizeof(aes_cbc_key));
+    para->op = cpu_to_le32(VIRTIO_CRYPTO_OP_ENCRYPT);
+    ctrl.u.sym_create_session.op_type =
+        cpu_to_le32(VIRTIO_CRYPTO_SYM_OP_CIPHER);
+
+    req_addr = guest_alloc(alloc, sizeof(ctrl));
+    key_addr = guest_alloc(alloc, sizeof(aes_cbc_key));
+    input_addr = guest_alloc(alloc, sizeof(input));
+    memwrite(req_addr, &ctrl, sizeof(ctrl));
+    memwrite(key_addr, aes_cbc_key, sizeof(aes_cbc_key));
+    memset(&input, 0xff, sizeof(input));
+    memwrite(input_addr, &input, sizeof(input));
+
+    free_head = qvirtqueue_add(qts, ctrlq, req_addr, sizeof(ctrl),
+                               false, true);
+    qvirtqueue_add(qts, ctrlq, key_addr, sizeof(aes_cbc_key), false, true);
+    qvirtqueue_add(qts, ctrlq, input_addr, sizeof(input), true, false);
+    qvirtqueue_kick(qts, dev, ctrlq, free_head);
+    qvirtio_wait_used_elem(qts, dev, ctrlq, free_head, NULL,
+                           QVIRTIO_CRYPTO_TIMEOUT_US);
+
+    memread(input_addr, &input, sizeof(input));
+    g_assert_cmpint(le32_to_cpu(input.status), ==, VIRTIO_CRYPTO_OK);
+
+    guest_free(alloc, req_addr);
+    guest_free(alloc, key_addr);
+    guest_free(alloc, input_addr);
+    return le64_to_cpu(input.session_id);
+}
+
+static void crypto_destroy_session(QVirtioDevice *dev, QGuestAllocator *alloc,
+                                   QVirtQueue *ctrlq, uint64_t session_id)
+{
+    QTestState *qts = global_qtest;
+    struct virtio_crypto_op_ctrl_req ctrl = {};
+    uint64_t req_addr, status_addr;
+    uint32_t free_head;
+    uint8_t status = 0xff;
+
+    ctrl.header.opcode = cpu_to_le32(VIRTIO_CRYPTO_CIPHER_DESTROY_SESSION);
+    ctrl.u.destroy_session.session_id = cpu_to_le64(session_id);
+
+    req_addr = guest_alloc(alloc, sizeof(ctrl));
+    status_addr = guest_alloc(alloc, sizeof(status));
+    memwrite(req_addr, &ctrl, sizeof(ctrl));
+    memwrite(status_addr, &status, sizeof(status));
+
+    free_head = qvirtqueue_add(qts, ctrlq, req_addr, sizeof(ctrl),
+                               false, true);
+    qvirtqueue_add(qts, ctrlq, status_addr, sizeof(status), true, false);
+    qvirtqueue_kick(qts, dev, ctrlq, free_head);
+    qvirtio_wait_used_elem(qts, dev, ctrlq, free_head, NULL,
+                           QVIRTIO_CRYPTO_TIMEOUT_US);
+
+    g_assert_cmpint(readb(status_addr), ==, VIRTIO_CRYPTO_OK);
+
+    guest_free(alloc, req_addr);
+    guest_free(alloc, status_addr);
+}
+
+static void crypto_req_init(QGuestAllocator *alloc, QVirtioCryptoReq *req,
+                            uint64_t session_id, const uint8_t *src,
+                            uint32_t len)
+{
+    struct virtio_crypto_op_data_req data = {};
+    struct virtio_crypto_cipher_para *para = &data.u.sym_req.u.cipher.para;
+    uint8_t status = 0xff;
+
+    data.header.opcode = cpu_to_le32(VIRTIO_CRYPTO_CIPHER_ENCRYPT);
+    data.header.algo = cpu_to_le32(VIRTIO_CRYPTO_CIPHER_AES_CBC);
+    data.header.session_id = cpu_to_le64(session_id);
+    data.u.sym_req.op_type = cpu_to_le32(VIRTIO_CRYPTO_SYM_OP_CIPHER);
+    para->iv_len = cpu_to_le32(sizeof(aes_cbc_iv));
+    para->src_data_len = cpu_to_le32(len);
+    para->dst_data_len = cpu_to_le32(len);
+
+    req->len = len;
+    req->addr = guest_alloc(alloc, sizeof(data));
+    req->src = guest_alloc(alloc, sizeof(aes_cbc_iv) + len);
+    req->dst = guest_alloc(alloc, len + sizeof(status));
+
+    memwrite(req->addr, &data, sizeof(data));
+    memwrite(req->src, aes_cbc_iv, sizeof(aes_cbc_iv));
+    if (src) {
+        memwrite(req->src + sizeof(aes_cbc_iv), src, len);
+    } else {
+        qtest_memset(global_qtest, req->src + sizeof(aes_cbc_iv), 0x5a, len);
+    }
+    memwrite(req->dst + len, &status, sizeof(status));
+}
+
+static void crypto_req_free(QGuestAllocator *alloc, QVirtioCryptoReq *req)
+{
+    guest_free(alloc, req->addr);
+    guest_free(alloc, req->src);
+    guest_free(alloc, req->dst);
+}
+
+static uint32_t crypto_req_submit(QVirtioDevice *dev, QVirtQueue *dataq,
+                                  QVirtioCryptoReq *req)
+{
+    QTestState *qts = global_qtest;
+    uint32_t free_head;
+
+    free_head = qvirtqueue_add(qts, dataq, req->addr,
+                               sizeof(struct virtio_crypto_op_data_req),
+                               false, true);
+    qvirtqueue_add(qts, dataq, req->src, sizeof(aes_cbc_iv) + req->len,
+                   false, true);
+    qvirtqueue_add(qts, dataq, req->dst, req->len, true, true);
+    qvirtqueue_add(qts, dataq, req->dst + req->len, 1, true, false);
+    qvirtqueue_kick(qts, dev, dataq, free_head);
+    return free_head;
+}
+
+static void aes_cbc(void *obj, void *data, QGuestAllocator *t_alloc)
+{
+    QVirtioCrypto *crypto = obj;
+    QVirtioDevice *dev = crypto->vdev;
+    QVirtioCryptoQueues q;
+    QVirtioCryptoReq req;
+    uint8_t dst[AES_BLOCK_SIZE];
+    uint64_t session_id;
+    uint32_t free_head;
+
+    crypto_setup(dev, t_alloc, &q);
+    session_id = crypto_create_session(dev, t_alloc, q.ctrlq);
+
+    crypto_req_init(t_alloc, &req, session_id, aes_cbc_plaintext,
+                    sizeof(aes_cbc_plaintext));
+    free_head = crypto_req_submit(dev, q.dataq, &req);
+    qvirtio_wait_used_elem(global_qtest, dev, q.dataq, free_head, NULL,
+                           QVIRTIO_CRYPTO_TIMEOUT_US);
+
+    g_assert_cmpint(readb(req.dst + req.len), ==, VIRTIO_CRYPTO_OK);
+    memread(req.dst, dst, sizeof(dst));
+    g_assert_cmpmem(dst, sizeof(dst),
+                    aes_cbc_ciphertext, sizeof(aes_cbc_ciphertext));
+    crypto_req_free(t_alloc, &req);
+
+    crypto_destroy_session(dev, t_alloc, q.ctrlq, session_id);
+    crypto_cleanup(dev, t_alloc, &q);
+}
+
+static void throughput(void *obj, void *data, QGuestAllocator *t_alloc)
+{
+    QVirtioCrypto *crypto = obj;
+    QVirtioDevice *dev = crypto->vdev;
+    QVirtioCryptoQueues q;
+    QVirtioCryptoReq reqs[PERF_BATCH];
+    uint64_t sessions[PERF_SESSIONS];
+    uint64_t bytes = 0;
+    gint64 start, elapsed;
+    int i;
+
+    crypto_setup(dev, t_alloc, &q);
+    for (i = 0; i < PERF_SESSIONS; i++) {
+        sessions[i] = crypto_create_session(dev, t_alloc, q.ctrlq);
+    }
+    for (i = 0; i < PERF_BATCH; i++) {
+        crypto_req_init(t_alloc, &reqs[i], sessions[i % PERF_SESSIONS],
+                        NULL, PERF_REQUEST_SIZE);
+    }
+
+    start = g_get_monotonic_time();
+    do {
+        int done = 0;
+
+        for (i = 0; i < PERF_BATCH; i++) {
+            crypto_req_submit(dev, q.dataq, &reqs[i]);
+        }
+        while (done < PERF_BATCH) {
+            qtest_clock_step(global_qtest, 100);
+            while (qvirtqueue_get_buf(global_qtest, q.dataq, NULL, NULL)) {
+                done++;
+            }
+            g_assert(g_get_monotonic_time() - start <=
+                     PERF_DURATION_US + QVIRTIO_CRYPTO_TIMEOUT_US);
+        }
+        crypto_recycle_descs(q.dataq);
+        bytes += (uint64_t)PERF_BATCH * PERF_REQUEST_SIZE;
+        elapsed = g_get_monotonic_time() - start;
+    } while (elapsed < PERF_DURATION_US);
+
+    for (i = 0; i < PERF_BATCH; i++) {
+        g_assert_cmpint(readb(reqs[i].dst + reqs[i].len), ==,
+                        VIRTIO_CRYPTO_OK);
+        crypto_req_free(t_alloc, &reqs[i]);
+    }
+
+    g_test_message("AES-128-CBC, %d requests of %d bytes in flight, "
+                   "%d sessions: %.1f MB/s",
+                   PERF_BATCH, PERF_REQUEST_SIZE, PERF_SESSIONS,
+                   (double)bytes / elapsed);
+    g_test_maximized_result((double)bytes / elapsed, "%.1f MB/s",
+                            (double)bytes / elapsed);
+
+    for (i = 0; i < PERF_SESSIONS; i++) {
+        crypto_destroy_session(dev, t_alloc, q.ctrlq, sessions[i]);
+    }
+    crypto_cleanup(dev, t_alloc, &q);
+}
+
+static void pci_aes_cbc(void *obj, void *data, QGuestAllocator *t_alloc)
+{
+    QVirtioCryptoPCI *crypto = obj;
+
+    aes_cbc(&crypto->crypto, data, t_alloc);
+}
+
+static void pci_throughput(void *obj, void *data, QGuestAllocator *t_alloc)
+{
+    QVirtioCryptoPCI *crypto = obj;
+
+    throughput(&crypto->crypto, data, t_alloc);
+}
+
+static void *virtio_crypto_setup_iothread(GString *cmd_line, void *arg)
+{
+    g_string_append(cmd_line, " -object iothread,id=thread0");
+    return arg;
+}
+
+static void register_virtio_crypto_test(void)
+{
+    QOSGraphTestOptions opts = { };
+
+    qos_add_test("aes-cbc", "virtio-crypto", aes_cbc, NULL);
+    if (g_test_perf()) {
+        qos_add_test("throughput", "virtio-crypto", throughput, NULL);
+    }
+
+    opts.before = virtio_crypto_setup_iothread;
+    opts.edge = (QOSGraphEdgeOptions) {
+        .extra_device_opts = "iothread=thread0",
+    };
+    qos_add_test("iothread-aes-cbc", "virtio-crypto-pci", pci_aes_cbc, &opts);
+    if (g_test_perf()) {
+        qos_add_test("iothread-throughput", "virtio-crypto-pci",
+                     pci_throughput, &opts);
+    }
+}
+
+libqos_init(register_virtio_crypto_test);
@@ -0,0 +1,712 @@
+/*
+ * Guest crypto instruction kernels
+ *
+ * Runs the inner loops of AES-128-CTR encryption, AES-128-CBC
+ * decryption, a GHASH-style carry-less multiply fold and SHA-256, the
+ * way a TLS library would.  When built with AES-NI/PCLMUL (x86) or the
+ * Armv8 crypto extensions (aarch64) the loops use the guest crypto
+ * instructions, otherwise plain C.  Results are checked against the
+ * plain C reference and known answers, and the throughput is reported.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+# if defined(__AES__) && defined(__PCLMUL__)
+#  include <immintrin.h>
+#  define HAVE_X86_AES 1
+# endif
+#elif defined(__aarch64__)
+# if defined(__ARM_FEATURE_CRYPTO) || \
+    (defined(__ARM_FEATURE_AES) && defined(__ARM_FEATURE_SHA2))
+#  include <arm_neon.h>
+#  define HAVE_ARM_CE 1
+# endif
+#endif
+
+#define BUF_SIZE    (16 * 1024)
+#define ITERS       16
+
+typedef struct {
+    uint8_t rk[11][16];
+} AESKey;
+
+static uint8_t buf[BUF_SIZE] __attribute__((aligned(16)));
+static uint8_t out[BUF_SIZE], ref[BUF_SIZE];
+static uint8_t sbox[256], isbox[256];
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Plain C reference
+ */
+
+static uint8_t xtime(uint8_t x)
+{
+    return (x << 1) ^ (x & 0x80 ? 0x1b : 0);
+}
+
+static uint8_t gmul(uint8_t a, uint8_t b)
+{
+    uint8_t r = 0;
+
+    while (b) {
+        if (b & 1) {
+            r ^= a;
+        }
+        a = xtime(a);
+        b >>= 1;
+    }
+    return r;
+}
+
+static void init_sbox(void)
+{
+    int i, j;
+
+    for (i = 0; i < 256; i++) {
+        uint8_t inv = 0, s;
+
+        for (j = 1; i && j < 256; j++) {
+            if (gmul(i, j) == 1) {
+                inv = j;
+                break;
+            }
+        }
+        s = inv;
+        for (j = 1; j < 5; j++) {
+            s ^= (inv << j) | (inv >> (8 - j));
+        }
+        sbox[i] = s ^ 0x63;
+        isbox[sbox[i]] = i;
+    }
+}
+
+static void ref_expand_key(AESKey *key, const uint8_t *user)
+{
+    uint8_t *w = &key->rk[0][0];
+    uint8_t rcon = 1;
+    int i;
+
+    memcpy(w, user, 16);
+    for (i = 16; i < 176; i += 4) {
+        uint8_t t[4];
+
+        memcpy(t, w + i - 4, 4);
+        if (i % 16 == 0) {
+            uint8_t t0 = t[0];
+
+            t[0] = sbox[t[1]] ^ rcon;
+            t[1] = sbox[t[2]];
+            t[2] = sbox[t[3]];
+            t[3] = sbox[t0];
+            rcon = xtime(rcon);
+        }
+        w[i + 0] = w[i - 16 + 0] ^ t[0];
+        w[i + 1] = w[i - 16 + 1] ^ t[1];
+        w[i + 2] = w[i - 16 + 2] ^ t[2];
+        w[i + 3] = w[i - 16 + 3] ^ t[3];
+    }
+}
+
+static void ref_encrypt(const AESKey *key, uint8_t *dst, const uint8_t *src)
+{
+    uint8_t s[16], t[16];
+    int r, i, c;
+
+    for (i = 0; i < 16; i++) {
+        s[i] = src[i] ^ key->rk[0][i];
+    }
+    for (r = 1; r <= 10; r++) {
+        /* SubBytes and ShiftRows */
+        for (i = 0; i < 16; i++) {
+            t[i] = sbox[s[(i + 4 * (i & 3)) & 15]];
+        }
+        /* MixColumns */
+        for (c = 0; c < 16; c += 4) {
+            uint8_t a0 = t[c], a1 = t[c + 1], a2 = t[c + 2], a3 = t[c + 3];
+            uint8_t x = a0 ^ a1 ^ a2 ^ a3;
+
+            if (r == 10) {
+                break;
+            }
+            t[c + 0] ^= x ^ xtime(a0 ^ a1);
+            t[c + 1] ^= x ^ xtime(a1 ^ a2);
+            t[c + 2] ^= x ^ xtime(a2 ^ a3);
+            t[c + 3] ^= x ^ xtime(a3 ^ a0);
+        }
+        for (i = 0; i < 16; i++) {
+            s[i] = t[i] ^ key->rk[r][i];
+        }
+    }
+    memcpy(dst, s, 16);
+}
+
+static void ref_decrypt(const AESKey *key, uint8_t *dst, const uint8_t *src)
+{
+    uint8_t s[16], t[16];
+    int r, i, c;
+
+    for (i = 0; i < 16; i++) {
+        s[i] = src[i] ^ key->rk[10][i];
+    }
+    for (r = 9; r >= 0; r--) {
+        /* InvShiftRows and InvSubBytes */
+        for (i = 0; i < 16; i++) {
+            t[i] = isbox[s[(i - 4 * (i & 3)) & 15]];
+        }
+        for (i = 0; i < 16; i++) {
+            s[i] = t[i] ^ key->rk[r][i];
+        }
+        if (r == 0) {
+            break;
+        }
+        /* InvMixColumns */
+        for (c = 0; c < 16; c += 4) {
+            uint8_t a0 = s[c], a1 = s[c + 1], a2 = s[c + 2], a3 = s[c + 3];
+
+            s[c + 0] = gmul(a0, 14) ^ gmul(a1, 11) ^ gmul(a2, 13) ^ gmul(a3, 9);
+            s[c + 1] = gmul(a0, 9) ^ gmul(a1, 14) ^ gmul(a2, 11) ^ gmul(a3, 13);
+            s[c + 2] = gmul(a0, 13) ^ gmul(a1, 9) ^ gmul(a2, 14) ^ gmul(a3, 11);
+            s[c + 3] = gmul(a0, 11) ^ gmul(a1, 13) ^ gmul(a2, 9) ^ gmul(a3, 14);
+        }
+    }
+    memcpy(dst, s, 16);
+}
+
+static void ref_clmul(uint64_t *lo, uint64_t *hi, uint64_t a, uint64_t b)
+{
+    uint64_t l = 0, h = 0;
+    int i;
+
+    for (i = 0; i < 64; i++) {
+        if ((b >> i) & 1) {
+            l ^= a << i;
+            h ^= i ? a >> (64 - i) : 0;
+        }
+    }
+    *lo = l;
+    *hi = h;
+}
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static const uint32_t sha256_iv[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+static uint32_t ror(uint32_t x, int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+static void ref_sha256_block(uint32_t h[8], const uint8_t *p)
+{
+    uint32_t w[64], a, b, c, d, e, f, g, k;
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        w[i] = (uint32_t)p[4 * i] << 24 | p[4 * i + 1] << 16 |
+               p[4 * i + 2] << 8 | p[4 * i + 3];
+    }
+    for (i = 16; i < 64; i++) {
+        uint32_t s0 = ror(w[i - 15], 7) ^ ror(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ror(w[i - 2], 17) ^ ror(w[i - 2], 19) ^ (w[i - 2] >> 10);
+
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    a = h[0], b = h[1], c = h[2], d = h[3];
+    e = h[4], f = h[5], g = h[6], k = h[7];
+    for (i = 0; i < 64; i++) {
+        uint32_t t1 = k + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) +
+                      ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+        uint32_t t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) +
+                      ((a & b) ^ (a & c) ^ (b & c));
+
+        k = g, g = f, f = e, e = d + t1;
+        d = c, c = b, b = a, a = t1 + t2;
+    }
+    h[0] += a, h[1] += b, h[2] += c, h[3] += d;
+    h[4] += e, h[5] += f, h[6] += g, h[7] += k;
+}
+
+/*
+ * Guest crypto instructions
+ */
+
+#if defined(HAVE_X86_AES)
+
+#define IMPL "aes-ni"
+
+#define EXPAND(n, rcon) do {                                            \
+        __m128i t = _mm_aeskeygenassist_si128(k, rcon);                 \
+        t = _mm_shuffle_epi32(t, 0xff);                                 \
+        k = _mm_xor_si128(k, _mm_slli_si128(k, 4));                     \
+        k = _mm_xor_si128(k, _mm_slli_si128(k, 4));                     \
+        k = _mm_xor_si128(k, _mm_slli_si128(k, 4));                     \
+        k = _mm_xor_si128(k, t);                                        \
+        _mm_storeu_si128((__m128i *)key->rk[n], k);                     \
+    } while (0)
+
+static void expand_key(AESKey *key, const uint8_t *user)
+{
+    __m128i k = _mm_loadu_si128((const __m128i *)user);
+
+    _mm_storeu_si128((__m128i *)key->rk[0], k);
+    EXPAND(1, 0x01);
+    EXPAND(2, 0x02);
+    EXPAND(3, 0x04);
+    EXPAND(4, 0x08);
+    EXPAND(5, 0x10);
+    EXPAND(6, 0x20);
+    EXPAND(7, 0x40);
+    EXPAND(8, 0x80);
+    EXPAND(9, 0x1b);
+    EXPAND(10, 0x36);
+}
+
+static __m128i encrypt_block(const __m128i *rk, __m128i s)
+{
+    int r;
+
+    s = _mm_xor_si128(s, rk[0]);
+    for (r = 1; r < 10; r++) {
+        s = _mm_aesenc_si128(s, rk[r]);
+    }
+    return _mm_aesenclast_si128(s, rk[10]);
+}
+
+static void aes_ctr(const AESKey *key, uint8_t *dst, const uint8_t *src,
+                    size_t len)
+{
+    __m128i rk[11], ctr = _mm_setzero_si128();
+    size_t i;
+    int r;
+
+    for (r = 0; r < 11; r++) {
+        rk[r] = _mm_loadu_si128((const __m128i *)key->rk[r]);
+    }
+    for (i = 0; i < len; i += 16) {
+        __m128i ks = encrypt_block(rk, ctr);
+        __m128i p = _mm_loadu_si128((const __m128i *)(src + i));
+
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(p, ks));
+        ctr = _mm_add_epi64(ctr, _mm_set_epi64x(0, 1));
+    }
+}
+
+static void aes_cbc_dec(const AESKey *key, uint8_t *dst, const uint8_t *src,
+                        size_t len)
+{
+    __m128i dk[11], iv = _mm_setzero_si128();
+    size_t i;
+    int r;
+
+    /* Equivalent inverse cipher: InvMixColumns on the middle keys */
+    dk[0] = _mm_loadu_si128((const __m128i *)key->rk[10]);
+    for (r = 1; r < 10; r++) {
+        dk[r] = _mm_aesimc_si128(
+            _mm_loadu_si128((const __m128i *)key->rk[10 - r]));
+    }
+    dk[10] = _mm_loadu_si128((const __m128i *)key->rk[0]);
+
+    for (i = 0; i < len; i += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i s = _mm_xor_si128(c, dk[0]);
+
+        for (r = 1; r < 10; r++) {
+            s = _mm_aesdec_si128(s, dk[r]);
+        }
+        s = _mm_aesdeclast_si128(s, dk[10]);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(s, iv));
+        iv = c;
+    }
+}
+
+static void clmul_fold(uint64_t acc[2], const uint64_t *p, size_t n,
+                       uint64_t h)
+{
+    __m128i a = _mm_setzero_si128();
+    __m128i hv = _mm_set_epi64x(0, h);
+    size_t i;
+
+    for (i = 0; i < n; i += 2) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+
+        a = _mm_xor_si128(a, _mm_clmulepi64_si128(x, hv, 0x00));
+        a = _mm_xor_si128(a, _mm_clmulepi64_si128(x, hv, 0x01));
+    }
+    _mm_storeu_si128((__m128i *)acc, a);
+}
+
+static void sha256_block(uint32_t h[8], const uint8_t *p)
+{
+    /* x86 guests have no SHA-NI in TCG */
+    ref_sha256_block(h, p);
+}
+
+#elif defined(HAVE_ARM_CE)
+
+#define IMPL "armv8-ce"
+
+static void expand_key(AESKey *key, const uint8_t *user)
+{
+    ref_expand_key(key, user);
+}
+
+static uint8x16_t encrypt_block(const uint8x16_t *rk, uint8x16_t s)
+{
+    int r;
+
+    for (r = 0; r < 9; r++) {
+        s = vaesmcq_u8(vaeseq_u8(s, rk[r]));
+    }
+    return veorq_u8(vaeseq_u8(s, rk[9]), rk[10]);
+}
+
+static void aes_ctr(const AESKey *key, uint8_t *dst, const uint8_t *src,
+                    size_t len)
+{
+    uint8x16_t rk[11];
+    uint64x2_t ctr = vdupq_n_u64(0);
+    uint64x2_t one = vsetq_lane_u64(1, vdupq_n_u64(0), 0);
+    size_t i;
+    int r;
+
+    for (r = 0; r < 11; r++) {
+        rk[r] = vld1q_u8(key->rk[r]);
+    }
+    for (i = 0; i < len; i += 16) {
+        uint8x16_t ks = encrypt_block(rk, vreinterpretq_u8_u64(ctr));
+
+        vst1q_u8(dst + i, veorq_u8(vld1q_u8(src + i), ks));
+        ctr = vaddq_u64(ctr, one);
+    }
+}
+
+static void aes_cbc_dec(const AESKey *key, uint8_t *dst, const uint8_t *src,
+                        size_t len)
+{
+    uint8x16_t dk[11], iv = vdupq_n_u8(0);
+    size_t i;
+    int r;
+
+    /* Equivalent inverse cipher: InvMixColumns on the middle keys */
+    dk[0] = vld1q_u8(key->rk[10]);
+    for (r = 1; r < 10; r++) {
+        dk[r] = vaesimcq_u8(vld1q_u8(key->rk[10 - r]));
+    }
+    dk[10] = vld1q_u8(key->rk[0]);
+
+    for (i = 0; i < len; i += 16) {
+        uint8x16_t c = vld1q_u8(src + i);
+        uint8x16_t s = vaesdq_u8(c, dk[0]);
+
+        for (r = 1; r < 10; r++) {
+            s = vaesdq_u8(vaesimcq_u8(s), dk[r]);
+        }
+        s = veorq_u8(s, dk[10]);
+        vst1q_u8(dst + i, veorq_u8(s, iv));
+        iv = c;
+    }
+}
+
+static void clmul_fold(uint64_t acc[2], const uint64_t *p, size_t n,
+                       uint64_t h)
+{
+    uint8x16_t a = vdupq_n_u8(0);
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        poly128_t r = vmull_p64((poly64_t)p[i], (poly64_t)h);
+
+        a = veorq_u8(a, vreinterpretq_u8_p128(r));
+    }
+    vst1q_u8((uint8_t *)acc, a);
+}
+
+static void sha256_block(uint32_t h[8], const uint8_t *p)
+{
+    uint32x4_t abcd = vld1q_u32(h), efgh = vld1q_u32(h + 4);
+    uint32x4_t abcd0 = abcd, efgh0 = efgh;
+    uint32x4_t m[4];
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        m[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p + 16 * i)));
+    }
+    for (i = 0; i < 16; i++) {
+        uint32x4_t wk = vaddq_u32(m[i & 3], vld1q_u32(sha256_k + 4 * i));
+        uint32x4_t t = abcd;
+
+        if (i < 12) {
+            m[i & 3] = vsha256su1q_u32(vsha256su0q_u32(m[i & 3],
+                                                       m[(i + 1) & 3]),
+                                       m[(i + 2) & 3], m[(i + 3) & 3]);
+        }
+        abcd = vsha256hq_u32(abcd, efgh, wk);
+        efgh = vsha256h2q_u32(efgh, t, wk);
+    }
+    vst1q_u32(h, vaddq_u32(abcd, abcd0));
+    vst1q_u32(h + 4, vaddq_u32(efgh, efgh0));
+}
+
+#else
+
+#define IMPL "c"
+
+#define expand_key      ref_expand_key
+#define aes_ctr         ref_aes_ctr
+#define aes_cbc_dec     ref_aes_cbc_dec
+#define clmul_fold      ref_clmul_fold
+#define sha256_block    ref_sha256_block
+
+#endif
+
+static void ref_aes_ctr(const AESKey *key, uint8_t *dst, const uint8_t *src,
+                        size_t len)
+{
+    uint8_t ctr[16] = { 0 }, ks[16];
+    size_t i;
+    int j;
+
+    for (i = 0; i < len; i += 16) {
+        ref_encrypt(key, ks, ctr);
+        for (j = 0; j < 16; j++) {
+            dst[i + j] = src[i + j] ^ ks[j];
+        }
+        /* Little-endian 64-bit counter in the low half */
+        for (j = 0; j < 8 && ++ctr[j] == 0; j++) {
+            continue;
+        }
+    }
+}
+
+static void ref_aes_cbc_dec(const AESKey *key, uint8_t *dst,
+                            const uint8_t *src, size_t len)
+{
+    uint8_t iv[16] = { 0 };
+    size_t i;
+    int j;
+
+    for (i = 0; i < len; i += 16) {
+        ref_decrypt(key, dst + i, src + i);
+        for (j = 0; j < 16; j++) {
+            dst[i + j] ^= iv[j];
+        }
+        memcpy(iv, src + i, 16);
+    }
+}
+
+static void ref_clmul_fold(uint64_t acc[2], const uint64_t *p, size_t n,
+                           uint64_t h)
+{
+    size_t i;
+
+    acc[0] = acc[1] = 0;
+    for (i = 0; i < n; i++) {
+        uint64_t lo, hi;
+
+        ref_clmul(&lo, &hi, p[i], h);
+        acc[0] ^= lo;
+        acc[1] ^= hi;
+    }
+}
+
+static void sha256(uint32_t h[8], const uint8_t *p, size_t len,
+                   void (*block)(uint32_t *, const uint8_t *))
+{
+    uint8_t last[128] = { 0 };
+    size_t rem = len % 64, pad = rem < 56 ? 64 : 128;
+    uint64_t bits = (uint64_t)len * 8;
+    int i;
+
+    memcpy(h, sha256_iv, sizeof(sha256_iv));
+    for (; len >= 64; len -= 64, p += 64) {
+        block(h, p);
+    }
+    memcpy(last, p, rem);
+    last[rem] = 0x80;
+    for (i = 0; i < 8; i++) {
+        last[pad - 1 - i] = bits >> (8 * i);
+    }
+    block(h, last);
+    if (pad == 128) {
+        block(h, last + 64);
+    }
+}
+
+static int check_kat(void)
+{
+    /* FIPS-197 appendix C.1 */
+    static const uint8_t user[16] = {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+        0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+    };
+    static const uint8_t pt[16] = {
+        0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+        0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff,
+    };
+    static const uint8_t ct[16] = {
+        0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+        0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a,
+    };
+    /* SHA-256("abc"), FIPS 180-2 appendix B.1 */
+    static const uint32_t abc[8] = {
+        0xba7816bf, 0x8f01cfea, 0x414140de, 0x5dae2223,
+        0xb00361a3, 0x96177a9c, 0xb410ff61, 0xf20015ad,
+    };
+    AESKey key, key_ref;
+    uint8_t blk[16], ks[16], zero[16] = { 0 };
+    uint32_t h[8];
+    int err = 0;
+
+    expand_key(&key, user);
+    ref_expand_key(&key_ref, user);
+    if (memcmp(&key, &key_ref, sizeof(key))) {
+        printf("FAIL: AES-128 key expansion\n");
+        err = 1;
+    }
+
+    ref_encrypt(&key_ref, blk, pt);
+    if (memcmp(blk, ct, 16)) {
+        printf("FAIL: reference AES-128 encryption\n");
+        err = 1;
+    }
+    ref_decrypt(&key_ref, blk, ct);
+    if (memcmp(blk, pt, 16)) {
+        printf("FAIL: reference AES-128 decryption\n");
+        err = 1;
+    }
+
+    /* With a zero counter or IV, the first block is a single AES block */
+    ref_encrypt(&key_ref, ks, zero);
+    aes_ctr(&key, blk, zero, 16);
+    if (memcmp(blk, ks, 16)) {
+        printf("FAIL: AES-128 encryption\n");
+        err = 1;
+    }
+    aes_cbc_dec(&key, blk, ct, 16);
+    if (memcmp(blk, pt, 16)) {
+        printf("FAIL: AES-128 decryption\n");
+        err = 1;
+    }
+
+    sha256(h, (const uint8_t *)"abc", 3, sha256_block);
+    if (memcmp(h, abc, sizeof(abc))) {
+        printf("FAIL: SHA-256(\"abc\")\n");
+        err = 1;
+    }
+    return err;
+}
+
+int main(int argc, char **argv)
+{
+    static const uint8_t user[16] = "0123456789abcdef";
+    int iters = argc > 1 ? atoi(argv[1]) : ITERS;
+    unsigned int seed = 1;
+    uint64_t acc[2], acc_ref[2];
+    uint32_t h[8], h_ref[8];
+    AESKey key;
+    double t0, t1;
+    int i, err;
+
+    if (iters < 1) {
+        iters = 1;
+    }
+    init_sbox();
+    for (i = 0; i < BUF_SIZE; i++) {
+        buf[i] = rand_r(&seed);
+    }
+    expand_key(&key, user);
+
+    printf("implementation: %s\n", IMPL);
+    err = check_kat();
+
+    t0 = now();
+    for (i = 0; i < iters; i++) {
+        aes_ctr(&key, out, buf, BUF_SIZE);
+    }
+    t1 = now();
+    printf("aes-128-ctr: %.2f MB/s\n",
+           (double)BUF_SIZE * iters / (t1 - t0) / 1e6);
+    ref_aes_ctr(&key, ref, buf, BUF_SIZE);
+    if (memcmp(out, ref, BUF_SIZE)) {
+        printf("FAIL: AES-128-CTR\n");
+        err = 1;
+    }
+
+    t0 = now();
+    for (i = 0; i < iters; i++) {
+        aes_cbc_dec(&key, out, buf, BUF_SIZE);
+    }
+    t1 = now();
+    printf("aes-128-cbc decrypt: %.2f MB/s\n",
+           (double)BUF_SIZE * iters / (t1 - t0) / 1e6);
+    ref_aes_cbc_dec(&key, ref, buf, BUF_SIZE);
+    if (memcmp(out, ref, BUF_SIZE)) {
+        printf("FAIL: AES-128-CBC decryption\n");
+        err = 1;
+    }
+
+    t0 = now();
+    for (i = 0; i < iters; i++) {
+        clmul_fold(acc, (const uint64_t *)buf, BUF_SIZE / 8,
+                   0x87654321deadbeefull);
+    }
+    t1 = now();
+    printf("clmul fold: %.2f MB/s\n",
+           (double)BUF_SIZE * iters / (t1 - t0) / 1e6);
+    ref_clmul_fold(acc_ref, (const uint64_t *)buf, BUF_SIZE / 8,
+                   0x87654321deadbeefull);
+    if (memcmp(acc, acc_ref, sizeof(acc))) {
+        printf("FAIL: carry-less multiply\n");
+        err = 1;
+    }
+
+    t0 = now();
+    for (i = 0; i < iters; i++) {
+        sha256(h, buf, BUF_SIZE, sha256_block);
+    }
+    t1 = now();
+    printf("sha-256: %.2f MB/s\n",
+           (double)BUF_SIZE * iters / (t1 - t0) / 1e6);
+    sha256(h_ref, buf, BUF_SIZE, ref_sha256_block);
+    if (memcmp(h, h_ref, sizeof(h))) {
+        printf("FAIL: SHA-256\n");
+        err = 1;
+    }
+
+    return err;
+}
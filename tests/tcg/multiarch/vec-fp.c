@@ -0,0 +1,133 @@
+/*
+ * Vector floating point kernels
+ *
+ * Runs a few packed single and double precision add/mul/div kernels,
+ * which compile to NEON on aarch64 and SSE on x86_64, checks them
+ * against the same computation done lane by lane and reports the
+ * throughput.  This exercises the lane-batched softfloat paths of the
+ * vector helpers.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef float v4sf __attribute__((vector_size(16)));
+typedef double v2df __attribute__((vector_size(16)));
+
+#define N_VEC   256
+#define ITERS   200
+
+static v4sf fa[N_VEC], fb[N_VEC], fd[N_VEC];
+static v2df da[N_VEC], db[N_VEC], dd[N_VEC];
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void init(void)
+{
+    unsigned int seed = 1;
+    int i, j;
+
+    for (i = 0; i < N_VEC; i++) {
+        for (j = 0; j < 4; j++) {
+            fa[i][j] = (float)rand_r(&seed) / RAND_MAX + 0.5f;
+            fb[i][j] = (float)rand_r(&seed) / RAND_MAX + 0.5f;
+        }
+        for (j = 0; j < 2; j++) {
+            da[i][j] = (double)rand_r(&seed) / RAND_MAX + 0.5;
+            db[i][j] = (double)rand_r(&seed) / RAND_MAX + 0.5;
+        }
+    }
+}
+
+/* d = (a + b) * a / b, packed */
+static void __attribute__((noinline)) kernel_f32(int iters)
+{
+    int i, n;
+
+    for (n = 0; n < iters; n++) {
+        for (i = 0; i < N_VEC; i++) {
+            fd[i] = (fa[i] + fb[i]) * fa[i] / fb[i];
+        }
+    }
+}
+
+static void __attribute__((noinline)) kernel_f64(int iters)
+{
+    int i, n;
+
+    for (n = 0; n < iters; n++) {
+        for (i = 0; i < N_VEC; i++) {
+            dd[i] = (da[i] + db[i]) * da[i] / db[i];
+        }
+    }
+}
+
+/*
+ * Targets that evaluate in extended precision (x87, m68k) may legitimately
+ * differ from the stepwise-rounded reference, so only compare bits when
+ * every operation rounds to its type.
+ */
+static int check(void)
+{
+#if FLT_EVAL_METHOD != 0
+    return 0;
+#else
+    volatile float fr;
+    volatile double dr;
+    int i, j, err = 0;
+
+    for (i = 0; i < N_VEC; i++) {
+        for (j = 0; j < 4; j++) {
+            fr = fa[i][j] + fb[i][j];
+            fr = fr * fa[i][j];
+            fr = fr / fb[i][j];
+            if (memcmp((const void *)&fr, &fd[i][j], sizeof(float))) {
+                printf("FAIL: f32 vector %d lane %d: %a != %a\n",
+                       i, j, fd[i][j], fr);
+                err = 1;
+            }
+        }
+        for (j = 0; j < 2; j++) {
+            dr = da[i][j] + db[i][j];
+            dr = dr * da[i][j];
+            dr = dr / db[i][j];
+            if (memcmp((const void *)&dr, &dd[i][j], sizeof(double))) {
+                printf("FAIL: f64 vector %d lane %d: %a != %a\n",
+                       i, j, dd[i][j], dr);
+                err = 1;
+            }
+        }
+    }
+    return err;
+#endif
+}
+
+int main(int argc, char **argv)
+{
+    int iters = argc > 1 ? atoi(argv[1]) : ITERS;
+    double t0, t1, t2;
+
+    init();
+
+    t0 = now();
+    kernel_f32(iters);
+    t1 = now();
+    kernel_f64(iters);
+    t2 = now();
+
+    printf("f32: %.2f MFlops\n", 3.0 * 4 * N_VEC * iters / (t1 - t0) / 1e6);
+    printf("f64: %.2f MFlops\n", 3.0 * 2 * N_VEC * iters / (t2 - t1) / 1e6);
+
+    return check();
+}
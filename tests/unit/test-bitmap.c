@@ -123,6 +123,130 @@ static void check_bitmap_set(void)
     bitmap_set_case(bitmap_set_atomic);
 }
 
+#define BMAP_FETCH_SIZE  (200 * BITS_PER_LONG)
+
+static void bitmap_fetch_and_clear_case(long start, long nr)
+{
+    unsigned long *bmap = bitmap_new(BMAP_FETCH_SIZE);
+    unsigned long *orig = bitmap_new(BMAP_FETCH_SIZE);
+    g_autofree unsigned long *fetched = NULL;
+    long i;
+
+    for (i = 0; i < BITS_TO_LONGS(BMAP_FETCH_SIZE); i++) {
+        bmap[i] = g_test_rand_int();
+    }
+    /* A clean run of words, so that buffer_is_zero() skips some */
+    bitmap_clear(bmap, 66 * BITS_PER_LONG, 128 * BITS_PER_LONG);
+    /* Make sure the range is dirty, and the bits around it too */
+    set_bit(start, bmap);
+    if (start > 0) {
+        set_bit(start - 1, bmap);
+    }
+    set_bit(start + nr, bmap);
+    bitmap_copy(orig, bmap, BMAP_FETCH_SIZE);
+
+    fetched = bitmap_fetch_and_clear_atomic(bmap, start, nr);
+    g_assert(fetched);
+    for (i = 0; i < BMAP_FETCH_SIZE; i++) {
+        if (i >= start && i < start + nr) {
+            g_assert_cmpint(test_bit(i - start, fetched), ==,
+                            test_bit(i, orig));
+            g_assert_false(test_bit(i, bmap));
+        } else {
+            g_assert_cmpint(test_bit(i, bmap), ==, test_bit(i, orig));
+        }
+    }
+
+    /* Now the range is clean, whatever its neighbours */
+    g_assert_null(bitmap_fetch_and_clear_atomic(bmap, start, nr));
+    g_assert(start == 0 || test_bit(start - 1, bmap));
+    g_assert(test_bit(start + nr, bmap));
+
+    g_free(bmap);
+    g_free(orig);
+}
+
+static void check_bitmap_fetch_and_clear_atomic(void)
+{
+    long start;
+
+    for (start = 0; start <= BITS_PER_LONG + 1; start++) {
+        /* Within a single word, or crossing into the next one */
+        bitmap_fetch_and_clear_case(start, 1);
+        bitmap_fetch_and_clear_case(start, 3);
+        /* Partial first and last words around full ones */
+        bitmap_fetch_and_clear_case(start, 2 * BITS_PER_LONG);
+        bitmap_fetch_and_clear_case(start, 3 * BITS_PER_LONG - 1);
+        /* More than one scan with buffer_is_zero() */
+        bitmap_fetch_and_clear_case(start, BMAP_FETCH_SIZE - start - 1);
+    }
+}
+
+#define BMAP_SEARCH_SIZE  (64 * BITS_PER_LONG + 37)
+
+/*
+ * Compare find_next_bit(), find_next_zero_bit() and bitmap_count_one() with
+ * the result of test_bit() for every starting offset.  Long runs of equal
+ * words are needed to exercise the vectorized code.
+ */
+static void bitmap_search_case(unsigned long *bmap)
+{
+    long next_set = BMAP_SEARCH_SIZE, next_zero = BMAP_SEARCH_SIZE;
+    long count = 0;
+    long i;
+
+    for (i = BMAP_SEARCH_SIZE - 1; i >= 0; i--) {
+        if (test_bit(i, bmap)) {
+            next_set = i;
+            count++;
+        } else {
+            next_zero = i;
+        }
+        g_assert_cmpint(find_next_bit(bmap, BMAP_SEARCH_SIZE, i),
+                        ==, next_set);
+        g_assert_cmpint(find_next_zero_bit(bmap, BMAP_SEARCH_SIZE, i),
+                        ==, next_zero);
+        g_assert_cmpint(bitmap_count_one_with_offset(bmap, i,
+                                                     BMAP_SEARCH_SIZE - i),
+                        ==, count);
+    }
+    g_assert_cmpint(bitmap_count_one(bmap, BMAP_SEARCH_SIZE), ==, count);
+}
+
+static void check_bitmap_search(void)
+{
+    unsigned long *bmap = bitmap_new(BMAP_SEARCH_SIZE);
+    int i;
+
+    do {
+        /* Sparse: a few isolated bits, including at both ends */
+        bitmap_zero(bmap, BMAP_SEARCH_SIZE);
+        bitmap_search_case(bmap);
+        set_bit(0, bmap);
+        set_bit(BMAP_SEARCH_SIZE - 1, bmap);
+        for (i = 0; i < 8; i++) {
+            set_bit(g_test_rand_int_range(0, BMAP_SEARCH_SIZE), bmap);
+        }
+        bitmap_search_case(bmap);
+
+        /* Dense: a few isolated holes */
+        bitmap_fill(bmap, BMAP_SEARCH_SIZE);
+        bitmap_search_case(bmap);
+        for (i = 0; i < 8; i++) {
+            clear_bit(g_test_rand_int_range(0, BMAP_SEARCH_SIZE), bmap);
+        }
+        bitmap_search_case(bmap);
+
+        /* Random */
+        for (i = 0; i < BITS_TO_LONGS(BMAP_SEARCH_SIZE); i++) {
+            bmap[i] = g_test_rand_int();
+        }
+        bitmap_search_case(bmap);
+    } while (test_bitops_next_accel());
+
+    g_free(bmap);
+}
+
 int main(int argc, char **argv)
 {
     g_test_init(&argc, &argv, NULL);
@@ -131,6 +255,10 @@ int main(int argc, char **argv)
                     check_bitmap_copy_with_offset);
     g_test_add_func("/bitmap/bitmap_set",
                     check_bitmap_set);
+    g_test_add_func("/bitmap/bitmap_search",
+                    check_bitmap_search);
+    g_test_add_func("/bitmap/bitmap_fetch_and_clear_atomic",
+                    check_bitmap_fetch_and_clear_atomic);
 
     g_test_run();
 
@@ -0,0 +1,331 @@
+/*
+ * Test the AES round, carry-less multiply and SHA round functions used
+ * by the TCG frontends, in both their generic and accelerated versions.
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bitops.h"
+#include "crypto/aes.h"
+#include "crypto/aes-round.h"
+#include "crypto/clmul.h"
+#include "crypto/sha-round.h"
+
+/* Run @fn with the host's accelerated functions, if any, and without. */
+static void for_each_impl(void (*fn)(void))
+{
+    unsigned accel = host_crypto_accel;
+
+    fn();
+    if (accel) {
+        host_crypto_accel = 0;
+        fn();
+        host_crypto_accel = accel;
+    }
+}
+
+static void random_state(AESState *st)
+{
+    st->d[0] = g_test_rand_int() | (uint64_t)g_test_rand_int() << 32;
+    st->d[1] = g_test_rand_int() | (uint64_t)g_test_rand_int() << 32;
+}
+
+static void assert_state_equal(const AESState *a, const AESState *b)
+{
+    g_assert(memcmp(a, b, sizeof(AESState)) == 0);
+}
+
+/* FIPS-197, Appendix C.1 */
+static const uint8_t aes_key[16] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+};
+static const uint8_t aes_plain[16] = {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+    0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff,
+};
+static const uint8_t aes_cipher[16] = {
+    0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+    0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a,
+};
+
+static void do_test_aes_kat(void)
+{
+    AESState rk[11], dk[11], st;
+    AES_KEY key;
+    int i, j;
+
+    /* The key schedule words are big-endian, the state is in byte order */
+    AES_set_encrypt_key(aes_key, 128, &key);
+    for (i = 0; i < 11; i++) {
+        for (j = 0; j < 4; j++) {
+            rk[i].w[j] = cpu_to_be32(key.rd_key[4 * i + j]);
+        }
+    }
+
+    /* Round keys for the equivalent inverse cipher */
+    dk[0] = rk[0];
+    dk[10] = rk[10];
+    for (i = 1; i < 10; i++) {
+        aesdec_IMC(&dk[i], &rk[i]);
+    }
+
+    memcpy(&st, aes_plain, 16);
+    st.d[0] ^= rk[0].d[0];
+    st.d[1] ^= rk[0].d[1];
+    for (i = 1; i < 10; i++) {
+        aesenc_SB_SR_MC_AK(&st, &st, &rk[i]);
+    }
+    aesenc_SB_SR_AK(&st, &st, &rk[10]);
+    g_assert(memcmp(&st, aes_cipher, 16) == 0);
+
+    st.d[0] ^= dk[10].d[0];
+    st.d[1] ^= dk[10].d[1];
+    for (i = 9; i > 0; i--) {
+        aesdec_ISB_ISR_IMC_AK(&st, &st, &dk[i]);
+    }
+    aesdec_ISB_ISR_AK(&st, &st, &dk[0]);
+    g_assert(memcmp(&st, aes_plain, 16) == 0);
+}
+
+static void test_aes_kat(void)
+{
+    for_each_impl(do_test_aes_kat);
+}
+
+static void do_test_aes_fragments(void)
+{
+    AESState st, t, u, zero = { };
+    int i, n;
+
+    for (n = 0; n < 1000; n++) {
+        random_state(&st);
+
+        aesenc_SB(&t, &st);
+        for (i = 0; i < 16; i++) {
+            g_assert_cmpint(t.b[i], ==, AES_sbox[st.b[i]]);
+        }
+
+        /* MixColumns is the middle round without SubBytes and ShiftRows */
+        aesenc_MC(&t, &st);
+        aesdec_ISB_ISR_AK(&u, &st, &zero);
+        aesenc_SB_SR_MC_AK(&u, &u, &zero);
+        assert_state_equal(&t, &u);
+
+        aesdec_IMC(&u, &t);
+        assert_state_equal(&u, &st);
+    }
+}
+
+static void test_aes_fragments(void)
+{
+    for_each_impl(do_test_aes_fragments);
+}
+
+static void test_aes_accel(void)
+{
+    AESState st, rk, a, b;
+    int n;
+
+    if (!HAVE_AES_ACCEL) {
+        g_test_skip("no accelerated AES on this host");
+        return;
+    }
+
+    for (n = 0; n < 1000; n++) {
+        random_state(&st);
+        random_state(&rk);
+
+        aesenc_SB_gen(&a, &st);
+        aesenc_SB_accel(&b, &st);
+        assert_state_equal(&a, &b);
+        aesenc_MC_gen(&a, &st);
+        aesenc_MC_accel(&b, &st);
+        assert_state_equal(&a, &b);
+        aesenc_SB_SR_AK_gen(&a, &st, &rk);
+        aesenc_SB_SR_AK_accel(&b, &st, &rk);
+        assert_state_equal(&a, &b);
+        aesenc_SB_SR_MC_AK_gen(&a, &st, &rk);
+        aesenc_SB_SR_MC_AK_accel(&b, &st, &rk);
+        assert_state_equal(&a, &b);
+        aesdec_IMC_gen(&a, &st);
+        aesdec_IMC_accel(&b, &st);
+        assert_state_equal(&a, &b);
+        aesdec_ISB_ISR_AK_gen(&a, &st, &rk);
+        aesdec_ISB_ISR_AK_accel(&b, &st, &rk);
+        assert_state_equal(&a, &b);
+        aesdec_ISB_ISR_IMC_AK_gen(&a, &st, &rk);
+        aesdec_ISB_ISR_IMC_AK_accel(&b, &st, &rk);
+        assert_state_equal(&a, &b);
+    }
+}
+
+static void do_test_clmul(void)
+{
+    Int128 r;
+    int i;
+
+    /* The square of a polynomial only has even powers */
+    r = clmul_64(-1, -1);
+    g_assert_cmphex(int128_getlo(r), ==, 0x5555555555555555ull);
+    g_assert_cmphex(int128_gethi(r), ==, 0x5555555555555555ull);
+
+    for (i = 0; i < 64; i++) {
+        uint64_t n = g_test_rand_int() | (uint64_t)g_test_rand_int() << 32;
+
+        r = clmul_64(n, 1ull << i);
+        g_assert_cmphex(int128_getlo(r), ==, n << i);
+        g_assert_cmphex(int128_gethi(r), ==, i ? n >> (64 - i) : 0);
+    }
+}
+
+static void test_clmul(void)
+{
+    for_each_impl(do_test_clmul);
+}
+
+static void test_clmul_accel(void)
+{
+    int n;
+
+    if (!HAVE_CLMUL_ACCEL) {
+        g_test_skip("no accelerated carry-less multiply on this host");
+        return;
+    }
+
+    for (n = 0; n < 1000; n++) {
+        uint64_t a = g_test_rand_int() | (uint64_t)g_test_rand_int() << 32;
+        uint64_t b = g_test_rand_int() | (uint64_t)g_test_rand_int() << 32;
+
+        g_assert(int128_eq(clmul_64_gen(a, b), clmul_64_accel(a, b)));
+    }
+}
+
+/* The one-block message "abc", padded */
+static void sha_abc_block(uint32_t w[16])
+{
+    memset(w, 0, 16 * sizeof(uint32_t));
+    w[0] = 0x61626380;
+    w[15] = 24;
+}
+
+static void do_test_sha1(void)
+{
+    static const uint32_t k[4] = {
+        0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6
+    };
+    static const SHA1Func f[4] = {
+        SHA1_CHOOSE, SHA1_PARITY, SHA1_MAJORITY, SHA1_PARITY
+    };
+    static const uint32_t digest[5] = {
+        0xa9993e36, 0x4706816a, 0xba3e2571, 0x7850c26c, 0x9cd0d89d
+    };
+    uint32_t h[5] = {
+        0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0
+    };
+    uint32_t w[80], abcd[4], e, wk[4];
+    int i, j;
+
+    sha_abc_block(w);
+    for (i = 16; i < 80; i++) {
+        w[i] = rol32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    memcpy(abcd, h, sizeof(abcd));
+    e = h[4];
+    for (i = 0; i < 80; i += 4) {
+        uint32_t a = abcd[0];
+
+        for (j = 0; j < 4; j++) {
+            wk[j] = w[i + j] + k[i / 20];
+        }
+        sha1_rounds4(abcd, e, wk, f[i / 20]);
+        e = rol32(a, 30);
+    }
+
+    for (i = 0; i < 4; i++) {
+        g_assert_cmphex(h[i] + abcd[i], ==, digest[i]);
+    }
+    g_assert_cmphex(h[4] + e, ==, digest[4]);
+}
+
+static void test_sha1(void)
+{
+    for_each_impl(do_test_sha1);
+}
+
+static void do_test_sha256(void)
+{
+    static const uint32_t k[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+        0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+        0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+        0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+        0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+        0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+        0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+        0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+        0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+    static const uint32_t digest[8] = {
+        0xba7816bf, 0x8f01cfea, 0x414140de, 0x5dae2223,
+        0xb00361a3, 0x96177a9c, 0xb410ff61, 0xf20015ad,
+    };
+    uint32_t h[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    uint32_t w[64], abcd[4], efgh[4], wk[4];
+    int i, j;
+
+    sha_abc_block(w);
+    for (i = 16; i < 64; i += 4) {
+        memcpy(&w[i], &w[i - 16], 4 * sizeof(uint32_t));
+        sha256_msg1(&w[i], &w[i - 12]);
+        for (j = 0; j < 4; j++) {
+            w[i + j] += w[i + j - 7];
+        }
+        sha256_msg2(&w[i], &w[i - 4]);
+    }
+
+    memcpy(abcd, &h[0], sizeof(abcd));
+    memcpy(efgh, &h[4], sizeof(efgh));
+    for (i = 0; i < 64; i += 4) {
+        for (j = 0; j < 4; j++) {
+            wk[j] = w[i + j] + k[i + j];
+        }
+        sha256_rounds4(abcd, efgh, wk);
+    }
+
+    for (i = 0; i < 4; i++) {
+        g_assert_cmphex(h[i] + abcd[i], ==, digest[i]);
+        g_assert_cmphex(h[i + 4] + efgh[i], ==, digest[i + 4]);
+    }
+}
+
+static void test_sha256(void)
+{
+    for_each_impl(do_test_sha256);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/crypto/rounds/aes/kat", test_aes_kat);
+    g_test_add_func("/crypto/rounds/aes/fragments", test_aes_fragments);
+    g_test_add_func("/crypto/rounds/aes/accel", test_aes_accel);
+    g_test_add_func("/crypto/rounds/clmul", test_clmul);
+    g_test_add_func("/crypto/rounds/clmul/accel", test_clmul_accel);
+    g_test_add_func("/crypto/rounds/sha1", test_sha1);
+    g_test_add_func("/crypto/rounds/sha256", test_sha256);
+    return g_test_run();
+}
@@ -27,6 +27,7 @@
 #include "io/channel-tls.h"
 #include "io/channel-socket.h"
 #include "io-channel-helpers.h"
+#include "socket-helpers.h"
 #include "crypto/init.h"
 #include "crypto/tlscredsx509.h"
 #include "qapi/error.h"
@@ -34,6 +35,14 @@
 #include "authz/list.h"
 #include "qom/object_interfaces.h"
 
+#ifdef CONFIG_GNUTLS_KTLS
+#include <netinet/tcp.h>
+
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+#endif
+
 #define WORKDIR "tests/test-io-channel-tls-work/"
 #define KEYFILE WORKDIR "key-ctx.pem"
 
@@ -46,6 +55,10 @@ struct QIOChannelTLSTestData {
     bool expectClientFail;
     const char *hostname;
     const char *const *wildcards;
+    const char *priority;
+    bool ktls;
+    /* QCryptoTLSSessionKTLS mask expected if the kernel supports kTLS */
+    int expectKtls;
 };
 
 struct QIOChannelTLSHandshakeData {
@@ -64,7 +77,9 @@ static void test_tls_handshake_done(QIOTask *task,
 
 
 static QCryptoTLSCreds *test_tls_creds_create(QCryptoTLSCredsEndpoint endpoint,
-                                              const char *certdir)
+                                              const char *certdir,
+                                              const char *priority,
+                                              bool ktls)
 {
     Object *parent = object_get_objects_root();
     Object *creds = object_new_with_props(
@@ -77,7 +92,8 @@ static QCryptoTLSCreds *test_tls_creds_create(QCryptoTLSCredsEndpoint endpoint,
                      "server" : "client"),
         "dir", certdir,
         "verify-peer", "yes",
-        "priority", "NORMAL",
+        "priority", priority ? priority : "NORMAL",
+        "ktls", ktls ? "yes" : "no",
         /* We skip initial sanity checks here because we
          * want to make sure that problems are being
          * detected at the TLS session validation stage,
@@ -92,6 +108,55 @@ static QCryptoTLSCreds *test_tls_creds_create(QCryptoTLSCredsEndpoint endpoint,
 }
 
 
+/*
+ * kTLS is only available on TCP sockets, so for those tests
+ * connect over the loopback interface instead of using a
+ * socketpair.
+ */
+static void test_tls_tcp_socketpair(int channel[2])
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t addrlen = sizeof(addr);
+    int lsock;
+
+    lsock = qemu_socket(AF_INET, SOCK_STREAM, 0);
+    g_assert(lsock >= 0);
+    g_assert(bind(lsock, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    g_assert(listen(lsock, 1) == 0);
+    g_assert(getsockname(lsock, (struct sockaddr *)&addr, &addrlen) == 0);
+
+    channel[0] = qemu_socket(AF_INET, SOCK_STREAM, 0);
+    g_assert(channel[0] >= 0);
+    g_assert(connect(channel[0], (struct sockaddr *)&addr,
+                     sizeof(addr)) == 0);
+    channel[1] = qemu_accept(lsock, NULL, NULL);
+    g_assert(channel[1] >= 0);
+
+    close(lsock);
+}
+
+
+static bool test_tls_kernel_has_ktls(void)
+{
+#ifdef CONFIG_GNUTLS_KTLS
+    int channel[2];
+    bool ret;
+
+    test_tls_tcp_socketpair(channel);
+    ret = setsockopt(channel[0], IPPROTO_TCP, TCP_ULP,
+                     "tls", sizeof("tls")) == 0;
+    close(channel[0]);
+    close(channel[1]);
+    return ret;
+#else
+    return false;
+#endif
+}
+
+
 /*
  * This tests validation checking of peer certificates
  *
@@ -119,9 +184,21 @@ static void test_io_channel_tls(const void *opaque)
     struct QIOChannelTLSHandshakeData serverHandshake = { false, false };
     QIOChannelTest *test;
     GMainContext *mainloop;
+    bool has_ipv4, has_ipv6;
+
+    if (data->ktls &&
+        (socket_check_protocol_support(&has_ipv4, &has_ipv6) < 0 ||
+         !has_ipv4)) {
+        g_test_skip("IPv4 loopback not available");
+        return;
+    }
 
     /* We'll use this for our fake client-server connection */
-    g_assert(qemu_socketpair(AF_UNIX, SOCK_STREAM, 0, channel) == 0);
+    if (data->ktls) {
+        test_tls_tcp_socketpair(channel);
+    } else {
+        g_assert(qemu_socketpair(AF_UNIX, SOCK_STREAM, 0, channel) == 0);
+    }
 
 #define CLIENT_CERT_DIR "tests/test-io-channel-tls-client/"
 #define SERVER_CERT_DIR "tests/test-io-channel-tls-server/"
@@ -152,12 +229,12 @@ static void test_io_channel_tls(const void *opaque)
 
     clientCreds = test_tls_creds_create(
         QCRYPTO_TLS_CREDS_ENDPOINT_CLIENT,
-        CLIENT_CERT_DIR);
+        CLIENT_CERT_DIR, data->priority, data->ktls);
     g_assert(clientCreds != NULL);
 
     serverCreds = test_tls_creds_create(
         QCRYPTO_TLS_CREDS_ENDPOINT_SERVER,
-        SERVER_CERT_DIR);
+        SERVER_CERT_DIR, data->priority, data->ktls);
     g_assert(serverCreds != NULL);
 
     auth = qauthz_list_new("channeltlsacl",
@@ -224,6 +301,11 @@ static void test_io_channel_tls(const void *opaque)
     g_assert(clientHandshake.failed == data->expectClientFail);
     g_assert(serverHandshake.failed == data->expectServerFail);
 
+    if (data->ktls && test_tls_kernel_has_ktls()) {
+        g_assert_cmpint(clientChanTLS->ktls, ==, data->expectKtls);
+        g_assert_cmpint(serverChanTLS->ktls, ==, data->expectKtls);
+    }
+
     test = qio_channel_test_new();
     qio_channel_test_run_threads(test, false,
                                  QIO_CHANNEL(clientChanTLS),
@@ -289,6 +371,22 @@ int main(int argc, char **argv)
     g_test_add_data_func("/qio/channel/tls/" # name,                    \
                          &name, test_io_channel_tls);
 
+    /*
+     * Without kernel support, the kTLS tests check that the channel
+     * falls back to GNUTLS; with it, that the expected directions
+     * are offloaded.
+     */
+# define TEST_CHANNEL_KTLS(name, caCrt,                                 \
+                           serverCrt, clientCrt,                        \
+                           hostname, wildcards, priority, expectKtls)   \
+    struct QIOChannelTLSTestData name = {                               \
+        caCrt, caCrt, serverCrt, clientCrt,                             \
+        false, false,                                                   \
+        hostname, wildcards, priority, true, expectKtls                 \
+    };                                                                  \
+    g_test_add_data_func("/qio/channel/tls/" # name,                    \
+                         &name, test_io_channel_tls);
+
     /* A perfect CA, perfect client & perfect server */
 
     /* Basic:CA:critical */
@@ -320,6 +418,14 @@ int main(int argc, char **argv)
     TEST_CHANNEL(basic, cacertreq.filename, servercertreq.filename,
                  clientcertreq.filename, false, false,
                  "qemu.org", wildcards);
+    TEST_CHANNEL_KTLS(ktls, cacertreq.filename, servercertreq.filename,
+                      clientcertreq.filename, "qemu.org", wildcards,
+                      NULL, QCRYPTO_TLS_KTLS_TX);
+    TEST_CHANNEL_KTLS(ktls_tls12, cacertreq.filename,
+                      servercertreq.filename, clientcertreq.filename,
+                      "qemu.org", wildcards,
+                      "NORMAL:-VERS-ALL:+VERS-TLS1.2",
+                      QCRYPTO_TLS_KTLS_TX | QCRYPTO_TLS_KTLS_RX);
 
     ret = g_test_run();
 
@@ -80,6 +80,7 @@ struct fuse_session {
     int   vu_socketfd;
     struct fv_VuDev *virtio_dev;
     int thread_pool_size;
+    int poll_max_ns;
 };
 
 struct fuse_chan {
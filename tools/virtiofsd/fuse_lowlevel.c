@@ -2563,6 +2563,7 @@ static const struct fuse_opt fuse_ll_opts[] = {
     LL_OPTION("--socket-group=%s", vu_socket_group, 0),
     LL_OPTION("--fd=%d", vu_listen_fd, 0),
     LL_OPTION("--thread-pool-size=%d", thread_pool_size, 0),
+    LL_OPTION("--poll-max-ns=%d", poll_max_ns, 0),
     FUSE_OPT_END
 };
 
@@ -2583,7 +2584,9 @@ void fuse_lowlevel_help(void)
         "    --socket-path=PATH         path for the vhost-user socket\n"
         "    --socket-group=GRNAME      name of group for the vhost-user socket\n"
         "    --fd=FDNUM                 fd number of vhost-user socket\n"
-        "    --thread-pool-size=NUM     thread pool size limit (default %d)\n",
+        "    --thread-pool-size=NUM     thread pool size limit (default %d)\n"
+        "    --poll-max-ns=NUM          busy poll virtqueues for up to NUM ns\n"
+        "                               (default 0, disabled)\n",
         THREAD_POOL_SIZE);
 }
 
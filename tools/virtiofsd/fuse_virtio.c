@@ -27,6 +27,9 @@
 
 #include "libvhost-user.h"
 
+/* Number of requests that are popped from a virtqueue at once */
+#define FV_POP_BATCH 32
+
 struct fv_VuDev;
 struct fv_QueueInfo {
     pthread_t thread;
@@ -619,6 +622,10 @@ static void *fv_queue_thread(void *opaque)
         }
     }
 
+    pthread_mutex_lock(&qi->vq_lock);
+    vu_queue_set_busy_poll(q, se->poll_max_ns);
+    pthread_mutex_unlock(&qi->vq_lock);
+
     fuse_log(FUSE_LOG_INFO, "%s: Start for queue %d kick_fd %d\n", __func__,
              qi->qidx, qi->kick_fd);
     while (1) {
@@ -670,42 +677,77 @@ static void *fv_queue_thread(void *opaque)
             fuse_log(FUSE_LOG_ERR, "Eventfd_read for queue: %m\n");
             break;
         }
-        /* Mutual exclusion with virtio_loop() */
-        vu_dispatch_rdlock(qi->virtio_dev);
-        pthread_mutex_lock(&qi->vq_lock);
-        /* out is from guest, in is too guest */
-        unsigned int in_bytes, out_bytes;
-        vu_queue_get_avail_bytes(dev, q, &in_bytes, &out_bytes, ~0, ~0);
-
-        fuse_log(FUSE_LOG_DEBUG,
-                 "%s: Queue %d gave evalue: %zx available: in: %u out: %u\n",
-                 __func__, qi->qidx, (size_t)evalue, in_bytes, out_bytes);
-
-        while (1) {
-            FVRequest *req = vu_queue_pop(dev, q, sizeof(FVRequest));
-            if (!req) {
-                break;
-            }
 
-            req->reply_sent = false;
-
-            if (!se->thread_pool_size) {
-                req_list = g_list_prepend(req_list, req);
-            } else {
-                g_thread_pool_push(pool, req, NULL);
+        bool more;
+        do {
+            /* Mutual exclusion with virtio_loop() */
+            vu_dispatch_rdlock(qi->virtio_dev);
+            pthread_mutex_lock(&qi->vq_lock);
+            /* out is from guest, in is too guest */
+            unsigned int in_bytes, out_bytes;
+            vu_queue_get_avail_bytes(dev, q, &in_bytes, &out_bytes, ~0, ~0);
+
+            fuse_log(FUSE_LOG_DEBUG,
+                     "%s: Queue %d gave evalue: %zx available: in: %u out: %u\n",
+                     __func__, qi->qidx, (size_t)evalue, in_bytes, out_bytes);
+
+            unsigned int i, n;
+            do {
+                void *reqs[FV_POP_BATCH];
+
+                n = vu_queue_pop_batch(dev, q, sizeof(FVRequest), reqs,
+                                       FV_POP_BATCH);
+                for (i = 0; i < n; i++) {
+                    FVRequest *req = reqs[i];
+
+                    req->reply_sent = false;
+
+                    if (!se->thread_pool_size) {
+                        req_list = g_list_prepend(req_list, req);
+                    } else {
+                        g_thread_pool_push(pool, req, NULL);
+                    }
+                }
+            } while (n == FV_POP_BATCH);
+
+            pthread_mutex_unlock(&qi->vq_lock);
+            vu_dispatch_unlock(qi->virtio_dev);
+
+            /* Process all the requests. */
+            if (!se->thread_pool_size && req_list != NULL) {
+                req_list = g_list_reverse(req_list);
+                g_list_foreach(req_list, fv_queue_worker, qi);
+                g_list_free(req_list);
+                req_list = NULL;
             }
-        }
-
-        pthread_mutex_unlock(&qi->vq_lock);
-        vu_dispatch_unlock(qi->virtio_dev);
 
-        /* Process all the requests. */
-        if (!se->thread_pool_size && req_list != NULL) {
-            req_list = g_list_reverse(req_list);
-            g_list_foreach(req_list, fv_queue_worker, qi);
-            g_list_free(req_list);
-            req_list = NULL;
-        }
+            /*
+             * With busy polling, keep processing requests without waiting
+             * for kicks as long as the guest keeps submitting them.
+             */
+            more = false;
+            if (se->poll_max_ns) {
+                vu_dispatch_rdlock(qi->virtio_dev);
+                pthread_mutex_lock(&qi->vq_lock);
+                vu_queue_busy_poll_begin(dev, q);
+                pthread_mutex_unlock(&qi->vq_lock);
+
+                /*
+                 * Spin without vq_lock, so that workers can send replies.
+                 * The dispatch lock keeps the ring mapped; drop it between
+                 * checks so that virtio_loop() is not held up either.
+                 */
+                while (!vu_queue_busy_poll(dev, q)) {
+                    vu_dispatch_unlock(qi->virtio_dev);
+                    vu_dispatch_rdlock(qi->virtio_dev);
+                }
+
+                pthread_mutex_lock(&qi->vq_lock);
+                more = vu_queue_busy_poll_end(dev, q);
+                pthread_mutex_unlock(&qi->vq_lock);
+                vu_dispatch_unlock(qi->virtio_dev);
+            }
+        } while (more);
     }
 
     if (pool) {
@@ -354,6 +354,7 @@ static bool aio_dispatch_handler(AioContext *ctx, AioHandler *node)
         aio_node_check(ctx, node->is_external) &&
         node->io_poll_ready) {
         node->io_poll_ready(node->opaque);
+        stat64_add(&ctx->stats.poll_dispatches, 1);
 
         /*
          * Return early since revents was zero. aio_notify() does not count as
@@ -367,6 +368,7 @@ static bool aio_dispatch_handler(AioContext *ctx, AioHandler *node)
         aio_node_check(ctx, node->is_external) &&
         node->io_read) {
         node->io_read(node->opaque);
+        stat64_add(&ctx->stats.fd_dispatches, 1);
 
         /* aio_notify() does not count as progress */
         if (node->opaque != &ctx->notifier) {
@@ -378,6 +380,7 @@ static bool aio_dispatch_handler(AioContext *ctx, AioHandler *node)
         aio_node_check(ctx, node->is_external) &&
         node->io_write) {
         node->io_write(node->opaque);
+        stat64_add(&ctx->stats.fd_dispatches, 1);
         progress = true;
     }
 
@@ -547,6 +550,9 @@ static bool run_poll_handlers(AioContext *ctx, AioHandlerList *ready_list,
         assert(!(max_ns && progress));
     } while (elapsed_time < max_ns && !ctx->fdmon_ops->need_wait(ctx));
 
+    stat64_add(progress ? &ctx->stats.poll_success_ns
+                        : &ctx->stats.poll_wasted_ns, elapsed_time);
+
     if (remove_idle_poll_handlers(ctx, ready_list,
                                   start_time + elapsed_time)) {
         *timeout = 0;
@@ -605,6 +611,9 @@ bool aio_poll(AioContext *ctx, bool blocking)
     bool use_notify_me;
     int64_t timeout;
     int64_t start = 0;
+    int64_t wait_start = 0;
+    int64_t dispatch_start = 0;
+    bool account_time = qatomic_read(&ctx->account_time);
 
     /*
      * There cannot be two concurrent aio_poll calls for the same AioContext (or
@@ -666,7 +675,16 @@ bool aio_poll(AioContext *ctx, bool blocking)
             progress = true;
         }
 
+        if (account_time) {
+            wait_start = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+        }
         ctx->fdmon_ops->wait(ctx, &ready_list, timeout);
+        if (account_time) {
+            dispatch_start = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+            stat64_add(&ctx->stats.blocked_ns, dispatch_start - wait_start);
+        }
+    } else if (account_time) {
+        dispatch_start = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
     }
 
     if (use_notify_me) {
@@ -679,7 +697,8 @@ bool aio_poll(AioContext *ctx, bool blocking)
 
     /* Adjust polling time */
     if (ctx->poll_max_ns) {
-        int64_t block_ns = qemu_clock_get_ns(QEMU_CLOCK_REALTIME) - start;
+        int64_t block_ns = (account_time ? dispatch_start :
+                            qemu_clock_get_ns(QEMU_CLOCK_REALTIME)) - start;
 
         if (block_ns <= ctx->poll_ns) {
             /* This is the sweet spot, no adjustment needed */
@@ -727,6 +746,10 @@ bool aio_poll(AioContext *ctx, bool blocking)
 
     progress |= timerlistgroup_run_timers(&ctx->tlg);
 
+    if (account_time) {
+        stat64_add(&ctx->stats.dispatch_ns,
+                   qemu_clock_get_ns(QEMU_CLOCK_REALTIME) - dispatch_start);
+    }
     return progress;
 }
 
@@ -177,6 +177,7 @@ int aio_bh_poll(AioContext *ctx)
                 ret = 1;
             }
             aio_bh_call(bh);
+            stat64_add(&ctx->stats.bh_runs, 1);
         }
         if (flags & (BH_DELETED | BH_ONESHOT)) {
             g_free(bh);
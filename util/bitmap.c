@@ -13,6 +13,7 @@
 #include "qemu/bitops.h"
 #include "qemu/bitmap.h"
 #include "qemu/atomic.h"
+#include "qemu/cutils.h"
 
 /*
  * bitmaps provide an array of bits, implemented using an
@@ -343,6 +344,79 @@ void bitmap_copy_and_clear_atomic(unsigned long *dst, unsigned long *src,
     }
 }
 
+/* Number of words that are checked for set bits at once */
+#define BITMAP_SCAN_WORDS 64
+
+/**
+ * bitmap_fetch_and_clear_atomic - fetch and clear a range of bits
+ * @map: The bitmap to fetch the bits from, possibly updated concurrently
+ * @start: The bit number of the first bit to fetch
+ * @nr: The number of bits to fetch
+ *
+ * Atomically clear the bits from @start to @start + @nr - 1 of @map, and
+ * return their previous values in a new bitmap of @nr bits whose bit 0
+ * stands for bit @start of @map.  Bits of @map outside of the range are
+ * left untouched, even when they share a word with the range.
+ *
+ * @map is expected to be mostly clean, so it is scanned with
+ * buffer_is_zero() and only the words with bits set are written to.
+ *
+ * Returns: the new bitmap, to be freed with g_free(), or NULL if none of
+ * the bits was set.
+ */
+unsigned long *bitmap_fetch_and_clear_atomic(unsigned long *map,
+                                             long start, long nr)
+{
+    unsigned long *p = map + BIT_WORD(start);
+    long shift = start % BITS_PER_LONG;
+    long nwords = BITS_TO_LONGS(shift + nr);
+    unsigned long *words = NULL, *bitmap;
+    long i, j;
+
+    assert(start >= 0 && nr >= 0);
+
+    for (i = 0; i < nwords; i += BITMAP_SCAN_WORDS) {
+        long n = MIN(BITMAP_SCAN_WORDS, nwords - i);
+
+        /* Non-atomic check first: much cheaper, and clean is common */
+        if (buffer_is_zero(p + i, n * sizeof(*p))) {
+            continue;
+        }
+
+        for (j = i; j < i + n; j++) {
+            unsigned long mask = ~0UL;
+
+            if (j == 0) {
+                mask &= BITMAP_FIRST_WORD_MASK(shift);
+            }
+            if (j == nwords - 1) {
+                mask &= BITMAP_LAST_WORD_MASK(shift + nr);
+            }
+            if (!(qatomic_read(&p[j]) & mask)) {
+                continue;
+            }
+
+            if (!words) {
+                words = bitmap_new(nwords * BITS_PER_LONG);
+            }
+            if (mask == ~0UL) {
+                words[j] = qatomic_xchg(&p[j], 0);
+            } else {
+                words[j] = qatomic_fetch_and(&p[j], ~mask) & mask;
+            }
+        }
+    }
+
+    if (!words || !shift) {
+        return words;
+    }
+
+    bitmap = bitmap_new(nr);
+    bitmap_copy_with_src_offset(bitmap, words, shift, nr);
+    g_free(words);
+    return bitmap;
+}
+
 #define ALIGN_MASK(x,mask)      (((x)+(mask))&~(mask))
 
 /**
@@ -401,21 +475,6 @@ int slow_bitmap_intersects(const unsigned long *bitmap1,
     return 0;
 }
 
-long slow_bitmap_count_one(const unsigned long *bitmap, long nbits)
-{
-    long k, lim = nbits / BITS_PER_LONG, result = 0;
-
-    for (k = 0; k < lim; k++) {
-        result += ctpopl(bitmap[k]);
-    }
-
-    if (nbits % BITS_PER_LONG) {
-        result += ctpopl(bitmap[k] & BITMAP_LAST_WORD_MASK(nbits));
-    }
-
-    return result;
-}
-
 static void bitmap_to_from_le(unsigned long *dst,
                               const unsigned long *src, long nbits)
 {
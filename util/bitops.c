@@ -13,6 +13,226 @@
 
 #include "qemu/osdep.h"
 #include "qemu/bitops.h"
+#include "qemu/bitmap.h"
+
+/*
+ * Dirty bitmaps for migration and vhost logging cover all of guest RAM and
+ * are often almost empty (or almost full), so searching them is mostly a
+ * matter of skipping long runs of identical words.  When the host has
+ * AVX2 or AVX-512, these runs and the population count of large bitmaps
+ * are handled with vector instructions.
+ */
+
+/* Below this many bits, the vector code is not worth the indirect call. */
+#define BITOPS_ACCEL_MIN_BITS   (16 * BITS_PER_LONG)
+
+static unsigned long skip_words_int(const unsigned long *p, unsigned long n,
+                                    unsigned long fill)
+{
+    return 0;
+}
+
+static unsigned long count_words_int(const unsigned long *p, unsigned long n)
+{
+    unsigned long i, result = 0;
+
+    for (i = 0; i < n; i++) {
+        result += ctpopl(p[i]);
+    }
+    return result;
+}
+
+#if defined(CONFIG_AVX512F_OPT) || defined(CONFIG_AVX2_OPT)
+#include <immintrin.h>
+
+/*
+ * The skip_words functions return a number of leading words of @p, at most
+ * @n, that are all equal to @fill (either 0 or ~0UL).  They may stop
+ * before the first word that differs; the caller looks at the remaining
+ * words one by one.
+ *
+ * The count_words functions return the number of bits set in the first
+ * @n words of @p.
+ */
+
+#ifdef CONFIG_AVX2_OPT
+#define LONGS_PER_M256  (sizeof(__m256i) / sizeof(unsigned long))
+
+static unsigned long __attribute__((target("avx2")))
+skip_words_avx2(const unsigned long *p, unsigned long n, unsigned long fill)
+{
+    __m256i f = _mm256_set1_epi64x(fill ? -1 : 0);
+    unsigned long i;
+
+    /* Compare 512 bits per iteration.  */
+    for (i = 0; i + 2 * LONGS_PER_M256 <= n; i += 2 * LONGS_PER_M256) {
+        __m256i t = _mm256_loadu_si256((const __m256i *)(p + i)) ^ f;
+
+        t |= _mm256_loadu_si256((const __m256i *)(p + i + LONGS_PER_M256)) ^ f;
+        if (!_mm256_testz_si256(t, t)) {
+            break;
+        }
+    }
+    return i;
+}
+
+static unsigned long __attribute__((target("avx2")))
+count_words_avx2(const unsigned long *p, unsigned long n)
+{
+    /* Look up the population count of each nibble with vpshufb.  */
+    const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3,
+                                         1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3,
+                                         1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    __m256i acc = _mm256_setzero_si256();
+    uint64_t lanes[4];
+    unsigned long i, result;
+
+    for (i = 0; i + LONGS_PER_M256 <= n; i += LONGS_PER_M256) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i lo = _mm256_shuffle_epi8(lut, v & nibble);
+        __m256i hi = _mm256_shuffle_epi8(lut, _mm256_srli_epi16(v, 4) & nibble);
+
+        /* Sum the bytes of each 64-bit lane.  */
+        acc = _mm256_add_epi64(acc,
+                               _mm256_sad_epu8(_mm256_add_epi8(lo, hi),
+                                               _mm256_setzero_si256()));
+    }
+
+    _mm256_storeu_si256((__m256i *)lanes, acc);
+    result = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    return result + count_words_int(p + i, n - i);
+}
+#endif /* CONFIG_AVX2_OPT */
+
+#ifdef CONFIG_AVX512F_OPT
+#define LONGS_PER_M512  (sizeof(__m512i) / sizeof(unsigned long))
+
+static unsigned long __attribute__((target("avx512f")))
+skip_words_avx512(const unsigned long *p, unsigned long n, unsigned long fill)
+{
+    __m512i f = _mm512_set1_epi64(fill ? -1 : 0);
+    unsigned long i;
+
+    /* Compare 1024 bits per iteration.  */
+    for (i = 0; i + 2 * LONGS_PER_M512 <= n; i += 2 * LONGS_PER_M512) {
+        __m512i t = _mm512_xor_si512(_mm512_loadu_si512(p + i), f);
+
+        t = _mm512_or_si512(t, _mm512_xor_si512(
+                                   _mm512_loadu_si512(p + i + LONGS_PER_M512),
+                                   f));
+        if (_mm512_test_epi64_mask(t, t)) {
+            break;
+        }
+    }
+    return i;
+}
+#endif /* CONFIG_AVX512F_OPT */
+
+#ifdef CONFIG_AVX512VPOPCNTDQ_OPT
+static unsigned long __attribute__((target("avx512f,avx512vpopcntdq")))
+count_words_avx512(const unsigned long *p, unsigned long n)
+{
+    __m512i acc = _mm512_setzero_si512();
+    unsigned long i;
+
+    for (i = 0; i + LONGS_PER_M512 <= n; i += LONGS_PER_M512) {
+        acc = _mm512_add_epi64(acc,
+                               _mm512_popcnt_epi64(_mm512_loadu_si512(p + i)));
+    }
+    return _mm512_reduce_add_epi64(acc) + count_words_int(p + i, n - i);
+}
+#endif /* CONFIG_AVX512VPOPCNTDQ_OPT */
+
+/* Note that for test_bitops_next_accel, the most preferred
+ * ISA must have the least significant bit.
+ */
+#define CACHE_AVX512VPOPCNTDQ   1
+#define CACHE_AVX512F           2
+#define CACHE_AVX2              4
+
+static unsigned cpuid_cache;
+static unsigned long (*skip_words_accel)(const unsigned long *, unsigned long,
+                                         unsigned long) = skip_words_int;
+static unsigned long (*count_words_accel)(const unsigned long *,
+                                          unsigned long) = count_words_int;
+
+static void init_accel(unsigned cache)
+{
+    skip_words_accel = skip_words_int;
+    count_words_accel = count_words_int;
+#ifdef CONFIG_AVX2_OPT
+    if (cache & CACHE_AVX2) {
+        skip_words_accel = skip_words_avx2;
+        count_words_accel = count_words_avx2;
+    }
+#endif
+#ifdef CONFIG_AVX512F_OPT
+    if (cache & CACHE_AVX512F) {
+        skip_words_accel = skip_words_avx512;
+    }
+#endif
+#ifdef CONFIG_AVX512VPOPCNTDQ_OPT
+    if (cache & CACHE_AVX512VPOPCNTDQ) {
+        count_words_accel = count_words_avx512;
+    }
+#endif
+}
+
+#include "qemu/cpuid.h"
+
+static void __attribute__((constructor)) init_cpuid_cache(void)
+{
+    unsigned max = __get_cpuid_max(0, NULL);
+    int a, b, c, d;
+    unsigned cache = 0;
+
+    if (max >= 7) {
+        __cpuid(1, a, b, c, d);
+
+        /* We must check that AVX is not just available, but usable.  */
+        if ((c & bit_OSXSAVE) && (c & bit_AVX)) {
+            int bv;
+            __asm("xgetbv" : "=a"(bv), "=d"(d) : "c"(0));
+            __cpuid_count(7, 0, a, b, c, d);
+            if ((bv & 0x6) == 0x6 && (b & bit_AVX2)) {
+                cache |= CACHE_AVX2;
+            }
+            /* See util/bufferiszero.c for the meaning of 0xe6.  */
+            if ((bv & 0xe6) == 0xe6 && (b & bit_AVX512F)) {
+                cache |= CACHE_AVX512F;
+                if (c & bit_AVX512VPOPCNTDQ) {
+                    cache |= CACHE_AVX512VPOPCNTDQ;
+                }
+            }
+        }
+    }
+    cpuid_cache = cache;
+    init_accel(cache);
+}
+
+bool test_bitops_next_accel(void)
+{
+    /* If no bits set, we just tested the integer functions, and there
+       are no more acceleration options to test.  */
+    if (cpuid_cache == 0) {
+        return false;
+    }
+    /* Disable the accelerator we used before and select a new one.  */
+    cpuid_cache &= cpuid_cache - 1;
+    init_accel(cpuid_cache);
+    return true;
+}
+
+#else
+#define skip_words_accel    skip_words_int
+#define count_words_accel   count_words_int
+bool test_bitops_next_accel(void)
+{
+    return false;
+}
+#endif
 
 /*
  * Find the next set bit in a memory region.
@@ -41,6 +261,13 @@ unsigned long find_next_bit(const unsigned long *addr, unsigned long size,
         size -= BITS_PER_LONG;
         result += BITS_PER_LONG;
     }
+    if (size >= BITOPS_ACCEL_MIN_BITS) {
+        unsigned long n = skip_words_accel(p, size / BITS_PER_LONG, 0);
+
+        p += n;
+        result += n * BITS_PER_LONG;
+        size -= n * BITS_PER_LONG;
+    }
     while (size >= 4*BITS_PER_LONG) {
         unsigned long d1, d2, d3;
         tmp = *p;
@@ -106,6 +333,13 @@ unsigned long find_next_zero_bit(const unsigned long *addr, unsigned long size,
         size -= BITS_PER_LONG;
         result += BITS_PER_LONG;
     }
+    if (size >= BITOPS_ACCEL_MIN_BITS) {
+        unsigned long n = skip_words_accel(p, size / BITS_PER_LONG, ~0UL);
+
+        p += n;
+        result += n * BITS_PER_LONG;
+        size -= n * BITS_PER_LONG;
+    }
     while (size & ~(BITS_PER_LONG-1)) {
         if (~(tmp = *(p++))) {
             goto found_middle;
@@ -155,3 +389,24 @@ unsigned long find_last_bit(const unsigned long *addr, unsigned long size)
     /* Not found */
     return size;
 }
+
+/*
+ * This lives here rather than in util/bitmap.c so that it can use the
+ * same accelerated functions as the searches above.
+ */
+long slow_bitmap_count_one(const unsigned long *bitmap, long nbits)
+{
+    long lim = nbits / BITS_PER_LONG, result;
+
+    if (nbits >= BITOPS_ACCEL_MIN_BITS) {
+        result = count_words_accel(bitmap, lim);
+    } else {
+        result = count_words_int(bitmap, lim);
+    }
+
+    if (nbits % BITS_PER_LONG) {
+        result += ctpopl(bitmap[lim] & BITMAP_LAST_WORD_MASK(nbits));
+    }
+
+    return result;
+}
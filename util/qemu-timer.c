@@ -26,6 +26,7 @@
 #include "qemu/main-loop.h"
 #include "qemu/timer.h"
 #include "qemu/lockable.h"
+#include "qemu/stats64.h"
 #include "sysemu/cpu-timers.h"
 #include "sysemu/replay.h"
 #include "sysemu/cpus.h"
@@ -73,6 +74,10 @@ struct QEMUTimerList {
 
     /* lightweight method to mark the end of timerlist's running */
     QemuEvent timers_done_ev;
+
+    /* see timerlistgroup_get_stats() */
+    Stat64 timers_run;
+    Stat64 lateness[QEMU_TIMER_LATENESS_BUCKETS];
 };
 
 /**
@@ -498,6 +503,15 @@ bool timer_expired(QEMUTimer *timer_head, int64_t current_time)
     return timer_expired_ns(timer_head, current_time * timer_head->scale);
 }
 
+static void timerlist_account_run(QEMUTimerList *timer_list, int64_t late_ns)
+{
+    int bucket = late_ns > 0 ? 64 - clz64(late_ns) : 0;
+
+    stat64_add(&timer_list->timers_run, 1);
+    stat64_add(&timer_list->lateness[MIN(bucket,
+                                         QEMU_TIMER_LATENESS_BUCKETS - 1)], 1);
+}
+
 bool timerlist_run_timers(QEMUTimerList *timer_list)
 {
     QEMUTimer *ts;
@@ -567,6 +581,7 @@ bool timerlist_run_timers(QEMUTimerList *timer_list)
         /* remove timer from the list before calling the callback */
         timer_list->active_timers = ts->next;
         ts->next = NULL;
+        timerlist_account_run(timer_list, current_time - ts->expire_time);
         ts->expire_time = -1;
         cb = ts->cb;
         opaque = ts->opaque;
@@ -617,6 +632,24 @@ bool timerlistgroup_run_timers(QEMUTimerListGroup *tlg)
     return progress;
 }
 
+void timerlistgroup_get_stats(QEMUTimerListGroup *tlg, uint64_t *timers_run,
+                              uint64_t *lateness)
+{
+    QEMUClockType type;
+    int i;
+
+    *timers_run = 0;
+    memset(lateness, 0, QEMU_TIMER_LATENESS_BUCKETS * sizeof(*lateness));
+    for (type = 0; type < QEMU_CLOCK_MAX; type++) {
+        QEMUTimerList *timer_list = tlg->tl[type];
+
+        *timers_run += stat64_get(&timer_list->timers_run);
+        for (i = 0; i < QEMU_TIMER_LATENESS_BUCKETS; i++) {
+            lateness[i] += stat64_get(&timer_list->lateness[i]);
+        }
+    }
+}
+
 int64_t timerlistgroup_deadline_ns(QEMUTimerListGroup *tlg)
 {
     int64_t deadline = -1;
@@ -48,6 +48,12 @@ struct ThreadPoolElement {
     /* Access to this list is protected by lock.  */
     QTAILQ_ENTRY(ThreadPoolElement) reqs;
 
+    /* Lock-free list of completed requests, filled by the workers.  */
+    QSLIST_ENTRY(ThreadPoolElement) completed;
+
+    /* Only accessed from the AioContext of the pool.  */
+    QSIMPLEQ_ENTRY(ThreadPoolElement) done;
+
     /* Access to this list is protected by the global mutex.  */
     QLIST_ENTRY(ThreadPoolElement) all;
 };
@@ -60,8 +66,12 @@ struct ThreadPool {
     QemuCond request_cond;
     QEMUBH *new_thread_bh;
 
+    /* Completed requests, most recent first.  Accessed atomically.  */
+    QSLIST_HEAD(, ThreadPoolElement) completed;
+
     /* The following variables are only accessed from one AioContext. */
     QLIST_HEAD(, ThreadPoolElement) head;
+    QSIMPLEQ_HEAD(, ThreadPoolElement) done;
 
     /* The following variables are protected by lock.  */
     QTAILQ_HEAD(, ThreadPoolElement) request_list;
@@ -73,6 +83,19 @@ struct ThreadPool {
     int max_threads;
 };
 
+/* Hand a request that is done over to the completion BH */
+static void thread_pool_complete_request(ThreadPool *pool,
+                                         ThreadPoolElement *req, int ret)
+{
+    req->ret = ret;
+    /* Write ret before state.  */
+    smp_wmb();
+    req->state = THREAD_DONE;
+
+    QSLIST_INSERT_HEAD_ATOMIC(&pool->completed, req, completed);
+    qemu_bh_schedule(pool->completion_bh);
+}
+
 static void *worker_thread(void *opaque)
 {
     ThreadPool *pool = opaque;
@@ -108,13 +131,8 @@ static void *worker_thread(void *opaque)
         qemu_mutex_unlock(&pool->lock);
 
         ret = req->func(req->arg);
+        thread_pool_complete_request(pool, req, ret);
 
-        req->ret = ret;
-        /* Write ret before state.  */
-        smp_wmb();
-        req->state = THREAD_DONE;
-
-        qemu_bh_schedule(pool->completion_bh);
         qemu_mutex_lock(&pool->lock);
     }
 
@@ -170,17 +188,35 @@ static void spawn_thread(ThreadPool *pool)
     }
 }
 
+/*
+ * Move the requests that the workers completed to pool->done, in the order
+ * in which they completed.
+ */
+static void thread_pool_collect_completed(ThreadPool *pool)
+{
+    QSLIST_HEAD(, ThreadPoolElement) completed;
+    QSIMPLEQ_HEAD(, ThreadPoolElement) batch =
+        QSIMPLEQ_HEAD_INITIALIZER(batch);
+    ThreadPoolElement *elem;
+
+    QSLIST_MOVE_ATOMIC(&completed, &pool->completed);
+    while ((elem = QSLIST_FIRST(&completed))) {
+        QSLIST_REMOVE_HEAD(&completed, completed);
+        QSIMPLEQ_INSERT_HEAD(&batch, elem, done);
+    }
+    QSIMPLEQ_CONCAT(&pool->done, &batch);
+}
+
 static void thread_pool_completion_bh(void *opaque)
 {
     ThreadPool *pool = opaque;
-    ThreadPoolElement *elem, *next;
+    ThreadPoolElement *elem;
 
     aio_context_acquire(pool->ctx);
-restart:
-    QLIST_FOREACH_SAFE(elem, &pool->head, all, next) {
-        if (elem->state != THREAD_DONE) {
-            continue;
-        }
+    thread_pool_collect_completed(pool);
+    while ((elem = QSIMPLEQ_FIRST(&pool->done))) {
+        QSIMPLEQ_REMOVE_HEAD(&pool->done, done);
+        assert(elem->state == THREAD_DONE);
 
         trace_thread_pool_complete(pool, elem, elem->common.opaque,
                                    elem->ret);
@@ -200,13 +236,13 @@ restart:
             aio_context_acquire(pool->ctx);
 
             /* We can safely cancel the completion_bh here regardless of someone
-             * else having scheduled it meanwhile because we reenter the
-             * completion function anyway (goto restart).
+             * else having scheduled it meanwhile because we pick up the
+             * requests that completed in the meantime right away.
              */
             qemu_bh_cancel(pool->completion_bh);
+            thread_pool_collect_completed(pool);
 
             qemu_aio_unref(elem);
-            goto restart;
         } else {
             qemu_aio_unref(elem);
         }
@@ -224,12 +260,8 @@ static void thread_pool_cancel(BlockAIOCB *acb)
     QEMU_LOCK_GUARD(&pool->lock);
     if (elem->state == THREAD_QUEUED) {
         QTAILQ_REMOVE(&pool->request_list, elem, reqs);
-        qemu_bh_schedule(pool->completion_bh);
-
-        elem->state = THREAD_DONE;
-        elem->ret = -ECANCELED;
+        thread_pool_complete_request(pool, elem, -ECANCELED);
     }
-
 }
 
 static AioContext *thread_pool_get_aio_context(BlockAIOCB *acb)
@@ -340,7 +372,9 @@ static void thread_pool_init_one(ThreadPool *pool, AioContext *ctx)
     qemu_cond_init(&pool->request_cond);
     pool->new_thread_bh = aio_bh_new(ctx, spawn_thread_bh_fn, pool);
 
+    QSLIST_INIT(&pool->completed);
     QLIST_INIT(&pool->head);
+    QSIMPLEQ_INIT(&pool->done);
     QTAILQ_INIT(&pool->request_list);
 
     thread_pool_update_params(pool, ctx);
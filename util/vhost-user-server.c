@@ -239,6 +239,47 @@ static void kick_handler(void *opaque)
     }
 }
 
+/*
+ * libvhost-user only watches kick fds, with the virtqueue index as @pvt.
+ * When the AioContext polls, check the available ring directly instead of
+ * waiting for the guest to kick.  Only report progress if kick_poll_ready()
+ * has a handler to run, or the AioContext would spin until poll-max-ns.
+ */
+static bool kick_poll(void *opaque)
+{
+    VuFdWatch *vu_fd_watch = opaque;
+    VuDev *vu_dev = vu_fd_watch->vu_dev;
+    int index = (intptr_t)vu_fd_watch->pvt;
+    VuVirtq *vq;
+
+    if (vu_dev->broken) {
+        return false;
+    }
+
+    vq = vu_get_queue(vu_dev, index);
+    return vq->handler && vu_queue_started(vu_dev, vq) &&
+           !vu_queue_empty(vu_dev, vq);
+}
+
+static void kick_poll_ready(void *opaque)
+{
+    VuFdWatch *vu_fd_watch = opaque;
+    VuDev *vu_dev = vu_fd_watch->vu_dev;
+    int index = (intptr_t)vu_fd_watch->pvt;
+    VuVirtq *vq = vu_get_queue(vu_dev, index);
+
+    /* The kick, if any, is consumed by kick_handler() later */
+    if (vq->handler) {
+        vq->handler(vu_dev, index);
+    }
+
+    if (vu_dev->broken) {
+        VuServer *server = container_of(vu_dev, VuServer, vu_dev);
+
+        qio_channel_shutdown(server->ioc, QIO_CHANNEL_SHUTDOWN_BOTH, NULL);
+    }
+}
+
 static VuFdWatch *find_vu_fd_watch(VuServer *server, int fd)
 {
 
@@ -272,7 +313,7 @@ set_watch(VuDev *vu_dev, int fd, int vu_evt,
         vu_fd_watch->cb = cb;
         qemu_socket_set_nonblock(fd);
         aio_set_fd_handler(server->ioc->ctx, fd, true, kick_handler,
-                           NULL, NULL, NULL, vu_fd_watch);
+                           NULL, kick_poll, kick_poll_ready, vu_fd_watch);
         vu_fd_watch->vu_dev = vu_dev;
         vu_fd_watch->pvt = pvt;
     }
@@ -400,7 +441,7 @@ void vhost_user_server_attach_aio_context(VuServer *server, AioContext *ctx)
 
     QTAILQ_FOREACH(vu_fd_watch, &server->vu_fd_watches, next) {
         aio_set_fd_handler(ctx, vu_fd_watch->fd, true, kick_handler, NULL,
-                           NULL, NULL, vu_fd_watch);
+                           kick_poll, kick_poll_ready, vu_fd_watch);
     }
 
     aio_co_schedule(ctx, server->co_trip);